@@ -0,0 +1,297 @@
+// ----------------------------------------------------------------------------
+// curvatureAccuracyBench.cpp
+//
+// Accuracy versus cost of the principal curvature estimators. Icospheres and
+// tori of increasing resolution are refined by 0 to -s levels of Loop
+// subdivision, then every estimator runs on them and is compared to the exact
+// curvature of an analytic surface at the vertices (SyntheticMesh.h).
+//
+// Loop subdivision shrinks the mesh: a subdivided mesh is compared to the
+// sphere or torus fitted to its own vertices, by least squares, rather than to
+// the generated one. The shrink column gives the relative change of the
+// fitted radius (the tube radius of a torus). What remains is the distance of
+// the Loop limit surface to that sphere or torus, which has no closed form.
+//
+// Usage: curvatureAccuracyBench [-s <max subdivision levels>] [-n <max triangles>]
+//                               [-a <target error>] [-d <target direction error>]
+//                               [-r <repetitions>]
+//
+// For every configuration, the table gives the RMS and max error of kappa1 and
+// kappa2, the RMS and max angle between the estimated and exact first
+// principal directions (outside umbilics), the cost (subdivision from the
+// generated mesh plus estimation, best of the repetitions) and the memory:
+// the mesh attributes plus the heap bytes allocated by one estimation. The
+// configurations are ranked on two errors: the error column, relative RMS
+// error over both curvatures, and the RMS direction error, on which the
+// radial curvature depends as much.
+//
+// Per shape, the configurations are listed by increasing cost, the Pareto
+// optimal ones (more accurate than every cheaper one in either error) marked
+// with '*', followed by the cheapest configuration whose errors are below
+// both targets (default 5% and 5 degrees).
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+#include "SyntheticMesh.h"
+#include "ThreadPool.h"
+
+// Heap bytes allocated since start-up: every operator new goes through this
+namespace {
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+void *countedAllocation(size_t size)
+{
+  g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if(void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+} // namespace
+
+void *operator new(size_t size) { return countedAllocation(size); }
+void *operator new[](size_t size) { return countedAllocation(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+const size_t kBaseTriangles[] = {320, 1280, 5120, 20480, 81920};
+
+struct Configuration {
+  SyntheticShape shape;
+  size_t baseTriangles, triangles;
+  unsigned int levels;
+  CurvatureEstimator estimator;
+  double kappa1Rms, kappa1Max, kappa2Rms, kappa2Max;
+  double directionRms, directionMax; // degrees
+  double error;                      // relative RMS error of both curvatures
+  double shrink;                     // relative change of the fitted radius from the generated one
+  double subdivisionMs, estimationMs;
+  double meshMiB, estimationMiB;
+  double costMs() const { return subdivisionMs + estimationMs; }
+};
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Positions, normals, texture coordinates, triangles and the four curvature attributes
+double meshMiB(const Mesh &mesh)
+{
+  const size_t V = mesh.vertexPositions().size(), T = mesh.triangleIndices().size();
+  return (V*(3*sizeof(glm::vec3) + sizeof(glm::vec2) + 2*sizeof(float)) + T*sizeof(glm::uvec3))/1048576.0;
+}
+
+void measureErrors(const Mesh &mesh, const CurvatureGroundTruth &truth, Configuration &c)
+{
+  const std::vector<float> &k1 = mesh.principalCurvatures1(), &k2 = mesh.principalCurvatures2();
+  const std::vector<glm::vec3> &d1 = mesh.principalDirections1();
+  double sum1 = 0.0, sum2 = 0.0, sumTruth = 0.0, sumAngle = 0.0;
+  size_t directions = 0;
+  c.kappa1Max = c.kappa2Max = c.directionMax = 0.0;
+  for(size_t v = 0; v < k1.size(); ++v) {
+    const double e1 = k1[v] - truth.kappa1[v], e2 = k2[v] - truth.kappa2[v];
+    sum1 += e1*e1;
+    sum2 += e2*e2;
+    sumTruth += double(truth.kappa1[v])*truth.kappa1[v] + double(truth.kappa2[v])*truth.kappa2[v];
+    c.kappa1Max = std::max(c.kappa1Max, std::abs(e1));
+    c.kappa2Max = std::max(c.kappa2Max, std::abs(e2));
+    // Directions are defined up to their sign, and only away from umbilics
+    const float length = glm::length(d1[v]);
+    if(truth.direction1[v] != glm::vec3(0.f) && length > 0.f) {
+      const double cosine = std::min(1.0, std::abs(double(glm::dot(d1[v]/length, truth.direction1[v]))));
+      const double angle = glm::degrees(std::acos(cosine));
+      sumAngle += angle*angle;
+      c.directionMax = std::max(c.directionMax, angle);
+      ++directions;
+    }
+  }
+  const size_t n = std::max<size_t>(1, k1.size());
+  c.kappa1Rms = std::sqrt(sum1/n);
+  c.kappa2Rms = std::sqrt(sum2/n);
+  c.error = sumTruth > 0.0 ? std::sqrt((sum1 + sum2)/sumTruth) : 0.0;
+  c.directionRms = directions ? std::sqrt(sumAngle/directions) : 0.0;
+}
+
+// Sphere or torus fitted to the vertices of the mesh, starting from the generated one: Gauss-Newton
+// on the distances to the surface. Returns the parameters with the fitted radii.
+SyntheticMeshParameters fitSurface(const SyntheticMeshParameters &parameters, const Mesh &mesh)
+{
+  SyntheticMeshParameters fitted = parameters;
+  const std::vector<glm::vec3> &P = mesh.vertexPositions();
+  if(P.empty())
+    return fitted;
+  if(parameters.shape != SyntheticShape::Torus) {
+    double sum = 0.0;
+    for(const glm::vec3 &p : P)
+      sum += glm::length(p);
+    fitted.radius = static_cast<float>(sum/P.size());
+    return fitted;
+  }
+  // Residual d - r, with d the distance to the core circle of radius R
+  double R = parameters.radius, r = parameters.minorRadius;
+  for(int iteration = 0; iteration < 8; ++iteration) {
+    double jRR = 0.0, jRr = 0.0, jrr = 0.0, gR = 0.0, gr = 0.0;
+    for(const glm::vec3 &p : P) {
+      const double rho = std::sqrt(double(p.x)*p.x + double(p.z)*p.z) - R;
+      const double d = std::max(1e-12, std::sqrt(rho*rho + double(p.y)*p.y));
+      const double residual = d - r, dR = -rho/d, dr = -1.0;
+      jRR += dR*dR;
+      jRr += dR*dr;
+      jrr += dr*dr;
+      gR += dR*residual;
+      gr += dr*residual;
+    }
+    const double determinant = jRR*jrr - jRr*jRr;
+    if(std::abs(determinant) < 1e-30)
+      break;
+    R -= (jrr*gR - jRr*gr)/determinant;
+    r -= (jRR*gr - jRr*gR)/determinant;
+  }
+  fitted.radius = static_cast<float>(R);
+  fitted.minorRadius = static_cast<float>(r);
+  return fitted;
+}
+
+void printTable(SyntheticShape shape, std::vector<Configuration> configurations, double target,
+                double directionTarget)
+{
+  std::stable_sort(configurations.begin(), configurations.end(),
+                   [](const Configuration &a, const Configuration &b) { return a.costMs() < b.costMs(); });
+  std::cout << " > " << syntheticShapeName(shape) << std::endl;
+  std::cout << "   " << std::setw(16) << "estimator" << std::setw(7) << "base" << std::setw(4) << "lvl" << std::setw(10)
+            << "triangles" << std::setw(10) << "k1 rms" << std::setw(10) << "k1 max" << std::setw(10) << "k2 rms"
+            << std::setw(10) << "k2 max" << std::setw(9) << "dir rms" << std::setw(9) << "dir max" << std::setw(9)
+            << "error" << std::setw(9) << "shrink" << std::setw(11) << "cost ms" << std::setw(11) << "(estim.)" << std::setw(10) << "mesh MiB"
+            << std::setw(11) << "estim. MiB" << std::endl;
+  const Configuration *cheapest = nullptr;
+  for(size_t i = 0; i < configurations.size(); ++i) {
+    const Configuration &c = configurations[i];
+    bool pareto = true;
+    for(size_t j = 0; j < i && pareto; ++j)
+      pareto = !(configurations[j].error <= c.error && configurations[j].directionRms <= c.directionRms);
+    if(!cheapest && c.error <= target && c.directionRms <= directionTarget)
+      cheapest = &c;
+    std::cout << (pareto ? " * " : "   ") << std::setw(16) << curvatureEstimatorName(c.estimator) << std::setw(7)
+              << c.baseTriangles << std::setw(4) << c.levels << std::setw(10) << c.triangles << std::fixed
+              << std::setprecision(4) << std::setw(10) << c.kappa1Rms << std::setw(10) << c.kappa1Max << std::setw(10)
+              << c.kappa2Rms << std::setw(10) << c.kappa2Max << std::setprecision(1) << std::setw(9) << c.directionRms
+              << std::setw(9) << c.directionMax << std::setprecision(2) << std::setw(8) << 100.0*c.error << "%"
+              << std::setw(8) << 100.0*c.shrink << "%" << std::setprecision(1) << std::setw(11) << c.costMs() << std::setw(11) << c.estimationMs << std::setw(10)
+              << c.meshMiB << std::setw(11) << c.estimationMiB << std::endl;
+  }
+  if(cheapest)
+    std::cout << " > Cheapest below " << 100.0*target << "% error and " << directionTarget << " degrees: " << curvatureEstimatorName(cheapest->estimator)
+              << " on " << cheapest->baseTriangles << " triangles subdivided " << cheapest->levels << " times, "
+              << cheapest->costMs() << " ms" << std::endl;
+  else
+    std::cout << " > No configuration below " << 100.0*target << "% error and " << directionTarget << " degrees"
+              << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  unsigned int maxLevels = 3;
+  size_t maxTriangles = 2000000;
+  double target = 0.05;
+  double directionTarget = 5.0;
+  unsigned int repetitions = 3;
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if(arg == "-s" && i + 1 < argc)
+      maxLevels = static_cast<unsigned int>(std::atoi(argv[++i]));
+    else if(arg == "-n" && i + 1 < argc)
+      maxTriangles = static_cast<size_t>(std::max(1.0, std::atof(argv[++i])));
+    else if(arg == "-a" && i + 1 < argc)
+      target = std::atof(argv[++i]);
+    else if(arg == "-d" && i + 1 < argc)
+      directionTarget = std::atof(argv[++i]);
+    else if(arg == "-r" && i + 1 < argc)
+      repetitions = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+    else {
+      std::cerr << "Usage: " << argv[0] << " [-s <max subdivision levels>] [-n <max triangles>] [-a <target error>]"
+                << " [-d <target direction error>] [-r <repetitions>]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The subdivision reports its progress: keep the tables readable
+  std::ostringstream quiet;
+  std::streambuf *cout = std::cout.rdbuf(quiet.rdbuf());
+  std::vector<std::vector<Configuration>> tables;
+  const SyntheticShape shapes[] = {SyntheticShape::Icosphere, SyntheticShape::Torus};
+  for(SyntheticShape shape : shapes) {
+    tables.emplace_back();
+    for(size_t base : kBaseTriangles) {
+      if(base > maxTriangles)
+        break;
+      SyntheticMeshParameters parameters;
+      parameters.shape = shape;
+      parameters.triangles = base;
+      Mesh mesh;
+      generateSyntheticMesh(parameters, mesh);
+      const size_t generated = mesh.triangleIndices().size();
+      double subdivisionMs = 0.0;
+      for(unsigned int level = 0; level <= maxLevels && mesh.triangleIndices().size() <= maxTriangles; ++level) {
+        if(level > 0) {
+          const auto start = std::chrono::steady_clock::now();
+          mesh.subdivideLoop();
+          subdivisionMs += elapsedMs(start);
+          if(mesh.triangleIndices().size() > maxTriangles)
+            break;
+        }
+        const SyntheticMeshParameters fitted = level > 0 ? fitSurface(parameters, mesh) : parameters;
+        const double shrink = (parameters.shape == SyntheticShape::Torus)
+                                  ? fitted.minorRadius/parameters.minorRadius - 1.0 : fitted.radius/parameters.radius - 1.0;
+        CurvatureGroundTruth truth;
+        computeCurvatureGroundTruth(fitted, mesh, truth);
+        for(CurvatureEstimator estimator : {CurvatureEstimator::TriangleTensor, CurvatureEstimator::LeastSquares}) {
+          Configuration c;
+          c.shape = shape;
+          c.baseTriangles = generated;
+          c.triangles = mesh.triangleIndices().size();
+          c.levels = level;
+          c.shrink = shrink;
+          c.estimator = estimator;
+          c.subdivisionMs = subdivisionMs;
+          mesh.setCurvatureEstimator(estimator);
+          c.estimationMs = 1e30;
+          for(unsigned int r = 0; r < repetitions; ++r) {
+            const uint64_t allocated = g_allocatedBytes.load();
+            const auto start = std::chrono::steady_clock::now();
+            mesh.calculatePrincipalCurvature();
+            c.estimationMs = std::min(c.estimationMs, elapsedMs(start));
+            c.estimationMiB = (g_allocatedBytes.load() - allocated)/1048576.0;
+          }
+          c.meshMiB = meshMiB(mesh);
+          measureErrors(mesh, truth, c);
+          tables.back().push_back(c);
+        }
+      }
+    }
+  }
+  std::cout.rdbuf(cout);
+
+  std::cout << " > Curvature accuracy versus cost, " << ThreadPool::threadCount() << " threads" << std::endl;
+  for(size_t s = 0; s < tables.size(); ++s)
+    printTable(shapes[s], tables[s], target, directionTarget);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+// ----------------------------------------------------------------------------
+// meshOrderBench.cpp
+//
+// Compares the vertex orders (file, Morton, Hilbert) and triangle orders (file,
+// Tipsify, Tipsify with overdraw clusters) on the per-frame contour pipeline:
+// wall-clock time of the pipeline and of its gather-heavy kernels, cache misses
+// of their per-vertex accesses replayed through a simulated L1 (32 KiB) and
+// L2 (1 MiB) cache, and ACMR/ATVR of the triangle order on a 16 and a 32 entry
+// FIFO post-transform vertex cache.
+//
+// Usage: meshOrderBench [-s <subdivision levels>] [-r <repetitions>] [<file.off>]
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ContourExtractor.h"
+#include "ContourPipeline.h"
+#include "Mesh.h"
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Fn>
+double bestOf(unsigned int repetitions, const Fn &fn)
+{
+  double best = 1e30;
+  for(unsigned int r = 0; r < repetitions; ++r) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, elapsedMs(start));
+  }
+  return best;
+}
+
+// Set-associative cache with 64-byte lines and LRU replacement
+class CacheSimulator {
+public:
+  CacheSimulator(size_t bytes, unsigned int ways) : _ways(ways), _sets(bytes/(64*ways)), _tags(_sets*ways, ~uint64_t(0)) {}
+
+  void access(const void *address, size_t bytes) {
+    const uint64_t first = reinterpret_cast<uintptr_t>(address) >> 6;
+    const uint64_t last = (reinterpret_cast<uintptr_t>(address) + bytes - 1) >> 6;
+    for(uint64_t line = first; line <= last; ++line)
+      accessLine(line);
+  }
+  uint64_t misses() const { return _misses; }
+
+private:
+  void accessLine(uint64_t line) {
+    uint64_t *set = &_tags[(line % _sets)*_ways];
+    unsigned int hit = _ways;
+    for(unsigned int w = 0; w < _ways; ++w)
+      if(set[w] == line)
+        hit = w;
+    if(hit == _ways) {
+      ++_misses;
+      hit = _ways - 1;
+    }
+    // Most recently used first
+    for(unsigned int w = hit; w > 0; --w)
+      set[w] = set[w - 1];
+    set[0] = line;
+  }
+
+  unsigned int _ways;
+  size_t _sets;
+  std::vector<uint64_t> _tags;
+  uint64_t _misses = 0;
+};
+
+struct CacheMisses {
+  uint64_t l1 = 0, l2 = 0;
+};
+
+// Replays the per-vertex reads of a kernel through both caches
+template <typename Stream>
+CacheMisses simulate(const Stream &stream)
+{
+  CacheSimulator l1(32 << 10, 8), l2(1 << 20, 16);
+  stream([&](const void *address, size_t bytes) {
+    l1.access(address, bytes);
+    l2.access(address, bytes);
+  });
+  CacheMisses misses;
+  misses.l1 = l1.misses();
+  misses.l2 = l2.misses();
+  return misses;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  unsigned int levels = 3;
+  unsigned int repetitions = 3;
+  std::string filename = "data/apple.off";
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if(arg == "-s" && i + 1 < argc)
+      levels = static_cast<unsigned int>(std::atoi(argv[++i]));
+    else if(arg == "-r" && i + 1 < argc)
+      repetitions = std::max(1, std::atoi(argv[++i]));
+    else
+      filename = arg;
+  }
+
+  std::cout << std::setw(9) << "vertices" << std::setw(18) << "triangles" << std::setw(12) << "pipeline" << std::setw(12) << "curvature"
+            << std::setw(12) << "gradients" << std::setw(12) << "hysteresis" << "   (ms)"
+            << std::setw(12) << "L1 misses" << std::setw(12) << "L2 misses"
+            << std::setw(10) << "ACMR16" << std::setw(8) << "ATVR16" << std::setw(8) << "ACMR32" << std::setw(8) << "ATVR32"
+            << std::endl;
+
+  CacheMisses reference;
+  for(VertexOrder order : {VertexOrder::File, VertexOrder::Morton, VertexOrder::Hilbert})
+  for(TriangleOrder triangleOrder : {TriangleOrder::File, TriangleOrder::Tipsify, TriangleOrder::TipsifyOverdraw}) {
+    auto mesh = std::make_shared<Mesh>();
+    mesh->setVertexOrder(order);
+    mesh->setTriangleOrder(triangleOrder);
+    try {
+      loadOFF(filename, mesh);
+    } catch(std::exception &e) {
+      std::cerr << "> [Error loading mesh]" << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    for(unsigned int l = 0; l < levels; ++l)
+      mesh->subdivideLoop();
+    mesh->calculatePrincipalCurvature();
+
+    glm::vec3 center;
+    float radius;
+    mesh->computeBoundingSphere(center, radius);
+    const glm::vec3 eye = center + 3.f*radius*glm::vec3(0.3f, 0.4f, 0.866f);
+    mesh->calculateRadialCurvature(eye);
+
+    ContourExtractor extractor;
+    std::vector<ContourPolyline> polylines;
+    ContourPipeline pipeline;
+    pipeline.reset(*mesh, extractor, polylines);
+    pipeline.run(eye);
+
+    const SuggestiveContourThresholds thresholds;
+    const auto neighbors = mesh->computeOneRingNeighbors();
+    std::vector<glm::vec3> gradAccum;
+    std::vector<float> weightAccum;
+    mesh->computeTriangleGradientAccumulators(gradAccum, weightAccum);
+    const std::vector<float> dirDeriv = mesh->computeDirectionalDerivatives(gradAccum, weightAccum, eye);
+
+    const double pipelineMs = bestOf(repetitions, [&]() { pipeline.run(eye); });
+    const double curvatureMs = bestOf(repetitions, [&]() { mesh->calculatePrincipalCurvature(); });
+    const double gradientMs = bestOf(repetitions, [&]() {
+      gradAccum.assign(gradAccum.size(), glm::vec3(0.f));
+      weightAccum.assign(weightAccum.size(), 0.f);
+      mesh->accumulateTriangleGradients(0, static_cast<unsigned int>(mesh->triangleIndices().size()), gradAccum, weightAccum);
+    });
+    std::vector<int> eligibility;
+    const double hysteresisMs = bestOf(repetitions, [&]() {
+      eligibility = mesh->applyThresholdsAndHysteresis(dirDeriv, neighbors, thresholds.tHigh, thresholds.tLow,
+                                                       thresholds.thetaC, eye);
+    });
+
+    // Per-vertex reads of a frame: the triangle corners of the gradient accumulation (positions,
+    // radial curvatures, accumulators) and the one-rings walked by the hysteresis
+    const std::vector<glm::vec3> &positions = mesh->vertexPositions();
+    const std::vector<float> &radial = mesh->radialCurvatures();
+    const CacheMisses misses = simulate([&](const auto &read) {
+      for(const glm::uvec3 &tri : mesh->triangleIndices())
+        for(unsigned int k = 0; k < 3; ++k) {
+          read(&positions[tri[k]], sizeof(glm::vec3));
+          read(&radial[tri[k]], sizeof(float));
+          read(&gradAccum[tri[k]], sizeof(glm::vec3));
+        }
+      for(size_t v = 0; v < neighbors.size(); ++v)
+        for(unsigned int nb : neighbors[v])
+          read(&eligibility[nb], sizeof(int));
+    });
+    if(order == VertexOrder::File && triangleOrder == TriangleOrder::File)
+      reference = misses;
+    const VertexCacheStats fifo16 = vertexCacheStats(mesh->triangleIndices(), positions.size(), 16);
+    const VertexCacheStats fifo32 = vertexCacheStats(mesh->triangleIndices(), positions.size(), 32);
+
+    std::cout << std::setw(9) << vertexOrderName(order) << std::setw(18) << triangleOrderName(triangleOrder)
+              << std::fixed << std::setprecision(2)
+              << std::setw(12) << pipelineMs << std::setw(12) << curvatureMs
+              << std::setw(12) << gradientMs << std::setw(12) << hysteresisMs << "       "
+              << std::setw(12) << misses.l1 << std::setw(12) << misses.l2
+              << std::setw(10) << fifo16.acmr << std::setw(8) << fifo16.atvr
+              << std::setw(8) << fifo32.acmr << std::setw(8) << fifo32.atvr;
+    if(order != VertexOrder::File || triangleOrder != TriangleOrder::File)
+      std::cout << "   (L1 x" << static_cast<double>(misses.l1)/std::max<uint64_t>(reference.l1, 1)
+                << ", L2 x" << static_cast<double>(misses.l2)/std::max<uint64_t>(reference.l2, 1) << ")";
+    std::cout << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,104 @@
+// ----------------------------------------------------------------------------
+// normalsBench.cpp
+//
+// Throughput of the vertex normals, in each weighting (area, angle, Max), on
+// synthetic tori of 100k, 1M and 10M vertices, up to -n, for an increasing
+// number of threads. Also reports the largest deviation of the normals from
+// unit length, and the vertices left at (0, 0, 0).
+//
+// Usage: normalsBench [-n <max vertices>] [-t <max threads>] [-r <repetitions>]
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Mesh.h"
+#include "SyntheticMesh.h"
+#include "ThreadPool.h"
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Fn>
+double bestOf(unsigned int repetitions, const Fn &fn)
+{
+  double best = 1e30;
+  for(unsigned int r = 0; r < repetitions; ++r) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, elapsedMs(start));
+  }
+  return best;
+}
+
+const size_t kVertices[] = {100000, 1000000, 10000000};
+const NormalWeighting kWeightings[] = {NormalWeighting::Area, NormalWeighting::Angle, NormalWeighting::Max};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  size_t maxVertices = 10000000;
+  unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  unsigned int repetitions = 3;
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if(arg == "-n" && i + 1 < argc)
+      maxVertices = static_cast<size_t>(std::max(0.0, std::atof(argv[++i])));
+    else if(arg == "-t" && i + 1 < argc)
+      maxThreads = std::max(1, std::atoi(argv[++i]));
+    else if(arg == "-r" && i + 1 < argc)
+      repetitions = std::max(1, std::atoi(argv[++i]));
+    else {
+      std::cerr << "Usage: " << argv[0] << " [-n <max vertices>] [-t <max threads>] [-r <repetitions>]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::cout << std::setw(10) << "vertices" << std::setw(8) << "threads" << std::setw(10) << "weighting"
+            << std::setw(12) << "ms" << std::setw(14) << "Mvertices/s" << std::setw(14) << "max |1-|n||"
+            << std::setw(8) << "zero" << std::endl;
+  for(size_t vertices : kVertices) {
+    if(vertices > maxVertices)
+      break;
+    // A torus has as many vertices as half its triangles
+    Mesh mesh;
+    SyntheticMeshParameters parameters;
+    parameters.shape = SyntheticShape::Torus;
+    parameters.triangles = 2*vertices;
+    generateSyntheticMesh(parameters, mesh);
+    const size_t V = mesh.vertexPositions().size();
+    for(unsigned int threads = 1; threads <= maxThreads; threads = (threads == maxThreads) ? threads + 1 : std::min(2*threads, maxThreads)) {
+      ThreadPool::setThreadCount(threads);
+      for(NormalWeighting weighting : kWeightings) {
+        mesh.setNormalWeighting(weighting);
+        const double ms = bestOf(repetitions, [&]() { mesh.recomputePerVertexNormals(); });
+        float deviation = 0.f;
+        size_t zero = 0;
+        for(const glm::vec3 &n : mesh.vertexNormals()) {
+          const float length = glm::length(n);
+          if(length == 0.f)
+            ++zero;
+          else
+            deviation = std::max(deviation, std::fabs(1.f - length));
+        }
+        std::cout << std::setw(10) << V << std::setw(8) << threads << std::setw(10) << normalWeightingName(weighting)
+                  << std::fixed << std::setprecision(1) << std::setw(12) << ms << std::setw(14) << V/(1000.0*ms)
+                  << std::scientific << std::setprecision(1) << std::setw(14) << deviation << std::setw(8) << zero
+                  << std::defaultfloat << std::endl;
+      }
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,472 @@
+// ----------------------------------------------------------------------------
+// scbench.cpp
+//
+// Microbenchmark suite of the Mesh kernels: load, cleanup, normals (area,
+// angle and Max weightings), principal curvature, subdivision levels 1 to 4,
+// one-ring neighbors and adjacency,
+// radial curvature, gradient accumulation, directional derivatives,
+// hysteresis, contour extraction, the contour task graph (with and without
+// occlusion culling) and the packing of the eligibility for the GPU upload.
+// They run on the given meshes (default: the bundled triangle meshes) and on
+// synthetic tori of 10k, 100k, 1M and 10M triangles, up to -n.
+//
+// Usage: scbench [-n <max triangles>] [-r <repetitions>] [-t <threads>]
+//                [-o <results.json>] [-b <baseline.json>] [<file.off|file.obj> ...]
+//
+// For every mesh and kernel, the best time of the repetitions is reported with
+// the throughput in items (vertices or triangles) per second, the number of
+// heap allocations and bytes allocated by the first run, the allocations of
+// the last run (those of a warmed-up frame: 0 for the kernels that keep their
+// buffers between calls), and the peak resident set
+// size during the runs (process-wide, and since start-up if the high-water mark
+// cannot be reset, i.e., off Linux). A subdivision level is skipped once it
+// would exceed the max triangle count.
+//
+// The results are saved as JSON (default: scbench.json), one result object per
+// line so that two files diff cleanly. With -b, each time is compared to the
+// same mesh and kernel in a saved baseline.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+#include "ContourExtractor.h"
+#include "ContourPipeline.h"
+#include "Mesh.h"
+#include "OcclusionCuller.h"
+#include "SyntheticMesh.h"
+#include "ThreadPool.h"
+
+// Heap allocation counters of the whole process: every operator new goes through these
+namespace {
+std::atomic<uint64_t> g_allocations{0};
+std::atomic<uint64_t> g_allocatedBytes{0};
+
+void *countedAllocation(size_t size)
+{
+  g_allocations.fetch_add(1, std::memory_order_relaxed);
+  g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+  if(void *p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc();
+}
+} // namespace
+
+void *operator new(size_t size) { return countedAllocation(size); }
+void *operator new[](size_t size) { return countedAllocation(size); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+// cube.off and head.off have polygon faces, which the triangle loaders do not read
+const char *kDefaultMeshes[] = {"data/sphere.off", "data/apple.off", "data/monkey.off"};
+const size_t kSyntheticTriangles[] = {10000, 100000, 1000000, 10000000};
+
+struct Options {
+  size_t maxTriangles = 10000000;
+  unsigned int repetitions = 3;
+  unsigned int threads = 0;
+  std::string output = "scbench.json";
+  std::string baseline;
+  std::vector<std::string> files;
+};
+
+struct Result {
+  std::string mesh, kernel;
+  size_t vertices = 0, triangles = 0;
+  double ms = 0.0;
+  size_t items = 0;
+  const char *itemUnit = "vertices";
+  uint64_t allocations = 0, allocatedBytes = 0;
+  uint64_t warmAllocations = 0;
+  uint64_t peakRssBytes = 0;
+};
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Restarts the peak RSS measure from the current RSS where the OS allows it
+bool resetPeakRss()
+{
+#if defined(__linux__)
+  std::ofstream clearRefs("/proc/self/clear_refs");
+  clearRefs << "5" << std::flush;
+  return static_cast<bool>(clearRefs);
+#else
+  return false;
+#endif
+}
+
+uint64_t peakRssBytes()
+{
+#if defined(__linux__)
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while(std::getline(status, line))
+    if(line.compare(0, 6, "VmHWM:") == 0)
+      return std::strtoull(line.c_str() + 6, nullptr, 10)*1024;
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+  struct rusage usage;
+  if(getrusage(RUSAGE_SELF, &usage) == 0)
+#if defined(__APPLE__)
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss)*1024;
+#endif
+#endif
+  return 0;
+}
+
+// Runs the kernel the given number of times: best time, allocations of the first and last runs
+template <typename Fn>
+void measure(unsigned int repetitions, Result &result, const Fn &fn)
+{
+  resetPeakRss();
+  result.ms = 1e30;
+  for(unsigned int r = 0; r < repetitions; ++r) {
+    const uint64_t allocations = g_allocations.load(), bytes = g_allocatedBytes.load();
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    result.ms = std::min(result.ms, elapsedMs(start));
+    if(r == 0) {
+      result.allocations = g_allocations.load() - allocations;
+      result.allocatedBytes = g_allocatedBytes.load() - bytes;
+    }
+    result.warmAllocations = g_allocations.load() - allocations;
+  }
+  result.peakRssBytes = peakRssBytes();
+}
+
+std::string baseName(const std::string &filename)
+{
+  const size_t slash = filename.find_last_of("/\\");
+  std::string name = (slash == std::string::npos) ? filename : filename.substr(slash + 1);
+  const size_t dot = name.find_last_of('.');
+  return (dot == std::string::npos) ? name : name.substr(0, dot);
+}
+
+bool endsWith(const std::string &s, const std::string &suffix)
+{
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+void load(const std::string &filename, std::shared_ptr<Mesh> mesh)
+{
+  if(endsWith(filename, ".obj"))
+    loadOBJ(filename, mesh);
+  else
+    loadOFF(filename, mesh);
+}
+
+// Every kernel on one mesh; filename is empty for the synthetic meshes
+void benchmarkMesh(const std::string &name, const std::string &filename, std::shared_ptr<Mesh> mesh,
+                   const Options &options, std::vector<Result> &results)
+{
+  // The loaders and subdivision report their progress: keep the table readable
+  std::ostringstream quiet;
+  std::streambuf *cout = std::cout.rdbuf(quiet.rdbuf());
+  std::vector<Result> meshResults;
+  auto add = [&](const char *kernel, size_t items, const char *itemUnit, const Mesh &measured) -> Result & {
+    meshResults.emplace_back();
+    Result &r = meshResults.back();
+    r.mesh = name;
+    r.kernel = kernel;
+    r.vertices = measured.vertexPositions().size();
+    r.triangles = measured.triangleIndices().size();
+    r.items = items;
+    r.itemUnit = itemUnit;
+    return r;
+  };
+  const size_t V = mesh->vertexPositions().size(), T = mesh->triangleIndices().size();
+
+  if(!filename.empty()) {
+    auto loaded = std::make_shared<Mesh>();
+    Result &r = add("load", T, "triangles", *mesh);
+    measure(options.repetitions, r, [&]() { load(filename, loaded); });
+  }
+  {
+    // Welding and the searches of degenerate and duplicate triangles run even if nothing is removed
+    Mesh cleaned = *mesh;
+    measure(options.repetitions, add("cleanup", T, "triangles", cleaned), [&]() { cleaned.cleanup(MeshCleanupOptions()); });
+  }
+  measure(options.repetitions, add("normals", V, "vertices", *mesh), [&]() { mesh->recomputePerVertexNormals(); });
+  mesh->setNormalWeighting(NormalWeighting::Angle);
+  measure(options.repetitions, add("normals (angle)", V, "vertices", *mesh), [&]() { mesh->recomputePerVertexNormals(); });
+  mesh->setNormalWeighting(NormalWeighting::Max);
+  measure(options.repetitions, add("normals (max)", V, "vertices", *mesh), [&]() { mesh->recomputePerVertexNormals(); });
+  mesh->setNormalWeighting(NormalWeighting::Area);
+  mesh->recomputePerVertexNormals();
+  measure(options.repetitions, add("curvature", V, "vertices", *mesh), [&]() { mesh->calculatePrincipalCurvature(); });
+
+  // Each level from a copy of the previous one, the copy being made outside the measure
+  {
+    static const char *kLevels[] = {"subdivision level 1", "subdivision level 2", "subdivision level 3", "subdivision level 4"};
+    Mesh coarse = *mesh;
+    for(unsigned int l = 0; l < 4 && 4*coarse.triangleIndices().size() <= options.maxTriangles; ++l) {
+      Result &r = add(kLevels[l], 4*coarse.triangleIndices().size(), "triangles", coarse);
+      std::vector<Mesh> copies(options.repetitions, coarse);
+      unsigned int run = 0;
+      measure(options.repetitions, r, [&]() { copies[run++].subdivideLoop(); });
+      coarse = copies.front();
+    }
+  }
+
+  std::vector<std::set<unsigned int>> neighbors;
+  measure(options.repetitions, add("one-ring neighbors", V, "vertices", *mesh), [&]() { neighbors = mesh->computeOneRingNeighbors(); });
+  std::vector<unsigned int> offsets, adjacent;
+  measure(options.repetitions, add("one-ring adjacency", V, "vertices", *mesh),
+          [&]() { mesh->computeOneRingAdjacency(offsets, adjacent); });
+
+  glm::vec3 center;
+  float radius;
+  mesh->computeBoundingSphere(center, radius);
+  const glm::vec3 eye = center + 3.f*radius*glm::vec3(0.3f, 0.4f, 0.866f);
+  measure(options.repetitions, add("radial curvature", V, "vertices", *mesh), [&]() { mesh->calculateRadialCurvature(eye); });
+
+  std::vector<glm::vec3> gradAccum;
+  std::vector<float> weightAccum;
+  measure(options.repetitions, add("gradient accumulation", T, "triangles", *mesh),
+          [&]() { mesh->computeTriangleGradientAccumulators(gradAccum, weightAccum); });
+  std::vector<float> dirDeriv;
+  measure(options.repetitions, add("directional derivatives", V, "vertices", *mesh),
+          [&]() { dirDeriv = mesh->computeDirectionalDerivatives(gradAccum, weightAccum, eye); });
+
+  const SuggestiveContourThresholds thresholds;
+  std::vector<int> eligibility;
+  measure(options.repetitions, add("hysteresis", V, "vertices", *mesh), [&]() {
+    eligibility = mesh->applyThresholdsAndHysteresis(dirDeriv, neighbors, thresholds.tHigh, thresholds.tLow,
+                                                     thresholds.thetaC, eye);
+  });
+  mesh->setSuggestiveContourEligibility(eligibility);
+
+  ContourExtractor extractor;
+  std::vector<ContourPolyline> polylines;
+  measure(options.repetitions, add("contour extraction", T, "triangles", *mesh), [&]() { extractor.extract(*mesh, polylines); });
+
+  // The whole contour computation of a view, its stages overlapping on the thread pool
+  {
+    ContourPipeline pipeline;
+    ContourExtractor pipelineExtractor;
+    std::vector<ContourPolyline> pipelinePolylines;
+    pipeline.reset(*mesh, pipelineExtractor, pipelinePolylines);
+    measure(options.repetitions, add("contour pipeline", V, "vertices", *mesh), [&]() { pipeline.run(eye); });
+  }
+  // With the clusters hidden from the eye culled, as in the viewer's task-graph mode
+  {
+    ContourPipeline pipeline;
+    OcclusionCuller culler;
+    ContourExtractor pipelineExtractor;
+    std::vector<ContourPolyline> pipelinePolylines;
+    pipeline.setOcclusionCuller(&culler);
+    pipeline.reset(*mesh, pipelineExtractor, pipelinePolylines);
+    const glm::mat4 modelViewProj = glm::perspective(glm::radians(45.f), 16.f/9.f, 0.01f*radius, 10.f*radius)*
+                                    glm::lookAt(eye, center, glm::vec3(0.f, 1.f, 0.f));
+    measure(options.repetitions, add("contour pipeline (culled)", V, "vertices", *mesh),
+            [&]() { pipeline.run(eye, modelViewProj); });
+  }
+
+  std::vector<int32_t> packed(V);
+  measure(options.repetitions, add("upload packing", V, "vertices", *mesh),
+          [&]() { mesh->packSuggestiveContourEligibility(0, static_cast<unsigned int>(V), packed.data()); });
+
+  std::cout.rdbuf(cout);
+  std::cout << " > " << name << ": " << V << " vertices, " << T << " triangles" << std::endl;
+  for(const Result &r : meshResults)
+    std::cout << std::setw(24) << r.kernel << std::fixed << std::setprecision(3) << std::setw(12) << r.ms << " ms"
+              << std::setprecision(2) << std::setw(10) << r.items/(r.ms*1e3) << " M" << r.itemUnit << "/s"
+              << std::setw(10) << r.allocations << " allocs" << std::setw(8) << r.warmAllocations << " warm"
+              << std::setw(10) << r.allocatedBytes/1048576.0 << " MiB"
+              << std::setw(10) << r.peakRssBytes/1048576.0 << " MiB peak RSS" << std::endl;
+  results.insert(results.end(), meshResults.begin(), meshResults.end());
+}
+
+void writeJsonString(std::ostream &out, const std::string &s)
+{
+  out << '"';
+  for(char c : s) {
+    if(c == '"' || c == '\\')
+      out << '\\';
+    out << c;
+  }
+  out << '"';
+}
+
+void writeResults(std::ostream &out, const Options &options, const std::vector<Result> &results)
+{
+  out << "{\"benchmark\":\"scbench\",\"threads\":" << ThreadPool::threadCount() << ",\"repetitions\":" << options.repetitions
+      << ",\"soaVertices\":"
+#if defined(SC_SOA_VERTICES)
+      << "true"
+#else
+      << "false"
+#endif
+      << ",\"results\":[" << std::endl;
+  out << std::setprecision(6);
+  for(size_t i = 0; i < results.size(); ++i) {
+    const Result &r = results[i];
+    out << "{\"mesh\":";
+    writeJsonString(out, r.mesh);
+    out << ",\"kernel\":";
+    writeJsonString(out, r.kernel);
+    out << ",\"vertices\":" << r.vertices << ",\"triangles\":" << r.triangles << ",\"ms\":" << r.ms
+        << ",\"items\":" << r.items << ",\"itemUnit\":\"" << r.itemUnit << "\",\"itemsPerSecond\":"
+        << r.items/(r.ms*1e-3) << ",\"allocations\":" << r.allocations << ",\"allocatedBytes\":" << r.allocatedBytes
+        << ",\"warmAllocations\":" << r.warmAllocations << ",\"peakRssBytes\":" << r.peakRssBytes << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+  }
+  out << "]}" << std::endl;
+}
+
+// Value of a "key": field of one result line as written by writeResults()
+std::string field(const std::string &line, const std::string &key)
+{
+  const std::string pattern = "\"" + key + "\":";
+  size_t start = line.find(pattern);
+  if(start == std::string::npos)
+    return std::string();
+  start += pattern.size();
+  if(line[start] == '"') {
+    const size_t end = line.find('"', start + 1);
+    return line.substr(start + 1, end - start - 1);
+  }
+  return line.substr(start, line.find_first_of(",}", start) - start);
+}
+
+// Times of a previous run, per mesh and kernel
+std::map<std::pair<std::string, std::string>, double> readBaseline(const std::string &filename)
+{
+  std::ifstream in(filename.c_str());
+  if(!in)
+    throw std::ios_base::failure("[scbench] Cannot open baseline " + filename);
+  std::map<std::pair<std::string, std::string>, double> times;
+  std::string line;
+  while(std::getline(in, line)) {
+    const std::string ms = field(line, "ms");
+    if(line.compare(0, 8, "{\"mesh\":") == 0 && !ms.empty())
+      times[std::make_pair(field(line, "mesh"), field(line, "kernel"))] = std::atof(ms.c_str());
+  }
+  return times;
+}
+
+void compareToBaseline(const std::string &filename, const std::vector<Result> &results)
+{
+  const auto baseline = readBaseline(filename);
+  std::cout << " > Compared to " << filename << " (time ratio, < 1 is faster)" << std::endl;
+  for(const Result &r : results) {
+    const auto it = baseline.find(std::make_pair(r.mesh, r.kernel));
+    if(it == baseline.end() || it->second <= 0.0)
+      continue;
+    const double ratio = r.ms/it->second;
+    std::cout << std::setw(16) << r.mesh << std::setw(24) << r.kernel << std::fixed << std::setprecision(3)
+              << std::setw(12) << it->second << " ms ->" << std::setw(10) << r.ms << " ms  x" << std::setprecision(2)
+              << ratio << (ratio > 1.1 ? "  slower" : ratio < 0.9 ? "  faster" : "") << std::endl;
+  }
+}
+
+bool parseArguments(int argc, char **argv, Options &options)
+{
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const bool hasValue = i + 1 < argc;
+    if(arg == "-n" && hasValue)
+      options.maxTriangles = static_cast<size_t>(std::max(0.0, std::atof(argv[++i])));
+    else if(arg == "-r" && hasValue)
+      options.repetitions = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+    else if(arg == "-t" && hasValue)
+      options.threads = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+    else if(arg == "-o" && hasValue)
+      options.output = argv[++i];
+    else if(arg == "-b" && hasValue)
+      options.baseline = argv[++i];
+    else if(!arg.empty() && arg[0] == '-')
+      return false;
+    else
+      options.files.push_back(arg);
+  }
+  if(options.files.empty())
+    options.files.assign(std::begin(kDefaultMeshes), std::end(kDefaultMeshes));
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if(!parseArguments(argc, argv, options)) {
+    std::cerr << "Usage: " << argv[0] << " [-n <max triangles>] [-r <repetitions>] [-t <threads>]"
+              << " [-o <results.json>] [-b <baseline.json>] [<file.off|file.obj> ...]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  ThreadPool::setThreadCount(options.threads);
+  if(!resetPeakRss())
+    std::cout << " > The peak RSS cannot be reset: it is reported since start-up" << std::endl;
+
+  std::vector<Result> results;
+  for(const std::string &filename : options.files) {
+    auto mesh = std::make_shared<Mesh>();
+    std::ostringstream quiet;
+    std::streambuf *cout = std::cout.rdbuf(quiet.rdbuf());
+    try {
+      load(filename, mesh);
+    } catch(std::exception &e) {
+      std::cout.rdbuf(cout);
+      std::cerr << " > [Error loading mesh]" << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout.rdbuf(cout);
+    benchmarkMesh(baseName(filename), filename, mesh, options, results);
+  }
+  for(size_t triangles : kSyntheticTriangles) {
+    if(triangles > options.maxTriangles)
+      break;
+    auto mesh = std::make_shared<Mesh>();
+    SyntheticMeshParameters parameters;
+    parameters.shape = SyntheticShape::Torus;
+    parameters.triangles = triangles;
+    generateSyntheticMesh(parameters, *mesh);
+    std::ostringstream name;
+    name << "torus-" << triangles;
+    benchmarkMesh(name.str(), std::string(), mesh, options, results);
+  }
+
+  std::ofstream out(options.output.c_str());
+  if(!out) {
+    std::cerr << " > [scbench] Cannot open " << options.output << std::endl;
+    return EXIT_FAILURE;
+  }
+  writeResults(out, options, results);
+  std::cout << " > Results saved to " << options.output << std::endl;
+
+  if(!options.baseline.empty()) {
+    try {
+      compareToBaseline(options.baseline, results);
+    } catch(std::exception &e) {
+      std::cerr << " > " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,122 @@
+// ----------------------------------------------------------------------------
+// silhouetteBench.cpp
+//
+// Compares the dual-space silhouette tree against brute-force edge scanning.
+//
+// Usage: silhouetteBench [-s <subdivision levels>] [-n <views>] [<file.off> ...]
+// ----------------------------------------------------------------------------
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include "Mesh.h"
+#include "SilhouetteTree.h"
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool sameEdges(std::vector<SilhouetteEdge> a, std::vector<SilhouetteEdge> b)
+{
+  auto less = [](const SilhouetteEdge &x, const SilhouetteEdge &y) { return x.a < y.a || (x.a == y.a && x.b < y.b); };
+  std::sort(a.begin(), a.end(), less);
+  std::sort(b.begin(), b.end(), less);
+  if(a.size() != b.size())
+    return false;
+  for(size_t i = 0; i < a.size(); ++i)
+    if(a[i].a != b[i].a || a[i].b != b[i].b)
+      return false;
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  unsigned int levels = 2;
+  unsigned int views = 200;
+  std::vector<std::string> files;
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if(arg == "-s" && i + 1 < argc)
+      levels = static_cast<unsigned int>(std::atoi(argv[++i]));
+    else if(arg == "-n" && i + 1 < argc)
+      views = static_cast<unsigned int>(std::atoi(argv[++i]));
+    else
+      files.push_back(arg);
+  }
+  // cube.off and head.off have polygon faces, which the triangle loader does not read
+  if(files.empty())
+    files = {"data/sphere.off", "data/apple.off", "data/monkey.off"};
+
+  for(const std::string &filename : files) {
+    auto mesh = std::make_shared<Mesh>();
+    try {
+      loadOFF(filename, mesh);
+    } catch(std::exception &e) {
+      std::cerr << "> [Error loading mesh]" << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    for(unsigned int l = 0; l < levels; ++l)
+      mesh->subdivideLoop();
+
+    glm::vec3 center;
+    float radius;
+    mesh->computeBoundingSphere(center, radius);
+
+    auto start = std::chrono::steady_clock::now();
+    SilhouetteTree tree;
+    tree.build(*mesh);
+    const double buildMs = elapsedMs(start);
+
+    // Views on a spiral around the mesh, at the default viewer distance
+    std::vector<glm::vec3> eyes(views);
+    for(unsigned int v = 0; v < views; ++v) {
+      const float z = 1.f - 2.f*(v + 0.5f)/views;
+      const float phi = v*2.39996323f;
+      const float r = std::sqrt(1.f - z*z);
+      eyes[v] = center + 3.f*radius*glm::vec3(r*std::cos(phi), r*std::sin(phi), z);
+    }
+
+    std::vector<SilhouetteEdge> fast, brute;
+    size_t outputSize = 0, visited = 0;
+    bool agree = true;
+    double treeMs = 0.0, bruteMs = 0.0;
+    for(const glm::vec3 &eye : eyes) {
+      fast.clear();
+      brute.clear();
+      start = std::chrono::steady_clock::now();
+      visited += tree.query(eye, fast);
+      treeMs += elapsedMs(start);
+      start = std::chrono::steady_clock::now();
+      tree.queryBruteForce(eye, brute);
+      bruteMs += elapsedMs(start);
+      outputSize += fast.size();
+      agree = agree && sameEdges(fast, brute);
+    }
+
+    std::cout << " > " << filename << " (level " << levels << "): "
+              << mesh->triangleIndices().size() << " triangles, "
+              << tree.edgeCount() << " interior edges, "
+              << tree.boundaryEdgeCount() << " boundary edges" << std::endl
+              << "    build: " << buildMs << " ms, " << tree.nodeCount() << " nodes" << std::endl
+              << "    tree query: " << treeMs/views << " ms/view, "
+              << static_cast<double>(visited)/views << " nodes visited/view" << std::endl
+              << "    brute force: " << bruteMs/views << " ms/view" << std::endl
+              << "    silhouette edges: " << static_cast<double>(outputSize)/views << " /view, speedup x"
+              << (treeMs > 0.0 ? bruteMs/treeMs : 0.0)
+              << (agree ? "" : "  ** MISMATCH **") << std::endl;
+    if(!agree)
+      return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
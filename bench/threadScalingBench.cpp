@@ -0,0 +1,127 @@
+// ----------------------------------------------------------------------------
+// threadScalingBench.cpp
+//
+// Times the parallel mesh kernels for an increasing number of threads and
+// reports the speedup of each kernel over the single-threaded run.
+//
+// Usage: threadScalingBench [-s <subdivision levels>] [-t <max threads>] [-r <repetitions>] [<file.off>]
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ContourExtractor.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+
+namespace {
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Best of the repetitions, to filter out scheduling noise
+template <typename Fn>
+double bestOf(unsigned int repetitions, const Fn &fn)
+{
+  double best = 1e30;
+  for(unsigned int r = 0; r < repetitions; ++r) {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    best = std::min(best, elapsedMs(start));
+  }
+  return best;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  unsigned int levels = 3;
+  unsigned int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+  unsigned int repetitions = 3;
+  std::string filename = "data/apple.off";
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if(arg == "-s" && i + 1 < argc)
+      levels = static_cast<unsigned int>(std::atoi(argv[++i]));
+    else if(arg == "-t" && i + 1 < argc)
+      maxThreads = std::max(1, std::atoi(argv[++i]));
+    else if(arg == "-r" && i + 1 < argc)
+      repetitions = std::max(1, std::atoi(argv[++i]));
+    else
+      filename = arg;
+  }
+
+  auto mesh = std::make_shared<Mesh>();
+  try {
+    loadOFF(filename, mesh);
+  } catch(std::exception &e) {
+    std::cerr << "> [Error loading mesh]" << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  // The last level is the subdivision kernel under test
+  for(unsigned int l = 0; l + 1 < levels; ++l)
+    mesh->subdivideLoop();
+  const Mesh coarse = *mesh->cloneGeometry();
+  mesh->subdivideLoop();
+  mesh->calculatePrincipalCurvature();
+
+  glm::vec3 center;
+  float radius;
+  mesh->computeBoundingSphere(center, radius);
+  const glm::vec3 eye = center + 3.f*radius*glm::vec3(0.3f, 0.4f, 0.866f);
+  const SuggestiveContourThresholds thresholds;
+  const auto neighbors = mesh->computeOneRingNeighbors();
+  std::vector<glm::vec3> gradAccum;
+  std::vector<float> weightAccum;
+  mesh->calculateRadialCurvature(eye);
+  mesh->computeTriangleGradientAccumulators(gradAccum, weightAccum);
+  const std::vector<float> dirDeriv = mesh->computeDirectionalDerivatives(gradAccum, weightAccum, eye);
+  ContourExtractor extractor;
+  std::vector<ContourPolyline> polylines;
+
+  std::cout << " > " << filename << " (level " << levels << "): " << mesh->vertexPositions().size()
+            << " vertices, " << mesh->triangleIndices().size() << " triangles" << std::endl;
+  std::cout << std::setw(8) << "threads" << std::setw(14) << "normals" << std::setw(14) << "curvature"
+            << std::setw(14) << "subdivision" << std::setw(14) << "radial" << std::setw(14) << "hysteresis"
+            << std::setw(14) << "extraction" << "   (ms, speedup)" << std::endl;
+
+  std::vector<double> reference;
+  for(unsigned int threads = 1; threads <= maxThreads; threads = (threads == maxThreads) ? threads + 1 : std::min(2*threads, maxThreads)) {
+    ThreadPool::setThreadCount(threads);
+    std::vector<double> times;
+    times.push_back(bestOf(repetitions, [&]() { mesh->recomputePerVertexNormals(); }));
+    times.push_back(bestOf(repetitions, [&]() { mesh->calculatePrincipalCurvature(); }));
+    times.push_back(bestOf(repetitions, [&]() {
+      Mesh refined = coarse;
+      refined.subdivideLoop();
+    }));
+    times.push_back(bestOf(repetitions, [&]() {
+      parallel_for(0, mesh->vertexPositions().size(), 4096, [&](size_t first, size_t last) {
+        mesh->calculateRadialCurvature(eye, static_cast<unsigned int>(first), static_cast<unsigned int>(last));
+      });
+    }));
+    times.push_back(bestOf(repetitions, [&]() {
+      mesh->applyThresholdsAndHysteresis(dirDeriv, neighbors, thresholds.tHigh, thresholds.tLow, thresholds.thetaC, eye);
+    }));
+    times.push_back(bestOf(repetitions, [&]() { extractor.extract(*mesh, polylines); }));
+    if(reference.empty())
+      reference = times;
+
+    std::cout << std::setw(8) << threads << std::fixed;
+    for(size_t k = 0; k < times.size(); ++k)
+      std::cout << std::setw(8) << std::setprecision(1) << times[k] << " x" << std::setw(4) << std::setprecision(1)
+                << reference[k]/times[k];
+    std::cout << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,460 @@
+#include "Bvh.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const unsigned int kParallelBuildSize = 8192;  // nodes from which the binning and the subtrees run in parallel
+const unsigned int kMaxDepth = 64;             // deeper nodes become leaves, to bound the traversal stacks,
+                                               // unless too large for Node::count: split by count then
+const unsigned int kStackSize = 2*kMaxDepth;
+// The splits by count of 2^32 triangles down to 2^16 take 16 levels past kMaxDepth
+static_assert(kStackSize >= kMaxDepth + 16, "traversal stack too small for the splits by count");
+
+struct Aabb {
+  glm::vec3 min = glm::vec3(FLT_MAX);
+  glm::vec3 max = glm::vec3(-FLT_MAX);
+
+  void extend(const glm::vec3 &p) { min = glm::min(min, p); max = glm::max(max, p); }
+  void extend(const Aabb &b) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+  float area() const
+  {
+    const glm::vec3 d = glm::max(max - min, glm::vec3(0.f));
+    return 2.f*(d.x*d.y + d.y*d.z + d.z*d.x);
+  }
+};
+
+struct Bins {
+  Aabb bounds[3][Bvh::kBinCount];
+  unsigned int count[3][Bvh::kBinCount] = {};
+};
+
+// Node and centroid bounds of a range of triangles
+struct RangeBounds {
+  Aabb bounds, centroids;
+};
+
+bool boxHit(const glm::vec3 &min, const glm::vec3 &max, const glm::vec3 &origin, const glm::vec3 &invDir, float tMax)
+{
+  const glm::vec3 t0 = (min - origin)*invDir, t1 = (max - origin)*invDir;
+  const glm::vec3 tn = glm::min(t0, t1), tf = glm::max(t0, t1);
+  const float tNear = std::max(std::max(tn.x, tn.y), tn.z), tFar = std::min(std::min(tf.x, tf.y), tf.z);
+  return tNear <= tFar && tFar > 0.f && tNear < tMax;
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+struct Bvh::BuildNode {
+  Aabb bounds;
+  std::unique_ptr<BuildNode> children[2];
+  unsigned int begin = 0, end = 0;
+  unsigned int axis = 0;
+};
+
+struct Bvh::BuildContext {
+  std::vector<Aabb> bounds;
+  std::vector<glm::vec3> centroids;
+  std::vector<unsigned int> refs;  // triangles, partitioned in leaf order by the build
+  std::atomic<unsigned int> depth{0};
+};
+
+Bvh::Bvh() {}
+Bvh::~Bvh() {}
+
+void Bvh::build(const Mesh &mesh)
+{
+  SC_PROFILE_SCOPE("Bvh::build");
+  const auto start = std::chrono::steady_clock::now();
+  const auto &P = mesh.vertexPositions();
+  const auto &T = mesh.triangleIndices();
+  _vertexCount = P.size();
+  _nodes.clear();
+  _triangles.clear();
+  _depth = 0;
+  if(T.empty())
+    return;
+
+  BuildContext context;
+  context.bounds.resize(T.size());
+  context.centroids.resize(T.size());
+  context.refs.resize(T.size());
+  parallel_for(0, T.size(), 4096, [&](size_t first, size_t last) {
+    for(size_t t = first; t < last; ++t) {
+      Aabb &b = context.bounds[t];
+      b = Aabb();
+      for(unsigned int k = 0; k < 3; ++k)
+        b.extend(P[T[t][k]]);
+      context.centroids[t] = 0.5f*(b.min + b.max);
+      context.refs[t] = static_cast<unsigned int>(t);
+    }
+  });
+
+  BuildNode root;
+  buildNode(context, root, 0, static_cast<unsigned int>(T.size()), 1);
+  _depth = context.depth;
+
+  _triangles.resize(T.size());
+  parallel_for(0, T.size(), 4096, [&](size_t first, size_t last) {
+    for(size_t i = first; i < last; ++i) {
+      const glm::uvec3 &tri = T[context.refs[i]];
+      Triangle &t = _triangles[i];
+      t.p0 = P[tri[0]];
+      t.e1 = P[tri[1]] - P[tri[0]];
+      t.e2 = P[tri[2]] - P[tri[0]];
+      t.index = context.refs[i];
+    }
+  });
+  flatten(root, context);
+  _buildMs = elapsedMs(start);
+}
+
+bool Bvh::builtFor(const Mesh &mesh) const
+{
+  return _vertexCount == mesh.vertexPositions().size() && _triangles.size() == mesh.triangleIndices().size();
+}
+
+void Bvh::buildNode(BuildContext &context, BuildNode &node, unsigned int begin, unsigned int end, unsigned int depth)
+{
+  node.begin = begin;
+  node.end = end;
+  unsigned int observed = context.depth.load(std::memory_order_relaxed);
+  while(depth > observed && !context.depth.compare_exchange_weak(observed, depth)) {}
+
+  const unsigned int count = end - begin;
+  auto boundsOf = [&](size_t first, size_t last) {
+    RangeBounds r;
+    for(size_t i = first; i < last; ++i) {
+      r.bounds.extend(context.bounds[context.refs[i]]);
+      r.centroids.extend(context.centroids[context.refs[i]]);
+    }
+    return r;
+  };
+  auto mergeBounds = [](RangeBounds a, const RangeBounds &b) {
+    a.bounds.extend(b.bounds);
+    a.centroids.extend(b.centroids);
+    return a;
+  };
+  const RangeBounds range = (count >= kParallelBuildSize) ? parallel_reduce(begin, end, 4096, RangeBounds(), boundsOf, mergeBounds)
+                                                          : boundsOf(begin, end);
+  node.bounds = range.bounds;
+  if(count <= kMaxLeafSize || (depth >= kMaxDepth && count <= UINT16_MAX))
+    return;
+  // Past the maximum depth, the split by count below halves the leaf, see kStackSize
+  float bestCost = FLT_MAX;
+  unsigned int bestAxis = 0, bestSplit = 0;
+
+  // Binned SAH over the 3 axes
+  const glm::vec3 extent = range.centroids.max - range.centroids.min;
+  glm::vec3 scale;
+  for(unsigned int a = 0; a < 3; ++a)
+    scale[a] = extent[a] > 0.f ? kBinCount*(1.f - 1e-6f)/extent[a] : 0.f;
+  auto binOf = [&](unsigned int ref, unsigned int axis) {
+    return std::min(kBinCount - 1, static_cast<unsigned int>((context.centroids[ref][axis] - range.centroids.min[axis])*scale[axis]));
+  };
+  auto binRange = [&](size_t first, size_t last) {
+    Bins bins;
+    for(size_t i = first; i < last; ++i)
+      for(unsigned int a = 0; a < 3; ++a) {
+        const unsigned int b = binOf(context.refs[i], a);
+        bins.bounds[a][b].extend(context.bounds[context.refs[i]]);
+        ++bins.count[a][b];
+      }
+    return bins;
+  };
+  auto mergeBins = [](Bins a, const Bins &b) {
+    for(unsigned int axis = 0; axis < 3; ++axis)
+      for(unsigned int k = 0; k < kBinCount; ++k) {
+        a.bounds[axis][k].extend(b.bounds[axis][k]);
+        a.count[axis][k] += b.count[axis][k];
+      }
+    return a;
+  };
+  const Bins bins = (depth >= kMaxDepth) ? Bins()
+                   : (count >= kParallelBuildSize) ? parallel_reduce(begin, end, 4096, Bins(), binRange, mergeBins)
+                                                   : binRange(begin, end);
+
+  for(unsigned int a = 0; a < 3 && depth < kMaxDepth; ++a) {
+    if(scale[a] == 0.f)
+      continue;
+    // Areas and counts right of each split, then a left to right sweep
+    float rightArea[kBinCount];
+    unsigned int rightCount[kBinCount];
+    Aabb right;
+    unsigned int n = 0;
+    for(unsigned int k = kBinCount; k-- > 1;) {
+      right.extend(bins.bounds[a][k]);
+      n += bins.count[a][k];
+      rightArea[k] = right.area();
+      rightCount[k] = n;
+    }
+    Aabb left;
+    n = 0;
+    for(unsigned int k = 1; k < kBinCount; ++k) {
+      left.extend(bins.bounds[a][k - 1]);
+      n += bins.count[a][k - 1];
+      if(n == 0 || rightCount[k] == 0)
+        continue;
+      const float cost = left.area()*n + rightArea[k]*rightCount[k];
+      if(cost < bestCost) {
+        bestCost = cost;
+        bestAxis = a;
+        bestSplit = k;
+      }
+    }
+  }
+
+  unsigned int *refs = context.refs.data();
+  unsigned int mid;
+  if(bestCost < FLT_MAX) {
+    mid = static_cast<unsigned int>(std::partition(refs + begin, refs + end, [&](unsigned int ref) {
+      return binOf(ref, bestAxis) < bestSplit;
+    }) - refs);
+  } else {
+    // Coincident centroids, or too deep: split by count along the largest extent of the bounds
+    const glm::vec3 size = node.bounds.max - node.bounds.min;
+    bestAxis = (size.x >= size.y && size.x >= size.z) ? 0 : (size.y >= size.z ? 1 : 2);
+    mid = begin + count/2;
+    std::nth_element(refs + begin, refs + mid, refs + end, [&](unsigned int a, unsigned int b) {
+      return context.centroids[a][bestAxis] < context.centroids[b][bestAxis];
+    });
+  }
+  node.axis = bestAxis;
+  node.children[0].reset(new BuildNode);
+  node.children[1].reset(new BuildNode);
+  const unsigned int ranges[3] = {begin, mid, end};
+  auto buildChild = [&](size_t first, size_t last) {
+    for(size_t c = first; c < last; ++c)
+      buildNode(context, *node.children[c], ranges[c], ranges[c + 1], depth + 1);
+  };
+  if(count >= kParallelBuildSize)
+    parallel_for(0, 2, 1, buildChild);
+  else
+    buildChild(0, 2);
+}
+
+unsigned int Bvh::flatten(const BuildNode &node, const BuildContext &context)
+{
+  const unsigned int index = static_cast<unsigned int>(_nodes.size());
+  _nodes.push_back(Node());
+  Node flat;
+  flat.min = node.bounds.min;
+  flat.max = node.bounds.max;
+  flat.axis = static_cast<uint16_t>(node.axis);
+  if(!node.children[0]) {
+    flat.offset = node.begin;
+    flat.count = static_cast<uint16_t>(node.end - node.begin);
+  } else {
+    flatten(*node.children[0], context);
+    flat.offset = flatten(*node.children[1], context);
+    flat.count = 0;
+  }
+  _nodes[index] = flat;
+  return index;
+}
+
+bool Bvh::intersect(const glm::vec3 &origin, const glm::vec3 &direction, RayHit &hit, float tMax) const
+{
+  if(_nodes.empty())
+    return false;
+  const glm::vec3 invDir = 1.f/direction;
+  hit.t = tMax;
+  bool found = false;
+  unsigned int stack[kStackSize];
+  unsigned int size = 0, index = 0;
+  while(true) {
+    const Node &node = _nodes[index];
+    if(boxHit(node.min, node.max, origin, invDir, hit.t)) {
+      if(node.count == 0) {
+        const bool reversed = direction[node.axis] < 0.f;
+        stack[size++] = reversed ? index + 1 : node.offset;
+        index = reversed ? node.offset : index + 1;
+        continue;
+      }
+      for(unsigned int i = node.offset; i < node.offset + node.count; ++i) {
+        const Triangle &tri = _triangles[i];
+        const glm::vec3 pvec = glm::cross(direction, tri.e2);
+        const float det = glm::dot(tri.e1, pvec);
+        if(det == 0.f)
+          continue;
+        const float invDet = 1.f/det;
+        const glm::vec3 tvec = origin - tri.p0;
+        const float u = glm::dot(tvec, pvec)*invDet;
+        if(u < 0.f || u > 1.f)
+          continue;
+        const glm::vec3 qvec = glm::cross(tvec, tri.e1);
+        const float v = glm::dot(direction, qvec)*invDet;
+        if(v < 0.f || u + v > 1.f)
+          continue;
+        const float t = glm::dot(tri.e2, qvec)*invDet;
+        if(t > 0.f && t < hit.t) {
+          hit.t = t;
+          hit.triangle = tri.index;
+          hit.u = u;
+          hit.v = v;
+          found = true;
+        }
+      }
+    }
+    if(size == 0)
+      break;
+    index = stack[--size];
+  }
+  return found;
+}
+
+bool Bvh::occluded(const glm::vec3 &origin, const glm::vec3 &direction, float tMax) const
+{
+  RayHit hit;
+  return intersect(origin, direction, hit, tMax);
+}
+
+void Bvh::visibility(const glm::vec3 &eye, const std::vector<glm::vec3> &points, std::vector<uint8_t> &visible,
+                     float epsilon) const
+{
+  SC_PROFILE_SCOPE("Bvh::visibility");
+  visible.resize(points.size());
+  const size_t packets = (points.size() + 3)/4;
+  parallel_for(0, packets, 64, [&](size_t first, size_t last) {
+    for(size_t p = first; p < last; ++p) {
+      const size_t i = 4*p;
+      occluded4(eye, &points[i], static_cast<unsigned int>(std::min<size_t>(4, points.size() - i)), 1.f - epsilon, &visible[i]);
+    }
+  });
+}
+
+// Any-hit traversal for up to 4 rays from the eye to the points, with t in (0, tMax)
+void Bvh::occluded4(const glm::vec3 &eye, const glm::vec3 *points, unsigned int count, float tMax, uint8_t *visible) const
+{
+  if(count == 0)
+    return;
+  for(unsigned int k = 0; k < count; ++k)
+    visible[k] = 1;
+  if(_nodes.empty())
+    return;
+#if defined(__SSE2__)
+  float d[3][4], inv[3][4];
+  for(unsigned int k = 0; k < 4; ++k) {
+    const glm::vec3 dir = points[std::min(k, count - 1)] - eye;
+    for(unsigned int a = 0; a < 3; ++a) {
+      d[a][k] = dir[a];
+      inv[a][k] = 1.f/dir[a];
+    }
+  }
+  const __m128 ox = _mm_set1_ps(eye.x), oy = _mm_set1_ps(eye.y), oz = _mm_set1_ps(eye.z);
+  const __m128 dx = _mm_loadu_ps(d[0]), dy = _mm_loadu_ps(d[1]), dz = _mm_loadu_ps(d[2]);
+  const __m128 ix = _mm_loadu_ps(inv[0]), iy = _mm_loadu_ps(inv[1]), iz = _mm_loadu_ps(inv[2]);
+  const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f), vtMax = _mm_set1_ps(tMax);
+  int active = (1 << count) - 1;
+
+  unsigned int stack[kStackSize];
+  unsigned int size = 0, index = 0;
+  while(active) {
+    const Node &node = _nodes[index];
+    // Slabs for the 4 rays
+    const __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min.x), ox), ix);
+    const __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max.x), ox), ix);
+    const __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min.y), oy), iy);
+    const __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max.y), oy), iy);
+    const __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.min.z), oz), iz);
+    const __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(node.max.z), oz), iz);
+    const __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)), _mm_min_ps(t0z, t1z));
+    const __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)), _mm_max_ps(t0z, t1z));
+    const int hits = _mm_movemask_ps(_mm_and_ps(_mm_and_ps(_mm_cmple_ps(tNear, tFar), _mm_cmpgt_ps(tFar, zero)),
+                                                _mm_cmplt_ps(tNear, vtMax))) & active;
+    if(hits) {
+      if(node.count == 0) {
+        const bool reversed = d[node.axis][0] < 0.f; // the rays of a packet are coherent
+        stack[size++] = reversed ? index + 1 : node.offset;
+        index = reversed ? node.offset : index + 1;
+        continue;
+      }
+      for(unsigned int i = node.offset; i < node.offset + node.count && active; ++i) {
+        const Triangle &tri = _triangles[i];
+        const __m128 e1x = _mm_set1_ps(tri.e1.x), e1y = _mm_set1_ps(tri.e1.y), e1z = _mm_set1_ps(tri.e1.z);
+        const __m128 e2x = _mm_set1_ps(tri.e2.x), e2y = _mm_set1_ps(tri.e2.y), e2z = _mm_set1_ps(tri.e2.z);
+        // pvec = d x e2
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        const __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        const __m128 invDet = _mm_div_ps(one, det);
+        // tvec = o - p0, the same for all the rays
+        const glm::vec3 tv = eye - tri.p0;
+        const __m128 tx = _mm_set1_ps(tv.x), ty = _mm_set1_ps(tv.y), tz = _mm_set1_ps(tv.z);
+        const __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(tx, px), _mm_mul_ps(ty, py)), _mm_mul_ps(tz, pz)), invDet);
+        // qvec = tvec x e1
+        const glm::vec3 q = glm::cross(tv, tri.e1);
+        const __m128 qx = _mm_set1_ps(q.x), qy = _mm_set1_ps(q.y), qz = _mm_set1_ps(q.z);
+        const __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+        const __m128 t = _mm_mul_ps(_mm_set1_ps(glm::dot(tri.e2, q)), invDet);
+        __m128 mask = _mm_cmpneq_ps(det, zero);
+        mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpge_ps(u, zero), _mm_cmpge_ps(v, zero)));
+        mask = _mm_and_ps(mask, _mm_cmple_ps(_mm_add_ps(u, v), one));
+        mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmpgt_ps(t, zero), _mm_cmplt_ps(t, vtMax)));
+        active &= ~_mm_movemask_ps(mask);
+      }
+    }
+    if(size == 0)
+      break;
+    index = stack[--size];
+  }
+  for(unsigned int k = 0; k < count; ++k)
+    visible[k] = (active >> k) & 1;
+#else
+  for(unsigned int k = 0; k < count; ++k) {
+    RayHit hit;
+    visible[k] = !intersect(eye, points[k] - eye, hit, tMax);
+  }
+#endif
+}
+
+void removeHiddenContours(const Bvh &bvh, const glm::vec3 &eye, const std::vector<ContourPolyline> &polylines,
+                          std::vector<ContourPolyline> &visiblePolylines, float epsilon)
+{
+  std::vector<glm::vec3> points;
+  for(const ContourPolyline &polyline : polylines)
+    points.insert(points.end(), polyline.points.begin(), polyline.points.end());
+  std::vector<uint8_t> visible;
+  bvh.visibility(eye, points, visible, epsilon);
+
+  // Runs of visible points, a closed polyline being walked from its first hidden point
+  visiblePolylines.clear();
+  size_t offset = 0;
+  for(const ContourPolyline &polyline : polylines) {
+    const size_t n = polyline.points.size();
+    const uint8_t *v = &visible[offset];
+    offset += n;
+    const size_t hidden = std::find(v, v + n, 0) - v;
+    if(hidden == n) {
+      visiblePolylines.push_back(polyline);
+      continue;
+    }
+    const size_t first = polyline.closed ? hidden + 1 : 0;
+    const size_t last = polyline.closed ? hidden + n : n;
+    ContourPolyline run;
+    for(size_t i = first; i <= last; ++i) {
+      if(i < last && v[i % n]) {
+        run.points.push_back(polyline.points[i % n]);
+        continue;
+      }
+      if(run.points.size() >= 2)
+        visiblePolylines.push_back(run);
+      run.points.clear();
+    }
+  }
+}
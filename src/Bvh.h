@@ -0,0 +1,92 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cfloat>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ContourExtractor.h"
+
+class Mesh;
+
+// Closest intersection of a ray with the mesh
+struct RayHit {
+  float t = FLT_MAX;         // hit point: origin + t*direction
+  unsigned int triangle = 0;
+  float u = 0.f, v = 0.f;    // barycentric coordinates of the hit point: (1 - u - v)*p0 + u*p1 + v*p2
+};
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Bounding volume hierarchy over the triangles of a mesh, for ray casting, picking and the
+ * visibility of contour points. It is built top-down with the surface area heuristic evaluated
+ * over a few bins of the triangle centroids, large nodes being binned and subtrees being built
+ * in parallel on the thread pool. The tree is then flattened depth-first into 32-byte nodes,
+ * the first child of an inner node following it, and the triangles are stored in leaf order.
+ *
+ * Visibility queries trace packets of 4 rays together (SSE), a node or a triangle being tested
+ * against the 4 rays at once.
+ */
+class Bvh {
+public:
+  static const unsigned int kBinCount = 16;
+  static const unsigned int kMaxLeafSize = 4;
+
+  Bvh();
+  ~Bvh();
+
+  void build(const Mesh &mesh);
+  // Whether the BVH was built for the current topology of the mesh
+  bool builtFor(const Mesh &mesh) const;
+
+  size_t nodeCount() const { return _nodes.size(); }
+  unsigned int depth() const { return _depth; }
+  double buildTime() const { return _buildMs; }
+  // Bytes held by the nodes and the triangles
+  size_t memoryBytes() const { return _nodes.capacity()*sizeof(Node) + _triangles.capacity()*sizeof(Triangle); }
+
+  // Closest hit along origin + t*direction, for t in (0, tMax)
+  bool intersect(const glm::vec3 &origin, const glm::vec3 &direction, RayHit &hit, float tMax = FLT_MAX) const;
+  // Whether anything is hit along origin + t*direction, for t in (0, tMax)
+  bool occluded(const glm::vec3 &origin, const glm::vec3 &direction, float tMax = FLT_MAX) const;
+
+  // Batched visibility of points from the eye: visible[i] is 0 if something lies between the
+  // eye and points[i], ignoring the last epsilon fraction of the way (the surface of the point)
+  void visibility(const glm::vec3 &eye, const std::vector<glm::vec3> &points, std::vector<uint8_t> &visible,
+                  float epsilon = 1e-3f) const;
+
+private:
+  struct Node {
+    glm::vec3 min;
+    uint32_t offset;  // inner node: index of the second child; leaf: first triangle
+    glm::vec3 max;
+    uint16_t count;   // triangles of the leaf, 0 for an inner node
+    uint16_t axis;    // split axis of an inner node
+  };
+  struct Triangle {
+    glm::vec3 p0, e1, e2;  // first vertex and edges, for Moller-Trumbore
+    unsigned int index;    // in the mesh
+  };
+  struct BuildNode;
+  struct BuildContext;
+
+  void buildNode(BuildContext &context, BuildNode &node, unsigned int begin, unsigned int end, unsigned int depth);
+  unsigned int flatten(const BuildNode &node, const BuildContext &context);
+  void occluded4(const glm::vec3 &eye, const glm::vec3 *points, unsigned int count, float tMax, uint8_t *visible) const;
+
+  std::vector<Node> _nodes;
+  std::vector<Triangle> _triangles;
+  size_t _vertexCount = 0;
+  unsigned int _depth = 0;
+  double _buildMs = 0.0;
+};
+
+// Splits the polylines into their visible parts, from points tested against the BVH
+void removeHiddenContours(const Bvh &bvh, const glm::vec3 &eye, const std::vector<ContourPolyline> &polylines,
+                          std::vector<ContourPolyline> &visiblePolylines, float epsilon = 1e-3f);
+
+#endif  // BVH_H
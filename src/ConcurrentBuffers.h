@@ -0,0 +1,83 @@
+#ifndef CONCURRENT_BUFFERS_H
+#define CONCURRENT_BUFFERS_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// The capacity is rounded up to a power of two.
+template <typename T>
+class SpscQueue {
+public:
+  explicit SpscQueue(size_t capacity = 16)
+  {
+    size_t size = 2;
+    while(size < capacity)
+      size *= 2;
+    _items.resize(size);
+    _mask = size - 1;
+  }
+
+  // Producer side. Returns false if the queue is full.
+  bool push(const T &item)
+  {
+    const size_t tail = _tail.load(std::memory_order_relaxed);
+    if(tail - _head.load(std::memory_order_acquire) > _mask)
+      return false;
+    _items[tail & _mask] = item;
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side. Returns false if the queue is empty.
+  bool pop(T &item)
+  {
+    const size_t head = _head.load(std::memory_order_relaxed);
+    if(head == _tail.load(std::memory_order_acquire))
+      return false;
+    item = _items[head & _mask];
+    _head.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const { return _head.load(std::memory_order_acquire) == _tail.load(std::memory_order_acquire); }
+
+private:
+  std::vector<T> _items;
+  size_t _mask;
+  alignas(64) std::atomic<size_t> _head{0};
+  alignas(64) std::atomic<size_t> _tail{0};
+};
+
+// Lock-free triple buffer: the producer always owns a back buffer to write into, the consumer
+// always owns a front buffer to read from, and publishing swaps the back buffer with the
+// middle one. The consumer only ever sees the latest completely written buffer.
+template <typename T>
+class TripleBuffer {
+public:
+  // Producer side
+  T &back() { return _buffers[_back]; }
+  void publish() { _back = _middle.exchange(_back | kFresh, std::memory_order_acq_rel) & kIndexMask; }
+
+  // Consumer side: returns true if a buffer newer than front() has been published
+  bool fetch()
+  {
+    if(!(_middle.load(std::memory_order_acquire) & kFresh))
+      return false;
+    _front = _middle.exchange(_front, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+  const T &front() const { return _buffers[_front]; }
+
+private:
+  static const unsigned int kFresh = 4;
+  static const unsigned int kIndexMask = 3;
+
+  T _buffers[3];
+  unsigned int _back = 0;
+  unsigned int _front = 1;
+  std::atomic<unsigned int> _middle{2};
+};
+
+#endif  // CONCURRENT_BUFFERS_H
@@ -0,0 +1,166 @@
+#include "ContourExtractor.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace {
+
+const unsigned int kTriangleBlockSize = 4096;
+const unsigned int kNoSegment = ~0u;
+const uint64_t kNoEdge = ~uint64_t(0); // never a key: the smaller vertex comes first
+
+inline size_t hashEdgeKey(uint64_t key)
+{
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  return static_cast<size_t>(key ^ (key >> 33));
+}
+
+uint64_t edgeKey(unsigned int a, unsigned int b)
+{
+  return (static_cast<uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+} // namespace
+
+void ContourExtractor::extractSegments(const Mesh &mesh)
+{
+  const auto &P = mesh.vertexPositions();
+  const auto &T = mesh.triangleIndices();
+  const auto &radial = mesh.radialCurvatures();
+  const auto &eligible = mesh.eligibleForSuggestiveContour();
+
+  _segmentCount = 0;
+  if(radial.size() != P.size() || eligible.size() != P.size())
+    return; // no radial curvature computed for the current geometry
+  _segments = _arena.allocate<Segment>(T.size()); // at most one segment per triangle
+
+  // Every block writes its segments from its first triangle on, then the blocks are compacted
+  // in order, so that the segments stay in the triangle order
+  const size_t blockCount = (T.size() + kTriangleBlockSize - 1)/kTriangleBlockSize;
+  size_t *blockSegmentCounts = _arena.allocate<size_t>(blockCount);
+  parallel_for(0, blockCount, 1, [&](size_t firstBlock, size_t lastBlock) {
+    for(size_t block = firstBlock; block < lastBlock; ++block) {
+      Segment *out = _segments + block*kTriangleBlockSize;
+      size_t count = 0;
+      const size_t end = std::min<size_t>(T.size(), (block + 1)*kTriangleBlockSize);
+      for(size_t t = block*kTriangleBlockSize; t < end; ++t) {
+        Segment segment;
+        unsigned int crossings = 0;
+        bool keep = true;
+        for(unsigned int k = 0; k < 3; ++k) {
+          const unsigned int i = T[t][k], j = T[t][(k + 1)%3];
+          // Consistent sign convention: a triangle is crossed by zero or two edges
+          if((radial[i] < 0.f) == (radial[j] < 0.f))
+            continue;
+          const float s = radial[i]/(radial[i] - radial[j]);
+          segment.edge[crossings] = edgeKey(i, j);
+          segment.p[crossings] = P[i] + s*(P[j] - P[i]);
+          keep = keep && (eligible[i] || eligible[j]);
+          ++crossings;
+        }
+        if(crossings == 2 && keep) {
+          segment.triangle = static_cast<unsigned int>(t);
+          out[count++] = segment;
+        }
+      }
+      blockSegmentCounts[block] = count;
+    }
+  });
+
+  for(size_t block = 0; block < blockCount; ++block) {
+    const Segment *first = _segments + block*kTriangleBlockSize;
+    std::copy(first, first + blockSegmentCounts[block], _segments + _segmentCount);
+    _segmentCount += blockSegmentCounts[block];
+  }
+}
+
+void ContourExtractor::chainSegments(std::vector<ContourPolyline> &polylines)
+{
+  // Hash join on the edge keys: every manifold edge is shared by at most two segments. Open
+  // addressing with linear probing, at most half full.
+  size_t capacity = 16;
+  while(capacity < 4*_segmentCount)
+    capacity *= 2;
+  const size_t mask = capacity - 1;
+  uint64_t *keys = _arena.allocate<uint64_t>(capacity, kNoEdge);
+  unsigned int *firstOnEdge = _arena.allocate<unsigned int>(capacity);
+  unsigned int *secondOnEdge = _arena.allocate<unsigned int>(capacity);
+  auto slotOf = [&](uint64_t key) {
+    size_t slot = hashEdgeKey(key) & mask;
+    while(keys[slot] != key && keys[slot] != kNoEdge)
+      slot = (slot + 1) & mask;
+    return slot;
+  };
+  for(unsigned int s = 0; s < _segmentCount; ++s) {
+    for(unsigned int k = 0; k < 2; ++k) {
+      const size_t slot = slotOf(_segments[s].edge[k]);
+      if(keys[slot] == kNoEdge) {
+        keys[slot] = _segments[s].edge[k];
+        firstOnEdge[slot] = s;
+        secondOnEdge[slot] = kNoSegment;
+      } else if(firstOnEdge[slot] != s && secondOnEdge[slot] == kNoSegment) {
+        secondOnEdge[slot] = s;
+      }
+    }
+  }
+
+  bool *visited = _arena.allocate<bool>(_segmentCount, false);
+  // Follows the chain leaving segment s through its end 'side', appending the points to out.
+  auto walk = [&](unsigned int s, unsigned int side, std::vector<glm::vec3> &out) -> bool {
+    uint64_t key = _segments[s].edge[side];
+    for(;;) {
+      const size_t slot = slotOf(key);
+      const unsigned int next = (firstOnEdge[slot] == s) ? secondOnEdge[slot] : firstOnEdge[slot];
+      if(next == kNoSegment)
+        return false;
+      if(visited[next])
+        return true; // back to a segment of this chain: the polyline is closed
+      visited[next] = true;
+      const Segment &segment = _segments[next];
+      const unsigned int exit = (segment.edge[0] == key) ? 1 : 0;
+      out.push_back(segment.p[exit]);
+      key = segment.edge[exit];
+      s = next;
+    }
+  };
+
+  // Polyline i takes the point array of the previous polyline i: a steady view reuses them all
+  for(auto it = polylines.rbegin(); it != polylines.rend(); ++it)
+    _spare.push_back(std::move(*it));
+  polylines.clear();
+  for(unsigned int s = 0; s < _segmentCount; ++s) {
+    if(visited[s])
+      continue;
+    visited[s] = true;
+    if(_spare.empty())
+      _spare.emplace_back();
+    ContourPolyline polyline = std::move(_spare.back());
+    _spare.pop_back();
+    polyline.points.clear();
+    polyline.points.push_back(_segments[s].p[0]);
+    polyline.points.push_back(_segments[s].p[1]);
+    polyline.closed = walk(s, 1, polyline.points);
+    if(polyline.closed) {
+      polyline.points.pop_back(); // the last crossing is the first point again
+    } else {
+      // The backward part is walked after the forward one, then both are put back in order
+      const size_t forward = polyline.points.size();
+      walk(s, 0, polyline.points);
+      std::reverse(polyline.points.begin(), polyline.points.end());
+      std::reverse(polyline.points.end() - forward, polyline.points.end());
+    }
+    polylines.push_back(std::move(polyline));
+  }
+}
+
+void ContourExtractor::extract(const Mesh &mesh, std::vector<ContourPolyline> &polylines)
+{
+  SC_PROFILE_SCOPE("ContourExtractor::extract");
+  _arena.reset();
+  extractSegments(mesh);
+  chainSegments(polylines);
+}
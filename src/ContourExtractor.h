@@ -0,0 +1,59 @@
+#ifndef CONTOUR_EXTRACTOR_H
+#define CONTOUR_EXTRACTOR_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "FrameArena.h"
+
+class Mesh;
+
+// A chain of contour points. Closed polylines do not repeat their first point.
+struct ContourPolyline {
+  std::vector<glm::vec3> points;
+  bool closed = false;
+};
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Object-space extraction of suggestive contours. The zero crossings of the radial curvature
+ * are located on the mesh edges, every triangle crossed by the zero set emits one segment,
+ * segments whose crossed edges have no vertex eligible for a suggestive contour are dropped,
+ * and the remaining segments are chained into polylines by joining them on their shared edges.
+ *
+ * Triangles are processed in parallel blocks, each one writing its segments in place before
+ * they are compacted in block order. The transient buffers of an extraction come from a frame
+ * arena, and the point arrays of the previous polylines are reused, so that once the arena has
+ * grown to its high-water mark an extraction only allocates for polylines longer than before.
+ */
+class ContourExtractor {
+public:
+  // Extracts the suggestive contours of the mesh for the radial curvature computed by the last
+  // call to Mesh::calculateRadialCurvature(). The previous content of polylines is replaced.
+  void extract(const Mesh &mesh, std::vector<ContourPolyline> &polylines);
+
+  // Number of segments found by the last extraction
+  size_t segmentCount() const { return _segmentCount; }
+  const FrameArena &arena() const { return _arena; }
+
+private:
+  struct Segment {
+    unsigned int triangle;
+    uint64_t edge[2]; // keys of the two crossed mesh edges
+    glm::vec3 p[2];   // zero crossings on these edges
+  };
+
+  void extractSegments(const Mesh &mesh);
+  void chainSegments(std::vector<ContourPolyline> &polylines);
+
+  FrameArena _arena;
+  Segment *_segments = nullptr; // in the arena
+  size_t _segmentCount = 0;
+  std::vector<ContourPolyline> _spare; // polylines of the previous extraction, in reverse order
+};
+
+#endif  // CONTOUR_EXTRACTOR_H
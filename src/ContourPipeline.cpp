@@ -0,0 +1,146 @@
+#include "ContourPipeline.h"
+#include "Mesh.h"
+#include "OcclusionCuller.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <string>
+
+template <typename Fn>
+void ContourPipeline::forEachVisibleRange(unsigned int begin, unsigned int end, const Fn &fn) const
+{
+  if(_culler)
+    _culler->forEachVisibleRange(begin, end, fn);
+  else
+    fn(begin, end);
+}
+
+void ContourPipeline::reset(Mesh &mesh, ContourExtractor &extractor, std::vector<ContourPolyline> &polylines,
+                            ContourAttributeListener *listener)
+{
+  _mesh = &mesh;
+  _vertexCount = mesh.vertexPositions().size();
+  _graph.clear();
+  mesh.resizeContourAttributes();
+  _dirDeriv.assign(_vertexCount, 0.f);
+  _eligibility.assign(_vertexCount, 0);
+
+  const unsigned int vertexCount = static_cast<unsigned int>(_vertexCount);
+  const unsigned int triangleCount = static_cast<unsigned int>(mesh.triangleIndices().size());
+  const unsigned int blockSize = std::max(1u, (vertexCount + kBlockCount - 1)/kBlockCount);
+
+  if(_culler) {
+    _culler->reset(mesh);
+    _graph.addStage("occlusion culling", {MeshBuffer::Positions, MeshBuffer::Triangles}, {MeshBuffer::Visibility}, [this]() {
+      _culler->update(*_mesh, _modelViewProj);
+    });
+  }
+
+  // Radial curvature by blocks, each one uploaded as soon as it is computed
+  for(unsigned int k = 0; k < kBlockCount && k*blockSize < vertexCount; ++k) {
+    const unsigned int begin = k*blockSize, end = std::min(vertexCount, begin + blockSize);
+    _graph.addStage("radial curvature [" + std::to_string(k) + "]",
+                    {MeshBuffer::Positions, MeshBuffer::PrincipalCurvature, MeshBuffer::Visibility},
+                    {BufferRange(MeshBuffer::RadialCurvature, k)}, [this, begin, end]() {
+      parallel_for(begin, end, 1024, [&](size_t first, size_t last) {
+        forEachVisibleRange(static_cast<unsigned int>(first), static_cast<unsigned int>(last), [&](unsigned int b, unsigned int e) {
+          _mesh->calculateRadialCurvature(_cameraPosition, b, e);
+        });
+      });
+    });
+    if(listener)
+      _graph.addStage("upload radial curvature [" + std::to_string(k) + "]",
+                      {BufferRange(MeshBuffer::RadialCurvature, k)},
+                      {BufferRange(MeshBuffer::GpuRadialCurvature, k)},
+                      [this, listener, begin, end]() { listener->radialCurvatureChanged(*_mesh, begin, end); }, true);
+  }
+
+  // Independent of the view: built on the first run only, overlapping the curvature stages
+  _ringOffsets.clear();
+  _graph.addStage("one-ring", {MeshBuffer::Triangles}, {MeshBuffer::OneRing}, [this]() {
+    if(_ringOffsets.size() != _vertexCount + 1)
+      _mesh->computeOneRingAdjacency(_ringOffsets, _ring);
+  });
+
+  _graph.addStage("gradient accumulation",
+                  {MeshBuffer::Positions, MeshBuffer::Triangles, MeshBuffer::RadialCurvature, MeshBuffer::Visibility},
+                  {MeshBuffer::Gradient}, [this, triangleCount]() {
+    _gradAccum.assign(_vertexCount, glm::vec3(0.f));
+    _weightAccum.assign(_vertexCount, 0.f);
+    if(!_culler) {
+      _mesh->accumulateTriangleGradients(0, triangleCount, _gradAccum, _weightAccum);
+      return;
+    }
+    // The gradients of the culled vertices are not used: only the runs of triangles with a
+    // visible vertex are accumulated
+    const std::vector<glm::uvec3> &triangles = _mesh->triangleIndices();
+    unsigned int first = 0;
+    for(unsigned int t = 0; t < triangleCount; ++t) {
+      const glm::uvec3 &tri = triangles[t];
+      if(_culler->vertexVisible(tri[0]) || _culler->vertexVisible(tri[1]) || _culler->vertexVisible(tri[2]))
+        continue;
+      if(first < t)
+        _mesh->accumulateTriangleGradients(first, t, _gradAccum, _weightAccum);
+      first = t + 1;
+    }
+    if(first < triangleCount)
+      _mesh->accumulateTriangleGradients(first, triangleCount, _gradAccum, _weightAccum);
+  });
+
+  _graph.addStage("directional derivative",
+                  {MeshBuffer::Positions, MeshBuffer::Normals, MeshBuffer::Gradient, MeshBuffer::Visibility},
+                  {MeshBuffer::DirectionalDerivative}, [this]() {
+    parallel_for(0, _vertexCount, 4096, [&](size_t first, size_t last) {
+      forEachVisibleRange(static_cast<unsigned int>(first), static_cast<unsigned int>(last), [&](unsigned int b, unsigned int e) {
+        _mesh->computeDirectionalDerivatives(_gradAccum, _weightAccum, _cameraPosition, b, e, _dirDeriv);
+      });
+    });
+  });
+
+  _graph.addStage("thresholds",
+                  {MeshBuffer::Positions, MeshBuffer::Normals, MeshBuffer::DirectionalDerivative, MeshBuffer::Visibility},
+                  {MeshBuffer::Classification}, [this]() {
+    const SuggestiveContourThresholds thresholds;
+    parallel_for(0, _vertexCount, 4096, [&](size_t first, size_t last) {
+      forEachVisibleRange(static_cast<unsigned int>(first), static_cast<unsigned int>(last), [&](unsigned int b, unsigned int e) {
+        _mesh->classifyForSuggestiveContour(_dirDeriv, thresholds, _cameraPosition, b, e, _eligibility);
+      });
+      if(_culler)
+        _culler->forEachCulledRange(static_cast<unsigned int>(first), static_cast<unsigned int>(last),
+                                    [&](unsigned int b, unsigned int e) {
+          std::fill(_eligibility.begin() + b, _eligibility.begin() + e, 0);
+        });
+    });
+  });
+
+  _graph.addStage("hysteresis", {MeshBuffer::Classification, MeshBuffer::OneRing},
+                  {MeshBuffer::Classification, MeshBuffer::Eligibility}, [this]() {
+    _hysteresisArena.reset();
+    _mesh->resolveHysteresis(_ringOffsets.data(), _ring.data(), _eligibility.data(), _hysteresisArena);
+    _mesh->setSuggestiveContourEligibility(_eligibility);
+  });
+
+  if(listener)
+    _graph.addStage("upload eligibility", {MeshBuffer::Eligibility}, {MeshBuffer::GpuEligibility}, [this, listener, vertexCount]() {
+      listener->eligibilityChanged(*_mesh, 0, vertexCount);
+    }, true);
+
+  // Overlaps the eligibility upload
+  _graph.addStage("contour extraction",
+                  {MeshBuffer::Positions, MeshBuffer::Triangles, MeshBuffer::RadialCurvature, MeshBuffer::Eligibility},
+                  {MeshBuffer::Contours}, [this, &extractor, &polylines]() { extractor.extract(*_mesh, polylines); });
+}
+
+bool ContourPipeline::ready(const Mesh &mesh) const
+{
+  return _mesh == &mesh && _vertexCount == mesh.vertexPositions().size();
+}
+
+void ContourPipeline::run(const glm::vec3 &cameraPosition, const glm::mat4 &modelViewProj)
+{
+  if(!_mesh)
+    return;
+  _cameraPosition = cameraPosition;
+  _modelViewProj = modelViewProj;
+  _graph.run();
+}
@@ -0,0 +1,70 @@
+#ifndef CONTOUR_PIPELINE_H
+#define CONTOUR_PIPELINE_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ContourExtractor.h"
+#include "FrameArena.h"
+#include "TaskGraph.h"
+
+class Mesh;
+class ContourAttributeListener;
+class OcclusionCuller;
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * The per-frame suggestive contour pipeline expressed as a task graph: radial curvature,
+ * one-ring building, gradient accumulation, directional derivatives, thresholds, hysteresis,
+ * contour extraction and GPU uploads. It gives the same attributes as
+ * Mesh::calculateRadialCurvature(), but the one-ring building overlaps the curvature stages,
+ * and the radial curvature is computed in vertex blocks whose upload overlaps the computation
+ * of the next ones.
+ *
+ * With an occlusion culler, the vertex clusters hidden from the camera are culled first: their
+ * radial curvature and directional derivatives are not updated, the triangles with culled
+ * vertices only are not accumulated into the gradients, and the culled vertices are not
+ * eligible for suggestive contours.
+ */
+class ContourPipeline {
+public:
+  static const unsigned int kBlockCount = 8;
+
+  // Builds the stages for the mesh, whose principal curvatures must be computed. The listener,
+  // if any, is notified of the updated attributes on the thread calling run() (e.g., the GL one).
+  void reset(Mesh &mesh, ContourExtractor &extractor, std::vector<ContourPolyline> &polylines,
+             ContourAttributeListener *listener = nullptr);
+  // Whether the stages are built for the current geometry of the mesh
+  bool ready(const Mesh &mesh) const;
+  // Culler of the hidden vertices, or nullptr: must be set before reset()
+  void setOcclusionCuller(OcclusionCuller *culler) { _culler = culler; }
+  OcclusionCuller *occlusionCuller() const { return _culler; }
+
+  // The model-view-projection matrix of the mesh is only used by the occlusion culler
+  void run(const glm::vec3 &cameraPosition, const glm::mat4 &modelViewProj = glm::mat4(1.f));
+  const TaskGraph &graph() const { return _graph; }
+
+private:
+  // Calls fn(first, last) on the vertex runs of [begin, end) that are not culled
+  template <typename Fn>
+  void forEachVisibleRange(unsigned int begin, unsigned int end, const Fn &fn) const;
+
+  Mesh *_mesh = nullptr;
+  size_t _vertexCount = 0;
+  glm::vec3 _cameraPosition = glm::vec3(0.f);
+  glm::mat4 _modelViewProj = glm::mat4(1.f);
+  OcclusionCuller *_culler = nullptr;
+  TaskGraph _graph;
+
+  // Intermediate buffers of the stages; the one-ring is compressed, see Mesh::computeOneRingAdjacency()
+  std::vector<unsigned int> _ringOffsets, _ring;
+  FrameArena _hysteresisArena;
+  std::vector<glm::vec3> _gradAccum;
+  std::vector<float> _weightAccum;
+  std::vector<float> _dirDeriv;
+  std::vector<int> _eligibility;
+};
+
+#endif  // CONTOUR_PIPELINE_H
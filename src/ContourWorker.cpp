@@ -0,0 +1,119 @@
+#include "ContourWorker.h"
+#include "Mesh.h"
+#include "Profiler.h"
+
+#include <chrono>
+
+ContourWorker::~ContourWorker()
+{
+  stop();
+}
+
+void ContourWorker::start(const Mesh &mesh)
+{
+  stop();
+  _mesh = mesh.cloneGeometry();
+  _mesh->resizeContourAttributes();
+  // A new generation, so that attributes left over from a previous run are ignored
+  _takenGeneration = ++_generation;
+  _thread = std::thread(&ContourWorker::run, this);
+}
+
+void ContourWorker::stop()
+{
+  if(!_thread.joinable())
+    return;
+  Command quit;
+  quit.type = Command::Quit;
+  while(!post(quit))
+    std::this_thread::yield();
+  _thread.join();
+}
+
+bool ContourWorker::post(const Command &command)
+{
+  if(!_commands.push(command))
+    return false;
+  _wake.notify_one();
+  return true;
+}
+
+bool ContourWorker::postView(unsigned long long frame, const glm::vec3 &cameraPosition, const glm::mat4 &modelMat)
+{
+  Command view;
+  view.type = Command::View;
+  view.frame = frame;
+  view.cameraPosition = cameraPosition;
+  view.modelMat = modelMat;
+  return post(view);
+}
+
+bool ContourWorker::postSubdivide()
+{
+  Command subdivide;
+  subdivide.type = Command::Subdivide;
+  return post(subdivide);
+}
+
+const ContourAttributes *ContourWorker::fetchAttributes()
+{
+  return _attributes.fetch() ? &_attributes.front() : nullptr;
+}
+
+std::shared_ptr<Mesh> ContourWorker::takeGeometry()
+{
+  std::lock_guard<std::mutex> lock(_geometryMutex);
+  if(!_refined)
+    return nullptr;
+  _takenGeneration = _refinedGeneration;
+  return std::move(_refined);
+}
+
+void ContourWorker::computeView(const Command &view)
+{
+  SC_PROFILE_SCOPE("ContourWorker::computeView");
+  // The contour attributes are computed in the frame of the mesh
+  const glm::vec3 eye = glm::vec3(glm::inverse(view.modelMat)*glm::vec4(view.cameraPosition, 1.0));
+  _mesh->calculateRadialCurvature(eye);
+
+  ContourAttributes &out = _attributes.back();
+  out.frame = view.frame;
+  out.generation = _generation;
+  out.radialCurvature = _mesh->radialCurvatures();
+  out.eligible = _mesh->eligibleForSuggestiveContour();
+  _extractor.extract(*_mesh, out.polylines);
+  _attributes.publish();
+}
+
+void ContourWorker::run()
+{
+  Command command, lastView;
+  bool hasView = false, pendingView = false;
+  for(;;) {
+    // Drain the queue: only the most recent view matters
+    while(_commands.pop(command)) {
+      if(command.type == Command::Quit)
+        return;
+      if(command.type == Command::View) {
+        lastView = command;
+        hasView = pendingView = true;
+      } else if(command.type == Command::Subdivide) {
+        _mesh->subdivideLoop();
+        _mesh->calculatePrincipalCurvature();
+        _mesh->resizeContourAttributes();
+        ++_generation;
+        std::lock_guard<std::mutex> lock(_geometryMutex);
+        _refined = _mesh->cloneGeometry();
+        _refinedGeneration = _generation;
+        pendingView = hasView; // recompute the last view on the refined geometry
+      }
+    }
+    if(pendingView) {
+      pendingView = false;
+      computeView(lastView);
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(_wakeMutex);
+    _wake.wait_for(lock, std::chrono::milliseconds(2), [this]() { return !_commands.empty(); });
+  }
+}
@@ -0,0 +1,86 @@
+#ifndef CONTOUR_WORKER_H
+#define CONTOUR_WORKER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "ConcurrentBuffers.h"
+#include "ContourExtractor.h"
+
+class Mesh;
+
+// Contour attributes computed by the worker for one view snapshot
+struct ContourAttributes {
+  unsigned long long frame = 0;  // frame of the snapshot they were computed for
+  unsigned int generation = 0;   // geometry they belong to, see ContourWorker::generation()
+  std::vector<float> radialCurvature;
+  std::vector<bool> eligible;
+  std::vector<ContourPolyline> polylines;
+};
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Computes the contour attributes on a dedicated thread, so that the render loop never waits
+ * for curvature or subdivision work. The render thread posts camera and model matrix
+ * snapshots through a lock-free single-producer/single-consumer queue, and picks up the
+ * latest completed attributes from a lock-free triple buffer. Subdivision requests are run
+ * by the worker on its own copy of the geometry, which is handed back once refined.
+ */
+class ContourWorker {
+public:
+  ~ContourWorker();
+
+  // Starts the worker on a copy of the mesh, whose principal curvatures must be computed.
+  void start(const Mesh &mesh);
+  void stop();
+  bool running() const { return _thread.joinable(); }
+
+  // Render thread: requests. Return false if the queue is full and the request was dropped.
+  bool postView(unsigned long long frame, const glm::vec3 &cameraPosition, const glm::mat4 &modelMat);
+  bool postSubdivide();
+
+  // Render thread: latest completed attributes, or nullptr if nothing newer was published
+  const ContourAttributes *fetchAttributes();
+  // Render thread: refined geometry, or nullptr if no subdivision has completed since the last call
+  std::shared_ptr<Mesh> takeGeometry();
+  // Render thread: generation of the last geometry taken, to match against the attributes
+  unsigned int generation() const { return _takenGeneration; }
+
+private:
+  struct Command {
+    enum Type { View, Subdivide, Quit } type;
+    unsigned long long frame;
+    glm::vec3 cameraPosition;
+    glm::mat4 modelMat;
+  };
+
+  bool post(const Command &command);
+  void run();
+  void computeView(const Command &view);
+
+  std::thread _thread;
+  SpscQueue<Command> _commands{64};
+  std::mutex _wakeMutex;
+  std::condition_variable _wake;
+
+  // Worker-owned state
+  std::shared_ptr<Mesh> _mesh;
+  unsigned int _generation = 0;
+  ContourExtractor _extractor;
+  TripleBuffer<ContourAttributes> _attributes;
+
+  // Refined geometry hand-off (rare: a plain mutex is enough)
+  std::mutex _geometryMutex;
+  std::shared_ptr<Mesh> _refined;
+  unsigned int _refinedGeneration = 0;
+  unsigned int _takenGeneration = 0;
+};
+
+#endif  // CONTOUR_WORKER_H
@@ -0,0 +1,53 @@
+#include "FrameArena.h"
+
+#include <algorithm>
+
+// Bound to references by std::max: defined once, as C++14 requires
+const size_t FrameArena::kAlignment;
+const size_t FrameArena::kMinBlockSize;
+
+void FrameArena::useBlock(size_t index)
+{
+  char *memory = _blocks[index].memory.get();
+  _base = reinterpret_cast<char *>((reinterpret_cast<uintptr_t>(memory) + kAlignment - 1) & ~uintptr_t(kAlignment - 1));
+  _size = _blocks[index].size - (_base - memory);
+  _offset = 0;
+}
+
+void *FrameArena::allocateInNewBlock(size_t bytes)
+{
+  _used += _offset;
+  // Doubling the capacity bounds the number of blocks of a growing frame
+  const size_t size = std::max(std::max(kMinBlockSize, _capacity), bytes) + kAlignment;
+  _blocks.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+  _capacity += size;
+  ++_heapAllocations;
+  useBlock(_blocks.size() - 1);
+  _offset = bytes;
+  return _base;
+}
+
+void FrameArena::reset()
+{
+  _highWater = std::max(_highWater, bytesUsed());
+  ++_frames;
+  if(_blocks.size() > 1) {
+    // One block for the largest frame so far, with room for the alignment of its start and of
+    // the first allocation moved from each of the other blocks
+    const size_t size = _highWater + (_blocks.size() + 1)*kAlignment;
+    _blocks.clear();
+    _blocks.push_back(Block{std::unique_ptr<char[]>(new char[size]), size});
+    _capacity = size;
+    ++_heapAllocations;
+  }
+  _used = 0;
+  if(!_blocks.empty())
+    useBlock(0);
+}
+
+void FrameArena::release()
+{
+  _blocks.clear();
+  _base = nullptr;
+  _size = _offset = _used = _capacity = 0;
+}
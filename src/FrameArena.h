@@ -0,0 +1,90 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Bump allocator of the transient buffers of a frame. Allocations are pointer increments in the
+ * current block, a new block being taken from the heap when it is full; nothing is freed before
+ * reset(), which rewinds the arena for the next frame. After a frame that needed several blocks,
+ * reset() replaces them by a single block of the frame's high-water mark, so the capacity grows
+ * monotonically and once it covers a frame, the following ones do not touch the heap at all:
+ * heapAllocations() stops increasing.
+ *
+ * The arena hands out uninitialized arrays of trivially destructible types, aligned to a cache
+ * line. It is not thread-safe: the buffers of a frame are allocated on one thread, before the
+ * parallel kernels fill them. A copy of an arena starts empty, as the arenas of copied objects.
+ */
+class FrameArena {
+public:
+  static const size_t kAlignment = 64;
+  static const size_t kMinBlockSize = size_t(1) << 16;
+
+  FrameArena() = default;
+  FrameArena(const FrameArena &) {}
+  FrameArena &operator=(const FrameArena &) { return *this; }
+
+  // Uninitialized array of count items
+  template <typename T>
+  T *allocate(size_t count) {
+    static_assert(std::is_trivially_destructible<T>::value, "the arena never runs destructors");
+    static_assert(alignof(T) <= kAlignment, "over-aligned type");
+    return static_cast<T *>(allocateBytes(count*sizeof(T)));
+  }
+  // Array of count copies of value
+  template <typename T>
+  T *allocate(size_t count, const T &value) {
+    T *items = allocate<T>(count);
+    for(size_t i = 0; i < count; ++i)
+      items[i] = value;
+    return items;
+  }
+
+  // Frees all the allocations of the frame at once
+  void reset();
+  // Returns the memory to the heap
+  void release();
+
+  // Bytes allocated since the last reset, and their maximum over the frames
+  size_t bytesUsed() const { return _used + _offset; }
+  size_t highWaterMark() const { return _highWater; }
+  // Bytes held in blocks
+  size_t capacity() const { return _capacity; }
+  // Blocks taken from the heap since construction, and resets
+  size_t heapAllocations() const { return _heapAllocations; }
+  size_t frameCount() const { return _frames; }
+
+private:
+  struct Block {
+    std::unique_ptr<char[]> memory;
+    size_t size;
+  };
+
+  void *allocateBytes(size_t bytes) {
+    const size_t offset = (_offset + kAlignment - 1) & ~(kAlignment - 1);
+    if(offset + bytes > _size)
+      return allocateInNewBlock(bytes);
+    _offset = offset + bytes;
+    return _base + offset;
+  }
+  void *allocateInNewBlock(size_t bytes);
+  void useBlock(size_t index);
+
+  std::vector<Block> _blocks;
+  char *_base = nullptr;     // aligned start of the last block
+  size_t _size = 0;          // usable bytes from _base
+  size_t _offset = 0;        // bytes used from _base
+  size_t _used = 0;          // bytes used in the previous blocks of the frame
+  size_t _capacity = 0;
+  size_t _highWater = 0;
+  size_t _heapAllocations = 0;
+  size_t _frames = 0;
+};
+
+#endif  // FRAME_ARENA_H
@@ -0,0 +1,169 @@
+#include "InteractionRecording.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <ios>
+#include <sstream>
+
+namespace {
+
+// Nearest-rank percentile of sorted durations
+double percentile(const std::vector<double> &sorted, double p)
+{
+  if(sorted.empty())
+    return 0.0;
+  const size_t rank = static_cast<size_t>(std::ceil(p*sorted.size()));
+  return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+void writeStatistics(std::ostream &out, std::vector<double> d, const std::string &name)
+{
+  std::sort(d.begin(), d.end());
+  double total = 0.0;
+  for(double t : d)
+    total += t;
+  out << std::setw(11) << total << std::setw(11) << (d.empty() ? 0.0 : total/d.size()) << std::setw(11)
+      << percentile(d, 0.50) << std::setw(11) << percentile(d, 0.95) << std::setw(11) << percentile(d, 0.99)
+      << std::setw(11) << (d.empty() ? 0.0 : d.back()) << "  " << name << std::endl;
+}
+
+} // namespace
+
+void saveInteractionRecording(const std::string &filename, const InteractionRecording &recording)
+{
+  std::ofstream out(filename.c_str());
+  if(!out)
+    throw std::ios_base::failure("[InteractionRecording][saveInteractionRecording] Cannot open " + filename);
+  out << "SCREC 1" << std::endl;
+  out << "viewport " << recording.width << " " << recording.height << std::endl;
+  char line[1024];
+  out.write(line, std::snprintf(line, sizeof(line), "camera %.9g %.9g %.9g\ntimestep %.9g\n", recording.fov,
+                                recording.nearPlane, recording.farPlane, recording.timestep));
+  for(const RecordedFrame &frame : recording.frames) {
+    for(const RecordedKey &k : frame.keys)
+      out << "k " << k.key << " " << k.action << " " << k.mods << "\n";
+    const glm::vec3 &p = frame.cameraPosition, &r = frame.cameraRotation;
+    int n = std::snprintf(line, sizeof(line), "f %.9g %.9g %.9g %.9g %.9g %.9g", p.x, p.y, p.z, r.x, r.y, r.z);
+    for(int c = 0; c < 4; ++c)
+      for(int l = 0; l < 4; ++l)
+        n += std::snprintf(line + n, sizeof(line) - n, " %.9g", frame.modelMat[c][l]);
+    n += std::snprintf(line + n, sizeof(line) - n, " %d %u %d %d %d %d %d %d %.9g\n", frame.contourMode,
+                       frame.subdivisions, int(frame.animating), int(frame.progressive), int(frame.temporalCache),
+                       int(frame.async), int(frame.taskGraph), int(frame.occlusionCulling), frame.progressiveBudgetMs);
+    out.write(line, n);
+  }
+  if(!out)
+    throw std::ios_base::failure("[InteractionRecording][saveInteractionRecording] Cannot write " + filename);
+}
+
+void loadInteractionRecording(const std::string &filename, InteractionRecording &recording)
+{
+  std::ifstream in(filename.c_str());
+  if(!in)
+    throw std::ios_base::failure("[InteractionRecording][loadInteractionRecording] Cannot open " + filename);
+  recording = InteractionRecording();
+  std::vector<RecordedKey> keys;
+  std::string line;
+  bool header = false;
+  for(size_t number = 1; std::getline(in, line); ++number) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream ss(line);
+    std::string tag;
+    if(!(ss >> tag))
+      continue;
+    bool valid = true;
+    if(tag == "SCREC") {
+      int version = 0;
+      header = (ss >> version) && version == 1;
+      valid = header;
+    } else if(!header) {
+      valid = false;
+    } else if(tag == "viewport") {
+      valid = static_cast<bool>(ss >> recording.width >> recording.height);
+    } else if(tag == "camera") {
+      valid = static_cast<bool>(ss >> recording.fov >> recording.nearPlane >> recording.farPlane);
+    } else if(tag == "timestep") {
+      valid = static_cast<bool>(ss >> recording.timestep);
+    } else if(tag == "k") {
+      RecordedKey k;
+      valid = static_cast<bool>(ss >> k.key >> k.action >> k.mods);
+      keys.push_back(k);
+    } else if(tag == "f") {
+      RecordedFrame frame;
+      glm::vec3 &p = frame.cameraPosition, &r = frame.cameraRotation;
+      ss >> p.x >> p.y >> p.z >> r.x >> r.y >> r.z;
+      for(int c = 0; c < 4; ++c)
+        for(int l = 0; l < 4; ++l)
+          ss >> frame.modelMat[c][l];
+      int flags[6] = {0, 0, 0, 0, 0, 0};
+      ss >> frame.contourMode >> frame.subdivisions;
+      for(int &flag : flags)
+        ss >> flag;
+      ss >> frame.progressiveBudgetMs;
+      valid = static_cast<bool>(ss);
+      frame.animating = flags[0] != 0;
+      frame.progressive = flags[1] != 0;
+      frame.temporalCache = flags[2] != 0;
+      frame.async = flags[3] != 0;
+      frame.taskGraph = flags[4] != 0;
+      frame.occlusionCulling = flags[5] != 0;
+      frame.keys.swap(keys);
+      keys.clear();
+      recording.frames.push_back(frame);
+    } else {
+      valid = false;
+    }
+    if(!valid)
+      throw std::ios_base::failure("[InteractionRecording][loadInteractionRecording] Invalid line " +
+                                   std::to_string(number) + " in " + filename);
+  }
+  if(!header)
+    throw std::ios_base::failure("[InteractionRecording][loadInteractionRecording] Not a recording: " + filename);
+}
+
+void FrameTimings::writeCSV(std::ostream &out) const
+{
+  out << "frame";
+  for(const std::string &stage : _stages)
+    out << "," << stage;
+  out << ",total" << std::endl;
+  out << std::fixed << std::setprecision(4);
+  for(size_t f = 0; f < _frames.size(); ++f) {
+    double total = 0.0;
+    out << f;
+    for(double t : _frames[f]) {
+      out << "," << t;
+      total += t;
+    }
+    out << "," << total << "\n";
+  }
+  out.unsetf(std::ios_base::floatfield);
+}
+
+void FrameTimings::saveCSV(const std::string &filename) const
+{
+  std::ofstream out(filename.c_str());
+  if(!out)
+    throw std::ios_base::failure("[FrameTimings][saveCSV] Cannot open " + filename);
+  writeCSV(out);
+}
+
+void FrameTimings::writeSummary(std::ostream &out) const
+{
+  out << " > Frame timings: " << _frames.size() << " frames" << std::endl;
+  out << "   total ms    mean ms     p50 ms     p95 ms     p99 ms     max ms  stage" << std::endl;
+  out << std::fixed << std::setprecision(3);
+  std::vector<double> d(_frames.size()), totals(_frames.size(), 0.0);
+  for(size_t s = 0; s < _stages.size(); ++s) {
+    for(size_t f = 0; f < _frames.size(); ++f) {
+      d[f] = _frames[f][s];
+      totals[f] += d[f];
+    }
+    writeStatistics(out, d, _stages[s]);
+  }
+  writeStatistics(out, totals, "frame");
+  out.unsetf(std::ios_base::floatfield);
+}
@@ -0,0 +1,90 @@
+#ifndef INTERACTION_RECORDING_H
+#define INTERACTION_RECORDING_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Key event of the viewer, with the GLFW key code, action and modifiers
+struct RecordedKey {
+  int key = 0;
+  int action = 0;
+  int mods = 0;
+};
+
+// State of the viewer at one frame: the keys entered since the previous frame, the camera, the
+// model matrix of the mesh and the modes that drive the per-frame contour work
+struct RecordedFrame {
+  std::vector<RecordedKey> keys;
+  glm::vec3 cameraPosition = glm::vec3(0.f);
+  glm::vec3 cameraRotation = glm::vec3(0.f);
+  glm::mat4 modelMat = glm::mat4(1.f);
+  int contourMode = 0;
+  unsigned int subdivisions = 0;    // Loop subdivisions applied to the loaded mesh so far
+  bool animating = false;           // rotation timers running
+  bool progressive = false;
+  bool temporalCache = false;
+  bool async = false;
+  bool taskGraph = false;
+  bool occlusionCulling = false;
+  float progressiveBudgetMs = 4.f;
+};
+
+/**
+ * This struct has been created for the suggestive contouring project.
+ *
+ * An interaction with the viewer, frame by frame, to be replayed at a fixed simulated timestep
+ * so that frame times can be compared before and after a change. Saved as text:
+ *   SCREC 1
+ *   viewport <width> <height>
+ *   camera <fov in degrees> <near> <far>
+ *   timestep <seconds>
+ * then, for every frame, the lines of its keys followed by the frame line:
+ *   k <key> <action> <mods>
+ *   f <position xyz> <rotation xyz> <model matrix, 16 values by column> <contour mode>
+ *     <subdivisions> <animating> <progressive> <temporal cache> <async> <task graph>
+ *     <occlusion culling> <progressive budget>
+ * '#' starts a comment.
+ */
+struct InteractionRecording {
+  int width = 1024, height = 768;
+  float fov = 45.f, nearPlane = 0.1f, farPlane = 10.f;
+  float timestep = 1.f/60.f;
+  std::vector<RecordedFrame> frames;
+};
+
+void saveInteractionRecording(const std::string &filename, const InteractionRecording &recording);
+void loadInteractionRecording(const std::string &filename, InteractionRecording &recording);
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * CPU time of named stages, frame by frame. The frame total is the sum of its stages.
+ */
+class FrameTimings {
+public:
+  explicit FrameTimings(const std::vector<std::string> &stages) : _stages(stages) {}
+
+  const std::vector<std::string> &stages() const { return _stages; }
+  size_t frameCount() const { return _frames.size(); }
+
+  // Starts a frame whose stages are all zero
+  void beginFrame() { _frames.emplace_back(_stages.size(), 0.0); }
+  // Adds to a stage of the current frame
+  void add(size_t stage, double milliseconds) { _frames.back()[stage] += milliseconds; }
+
+  // One line per frame: frame, the stages and the total, in milliseconds
+  void writeCSV(std::ostream &out) const;
+  void saveCSV(const std::string &filename) const;
+  // Per stage and for the frame total: total, mean, p50, p95, p99 and max
+  void writeSummary(std::ostream &out) const;
+
+private:
+  std::vector<std::string> _stages;
+  std::vector<std::vector<double>> _frames;
+};
+
+#endif  // INTERACTION_RECORDING_H
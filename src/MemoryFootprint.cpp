@@ -0,0 +1,71 @@
+#include "MemoryFootprint.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char *categoryName(MemoryCategory category)
+{
+  switch(category) {
+  case MemoryCategory::Attributes: return "attributes";
+  case MemoryCategory::Caches: return "caches";
+  case MemoryCategory::Transient: return "transient";
+  case MemoryCategory::Gpu: return "gpu";
+  }
+  return "";
+}
+
+} // namespace
+
+void MemoryFootprint::add(MemoryCategory category, const std::string &name, size_t bytes, MemoryScale scale,
+                          MemoryForecast forecast)
+{
+  _entries.push_back(MemoryFootprintEntry{category, name, bytes, scale, forecast});
+}
+
+size_t MemoryFootprint::total(MemoryCategory category) const
+{
+  size_t bytes = 0;
+  for(const MemoryFootprintEntry &e : _entries)
+    if(e.category == category)
+      bytes += e.bytes;
+  return bytes;
+}
+
+void MemoryFootprint::write(std::ostream &out) const
+{
+  out << "       MiB  category    array" << std::endl;
+  out << std::fixed << std::setprecision(3);
+  for(const MemoryFootprintEntry &e : _entries)
+    out << std::setw(10) << e.bytes/1048576.0 << "  " << std::left << std::setw(12) << categoryName(e.category)
+        << std::right << e.name << std::endl;
+  for(MemoryCategory c : {MemoryCategory::Attributes, MemoryCategory::Caches, MemoryCategory::Transient, MemoryCategory::Gpu})
+    out << std::setw(10) << total(c)/1048576.0 << "  " << std::left << std::setw(12) << categoryName(c)
+        << std::right << "(total)" << std::endl;
+  out << std::setw(10) << residentBytes()/1048576.0 << "  host resident (attributes and caches)" << std::endl;
+  out.unsetf(std::ios_base::floatfield);
+}
+
+size_t availablePhysicalMemory()
+{
+#if defined(__linux__)
+  // Free memory plus the reclaimable caches
+  std::ifstream meminfo("/proc/meminfo");
+  std::string line;
+  while(std::getline(meminfo, line))
+    if(line.compare(0, 13, "MemAvailable:") == 0)
+      return static_cast<size_t>(std::strtoull(line.c_str() + 13, nullptr, 10))*1024;
+#endif
+#if defined(_SC_AVPHYS_PAGES) && defined(_SC_PAGESIZE)
+  const long pages = sysconf(_SC_AVPHYS_PAGES), pageSize = sysconf(_SC_PAGESIZE);
+  if(pages > 0 && pageSize > 0)
+    return static_cast<size_t>(pages)*static_cast<size_t>(pageSize);
+#endif
+  return 0;
+}
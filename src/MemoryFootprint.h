@@ -0,0 +1,89 @@
+#ifndef MEMORY_FOOTPRINT_H
+#define MEMORY_FOOTPRINT_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Kind of memory of a footprint entry
+enum class MemoryCategory {
+  Attributes,  // per-vertex and per-triangle arrays of the mesh
+  Caches,      // derived structures, rebuilt on demand
+  Transient,   // peaks of the temporaries of an operation, not held afterwards
+  Gpu          // buffers of the renderer
+};
+
+// What the size of a footprint entry is proportional to, to extrapolate it to another level
+enum class MemoryScale { Fixed, Vertices, Triangles };
+
+// Whether a forecast extrapolates a footprint entry by its scale, or estimates it on its own,
+// e.g., the buffers that are sized by the previous level or recomputed after a subdivision
+enum class MemoryForecast { Scaled, Estimated };
+
+struct MemoryFootprintEntry {
+  MemoryCategory category;
+  std::string name;
+  size_t bytes;
+  MemoryScale scale;
+  MemoryForecast forecast;
+};
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Bytes held by the arrays and caches of a mesh and by its GPU buffers, entry by entry. The
+ * arrays are counted at their capacity, the memory they actually hold; heap block headers and
+ * the slack of the allocator are not counted.
+ */
+class MemoryFootprint {
+public:
+  void add(MemoryCategory category, const std::string &name, size_t bytes, MemoryScale scale = MemoryScale::Fixed,
+           MemoryForecast forecast = MemoryForecast::Scaled);
+  template <typename T, typename Allocator>
+  void addArray(MemoryCategory category, const std::string &name, const std::vector<T, Allocator> &array,
+                MemoryScale scale = MemoryScale::Vertices, MemoryForecast forecast = MemoryForecast::Scaled) {
+    add(category, name, array.capacity()*sizeof(T), scale, forecast);
+  }
+  void addArray(MemoryCategory category, const std::string &name, const std::vector<bool> &array,
+                MemoryScale scale = MemoryScale::Vertices, MemoryForecast forecast = MemoryForecast::Scaled) {
+    add(category, name, (array.capacity() + 7)/8, scale, forecast);
+  }
+
+  const std::vector<MemoryFootprintEntry> &entries() const { return _entries; }
+  size_t total(MemoryCategory category) const;
+  // Host memory held: attributes and caches
+  size_t residentBytes() const { return total(MemoryCategory::Attributes) + total(MemoryCategory::Caches); }
+
+  // One line per entry, then the totals per category, in MiB
+  void write(std::ostream &out) const;
+
+private:
+  std::vector<MemoryFootprintEntry> _entries;
+};
+
+/**
+ * This struct has been created for the suggestive contouring project.
+ *
+ * Host memory of one more Loop subdivision of a mesh, followed by the recomputation of its
+ * principal curvatures, see Mesh::forecastSubdivision(). Both are totals of the mesh, not
+ * increments: residentBytes is what the mesh holds once both are done, peakBytes the most it
+ * holds at any time in between, while the current mesh, the subdivided one and the temporaries
+ * coexist. The peak is thus never below the resident bytes.
+ */
+struct SubdivisionForecast {
+  size_t vertexCount = 0, triangleCount = 0;
+  size_t residentBytes = 0;
+  size_t peakBytes = 0;
+
+  // Bytes to allocate on top of those the mesh holds now, at the highest point
+  size_t additionalBytes(size_t currentResidentBytes) const {
+    const size_t highest = peakBytes > residentBytes ? peakBytes : residentBytes;
+    return highest > currentResidentBytes ? highest - currentResidentBytes : 0;
+  }
+};
+
+// Physical memory available to the process without swapping, in bytes: 0 if unknown
+size_t availablePhysicalMemory();
+
+#endif  // MEMORY_FOOTPRINT_H
@@ -1,6 +1,8 @@
 #define _USE_MATH_DEFINES
 
 #include "Mesh.h"
+#include "Bvh.h"
+#include "Profiler.h"
 #include <cmath>
 #include <algorithm>
 #include <iostream>
@@ -10,12 +12,142 @@
 #include <string>
 #include <memory>
 #include <sstream>
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <cstdio>
+#include <limits>
+
+#if defined(SC_SOA_VERTICES) && defined(__SSE2__)
+#define SC_SOA_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Per-vertex attribute of the vertices newToOld of the oldCount current ones; attributes not
+// computed for the current vertices are left as they are
+template <typename T>
+void gatherVertexAttribute(std::vector<T> &attribute, const std::vector<unsigned int> &newToOld, size_t oldCount)
+{
+  if(attribute.size() != oldCount)
+    return;
+  std::vector<T> gathered(newToOld.size());
+  for(size_t v = 0; v < newToOld.size(); ++v)
+    gathered[v] = attribute[newToOld[v]];
+  attribute.swap(gathered);
+}
+
+// Per-vertex attribute in the new order
+template <typename T>
+void permuteVertexAttribute(std::vector<T> &attribute, const std::vector<unsigned int> &newToOld)
+{
+  gatherVertexAttribute(attribute, newToOld, newToOld.size());
+}
+
+// One-ring adjacency in compressed form, sorted and without duplicates, into offsets (vertex
+// count plus one), neighbors (six per triangle) and cursor (vertex count). Returns the number
+// of neighbors written.
+unsigned int buildOneRingAdjacency(const std::vector<glm::uvec3> &triangles, size_t vertexCount, unsigned int *offsets,
+                                   unsigned int *neighbors, unsigned int *cursor)
+{
+  // Each triangle corner contributes its two opposite vertices; duplicates are removed per vertex
+  std::fill(offsets, offsets + vertexCount + 1, 0u);
+  for (const auto &tri : triangles)
+      for (unsigned int k = 0; k < 3; ++k)
+          offsets[tri[k] + 1] += 2;
+  for (size_t v = 0; v < vertexCount; ++v)
+      offsets[v + 1] += offsets[v];
+  std::copy(offsets, offsets + vertexCount, cursor);
+  for (const auto &tri : triangles) {
+      for (unsigned int k = 0; k < 3; ++k) {
+          neighbors[cursor[tri[k]]++] = tri[(k + 1)%3];
+          neighbors[cursor[tri[k]]++] = tri[(k + 2)%3];
+      }
+  }
+  unsigned int write = 0;
+  for (size_t v = 0; v < vertexCount; ++v) {
+      unsigned int *first = neighbors + offsets[v], *last = neighbors + offsets[v + 1];
+      std::sort(first, last);
+      last = std::unique(first, last);
+      offsets[v] = write;
+      write = static_cast<unsigned int>(std::copy(first, last, neighbors + write) - neighbors);
+  }
+  offsets[vertexCount] = write;
+  return write;
+}
+
+#if defined(SC_SOA_SSE)
+// 4 consecutive vertices of a structure-of-arrays attribute. The operations follow the
+// evaluation order of their glm counterparts, so that both paths give the same floats.
+struct Vec3x4 {
+  __m128 x, y, z;
+};
+
+inline Vec3x4 load4(const SoaVec3 &a, size_t i)
+{
+  return Vec3x4{_mm_loadu_ps(a.x() + i), _mm_loadu_ps(a.y() + i), _mm_loadu_ps(a.z() + i)};
+}
+
+// 4 consecutive vertices of an array-of-structures attribute
+inline Vec3x4 transpose4(const glm::vec3 *a)
+{
+  return Vec3x4{_mm_setr_ps(a[0].x, a[1].x, a[2].x, a[3].x), _mm_setr_ps(a[0].y, a[1].y, a[2].y, a[3].y),
+                _mm_setr_ps(a[0].z, a[1].z, a[2].z, a[3].z)};
+}
+
+inline Vec3x4 sub(const Vec3x4 &a, const Vec3x4 &b)
+{
+  return Vec3x4{_mm_sub_ps(a.x, b.x), _mm_sub_ps(a.y, b.y), _mm_sub_ps(a.z, b.z)};
+}
+
+inline Vec3x4 scale(const Vec3x4 &a, __m128 s)
+{
+  return Vec3x4{_mm_mul_ps(a.x, s), _mm_mul_ps(a.y, s), _mm_mul_ps(a.z, s)};
+}
+
+inline __m128 dot(const Vec3x4 &a, const Vec3x4 &b)
+{
+  return _mm_add_ps(_mm_add_ps(_mm_mul_ps(a.x, b.x), _mm_mul_ps(a.y, b.y)), _mm_mul_ps(a.z, b.z));
+}
+
+inline Vec3x4 normalize(const Vec3x4 &a)
+{
+  return scale(a, _mm_div_ps(_mm_set1_ps(1.f), _mm_sqrt_ps(dot(a, a))));
+}
+
+inline __m128 select(__m128 mask, __m128 a, __m128 b)
+{
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// 4 vertices of an array-of-structures attribute, by index
+inline Vec3x4 gather4(const glm::vec3 *a, unsigned int i0, unsigned int i1, unsigned int i2, unsigned int i3)
+{
+  return Vec3x4{_mm_setr_ps(a[i0].x, a[i1].x, a[i2].x, a[i3].x), _mm_setr_ps(a[i0].y, a[i1].y, a[i2].y, a[i3].y),
+                _mm_setr_ps(a[i0].z, a[i1].z, a[i2].z, a[i3].z)};
+}
+
+inline Vec3x4 cross(const Vec3x4 &a, const Vec3x4 &b)
+{
+  return Vec3x4{_mm_sub_ps(_mm_mul_ps(a.y, b.z), _mm_mul_ps(b.y, a.z)),
+                _mm_sub_ps(_mm_mul_ps(a.z, b.x), _mm_mul_ps(b.z, a.x)),
+                _mm_sub_ps(_mm_mul_ps(a.x, b.y), _mm_mul_ps(b.x, a.y))};
+}
+#endif
+
+} // namespace
 
 Mesh::~Mesh()
 {
   clear();
 }
 
+std::shared_ptr<Mesh> Mesh::cloneGeometry() const
+{
+  return std::make_shared<Mesh>(*this);
+}
+
 void Mesh::computeBoundingSphere(glm::vec3 &center, float &radius) const
 {
   center = glm::vec3(0.0);
@@ -23,28 +155,237 @@ void Mesh::computeBoundingSphere(glm::vec3 &center, float &radius) const
   for(const auto &p : _vertexPositions)
     center += p;
   center /= _vertexPositions.size();
-  for(const auto &p : _vertexPositions)
-    radius = std::max(radius, distance(center, p));
+  radius = parallel_reduce(0, _vertexPositions.size(), 65536, 0.f, [&](size_t first, size_t last) {
+    float r = 0.f;
+    for(size_t v = first; v < last; ++v)
+      r = std::max(r, distance(center, _vertexPositions[v]));
+    return r;
+  }, [](float a, float b) { return std::max(a, b); });
 }
 
-void Mesh::recomputePerVertexNormals(bool angleBased)
+void Mesh::applyVertexOrder()
 {
-  _vertexNormals.clear();
-  // Change the following code to compute a proper per-vertex normal
-  _vertexNormals.resize(_vertexPositions.size(), glm::vec3(0.0, 0.0, 0.0));
-
-  for(unsigned int tIt=0 ; tIt < _triangleIndices.size() ; ++tIt) {
-    glm::uvec3 t = _triangleIndices[tIt];
-    glm::vec3 n_t = glm::cross(
-      _vertexPositions[t[1]] - _vertexPositions[t[0]],
-      _vertexPositions[t[2]] - _vertexPositions[t[0]]);
-    _vertexNormals[t[0]] += n_t;
-    _vertexNormals[t[1]] += n_t;
-    _vertexNormals[t[2]] += n_t;
+  SC_PROFILE_SCOPE("Mesh::applyVertexOrder");
+  if(_vertexOrder != VertexOrder::File)
+    reorderVertices(spatialVertexOrder(_vertexPositions, _vertexOrder));
+}
+
+void Mesh::reorderVertices(const std::vector<unsigned int> &newToOld)
+{
+  std::vector<unsigned int> oldToNew(newToOld.size());
+  for(unsigned int v = 0; v < newToOld.size(); ++v)
+    oldToNew[newToOld[v]] = v;
+  parallel_for(0, _triangleIndices.size(), 16384, [&](size_t first, size_t last) {
+    for(size_t t = first; t < last; ++t)
+      for(unsigned int k = 0; k < 3; ++k)
+        _triangleIndices[t][k] = oldToNew[_triangleIndices[t][k]];
+  });
+  permuteVertexAttribute(_vertexPositions, newToOld);
+  permuteVertexAttribute(_vertexNormals, newToOld);
+  permuteVertexAttribute(_vertexTexCoords, newToOld);
+  permuteVertexAttribute(principalCurvatureKappa1, newToOld);
+  permuteVertexAttribute(principalCurvatureKappa2, newToOld);
+  permuteVertexAttribute(principalDirectionK1, newToOld);
+  permuteVertexAttribute(principalDirectionK2, newToOld);
+  permuteVertexAttribute(radialCurvature, newToOld);
+  permuteVertexAttribute(eligible_for_suggestive_contour, newToOld);
+  invalidateBvh();
+  syncVertexAttributeStore();
+}
+
+void Mesh::applyTriangleOrder()
+{
+  SC_PROFILE_SCOPE("Mesh::applyTriangleOrder");
+  if(_triangleOrder != TriangleOrder::File)
+    reorderTriangles(vertexCacheTriangleOrder(_triangleIndices, _vertexPositions, _triangleOrder));
+}
+
+void Mesh::reorderTriangles(const std::vector<unsigned int> &newToOld)
+{
+  std::vector<glm::uvec3> permuted(newToOld.size());
+  for(size_t t = 0; t < newToOld.size(); ++t)
+    permuted[t] = _triangleIndices[newToOld[t]];
+  _triangleIndices.swap(permuted);
+  invalidateBvh();
+}
+
+MeshCleanupReport Mesh::cleanup(const MeshCleanupOptions &options)
+{
+  SC_PROFILE_SCOPE("Mesh::cleanup");
+  const size_t oldCount = _vertexPositions.size();
+  const bool hasNormals = _vertexNormals.size() == oldCount && oldCount > 0;
+  std::vector<unsigned int> newToOld;
+  _cleanupReport = cleanupMeshGeometry(_vertexPositions, _triangleIndices, options, newToOld);
+  gatherVertexAttribute(_vertexNormals, newToOld, oldCount);
+  gatherVertexAttribute(_vertexTexCoords, newToOld, oldCount);
+  gatherVertexAttribute(principalCurvatureKappa1, newToOld, oldCount);
+  gatherVertexAttribute(principalCurvatureKappa2, newToOld, oldCount);
+  gatherVertexAttribute(principalDirectionK1, newToOld, oldCount);
+  gatherVertexAttribute(principalDirectionK2, newToOld, oldCount);
+  gatherVertexAttribute(radialCurvature, newToOld, oldCount);
+  gatherVertexAttribute(eligible_for_suggestive_contour, newToOld, oldCount);
+  invalidateBvh();
+  if(hasNormals)
+    recomputePerVertexNormals();
+  syncVertexAttributeStore();
+  return _cleanupReport;
+}
+
+void Mesh::syncVertexAttributeStore()
+{
+#if defined(SC_SOA_VERTICES)
+  _positionsSoA.assign(_vertexPositions);
+  _normalsSoA.assign(_vertexNormals);
+  _principalDirectionK1SoA.clear();
+  if(principalDirectionK1.size() == _vertexPositions.size()) {
+    _principalDirectionK1SoA.resize(principalDirectionK1.size());
+    for(size_t v = 0; v < principalDirectionK1.size(); ++v)
+      _principalDirectionK1SoA.set(v, glm::normalize(principalDirectionK1[v]));
+  }
+#endif
+}
+
+const char *normalWeightingName(NormalWeighting weighting)
+{
+  switch(weighting) {
+  case NormalWeighting::Angle: return "angle";
+  case NormalWeighting::Max: return "max";
+  default: return "area";
   }
-  for(unsigned int nIt = 0 ; nIt < _vertexNormals.size() ; ++nIt) {
-    glm::normalize(_vertexNormals[nIt]);
+}
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Per-vertex normals, gathered over the corners of the incident triangles. A first pass computes
+ * the normal of every triangle, the cross product of its edges (unit for the angle weighting),
+ * and the weights of its corners: the angle, or the inverse product of the squared lengths of
+ * the two edges (Max). With SSE, 4 triangles at a time, giving the same floats as the scalar
+ * loop. The second pass sums the weighted normals of the corners of each vertex, by increasing
+ * triangle index, and normalizes: gathered per vertex on the thread pool, or scattered over the
+ * triangles with a single thread, where building the adjacency would cost more than the sums.
+ */
+void Mesh::recomputePerVertexNormals()
+{
+  SC_PROFILE_SCOPE("Mesh::recomputePerVertexNormals");
+  const size_t V = _vertexPositions.size(), T = _triangleIndices.size();
+  const NormalWeighting weighting = _normalWeighting;
+  std::vector<glm::vec3> triangleNormals(T);
+  std::vector<float> cornerWeights(weighting == NormalWeighting::Area ? 0 : 3*T);
+  const glm::vec3 *P = _vertexPositions.data();
+  parallel_for(0, T, 4096, [&](size_t first, size_t last) {
+    size_t t = first;
+#if defined(SC_SOA_SSE)
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.f);
+    for(; t + 4 <= last; t += 4) {
+      const glm::uvec3 *tri = _triangleIndices.data() + t;
+      Vec3x4 p[3];
+      for(unsigned int k = 0; k < 3; ++k)
+        p[k] = gather4(P, tri[0][k], tri[1][k], tri[2][k], tri[3][k]);
+      Vec3x4 n = cross(sub(p[1], p[0]), sub(p[2], p[0]));
+      if(weighting != NormalWeighting::Area) {
+        const Vec3x4 e[3] = {sub(p[1], p[0]), sub(p[2], p[1]), sub(p[0], p[2])};
+        const __m128 l[3] = {dot(e[0], e[0]), dot(e[1], e[1]), dot(e[2], e[2])};
+        alignas(16) float w[3][4];
+        for(unsigned int k = 0; k < 3; ++k) {
+          // Edges from corner k: e[k] and -e[k+2]
+          const __m128 ll = _mm_mul_ps(l[k], l[(k + 2)%3]), valid = _mm_cmpgt_ps(ll, zero);
+          if(weighting == NormalWeighting::Max) {
+            _mm_store_ps(w[k], select(valid, _mm_div_ps(one, ll), zero));
+          } else {
+            const Vec3x4 back = sub(Vec3x4{zero, zero, zero}, e[(k + 2)%3]);
+            const __m128 c = _mm_div_ps(dot(e[k], back), _mm_sqrt_ps(ll));
+            _mm_store_ps(w[k], _mm_max_ps(_mm_set1_ps(-1.f), _mm_min_ps(one, c)));
+            const int validLanes = _mm_movemask_ps(valid);
+            for(unsigned int i = 0; i < 4; ++i)
+              w[k][i] = (validLanes >> i) & 1 ? std::acos(w[k][i]) : 0.f;
+          }
+        }
+        for(unsigned int i = 0; i < 4; ++i)
+          for(unsigned int k = 0; k < 3; ++k)
+            cornerWeights[3*(t + i) + k] = w[k][i];
+        if(weighting == NormalWeighting::Angle) {
+          const __m128 n2 = dot(n, n);
+          n = scale(n, select(_mm_cmpgt_ps(n2, zero), _mm_div_ps(one, _mm_sqrt_ps(n2)), zero));
+        }
+      }
+      alignas(16) float x[4], y[4], z[4];
+      _mm_store_ps(x, n.x);
+      _mm_store_ps(y, n.y);
+      _mm_store_ps(z, n.z);
+      for(unsigned int i = 0; i < 4; ++i)
+        triangleNormals[t + i] = glm::vec3(x[i], y[i], z[i]);
+    }
+#endif
+    for(; t < last; ++t) {
+      const glm::uvec3 &tri = _triangleIndices[t];
+      glm::vec3 n = glm::cross(P[tri[1]] - P[tri[0]], P[tri[2]] - P[tri[0]]);
+      if(weighting != NormalWeighting::Area) {
+        const glm::vec3 e[3] = {P[tri[1]] - P[tri[0]], P[tri[2]] - P[tri[1]], P[tri[0]] - P[tri[2]]};
+        const float l[3] = {glm::dot(e[0], e[0]), glm::dot(e[1], e[1]), glm::dot(e[2], e[2])};
+        for(unsigned int k = 0; k < 3; ++k) {
+          const float ll = l[k]*l[(k + 2)%3];
+          float &w = cornerWeights[3*t + k];
+          if(!(ll > 0.f))
+            w = 0.f;
+          else if(weighting == NormalWeighting::Max)
+            w = 1.f/ll;
+          else
+            w = std::acos(std::max(-1.f, std::min(1.f, glm::dot(e[k], glm::vec3(0.f) - e[(k + 2)%3])/std::sqrt(ll))));
+        }
+        const float n2 = glm::dot(n, n);
+        if(weighting == NormalWeighting::Angle)
+          n = n*(n2 > 0.f ? 1.f/std::sqrt(n2) : 0.f);
+      }
+      triangleNormals[t] = n;
+    }
+  });
+
+  const auto normalize = [&](size_t first, size_t last) {
+    for(size_t v = first; v < last; ++v) {
+      const float length2 = glm::dot(_vertexNormals[v], _vertexNormals[v]);
+      _vertexNormals[v] = length2 > 0.f ? _vertexNormals[v]*(1.f/std::sqrt(length2)) : glm::vec3(0.f);
+    }
+  };
+  _vertexNormals.assign(V, glm::vec3(0.f));
+  if(ThreadPool::threadCount() <= 1) {
+    // Scattered over the triangles: the same sums, without building the adjacency
+    for(size_t t = 0; t < T; ++t)
+      for(unsigned int k = 0; k < 3; ++k)
+        _vertexNormals[_triangleIndices[t][k]] +=
+          weighting == NormalWeighting::Area ? triangleNormals[t] : triangleNormals[t]*cornerWeights[3*t + k];
+    normalize(0, V);
+  } else {
+    // Gathered over the corners 3t+k of each vertex, by increasing triangle
+    std::vector<unsigned int> offsets(V + 1, 0), corners(3*T);
+    for(const glm::uvec3 &tri : _triangleIndices)
+      for(unsigned int k = 0; k < 3; ++k)
+        ++offsets[tri[k] + 1];
+    for(size_t v = 0; v < V; ++v)
+      offsets[v + 1] += offsets[v];
+    {
+      std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+      for(unsigned int t = 0; t < T; ++t)
+        for(unsigned int k = 0; k < 3; ++k)
+          corners[cursor[_triangleIndices[t][k]]++] = 3*t + k;
+    }
+    parallel_for(0, V, 4096, [&](size_t first, size_t last) {
+      for(size_t v = first; v < last; ++v) {
+        glm::vec3 &sum = _vertexNormals[v];
+        if(weighting == NormalWeighting::Area)
+          for(unsigned int i = offsets[v]; i < offsets[v + 1]; ++i)
+            sum += triangleNormals[corners[i]/3];
+        else
+          for(unsigned int i = offsets[v]; i < offsets[v + 1]; ++i)
+            sum += triangleNormals[corners[i]/3]*cornerWeights[corners[i]];
+      }
+      normalize(first, last);
+    });
   }
+#if defined(SC_SOA_VERTICES)
+  _positionsSoA.assign(_vertexPositions);
+  _normalsSoA.assign(_vertexNormals);
+#endif
 }
 
 void Mesh::recomputePerVertexTextureCoordinates()
@@ -68,194 +409,312 @@ void Mesh::recomputePerVertexTextureCoordinates()
   }
 }
 
-#ifdef SUPPORT_OPENGL_45
-void Mesh::init()
+void Mesh::clear()
 {
-  glCreateBuffers(1, &_posVbo); // Generate a GPU buffer to store the positions of the vertices
-  size_t vertexBufferSize = sizeof(glm::vec3)*_vertexPositions.size(); // Gather the size of the buffer from the CPU-side vector
-  glNamedBufferStorage(_posVbo, vertexBufferSize, _vertexPositions.data(), GL_DYNAMIC_STORAGE_BIT); // Create a data store on the GPU
-
-  glCreateBuffers(1, &_normalVbo); // Same for normal
-  glNamedBufferStorage(_normalVbo, vertexBufferSize, _vertexNormals.data(), GL_DYNAMIC_STORAGE_BIT);
-
-  glCreateBuffers(1, &_texCoordVbo); // Same for texture coordinates
-  size_t texCoordBufferSize = sizeof(glm::vec2)*_vertexTexCoords.size();
-  glNamedBufferStorage(_texCoordVbo, texCoordBufferSize, _vertexTexCoords.data(), GL_DYNAMIC_STORAGE_BIT);
-
-  glCreateBuffers(1, &_ibo); // Same for the index buffer, that stores the list of indices of the triangles forming the mesh
-  size_t indexBufferSize = sizeof(glm::uvec3)*_triangleIndices.size();
-  glNamedBufferStorage(_ibo, indexBufferSize, _triangleIndices.data(), GL_DYNAMIC_STORAGE_BIT);
-
-  glCreateVertexArrays(1, &_vao); // Create a single handle that joins together attributes (vertex positions, normals) and connectivity (triangles indices)
-  glBindVertexArray(_vao);
-
-  glEnableVertexAttribArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, _posVbo);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GLfloat), 0);
-
-  glEnableVertexAttribArray(1);
-  glBindBuffer(GL_ARRAY_BUFFER, _normalVbo);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GLfloat), 0);
-
-  glEnableVertexAttribArray(2);
-  glBindBuffer(GL_ARRAY_BUFFER, _texCoordVbo);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2*sizeof(GLfloat), 0);
-
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
-  glBindVertexArray(0); // Desactive the VAO just created. Will be activated at rendering time.
+  _vertexPositions.clear();
+  _vertexNormals.clear();
+  _vertexTexCoords.clear();
+  _triangleIndices.clear();
+  _cleanupReport = MeshCleanupReport();
+  invalidateBvh();
 }
-#else
-void Mesh::init()
-{
-  //MY CODE CHOOSES WITH IF-BRANCH
-  // Generate a GPU buffer to store the positions of the vertices
-  size_t vertexBufferSize = sizeof(glm::vec3)*_vertexPositions.size();
-  glGenBuffers(1, &_posVbo);
-  glBindBuffer(GL_ARRAY_BUFFER, _posVbo);
-  glBufferData(GL_ARRAY_BUFFER, vertexBufferSize, _vertexPositions.data(), GL_DYNAMIC_READ);
-
-  // Generate a GPU buffer to store the vertex normals of the vertices
-  glGenBuffers(1, &_normalVbo);
-  glBindBuffer(GL_ARRAY_BUFFER, _normalVbo);
-  glBufferData(GL_ARRAY_BUFFER, vertexBufferSize, _vertexNormals.data(), GL_DYNAMIC_READ);
 
-  // Generate a GPU buffer to store the texture coordinates of the vertices
-  size_t texCoordBufferSize = sizeof(glm::vec2)*_vertexTexCoords.size();
-  glGenBuffers(1, &_texCoordVbo);
-  glBindBuffer(GL_ARRAY_BUFFER, _texCoordVbo);
-  glBufferData(GL_ARRAY_BUFFER, texCoordBufferSize, _vertexTexCoords.data(), GL_DYNAMIC_READ);
-
-  // Create and populate buffer for radialCurvature (location=5)
-  glGenBuffers(1, &_radialCurvatureVbo);
-  glBindBuffer(GL_ARRAY_BUFFER, _radialCurvatureVbo);
-  glBufferData(GL_ARRAY_BUFFER, radialCurvature.size() * sizeof(float), radialCurvature.data(), GL_DYNAMIC_READ);
+void Mesh::subdivideLoop1()
+{
+  SC_PROFILE_SCOPE("Mesh::subdivideLoop");
+  SubdivisionScratch &scratch = _subdivisionScratch;
+  const size_t V = _vertexPositions.size(), T = _triangleIndices.size();
+  const unsigned int kNoVertex = std::numeric_limits<unsigned int>::max();
+
+  // The edges are the slots (a, b) of the one-ring adjacency with a <= b, the rings being sorted
+  scratch.ringOffsets.resize(V + 1);
+  scratch.ring.resize(6*T);
+  scratch.cursor.resize(V);
+  scratch.ring.resize(buildOneRingAdjacency(_triangleIndices, V, scratch.ringOffsets.data(), scratch.ring.data(),
+                                            scratch.cursor.data()));
+  const unsigned int *ringOffsets = scratch.ringOffsets.data(), *ring = scratch.ring.data();
+  size_t E = 0;
+  for(unsigned int v = 0; v < V; ++v)
+    for(unsigned int i = ringOffsets[v]; i < ringOffsets[v + 1]; ++i)
+      E += ring[i] >= v;
+  auto edgeSlot = [&](unsigned int a, unsigned int b) -> unsigned int {
+    if(b < a)
+      std::swap(a, b);
+    return static_cast<unsigned int>(std::lower_bound(ring + ringOffsets[a], ring + ringOffsets[a + 1], b) - ring);
+  };
+
+  // Odd vertices numbered in the order their edge is first met, and the children written in
+  // place: the central child 4t+3 holds the odd vertices of the edges ab, bc and ca of t. Each
+  // edge counts its triangles, a triangle meeting the same edge twice (degenerate) once.
+  std::vector<glm::uvec3> newTriangles(4*T);
+  scratch.slotOddVertex.assign(scratch.ring.size(), kNoVertex);
+  scratch.oddEdges.resize(E);
+  scratch.oppositeOffsets.assign(E + 1, 0);
+  unsigned int oddCount = 0;
+  for(size_t t = 0; t < T; ++t) {
+    const glm::uvec3 &tri = _triangleIndices[t];
+    glm::uvec3 odd;
+    for(unsigned int k = 0; k < 3; ++k) {
+      const unsigned int a = tri[k], b = tri[(k + 1)%3];
+      unsigned int &slotOdd = scratch.slotOddVertex[edgeSlot(a, b)];
+      if(slotOdd == kNoVertex) {
+        scratch.oddEdges[oddCount] = glm::uvec2(std::min(a, b), std::max(a, b));
+        slotOdd = static_cast<unsigned int>(V) + oddCount++;
+      }
+      odd[k] = slotOdd;
+      if((k == 0 || odd[k] != odd[0]) && (k < 2 || odd[k] != odd[1]))
+        ++scratch.oppositeOffsets[odd[k] - V + 1];
+    }
+    newTriangles[4*t] = glm::uvec3(tri[0], odd[0], odd[2]);
+    newTriangles[4*t + 1] = glm::uvec3(odd[0], tri[1], odd[1]);
+    newTriangles[4*t + 2] = glm::uvec3(odd[2], odd[1], tri[2]);
+    newTriangles[4*t + 3] = odd;
+  }
 
-  std::vector<GLint> eligibleInt(eligible_for_suggestive_contour.size());
-  for (size_t i = 0; i < eligible_for_suggestive_contour.size(); i++) {
-      eligibleInt[i] = eligible_for_suggestive_contour[i] ? 1 : 0;
+  // Vertex opposite to each edge in each of its triangles, by increasing triangle
+  for(size_t e = 0; e < E; ++e)
+    scratch.oppositeOffsets[e + 1] += scratch.oppositeOffsets[e];
+  scratch.opposites.resize(scratch.oppositeOffsets[E]);
+  scratch.cursor.assign(scratch.oppositeOffsets.begin(), scratch.oppositeOffsets.end() - 1);
+  for(size_t t = 0; t < T; ++t) {
+    const glm::uvec3 &tri = _triangleIndices[t], &odd = newTriangles[4*t + 3];
+    for(unsigned int k = 0; k < 3; ++k)
+      if((k == 0 || odd[k] != odd[0]) && (k < 2 || odd[k] != odd[1]))
+        scratch.opposites[scratch.cursor[odd[k] - V]++] = tri[(k + 2)%3];
   }
-  glGenBuffers(1, &_eligibleForSuggestiveContourVbo);
-  glBindBuffer(GL_ARRAY_BUFFER, _eligibleForSuggestiveContourVbo);
-  glBufferData(GL_ARRAY_BUFFER, eligibleInt.size() * sizeof(GLint), eligibleInt.data(), GL_DYNAMIC_READ);
-
-  // // Generate a GPU buffer to store the index buffer that stores the list of indices of the triangles forming the mesh
-  size_t indexBufferSize = sizeof(glm::uvec3)*_triangleIndices.size();
-  glGenBuffers(1, &_ibo);
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferSize, _triangleIndices.data(), GL_DYNAMIC_READ);
-
-  // Create a single handle that joins together attributes (vertex positions, normals) and connectivity (triangles indices)
-  glGenVertexArrays(1, &_vao);
-  glBindVertexArray(_vao);
-
-  /*
-  The previous snippet treating _posVbo had the following function:
-  It sets up the storage for the vertex positions on the GPU and populates it with the data from the CPU. 
-  It only prepares the data but does not tell OpenGL how to interpret it for rendering.
-
-  This following snippet treating _posVbo has the following function:
-  It tells OpenGL how to read and interpret the data in the buffer for the enabled vertex attribute:
-    - The attribute at location 0 (likely vertex positions) is associated with _posVbo.
-    - OpenGL now knows that each vertex is represented by 3 floats.
-  */
-  glEnableVertexAttribArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, _posVbo);
-  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GLfloat), 0);
-
-  glEnableVertexAttribArray(1);
-  glBindBuffer(GL_ARRAY_BUFFER, _normalVbo);
-  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GLfloat), 0);
+  const unsigned int *oppositeOffsets = scratch.oppositeOffsets.data(), *opposites = scratch.opposites.data();
+  scratch.evenIsBoundary.assign(V, 0);
+  for(size_t e = 0; e < E; ++e)
+    if(oppositeOffsets[e + 1] - oppositeOffsets[e] == 1)
+      scratch.evenIsBoundary[scratch.oddEdges[e].x] = scratch.evenIsBoundary[scratch.oddEdges[e].y] = 1;
+
+  std::vector<glm::vec3> newVertices(V + E);
+  // Even vertices: neighbors by increasing index, as the sums of the reference implementation
+  parallel_for(0, V, 1024, [&](size_t first, size_t last) {
+    for(size_t v = first; v < last; ++v) {
+      glm::vec3 sumNeighbours(0.0, 0.0, 0.0);
+      if(!scratch.evenIsBoundary[v]) {
+        const int n = static_cast<int>(ringOffsets[v + 1] - ringOffsets[v]);
+        for(unsigned int i = ringOffsets[v]; i < ringOffsets[v + 1]; ++i)
+          sumNeighbours += _vertexPositions[ring[i]];
+        const float warren_formula = (n == 3) ? 3.0f/16.0f : 3.0f/(8.0f*n);
+        newVertices[v] = (sumNeighbours*warren_formula) + ((1 - n*warren_formula)*_vertexPositions[v]);
+      } else {
+        for(unsigned int i = ringOffsets[v]; i < ringOffsets[v + 1]; ++i)
+          if(scratch.evenIsBoundary[ring[i]])
+            sumNeighbours += _vertexPositions[ring[i]];
+        newVertices[v] = (0.125f*sumNeighbours) + (0.75f*_vertexPositions[v]);
+      }
+    }
+  });
+  // Odd vertices: midpoint of a boundary edge, else 3/8 of the edge and 1/8 of each opposite vertex
+  parallel_for(0, E, 1024, [&](size_t first, size_t last) {
+    for(size_t e = first; e < last; ++e) {
+      const glm::uvec2 &edge = scratch.oddEdges[e];
+      if(oppositeOffsets[e + 1] - oppositeOffsets[e] == 1) {
+        newVertices[V + e] = 0.5f*(_vertexPositions[edge.x] + _vertexPositions[edge.y]);
+        continue;
+      }
+      glm::vec3 positionOddVertex = 0.375f*(_vertexPositions[edge.x] + _vertexPositions[edge.y]);
+      for(unsigned int i = oppositeOffsets[e]; i < oppositeOffsets[e + 1]; ++i)
+        if(opposites[i] != edge.x && opposites[i] != edge.y)
+          positionOddVertex += 0.125f*_vertexPositions[opposites[i]];
+      newVertices[V + e] = positionOddVertex;
+    }
+  });
+
+  _lastSubdivisionTransientBytes = subdivisionTransientBytes(V, E, T);
+  // The previous arrays are freed with the temporaries
+  _triangleIndices.swap(newTriangles);
+  _vertexPositions.swap(newVertices);
+  std::vector<glm::uvec3>().swap(newTriangles);
+  std::vector<glm::vec3>().swap(newVertices);
+  invalidateBvh();
+  applyVertexOrder();
+  applyTriangleOrder();
+  recomputePerVertexNormals();
+  recomputePerVertexTextureCoordinates();
+}
 
-  
-  glEnableVertexAttribArray(2);
-  glBindBuffer(GL_ARRAY_BUFFER, _texCoordVbo);
-  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2*sizeof(GLfloat), 0);
+void Mesh::releaseSubdivisionScratch()
+{
+  SubdivisionScratch &s = _subdivisionScratch;
+  for(std::vector<unsigned int> *v : {&s.ringOffsets, &s.ring, &s.cursor, &s.slotOddVertex, &s.oppositeOffsets, &s.opposites})
+    std::vector<unsigned int>().swap(*v);
+  std::vector<glm::uvec2>().swap(s.oddEdges);
+  std::vector<uint8_t>().swap(s.evenIsBoundary);
+}
 
-  glEnableVertexAttribArray(5); // Radial curvature attribute location
-  glBindBuffer(GL_ARRAY_BUFFER, _radialCurvatureVbo);
-  glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(float), 0);
+size_t Mesh::SubdivisionScratch::memoryBytes() const
+{
+  return (ringOffsets.capacity() + ring.capacity() + cursor.capacity() + slotOddVertex.capacity() +
+          oppositeOffsets.capacity() + opposites.capacity())*sizeof(unsigned int) +
+         oddEdges.capacity()*sizeof(glm::uvec2) + evenIsBoundary.capacity();
+}
 
-  glEnableVertexAttribArray(6);
-  glBindBuffer(GL_ARRAY_BUFFER, _eligibleForSuggestiveContourVbo);
-  // Use the integer version of the attribute pointer.
-  glVertexAttribIPointer(6, 1, GL_INT, sizeof(GLint), 0);
+void Mesh::accountMemory(MemoryFootprint &footprint) const
+{
+  footprint.addArray(MemoryCategory::Attributes, "vertex positions", _vertexPositions);
+  footprint.addArray(MemoryCategory::Attributes, "vertex normals", _vertexNormals);
+  footprint.addArray(MemoryCategory::Attributes, "vertex texture coordinates", _vertexTexCoords);
+  footprint.addArray(MemoryCategory::Attributes, "triangle indices", _triangleIndices, MemoryScale::Triangles);
+  // Recomputed after a subdivision, whether or not they are now: see forecastSubdivision()
+  const MemoryScale perVertex = MemoryScale::Vertices;
+  const MemoryForecast recomputed = MemoryForecast::Estimated;
+  footprint.addArray(MemoryCategory::Attributes, "principal curvatures 1", principalCurvatureKappa1, perVertex, recomputed);
+  footprint.addArray(MemoryCategory::Attributes, "principal curvatures 2", principalCurvatureKappa2, perVertex, recomputed);
+  footprint.addArray(MemoryCategory::Attributes, "principal directions 1", principalDirectionK1, perVertex, recomputed);
+  footprint.addArray(MemoryCategory::Attributes, "principal directions 2", principalDirectionK2, perVertex, recomputed);
+  footprint.addArray(MemoryCategory::Attributes, "radial curvatures", radialCurvature);
+  footprint.addArray(MemoryCategory::Attributes, "suggestive contour eligibility", eligible_for_suggestive_contour);
+
+  const std::shared_ptr<const Bvh> bvh = std::atomic_load(&_bvh);
+  footprint.add(MemoryCategory::Caches, "bvh", bvh ? bvh->memoryBytes() : 0, MemoryScale::Triangles);
+#if defined(SC_SOA_VERTICES)
+  footprint.add(MemoryCategory::Caches, "vertex positions (SoA)", _positionsSoA.memoryBytes(), MemoryScale::Vertices);
+  footprint.add(MemoryCategory::Caches, "vertex normals (SoA)", _normalsSoA.memoryBytes(), MemoryScale::Vertices);
+  footprint.add(MemoryCategory::Caches, "principal directions 1 (SoA)", _principalDirectionK1SoA.memoryBytes(),
+                perVertex, recomputed);
+#endif
+  footprint.add(MemoryCategory::Caches, "contour frame arena", _contourArena.capacity(), MemoryScale::Vertices);
+  // Sized by the previous level, see forecastSubdivision()
+  footprint.add(MemoryCategory::Caches, "subdivision scratch", _subdivisionScratch.memoryBytes(), MemoryScale::Fixed,
+                MemoryForecast::Estimated);
 
-  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+  footprint.add(MemoryCategory::Transient, "last subdivision (peak)", _lastSubdivisionTransientBytes);
+}
 
-  glBindVertexArray(0); // Desactive the VAO just created. Will be activated at rendering time.
+size_t Mesh::subdivisionScratchBytes(size_t V, size_t E, size_t T)
+{
+  // One-ring adjacency (its neighbors at their size before deduplication), then the slots, the
+  // edges, their opposite vertices and the boundary flags
+  return ((V + 1) + 6*T + std::max(V, E) + 2*E + (E + 1) + 3*T)*sizeof(unsigned int) + E*sizeof(glm::uvec2) + V;
 }
-#endif
 
-void Mesh::render()
+size_t Mesh::subdivisionTransientBytes(size_t V, size_t E, size_t T)
 {
-  glBindVertexArray(_vao);      // Activate the VAO storing geometry data
-  glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(_triangleIndices.size()*3), GL_UNSIGNED_INT, 0);
-  // Call for rendering: stream the current GPU geometry through the current GPU program
+  const size_t newV = V + E, newT = 4*T;
+  // New positions and triangles next to the current ones, until they replace them
+  const size_t children = newV*sizeof(glm::vec3) + newT*sizeof(glm::uvec3);
+  // Then the reordering: vertex permutations, spatial keys and a permuted attribute, then the
+  // vertex-triangle adjacency, permutation and permuted triangles
+  size_t reordering = (newV - V)*sizeof(glm::vec3) + (newT - T)*sizeof(glm::uvec3);
+  reordering += newV*(2*sizeof(unsigned int) + sizeof(std::pair<uint64_t, unsigned int>) + sizeof(glm::vec3));
+  reordering += (newV + 1 + 3*newT)*sizeof(unsigned int) + newT*(sizeof(unsigned int) + sizeof(glm::uvec3));
+  return std::max(children, reordering);
 }
 
-void Mesh::clear()
+SubdivisionForecast Mesh::forecastSubdivision() const
 {
-  _vertexPositions.clear();
-  _vertexNormals.clear();
-  _vertexTexCoords.clear();
-  _triangleIndices.clear();
-  if(_vao) {
-    glDeleteVertexArrays(1, &_vao);
-    _vao = 0;
-  }
-  if(_posVbo) {
-    glDeleteBuffers(1, &_posVbo);
-    _posVbo = 0;
-  }
-  if(_normalVbo) {
-    glDeleteBuffers(1, &_normalVbo);
-    _normalVbo = 0;
-  }
-  if(_texCoordVbo) {
-    glDeleteBuffers(1, &_texCoordVbo);
-    _texCoordVbo = 0;
-  }
-  if (_radialCurvatureVbo) {
-    glDeleteBuffers(1, &_radialCurvatureVbo);
-    _radialCurvatureVbo= 0;
-    }
-  
-  if (_eligibleForSuggestiveContourVbo) {
-    glDeleteBuffers(1, &_eligibleForSuggestiveContourVbo);
-    _eligibleForSuggestiveContourVbo = 0;
+  SubdivisionForecast forecast;
+  std::vector<unsigned int> offsets, neighbors;
+  computeOneRingAdjacency(offsets, neighbors);
+  const size_t V = _vertexPositions.size(), T = _triangleIndices.size(), E = neighbors.size()/2;
+  forecast.vertexCount = V + E;
+  forecast.triangleCount = 4*T;
+
+  // The arrays keep their element sizes at the next level, the caches their bytes per item. The
+  // subdivision scratch is resized for the current level and kept.
+  MemoryFootprint current;
+  accountMemory(current);
+  const size_t scratchBytes = subdivisionScratchBytes(V, E, T);
+  forecast.residentBytes = scratchBytes;
+  // The principal curvatures are recomputed at the next level, whether or not they are now
+  forecast.residentBytes += curvatureBytes(forecast.vertexCount);
+  for(const MemoryFootprintEntry &e : current.entries()) {
+    if((e.category != MemoryCategory::Attributes && e.category != MemoryCategory::Caches) ||
+       e.forecast == MemoryForecast::Estimated)
+      continue;
+    if(e.scale == MemoryScale::Vertices && V > 0)
+      forecast.residentBytes += static_cast<size_t>(static_cast<double>(e.bytes)*forecast.vertexCount/V);
+    else if(e.scale == MemoryScale::Triangles)
+      forecast.residentBytes += 4*e.bytes;
+    else
+      forecast.residentBytes += e.bytes;
   }
+  const size_t scratchGrowth = scratchBytes - std::min(scratchBytes, _subdivisionScratch.memoryBytes());
+  // The subdivision runs next to the current mesh, the curvature on the subdivided one
+  const size_t subdivisionPeak = current.residentBytes() + scratchGrowth + subdivisionTransientBytes(V, E, T);
+  const size_t curvaturePeak = forecast.residentBytes + curvatureTransientBytes(forecast.vertexCount, forecast.triangleCount);
+  forecast.peakBytes = std::max(subdivisionPeak, curvaturePeak);
+  return forecast;
+}
 
-  if(_ibo) {
-    glDeleteBuffers(1, &_ibo);
-    _ibo = 0;
+std::shared_ptr<const Bvh> Mesh::bvh() const
+{
+  std::shared_ptr<const Bvh> bvh = std::atomic_load(&_bvh);
+  if(!bvh || !bvh->builtFor(*this)) {
+    // Concurrent first uses may both build it, which is harmless
+    auto fresh = std::make_shared<Bvh>();
+    fresh->build(*this);
+    bvh = fresh;
+    std::atomic_store(&_bvh, bvh);
   }
+  return bvh;
+}
+
+bool Mesh::raycast(const glm::vec3 &origin, const glm::vec3 &direction, RayHit &hit) const
+{
+  return bvh()->intersect(origin, direction, hit);
+}
+
+bool Mesh::pick(const glm::vec2 &windowPos, const glm::mat4 &modelView, const glm::mat4 &proj, const glm::vec4 &viewport,
+                RayHit &hit) const
+{
+  const glm::vec3 nearPoint = glm::unProject(glm::vec3(windowPos, 0.f), modelView, proj, viewport);
+  const glm::vec3 farPoint = glm::unProject(glm::vec3(windowPos, 1.f), modelView, proj, viewport);
+  return raycast(nearPoint, farPoint - nearPoint, hit);
 }
 
 
+const char *curvatureEstimatorName(CurvatureEstimator estimator)
+{
+  return (estimator == CurvatureEstimator::LeastSquares) ? "least-squares" : "triangle-tensor";
+}
+
 /**
  * This function has been created for the suggestive contouring project.
  *
- * Computes the principal curvatures and principal directions at each vertex of the mesh.
- * Curvature information is aggregated from adjacent triangles and eigen-decomposition
- * is performed on the resulting curvature tensor to extract the minimum and maximum
- * curvatures along with their corresponding directions.
+ * Computes the principal curvatures and principal directions at each vertex of the mesh,
+ * with the estimator set by setCurvatureEstimator().
  */
 void Mesh::calculatePrincipalCurvature() {
+    SC_PROFILE_SCOPE("Mesh::calculatePrincipalCurvature");
     // Resize storage for curvature results
     principalCurvatureKappa1.resize(_vertexPositions.size(), 0.0f);
     principalCurvatureKappa2.resize(_vertexPositions.size(), 0.0f);
     principalDirectionK1.resize(_vertexPositions.size(), glm::vec3(0.0f));
     principalDirectionK2.resize(_vertexPositions.size(), glm::vec3(0.0f));
 
-    // Temporary storage to accumulate curvature tensors
-    std::vector<Eigen::Matrix2d> curvatureTensors(_vertexPositions.size(), Eigen::Matrix2d::Zero());
-    std::vector<int> vertexCounts(_vertexPositions.size(), 0);
+    if (_curvatureEstimator == CurvatureEstimator::LeastSquares)
+        calculatePrincipalCurvatureLeastSquares();
+    else
+        calculatePrincipalCurvatureTriangleTensor();
+    syncVertexAttributeStore();
+}
 
-    
-    // Iterate over triangles
-    for (const auto& tri : _triangleIndices) {
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Curvature information is aggregated from adjacent triangles and eigen-decomposition
+ * is performed on the resulting curvature tensor to extract the minimum and maximum
+ * curvatures along with their corresponding directions.
+ */
+void Mesh::calculatePrincipalCurvatureTriangleTensor() {
+    // Per-triangle curvature tensors
+    std::vector<Eigen::Matrix2d> triangleTensors(_triangleIndices.size());
+    // Degenerate triangles, whose first fundamental form E G - F^2 vanishes, have no tensor
+    std::vector<uint8_t> degenerate(_triangleIndices.size());
+    parallel_for(0, _triangleIndices.size(), 4096, [&](size_t first, size_t last) {
+      for (size_t t = first; t < last; ++t) {
+        const auto& tri = _triangleIndices[t];
         unsigned int i0 = tri[0], i1 = tri[1], i2 = tri[2];
         glm::vec3 p0 = _vertexPositions[i0], p1 = _vertexPositions[i1], p2 = _vertexPositions[i2];
+        degenerate[t] = isDegenerateTriangle(p0, p1, p2);
+        if (degenerate[t]) {
+            triangleTensors[t].setZero();
+            continue;
+        }
         glm::vec3 n0 = _vertexNormals[i0], n1 = _vertexNormals[i1], n2 = _vertexNormals[i2];
 
         // Compute triangle edges and partial derivatives
@@ -269,27 +728,36 @@ void Mesh::calculatePrincipalCurvature() {
         double L = -glm::dot(dn1, e1), M = -glm::dot(dn1, e2), N = -glm::dot(dn2, e2);
 
         // Construct Weingarten matrix
-        Eigen::Matrix2d W;
+        Eigen::Matrix2d &W = triangleTensors[t];
         W(0, 0) = (L * G - M * F) / (E * G - F * F);
         W(0, 1) = (M * E - L * F) / (E * G - F * F);
         W(1, 0) = (M * E - N * F) / (E * G - F * F);
         W(1, 1) = (N * E - M * F) / (E * G - F * F);
+      }
+    });
 
-        // Assign curvature tensor to each vertex
-        for (unsigned int v : {i0, i1, i2}) {
-            curvatureTensors[v] += W;
-            vertexCounts[v]++;
-        }
-    }
+    // Incident triangles by increasing index (once per corner): the tensors are summed in the
+    // order of a scatter over the triangles
+    std::vector<unsigned int> offsets, triangles;
+    computeVertexTriangleAdjacency(offsets, triangles);
 
     // Average curvature tensors and compute eigenvalues/directions
-    for (unsigned int v = 0; v < _vertexPositions.size(); ++v) {
-      if (vertexCounts[v] > 0) {
+    parallel_for(0, _vertexPositions.size(), 1024, [&](size_t first, size_t last) {
+    for (size_t v = first; v < last; ++v) {
+      Eigen::Matrix2d curvatureTensor = Eigen::Matrix2d::Zero();
+      int vertexCount = 0;
+      for (unsigned int i = offsets[v]; i < offsets[v + 1]; ++i) {
+          if (degenerate[triangles[i]])
+              continue;
+          curvatureTensor += triangleTensors[triangles[i]];
+          vertexCount++;
+      }
+      if (vertexCount > 0) {
           // Average the curvature tensor
-          curvatureTensors[v] /= vertexCounts[v];
+          curvatureTensor /= vertexCount;
 
           // Perform eigen decomposition of the curvature tensor
-          Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> solver(curvatureTensors[v]);
+          Eigen::SelfAdjointEigenSolver<Eigen::Matrix2d> solver(curvatureTensor);
           if (solver.info() == Eigen::Success) {
               // Eigenvalues are the principal curvatures
               principalCurvatureKappa1[v] = solver.eigenvalues()(0);  // Minimum curvature
@@ -301,19 +769,20 @@ void Mesh::calculatePrincipalCurvature() {
 
               // Compute tangent plane basis vectors from 3D positions of neighbors
               glm::vec3 tangentU(0.0f), tangentV(0.0f);
-              for (const auto& tri : _triangleIndices) {
-                  if (tri[0] == v || tri[1] == v || tri[2] == v) {
-                      // Find two edges of the triangle that share vertex v
-                      unsigned int v1 = (tri[0] == v) ? tri[1] : tri[0];
-                      unsigned int v2 = (tri[0] == v || tri[1] == v) ? tri[2] : tri[1];
-
-                      glm::vec3 edge1 = _vertexPositions[v1] - _vertexPositions[v];
-                      glm::vec3 edge2 = _vertexPositions[v2] - _vertexPositions[v];
-
-                      // Use these edges to compute a local tangent basis
-                      tangentU += edge1;
-                      tangentV += edge2;
-                  }
+              for (unsigned int i = offsets[v]; i < offsets[v + 1]; ++i) {
+                  if (i > offsets[v] && triangles[i - 1] == triangles[i])
+                      continue; // each incident triangle once
+                  const auto& tri = _triangleIndices[triangles[i]];
+                  // Find two edges of the triangle that share vertex v
+                  unsigned int v1 = (tri[0] == v) ? tri[1] : tri[0];
+                  unsigned int v2 = (tri[0] == v || tri[1] == v) ? tri[2] : tri[1];
+
+                  glm::vec3 edge1 = _vertexPositions[v1] - _vertexPositions[v];
+                  glm::vec3 edge2 = _vertexPositions[v2] - _vertexPositions[v];
+
+                  // Use these edges to compute a local tangent basis
+                  tangentU += edge1;
+                  tangentV += edge2;
               }
 
               // Normalize the tangent vectors
@@ -330,6 +799,152 @@ void Mesh::calculatePrincipalCurvature() {
           }
       }
     }
+    });
+}
+
+namespace {
+
+// Shape operator of a triangle in its own orthonormal frame (t, b)
+struct TriangleCurvature {
+  glm::vec3 t, b;
+  float ku = 0.f, kuv = 0.f, kv = 0.f;
+  float weight = 0.f; // a third of the area, 0 for a degenerate triangle
+};
+
+// Rotates the frame (u, v) about the intersection of its plane with the plane of normal n,
+// so that it becomes tangent to the latter
+void rotateFrame(glm::vec3 &u, glm::vec3 &v, const glm::vec3 &n)
+{
+  const glm::vec3 oldNormal = glm::cross(u, v);
+  const float ndot = glm::dot(oldNormal, n);
+  if(ndot <= -1.f) {
+    u = -u;
+    v = -v;
+    return;
+  }
+  const glm::vec3 perpOld = n - ndot*oldNormal;
+  const glm::vec3 dperp = (oldNormal + n)/(1.f + ndot);
+  u -= dperp*glm::dot(u, perpOld);
+  v -= dperp*glm::dot(v, perpOld);
+}
+
+} // namespace
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Least-squares estimator of Rusinkiewicz (2004). On each triangle, the shape operator is
+ * fitted to the variation of the normals along its three edges. The fitted operators are then
+ * re-expressed in an orthonormal tangent frame at each vertex and averaged, weighted by a third
+ * of the triangle area, before being diagonalized. The vertex normals are normalized here, so
+ * that any weighting of recomputePerVertexNormals() can be used.
+ */
+void Mesh::calculatePrincipalCurvatureLeastSquares() {
+  const auto unitNormal = [&](unsigned int v) {
+    const float length = glm::length(_vertexNormals[v]);
+    return length > 0.f ? _vertexNormals[v]/length : glm::vec3(0.f);
+  };
+
+  std::vector<TriangleCurvature> fits(_triangleIndices.size());
+  parallel_for(0, _triangleIndices.size(), 4096, [&](size_t first, size_t last) {
+    for(size_t f = first; f < last; ++f) {
+      const glm::uvec3 &tri = _triangleIndices[f];
+      // Edge j is opposite to corner j, from corner j+2 to corner j+1
+      glm::vec3 e[3], dn[3];
+      for(unsigned int j = 0; j < 3; ++j) {
+        e[j] = _vertexPositions[tri[(j + 1) % 3]] - _vertexPositions[tri[(j + 2) % 3]];
+        // Minus the normal derivative, the sign convention of the triangle tensor estimator
+        dn[j] = unitNormal(tri[(j + 2) % 3]) - unitNormal(tri[(j + 1) % 3]);
+      }
+      const glm::vec3 normal = glm::cross(e[0], e[1]);
+      const float area2 = glm::length(normal);
+      TriangleCurvature &fit = fits[f];
+      if(!(area2 > 0.f) || glm::length(e[0]) == 0.f)
+        continue;
+      fit.t = glm::normalize(e[0]);
+      fit.b = glm::cross(normal/area2, fit.t);
+      Eigen::Matrix3d w = Eigen::Matrix3d::Zero();
+      Eigen::Vector3d m = Eigen::Vector3d::Zero();
+      for(unsigned int j = 0; j < 3; ++j) {
+        const double u = glm::dot(e[j], fit.t), v = glm::dot(e[j], fit.b);
+        const double dnu = glm::dot(dn[j], fit.t), dnv = glm::dot(dn[j], fit.b);
+        w(0, 0) += u*u;
+        w(0, 1) += u*v;
+        w(2, 2) += v*v;
+        m(0) += dnu*u;
+        m(1) += dnu*v + dnv*u;
+        m(2) += dnv*v;
+      }
+      w(1, 0) = w(0, 1);
+      w(1, 1) = w(0, 0) + w(2, 2);
+      w(1, 2) = w(2, 1) = w(0, 1);
+      const Eigen::LDLT<Eigen::Matrix3d> ldlt(w);
+      if(ldlt.info() != Eigen::Success)
+        continue;
+      const Eigen::Vector3d k = ldlt.solve(m);
+      fit.ku = static_cast<float>(k(0));
+      fit.kuv = static_cast<float>(k(1));
+      fit.kv = static_cast<float>(k(2));
+      fit.weight = area2/6.f;
+    }
+  });
+
+  std::vector<unsigned int> offsets, triangles;
+  computeVertexTriangleAdjacency(offsets, triangles);
+  parallel_for(0, _vertexPositions.size(), 1024, [&](size_t first, size_t last) {
+    for(size_t v = first; v < last; ++v) {
+      const glm::vec3 n = unitNormal(static_cast<unsigned int>(v));
+      if(n == glm::vec3(0.f))
+        continue;
+      // Tangent frame of the vertex
+      const glm::vec3 pu = glm::normalize(glm::cross(n, std::abs(n.x) < 0.9f ? glm::vec3(1.f, 0.f, 0.f) : glm::vec3(0.f, 1.f, 0.f)));
+      const glm::vec3 pv = glm::cross(n, pu);
+      float ku = 0.f, kuv = 0.f, kv = 0.f, weight = 0.f;
+      for(unsigned int i = offsets[v]; i < offsets[v + 1]; ++i) {
+        const TriangleCurvature &fit = fits[triangles[i]];
+        if(fit.weight == 0.f)
+          continue;
+        // The vertex frame, rotated into the plane of the triangle, in the triangle frame
+        glm::vec3 ru = pu, rv = pv;
+        rotateFrame(ru, rv, glm::cross(fit.t, fit.b));
+        const float u1 = glm::dot(ru, fit.t), v1 = glm::dot(ru, fit.b);
+        const float u2 = glm::dot(rv, fit.t), v2 = glm::dot(rv, fit.b);
+        ku += fit.weight*(fit.ku*u1*u1 + 2.f*fit.kuv*u1*v1 + fit.kv*v1*v1);
+        kuv += fit.weight*(fit.ku*u1*u2 + fit.kuv*(u1*v2 + u2*v1) + fit.kv*v1*v2);
+        kv += fit.weight*(fit.ku*u2*u2 + 2.f*fit.kuv*u2*v2 + fit.kv*v2*v2);
+        weight += fit.weight;
+      }
+      if(weight == 0.f)
+        continue;
+      ku /= weight;
+      kuv /= weight;
+      kv /= weight;
+      // Eigen decomposition of [[ku, kuv], [kuv, kv]]; theta is the angle of the maximum direction
+      const float mean = 0.5f*(ku + kv), radius = std::sqrt(0.25f*(ku - kv)*(ku - kv) + kuv*kuv);
+      const float theta = 0.5f*std::atan2(2.f*kuv, ku - kv);
+      const glm::vec3 maxDirection = std::cos(theta)*pu + std::sin(theta)*pv;
+      principalCurvatureKappa1[v] = mean - radius;
+      principalCurvatureKappa2[v] = mean + radius;
+      principalDirectionK1[v] = glm::cross(n, maxDirection);
+      principalDirectionK2[v] = maxDirection;
+    }
+  });
+}
+
+size_t Mesh::curvatureBytes(size_t V)
+{
+  size_t bytes = V*(2*sizeof(float) + 2*sizeof(glm::vec3));
+#if defined(SC_SOA_VERTICES)
+  bytes += (V + kSimdWidth - 1)/kSimdWidth*kSimdWidth*3*sizeof(float); // principal directions 1 (SoA)
+#endif
+  return bytes;
+}
+
+size_t Mesh::curvatureTransientBytes(size_t V, size_t T)
+{
+  // Per-triangle tensors or fits, whichever estimator is set later, then the vertex-triangle adjacency
+  const size_t perTriangle = std::max(sizeof(Eigen::Matrix2d) + sizeof(uint8_t), sizeof(TriangleCurvature));
+  return T*perTriangle + (V + 1 + 3*T)*sizeof(unsigned int);
 }
 
 
@@ -342,6 +957,7 @@ void Mesh::calculatePrincipalCurvature() {
  * @return A vector of sets, where each set contains the indices of neighboring vertices.
  */
 std::vector<std::set<unsigned int>> Mesh::computeOneRingNeighbors() const {
+  SC_PROFILE_SCOPE("Mesh::computeOneRingNeighbors");
   std::vector<std::set<unsigned int>> neighbors(_vertexPositions.size());
   for (const auto &tri : _triangleIndices) {
       neighbors[tri[0]].insert(tri[1]);
@@ -355,6 +971,65 @@ std::vector<std::set<unsigned int>> Mesh::computeOneRingNeighbors() const {
 }
 
 
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Computes the one-ring neighborhood of each vertex in compressed form. The neighbors of a
+ * vertex are sorted by increasing index, as in computeOneRingNeighbors().
+ *
+ * @param offsets Receives the number of vertices plus one offsets into neighbors.
+ * @param neighbors Receives the concatenated neighbor lists.
+ */
+void Mesh::computeOneRingAdjacency(std::vector<unsigned int> &offsets, std::vector<unsigned int> &neighbors) const {
+  SC_PROFILE_SCOPE("Mesh::computeOneRingAdjacency");
+  offsets.resize(_vertexPositions.size() + 1);
+  neighbors.resize(6*_triangleIndices.size());
+  std::vector<unsigned int> cursor(_vertexPositions.size());
+  neighbors.resize(buildOneRingAdjacency(_triangleIndices, _vertexPositions.size(), offsets.data(), neighbors.data(),
+                                         cursor.data()));
+}
+
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Same as above, the arrays being allocated in the arena. The neighbor array keeps the size of
+ * six neighbors per triangle, of which offsets[number of vertices] are used.
+ */
+void Mesh::computeOneRingAdjacency(FrameArena &arena, unsigned int *&offsets, unsigned int *&neighbors) const {
+  SC_PROFILE_SCOPE("Mesh::computeOneRingAdjacency");
+  offsets = arena.allocate<unsigned int>(_vertexPositions.size() + 1);
+  neighbors = arena.allocate<unsigned int>(6*_triangleIndices.size());
+  unsigned int *cursor = arena.allocate<unsigned int>(_vertexPositions.size());
+  buildOneRingAdjacency(_triangleIndices, _vertexPositions.size(), offsets, neighbors, cursor);
+}
+
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Computes the triangles incident to each vertex in compressed form, by increasing triangle
+ * index, so that gathering over them visits the triangles in the order of a scatter loop.
+ *
+ * @param offsets Receives the number of vertices plus one offsets into triangles.
+ * @param triangles Receives the concatenated incident triangle lists.
+ */
+void Mesh::computeVertexTriangleAdjacency(std::vector<unsigned int> &offsets, std::vector<unsigned int> &triangles) const {
+  SC_PROFILE_SCOPE("Mesh::computeVertexTriangleAdjacency");
+  offsets.assign(_vertexPositions.size() + 1, 0);
+  for (const auto &tri : _triangleIndices)
+      for (unsigned int k = 0; k < 3; ++k)
+          offsets[tri[k] + 1]++;
+  for (size_t v = 0; v < _vertexPositions.size(); ++v)
+      offsets[v + 1] += offsets[v];
+  triangles.resize(offsets.back());
+  std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+  for (unsigned int t = 0; t < _triangleIndices.size(); ++t)
+      for (unsigned int k = 0; k < 3; ++k)
+          triangles[cursor[_triangleIndices[t][k]]++] = t;
+}
+
+
 /**
  * This function has been created for the suggestive contouring project.
  *
@@ -368,23 +1043,42 @@ std::vector<std::set<unsigned int>> Mesh::computeOneRingNeighbors() const {
  */
 void Mesh::computeTriangleGradientAccumulators(std::vector<glm::vec3> &gradAccum,
                                                  std::vector<float> &weightAccum) const {
+  SC_PROFILE_SCOPE("Mesh::computeTriangleGradientAccumulators");
   // Initialize accumulators for each vertex.
   gradAccum.resize(_vertexPositions.size(), glm::vec3(0.0f));
   weightAccum.resize(_vertexPositions.size(), 0.0f);
 
-  // Loop over triangles.
-  for (const auto &tri : _triangleIndices) {
+  accumulateTriangleGradients(0, static_cast<unsigned int>(_triangleIndices.size()), gradAccum, weightAccum);
+}
+
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Accumulates the angle-weighted radial curvature gradients of the triangles [begin, end)
+ * into their vertices. The accumulators must already be sized to the number of vertices.
+ *
+ * @param begin The first triangle to process.
+ * @param end One past the last triangle to process.
+ * @param gradAccum The per-vertex accumulated gradient vectors.
+ * @param weightAccum The per-vertex accumulated weights.
+ */
+void Mesh::accumulateTriangleGradients(unsigned int begin, unsigned int end,
+                                       glm::vec3 *gradAccum, float *weightAccum) const {
+  for (unsigned int t = begin; t < end; ++t) {
+      const glm::uvec3 &tri = _triangleIndices[t];
       unsigned int i = tri[0], j = tri[1], k = tri[2];
       const glm::vec3 &p_i = _vertexPositions[i];
       const glm::vec3 &p_j = _vertexPositions[j];
       const glm::vec3 &p_k = _vertexPositions[k];
 
+      // Degenerate triangles have no gradient: see Mesh::cleanup() to remove them
+      if (isDegenerateTriangle(p_i, p_j, p_k))
+          continue;
       glm::vec3 e1 = p_j - p_i;
       glm::vec3 e2 = p_k - p_i;
       glm::vec3 n = glm::normalize(glm::cross(e1, e2));
       float area2 = glm::length(glm::cross(e1, e2));
-      if (area2 < 1e-8f)
-          continue; // Skip degenerate triangles.
 
       // Barycentric gradients.
       glm::vec3 gradLambda_i = glm::cross(n, p_k - p_j) / area2;
@@ -436,8 +1130,46 @@ void Mesh::computeTriangleGradientAccumulators(std::vector<glm::vec3> &gradAccum
 std::vector<float> Mesh::computeDirectionalDerivatives(const std::vector<glm::vec3>& gradAccum,
                                                          const std::vector<float>& weightAccum,
                                                          const glm::vec3 &cameraPosition) const {
+  SC_PROFILE_SCOPE("Mesh::computeDirectionalDerivatives");
   std::vector<float> dirDeriv(_vertexPositions.size(), 0.0f);
-  for (unsigned int v = 0; v < _vertexPositions.size(); v++) {
+  parallel_for(0, _vertexPositions.size(), 4096, [&](size_t first, size_t last) {
+    computeDirectionalDerivatives(gradAccum, weightAccum, cameraPosition,
+                                  static_cast<unsigned int>(first), static_cast<unsigned int>(last), dirDeriv);
+  });
+  return dirDeriv;
+}
+
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Range-based version of computeDirectionalDerivatives(), filling dirDeriv for the vertices
+ * [begin, end) only. dirDeriv must already be sized to the number of vertices.
+ */
+void Mesh::computeDirectionalDerivatives(const glm::vec3 *gradAccum, const float *weightAccum,
+                                         const glm::vec3 &cameraPosition,
+                                         unsigned int begin, unsigned int end,
+                                         float *dirDeriv) const {
+#if defined(SC_SOA_SSE)
+  if (_positionsSoA.size() == _vertexPositions.size() && _normalsSoA.size() == _vertexPositions.size()) {
+      const Vec3x4 camera{_mm_set1_ps(cameraPosition.x), _mm_set1_ps(cameraPosition.y), _mm_set1_ps(cameraPosition.z)};
+      const __m128 zero = _mm_setzero_ps();
+      for (; begin + 4 <= end; begin += 4) {
+          const __m128 weight = _mm_loadu_ps(&weightAccum[begin]);
+          const __m128 weighted = _mm_cmpgt_ps(weight, zero);
+          const Vec3x4 sum = transpose4(&gradAccum[begin]);
+          const Vec3x4 grad{select(weighted, _mm_div_ps(sum.x, weight), zero),
+                            select(weighted, _mm_div_ps(sum.y, weight), zero),
+                            select(weighted, _mm_div_ps(sum.z, weight), zero)};
+
+          const Vec3x4 viewVec = normalize(sub(camera, load4(_positionsSoA, begin)));
+          const Vec3x4 normal = normalize(load4(_normalsSoA, begin));
+          const Vec3x4 w = normalize(sub(viewVec, scale(normal, dot(viewVec, normal))));
+          _mm_storeu_ps(&dirDeriv[begin], dot(grad, w));
+      }
+  }
+#endif
+  for (unsigned int v = begin; v < end; v++) {
       glm::vec3 grad = (weightAccum[v] > 0.0f) ? (gradAccum[v] / weightAccum[v]) : glm::vec3(0.0f);
       
       glm::vec3 viewVec = glm::normalize(cameraPosition - _vertexPositions[v]);
@@ -449,7 +1181,6 @@ std::vector<float> Mesh::computeDirectionalDerivatives(const std::vector<glm::ve
       // Compute directional derivative along w
       dirDeriv[v] = glm::dot(grad, w);
   }
-  return dirDeriv;
 }
 
 
@@ -473,41 +1204,130 @@ std::vector<int> Mesh::applyThresholdsAndHysteresis(const std::vector<float> &di
                                                       const std::vector<std::set<unsigned int>> &neighbors,
                                                       float t_high, float t_low, float theta_c,
                                                       const glm::vec3 &cameraPosition) const {
+  SC_PROFILE_SCOPE("Mesh::applyThresholdsAndHysteresis");
   std::vector<int> eligibility(_vertexPositions.size(), 0);
   
   // Assign initial eligibility based on derivative and view conditions.
-  for (unsigned int v = 0; v < _vertexPositions.size(); v++) {
+  SuggestiveContourThresholds thresholds;
+  thresholds.tHigh = t_high;
+  thresholds.tLow = t_low;
+  thresholds.thetaC = theta_c;
+  parallel_for(0, _vertexPositions.size(), 4096, [&](size_t first, size_t last) {
+    classifyForSuggestiveContour(dirDeriv, thresholds, cameraPosition,
+                                 static_cast<unsigned int>(first), static_cast<unsigned int>(last), eligibility);
+  });
+  
+  // Hysteresis filtering: Upgrade weak vertices adjacent to strong ones.
+  resolveHysteresis(neighbors, eligibility);
+  
+  return eligibility;
+}
+
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Classifies the vertices [begin, end) as not eligible (0), weak (1) or strong (2) from their
+ * directional derivative and the view-dependent threshold angle, before hysteresis.
+ */
+void Mesh::classifyForSuggestiveContour(const float *dirDeriv,
+                                        const SuggestiveContourThresholds &thresholds,
+                                        const glm::vec3 &cameraPosition,
+                                        unsigned int begin, unsigned int end,
+                                        int *eligibility) const {
+  for (unsigned int v = begin; v < end; v++) {
       glm::vec3 viewVec = glm::normalize(cameraPosition - _vertexPositions[v]);
       glm::vec3 normal = glm::normalize(_vertexNormals[v]);
-      bool viewCondition = (glm::dot(normal, viewVec) < cos(theta_c));
+      bool viewCondition = (glm::dot(normal, viewVec) < cos(thresholds.thetaC));
       if (!viewCondition)
           eligibility[v] = 0;
-      else if (dirDeriv[v] >= t_high)
+      else if (dirDeriv[v] >= thresholds.tHigh)
           eligibility[v] = 2; // strong
-      else if (dirDeriv[v] >= t_low)
+      else if (dirDeriv[v] >= thresholds.tLow)
           eligibility[v] = 1; // weak
       else
           eligibility[v] = 0;
   }
-  
-  // Hysteresis filtering: Upgrade weak vertices adjacent to strong ones.
-  bool changed = true;
-  while (changed) {
-      changed = false;
-      for (unsigned int v = 0; v < _vertexPositions.size(); v++) {
-          if (eligibility[v] == 1) { // weak vertex
-              for (unsigned int nb : neighbors[v]) {
-                  if (eligibility[nb] == 2) {
-                      eligibility[v] = 2;
-                      changed = true;
-                      break;
-                  }
-              }
-          }
-      }
+}
+
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Upgrades all weak vertices connected to a strong one through weak vertices: the fixed point
+ * of repeated sweeps upgrading the weak vertices adjacent to strong ones, reached by a parallel
+ * breadth-first search from the strong vertices in which each weak vertex is claimed by exactly
+ * one thread.
+ */
+void Mesh::resolveHysteresis(const std::vector<std::set<unsigned int>> &neighbors,
+                             std::vector<int> &eligibility) const {
+  SC_PROFILE_SCOPE("Mesh::resolveHysteresis");
+  std::unique_ptr<std::atomic<bool>[]> claimed(new std::atomic<bool>[_vertexPositions.size()]);
+  std::vector<unsigned int> frontier;
+  for (unsigned int v = 0; v < _vertexPositions.size(); v++) {
+      claimed[v].store(eligibility[v] == 2, std::memory_order_relaxed);
+      if (eligibility[v] == 2)
+          frontier.push_back(v);
+  }
+  std::mutex nextMutex;
+  while (!frontier.empty()) {
+      std::vector<unsigned int> next;
+      parallel_for(0, frontier.size(), 256, [&](size_t first, size_t last) {
+        std::vector<unsigned int> local;
+        for (size_t f = first; f < last; ++f) {
+            for (unsigned int nb : neighbors[frontier[f]]) {
+                if (eligibility[nb] != 0 && !claimed[nb].exchange(true, std::memory_order_relaxed))
+                    local.push_back(nb);
+            }
+        }
+        std::lock_guard<std::mutex> lock(nextMutex);
+        next.insert(next.end(), local.begin(), local.end());
+      });
+      // Weak (1) and strong (2) vertices are never written during the search, only afterwards
+      for (unsigned int v : next)
+          eligibility[v] = 2;
+      frontier.swap(next);
+  }
+}
+
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * resolveHysteresis() on the compressed one-ring adjacency. The breadth-first search levels
+ * follow each other in one queue of the vertex count, as every vertex enters it at most once,
+ * so that all its buffers come from the arena.
+ */
+void Mesh::resolveHysteresis(const unsigned int *ringOffsets, const unsigned int *ring, int *eligibility,
+                             FrameArena &arena) const {
+  SC_PROFILE_SCOPE("Mesh::resolveHysteresis");
+  const size_t vertexCount = _vertexPositions.size();
+  std::atomic<bool> *claimed = arena.allocate<std::atomic<bool>>(vertexCount);
+  unsigned int *queue = arena.allocate<unsigned int>(vertexCount);
+  size_t head = 0, tail = 0;
+  for (unsigned int v = 0; v < vertexCount; v++) {
+      new (&claimed[v]) std::atomic<bool>(eligibility[v] == 2);
+      if (eligibility[v] == 2)
+          queue[tail++] = v;
+  }
+  std::atomic<size_t> cursor(tail);
+  while (head < tail) {
+      parallel_for(head, tail, 256, [&](size_t first, size_t last) {
+        for (size_t f = first; f < last; ++f) {
+            for (unsigned int n = ringOffsets[queue[f]]; n < ringOffsets[queue[f] + 1]; ++n) {
+                const unsigned int nb = ring[n];
+                if (eligibility[nb] != 0 && !claimed[nb].exchange(true, std::memory_order_relaxed))
+                    queue[cursor.fetch_add(1, std::memory_order_relaxed)] = nb;
+            }
+        }
+      });
+      // Weak (1) and strong (2) vertices are never written during the search, only afterwards
+      const size_t next = cursor.load();
+      for (size_t i = tail; i < next; ++i)
+          eligibility[queue[i]] = 2;
+      head = tail;
+      tail = next;
   }
-  
-  return eligibility;
 }
 
 
@@ -524,31 +1344,63 @@ std::vector<int> Mesh::applyThresholdsAndHysteresis(const std::vector<float> &di
 void Mesh::verify_which_vertex_is_eligible_for_in_a_suggestive_contour(const glm::vec3 &cameraPosition) {
     
     // Define thresholds
-    const float t_high = 0.005f;            // Strong derivative threshold
-    const float t_low  = 0.002f;            // Weak derivative threshold
-    const float theta_c = glm::radians(20.0f); // Minimum view angle in radians
+    const SuggestiveContourThresholds thresholds;
+    const size_t vertexCount = _vertexPositions.size();
+
+    // All the buffers below are transient: those of the previous call are released at once
+    _contourArena.reset();
 
     // Step 1: Compute triangle–wise gradient accumulators.
-    std::vector<glm::vec3> gradAccum;
-    std::vector<float> weightAccum;
-    computeTriangleGradientAccumulators(gradAccum, weightAccum);
+    glm::vec3 *gradAccum = _contourArena.allocate<glm::vec3>(vertexCount, glm::vec3(0.0f));
+    float *weightAccum = _contourArena.allocate<float>(vertexCount, 0.0f);
+    accumulateTriangleGradients(0, static_cast<unsigned int>(_triangleIndices.size()), gradAccum, weightAccum);
 
     // Step 2: Build one–ring neighbor connectivity.
-    std::vector<std::set<unsigned int>> neighbors = computeOneRingNeighbors();
+    unsigned int *ringOffsets, *ring;
+    computeOneRingAdjacency(_contourArena, ringOffsets, ring);
 
     // Step 3: Compute per–vertex directional derivatives.
-    std::vector<float> dirDeriv = computeDirectionalDerivatives(gradAccum, weightAccum, cameraPosition);
-
-    // Step 4: Apply thresholds and hysteresis filtering using the helper function.
-    std::vector<int> eligibility = applyThresholdsAndHysteresis(dirDeriv, neighbors, t_high, t_low, theta_c, cameraPosition);
+    float *dirDeriv = _contourArena.allocate<float>(vertexCount);
+    parallel_for(0, vertexCount, 4096, [&](size_t first, size_t last) {
+      computeDirectionalDerivatives(gradAccum, weightAccum, cameraPosition,
+                                    static_cast<unsigned int>(first), static_cast<unsigned int>(last), dirDeriv);
+    });
+
+    // Step 4: Apply thresholds and hysteresis filtering.
+    int *eligibility = _contourArena.allocate<int>(vertexCount);
+    parallel_for(0, vertexCount, 4096, [&](size_t first, size_t last) {
+      classifyForSuggestiveContour(dirDeriv, thresholds, cameraPosition,
+                                   static_cast<unsigned int>(first), static_cast<unsigned int>(last), eligibility);
+    });
+    resolveHysteresis(ringOffsets, ring, eligibility, _contourArena);
     
     // Final: Mark vertex eligible only if classified as strong (i.e., eligibility == 2).
+    setSuggestiveContourEligibility(eligibility);
+}
+
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Stores the final eligibility: a vertex is eligible only if classified as strong (i.e., eligibility == 2).
+ */
+void Mesh::setSuggestiveContourEligibility(const int *eligibility) {
     eligible_for_suggestive_contour.resize(_vertexPositions.size(), false);
     for (unsigned int v = 0; v < _vertexPositions.size(); v++) {
         eligible_for_suggestive_contour[v] = (eligibility[v] == 2);
     }
 }
 
+void Mesh::packSuggestiveContourEligibility(unsigned int begin, unsigned int end, int32_t *packed) const
+{
+  const unsigned int computed = std::min<unsigned int>(end, static_cast<unsigned int>(eligible_for_suggestive_contour.size()));
+  unsigned int v = begin;
+  for(; v < computed; ++v)
+    packed[v - begin] = eligible_for_suggestive_contour[v] ? 1 : 0;
+  for(; v < end; ++v)
+    packed[v - begin] = 0;
+}
+
 
 /**
  * This function has been created for the suggestive contouring project.
@@ -560,10 +1412,63 @@ void Mesh::verify_which_vertex_is_eligible_for_in_a_suggestive_contour(const glm
  * @param cameraPosition The current position of the camera.
  */
 void Mesh::calculateRadialCurvature(const glm::vec3& cameraPosition) {
+    SC_PROFILE_SCOPE("Mesh::calculateRadialCurvature");
     // Resize the storage for radial curvature
     radialCurvature.resize(_vertexPositions.size(), 0.0f);
 
-    for (unsigned int v = 0; v < _vertexPositions.size(); ++v) {
+    parallel_for(0, _vertexPositions.size(), 4096, [&](size_t first, size_t last) {
+      calculateRadialCurvature(cameraPosition, static_cast<unsigned int>(first), static_cast<unsigned int>(last));
+    });
+
+    verify_which_vertex_is_eligible_for_in_a_suggestive_contour(cameraPosition);
+}
+
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Sizes the view-dependent contour attributes to the number of vertices, so that they can be
+ * computed range by range and uploaded before being complete.
+ */
+void Mesh::resizeContourAttributes() {
+    radialCurvature.resize(_vertexPositions.size(), 0.0f);
+    eligible_for_suggestive_contour.resize(_vertexPositions.size(), false);
+}
+
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Computes the radial curvature of the vertices [begin, end) only, without updating the
+ * eligibility. The radial curvature storage must already be sized to the number of vertices.
+ *
+ * @param cameraPosition The current position of the camera.
+ * @param begin The first vertex to process.
+ * @param end One past the last vertex to process.
+ */
+void Mesh::calculateRadialCurvature(const glm::vec3& cameraPosition, unsigned int begin, unsigned int end) {
+#if defined(SC_SOA_SSE)
+    if (_positionsSoA.size() == _vertexPositions.size() && _principalDirectionK1SoA.size() == _vertexPositions.size()) {
+        const Vec3x4 camera{_mm_set1_ps(cameraPosition.x), _mm_set1_ps(cameraPosition.y), _mm_set1_ps(cameraPosition.z)};
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+        for (; begin + 4 <= end; begin += 4) {
+            const __m128 kappa1 = _mm_loadu_ps(&principalCurvatureKappa1[begin]);
+            const __m128 kappa2 = _mm_loadu_ps(&principalCurvatureKappa2[begin]);
+            // Vertices without valid principal curvatures keep their radial curvature
+            const __m128 valid = _mm_or_ps(_mm_cmpneq_ps(kappa1, zero), _mm_cmpneq_ps(kappa2, zero));
+            if (!_mm_movemask_ps(valid))
+                continue;
+
+            const Vec3x4 w = normalize(sub(camera, load4(_positionsSoA, begin)));
+            const __m128 cosPhi = dot(w, load4(_principalDirectionK1SoA, begin));
+            const __m128 sinPhi = _mm_sqrt_ps(_mm_sub_ps(one, _mm_mul_ps(cosPhi, cosPhi)));
+            const __m128 radial = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(kappa1, cosPhi), cosPhi),
+                                             _mm_mul_ps(_mm_mul_ps(kappa2, sinPhi), sinPhi));
+            _mm_storeu_ps(&radialCurvature[begin], select(valid, radial, _mm_loadu_ps(&radialCurvature[begin])));
+        }
+    }
+#endif
+    for (unsigned int v = begin; v < end; ++v) {
         if (principalCurvatureKappa1[v] == 0.0f && principalCurvatureKappa2[v] == 0.0f) {
             // Skip vertices without valid principal curvatures
             continue;
@@ -580,15 +1485,41 @@ void Mesh::calculateRadialCurvature(const glm::vec3& cameraPosition) {
         radialCurvature[v] = principalCurvatureKappa1[v] * cosPhi * cosPhi +
                              principalCurvatureKappa2[v] * sinPhi * sinPhi;
     }
+}
 
-    verify_which_vertex_is_eligible_for_in_a_suggestive_contour(cameraPosition);
+
+
+namespace {
+
+// Triangle order of a loaded mesh, with its effect on the vertex cache
+void applyTriangleOrderVerbose(Mesh &mesh)
+{
+  if(mesh.triangleOrder() == TriangleOrder::File)
+    return;
+  const VertexCacheStats before = vertexCacheStats(mesh.triangleIndices(), mesh.vertexPositions().size());
+  mesh.applyTriangleOrder();
+  const VertexCacheStats after = vertexCacheStats(mesh.triangleIndices(), mesh.vertexPositions().size());
+  std::cout << " > Triangle order <" << triangleOrderName(mesh.triangleOrder()) << ">: ACMR "
+            << before.acmr << " -> " << after.acmr << ", ATVR " << before.atvr << " -> " << after.atvr << std::endl;
 }
 
+// Cleanup of a loaded mesh, if enabled, with its report
+void cleanupLoadedMesh(Mesh &mesh)
+{
+  if(!mesh.cleanupOnLoad())
+    return;
+  const MeshCleanupReport report = mesh.cleanup(mesh.cleanupOptions());
+  std::cout << " > Cleanup: ";
+  report.write(std::cout);
+  std::cout << std::endl;
+}
 
+} // namespace
 
 // Loads an OFF mesh file. See https://en.wikipedia.org/wiki/OFF_(file_format)
 void loadOFF(const std::string &filename, std::shared_ptr<Mesh> meshPtr)
 {
+  SC_PROFILE_SCOPE("loadOFF");
   std::cout << " > Start loading mesh <" << filename << ">" << std::endl;
   meshPtr->clear();
   std::ifstream in(filename.c_str());
@@ -618,6 +1549,9 @@ void loadOFF(const std::string &filename, std::shared_ptr<Mesh> meshPtr)
   }
   std::cout << "]" << std::endl;
   in.close();
+  cleanupLoadedMesh(*meshPtr);
+  meshPtr->applyVertexOrder();
+  applyTriangleOrderVerbose(*meshPtr);
   meshPtr->vertexNormals().resize(P.size(), glm::vec3(0.f, 0.f, 1.f));
   meshPtr->vertexTexCoords().resize(P.size(), glm::vec2(0.f, 0.f));
   meshPtr->recomputePerVertexNormals();
@@ -628,6 +1562,7 @@ void loadOFF(const std::string &filename, std::shared_ptr<Mesh> meshPtr)
 // Loads an OBJ mesh file. See https://en.wikipedia.org/wiki/Wavefront_.obj_file
 void loadOBJ(const std::string &filename, std::shared_ptr<Mesh> meshPtr)
 {
+  SC_PROFILE_SCOPE("loadOBJ");
   std::cout << " > Start loading OBJ mesh <" << filename << ">" << std::endl;
   meshPtr->clear();
   
@@ -673,9 +1608,46 @@ void loadOBJ(const std::string &filename, std::shared_ptr<Mesh> meshPtr)
   
   in.close();
 
+  cleanupLoadedMesh(*meshPtr);
+  meshPtr->applyVertexOrder();
+  applyTriangleOrderVerbose(*meshPtr);
   meshPtr->vertexNormals().resize(P.size(), glm::vec3(0.f, 0.f, 1.f));
   meshPtr->vertexTexCoords().resize(P.size(), glm::vec2(0.f, 0.f));
   meshPtr->recomputePerVertexNormals();
   meshPtr->recomputePerVertexTextureCoordinates();
 }
 
+
+// Saves the mesh as OFF. The coordinates are written with 9 significant digits, so that they
+// read back as the same floats: a saved mesh reloads in the same vertex order.
+void saveOFF(const std::string &filename, const Mesh &mesh)
+{
+  SC_PROFILE_SCOPE("saveOFF");
+  std::ofstream out(filename.c_str(), std::ios::binary);
+  if(!out)
+    throw std::ios_base::failure("[Mesh Saver][saveOFF] Cannot open " + filename);
+  const auto &P = mesh.vertexPositions();
+  const auto &T = mesh.triangleIndices();
+  out << "OFF\n" << P.size() << " " << T.size() << " 0\n";
+  // Formatted in parallel by blocks of lines, written in order
+  const size_t kBlock = 65536;
+  std::vector<std::string> blocks((P.size() + kBlock - 1)/kBlock + (T.size() + kBlock - 1)/kBlock);
+  const size_t vertexBlocks = (P.size() + kBlock - 1)/kBlock;
+  parallel_for(0, blocks.size(), 1, [&](size_t first, size_t last) {
+    char line[96];
+    for(size_t b = first; b < last; ++b) {
+      std::string &block = blocks[b];
+      if(b < vertexBlocks) {
+        for(size_t i = b*kBlock; i < std::min(P.size(), (b + 1)*kBlock); ++i)
+          block.append(line, std::snprintf(line, sizeof(line), "%.9g %.9g %.9g\n", P[i].x, P[i].y, P[i].z));
+      } else {
+        for(size_t i = (b - vertexBlocks)*kBlock; i < std::min(T.size(), (b - vertexBlocks + 1)*kBlock); ++i)
+          block.append(line, std::snprintf(line, sizeof(line), "3 %u %u %u\n", T[i][0], T[i][1], T[i][2]));
+      }
+    }
+  });
+  for(const std::string &block : blocks)
+    out.write(block.data(), static_cast<std::streamsize>(block.size()));
+  if(!out)
+    throw std::ios_base::failure("[Mesh Saver][saveOFF] Cannot write " + filename);
+}
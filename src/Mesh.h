@@ -1,8 +1,8 @@
 #ifndef MESH_H
 #define MESH_H
 
-#include <glad/glad.h>
 #include <vector>
+#include <string>
 #include <memory>
 #include <Eigen>
 
@@ -13,6 +13,41 @@
 #include <map>
 #include <set>
 
+#include "ThreadPool.h"
+#include "MeshOrdering.h"
+#include "MeshCleanup.h"
+#include "VertexAttributeStore.h"
+#include "Profiler.h"
+#include "FrameArena.h"
+#include "MemoryFootprint.h"
+
+class Bvh;
+struct RayHit;
+
+// Thresholds of the suggestive contour eligibility test
+struct SuggestiveContourThresholds {
+  float tHigh = 0.005f;                // Strong derivative threshold
+  float tLow = 0.002f;                 // Weak derivative threshold
+  float thetaC = glm::radians(20.0f);  // Minimum view angle in radians
+};
+
+// Estimator of the principal curvatures at the vertices
+enum class CurvatureEstimator {
+  TriangleTensor, // average of the per-triangle shape operators, each in the basis of its own edges
+  LeastSquares    // Rusinkiewicz, "Estimating curvatures and their derivatives on triangle meshes", 2004
+};
+
+const char *curvatureEstimatorName(CurvatureEstimator estimator);
+
+// Weighting of the triangle normals summed into a vertex normal
+enum class NormalWeighting {
+  Area,   // cross product of the edges, proportional to the area of the triangle
+  Angle,  // unit normal times the angle at the vertex (Thurmer and Wuthrich, 1998)
+  Max     // cross product over the squared lengths of the two edges at the vertex (Max, 1999)
+};
+
+const char *normalWeightingName(NormalWeighting weighting);
+
 class Mesh {
 public:
   virtual ~Mesh();
@@ -29,20 +64,96 @@ public:
   const std::vector<glm::uvec3> &triangleIndices() const { return _triangleIndices; }
   std::vector<glm::uvec3> &triangleIndices() { return _triangleIndices; }
 
+  // View-dependent contour attributes, valid after calculateRadialCurvature()
+  const std::vector<float> &radialCurvatures() const { return radialCurvature; }
+  const std::vector<bool> &eligibleForSuggestiveContour() const { return eligible_for_suggestive_contour; }
+  // Valid after calculatePrincipalCurvature(): kappa1 <= kappa2, with their unit directions
+  const std::vector<float> &principalCurvatures1() const { return principalCurvatureKappa1; }
+  const std::vector<float> &principalCurvatures2() const { return principalCurvatureKappa2; }
+  const std::vector<glm::vec3> &principalDirections1() const { return principalDirectionK1; }
+  const std::vector<glm::vec3> &principalDirections2() const { return principalDirectionK2; }
+
+  /// Copy of the mesh data, e.g., to be processed by another thread
+  std::shared_ptr<Mesh> cloneGeometry() const;
+
   /// Compute the parameters of a sphere which bounds the mesh
   void computeBoundingSphere(glm::vec3 &center, float &radius) const;
 
-  void recomputePerVertexNormals(bool angleBased = false);
+  /// BVH of the triangles, built on first use. Loading and subdivision invalidate it; so must
+  /// any in-place edit of the vertex positions.
+  std::shared_ptr<const Bvh> bvh() const;
+  void invalidateBvh() { std::atomic_store(&_bvh, std::shared_ptr<const Bvh>()); }
+  /// Closest hit of the ray origin + t*direction, t > 0, with the mesh
+  bool raycast(const glm::vec3 &origin, const glm::vec3 &direction, RayHit &hit) const;
+  /// Closest hit under a window position (origin at the bottom left), see glm::unProject
+  bool pick(const glm::vec2 &windowPos, const glm::mat4 &modelView, const glm::mat4 &proj, const glm::vec4 &viewport,
+            RayHit &hit) const;
+
+  /// Space-filling curve the vertices are sorted along after loading and each subdivision level
+  VertexOrder vertexOrder() const { return _vertexOrder; }
+  void setVertexOrder(VertexOrder order) { _vertexOrder = order; }
+  /// Sorts the vertices along the vertex order curve, see reorderVertices()
+  void applyVertexOrder();
+  /// Moves the old vertex newToOld[v] to index v, with all its attributes, and remaps the triangles
+  void reorderVertices(const std::vector<unsigned int> &newToOld);
+  /// Vertex cache order the triangles are sorted in after loading and each subdivision level,
+  /// once the vertices are sorted
+  TriangleOrder triangleOrder() const { return _triangleOrder; }
+  void setTriangleOrder(TriangleOrder order) { _triangleOrder = order; }
+  /// Sorts the triangles in the triangle order, see reorderTriangles()
+  void applyTriangleOrder();
+  /// Moves the old triangle newToOld[t] to index t
+  void reorderTriangles(const std::vector<unsigned int> &newToOld);
+
+  /// With SC_SOA_VERTICES, the radial curvature and directional derivative kernels run on
+  /// structure-of-arrays copies of the positions, normals and principal directions; the
+  /// accessors above stay the reference storage. The copies are refreshed by the loaders,
+  /// subdivision, recomputePerVertexNormals() and calculatePrincipalCurvature(); any other
+  /// in-place edit of the positions or normals must call syncVertexAttributeStore().
+  void syncVertexAttributeStore();
+#if defined(SC_SOA_VERTICES)
+  const SoaVec3 &positionsSoA() const { return _positionsSoA; }
+  const SoaVec3 &normalsSoA() const { return _normalsSoA; }
+#endif
+
+  /// Unit vertex normals, sums of the normals of the incident triangles with the weighting set
+  /// by setNormalWeighting(); (0, 0, 0) at the vertices of no or only degenerate triangles
+  NormalWeighting normalWeighting() const { return _normalWeighting; }
+  void setNormalWeighting(NormalWeighting weighting) { _normalWeighting = weighting; }
+  void recomputePerVertexNormals();
   void recomputePerVertexTextureCoordinates( );
 
-  void init();
-  void initOldGL();
-  void render();
   void clear();
+
+  /// Welds the vertices and removes the degenerate and duplicate triangles and the unreferenced
+  /// vertices, see cleanupMeshGeometry(). The vertex attributes follow their vertex, the normals
+  /// are recomputed if present; the curvatures must be recomputed.
+  MeshCleanupReport cleanup(const MeshCleanupOptions &options);
+  /// Cleanup run by the loaders before sorting the vertices, off by default
+  bool cleanupOnLoad() const { return _cleanupOnLoad; }
+  const MeshCleanupOptions &cleanupOptions() const { return _cleanupOptions; }
+  void setCleanupOnLoad(bool enabled, const MeshCleanupOptions &options = MeshCleanupOptions()) {
+    _cleanupOnLoad = enabled;
+    _cleanupOptions = options;
+  }
+  /// Report of the last cleanup, e.g., at load
+  const MeshCleanupReport &cleanupReport() const { return _cleanupReport; }
+
+  // Bytes held by the arrays and caches of the mesh, with the transient peak of the last subdivision
+  void accountMemory(MemoryFootprint &footprint) const;
+  // Host memory needed by one more subdivideLoop() and the calculatePrincipalCurvature() after it,
+  // to refuse them before running out of memory
+  SubdivisionForecast forecastSubdivision() const;
+  /// Estimator used by calculatePrincipalCurvature()
+  CurvatureEstimator curvatureEstimator() const { return _curvatureEstimator; }
+  void setCurvatureEstimator(CurvatureEstimator estimator) { _curvatureEstimator = estimator; }
   void calculatePrincipalCurvature();
   void computeTriangleGradientAccumulators(std::vector<glm::vec3> &gradAccum,
                                              std::vector<float> &weightAccum) const;
   std::vector<std::set<unsigned int>> computeOneRingNeighbors() const;
+  // Compressed (CSR) adjacency: the items of vertex v are items[offsets[v]] to items[offsets[v+1]-1]
+  void computeOneRingAdjacency(std::vector<unsigned int> &offsets, std::vector<unsigned int> &neighbors) const;
+  void computeVertexTriangleAdjacency(std::vector<unsigned int> &offsets, std::vector<unsigned int> &triangles) const;
   std::vector<float> computeDirectionalDerivatives(const std::vector<glm::vec3>& gradAccum,
                                                    const std::vector<float>& weightAccum,
                                                    const glm::vec3 &cameraPosition) const;
@@ -53,222 +164,83 @@ public:
   void verify_which_vertex_is_eligible_for_in_a_suggestive_contour(const glm::vec3 &cameraPosition);
   void calculateRadialCurvature(const glm::vec3& cameraPosition);
 
-  void subdivideLoop1()
-  {
-    // Declare new vertices and new triangles. Initialize the new positions for the even vertices with (0,0,0):
-    std::vector<glm::vec3> newVertices( _vertexPositions.size() , glm::vec3(0,0,0) );
-    std::vector<glm::uvec3> newTriangles;
-
-    struct Edge {
-      unsigned int a , b;
-      Edge( unsigned int c , unsigned int d ) : a( std::min<unsigned int>(c,d) ) , b( std::max<unsigned int>(c,d) ) {}
-      bool operator < ( Edge const & o ) const {   return a < o.a  ||  (a == o.a && b < o.b);  }
-      bool operator == ( Edge const & o ) const {   return a == o.a  &&  b == o.b;  }
-    };
-
-    std::map< Edge , unsigned int > newVertexOnEdge; // this will be useful to find out whether we already inserted an odd vertex or not
-    std::map< Edge , std::set< unsigned int > > trianglesOnEdge; // this will be useful to find out if an edge is boundary or not
-    std::vector< std::set< unsigned int > > neighboringVertices( _vertexPositions.size() ); // this will be used to store the adjacent vertices, i.e., neighboringVertices[i] will be the list of vertices that are adjacent to vertex i.
-    std::vector< bool > evenVertexIsBoundary( _vertexPositions.size() , false );
-
-
-    for(unsigned int tIt = 0 ; tIt < _triangleIndices.size() ; ++tIt) {
-      unsigned int a = _triangleIndices[tIt][0];
-      unsigned int b = _triangleIndices[tIt][1];
-      unsigned int c = _triangleIndices[tIt][2];
-
-
-      Edge Eab(a,b);
-      Edge Ebc(b,c);
-      Edge Eca(c,a);
-
-      trianglesOnEdge[Eab].insert(tIt);
-      trianglesOnEdge[Ebc].insert(tIt);
-      trianglesOnEdge[Eca].insert(tIt);
-
-      neighboringVertices[ a ].insert( b );
-      neighboringVertices[ a ].insert( c );
-      neighboringVertices[ b ].insert( a );
-      neighboringVertices[ b ].insert( c );
-      neighboringVertices[ c ].insert( a );
-      neighboringVertices[ c ].insert( b );
-    }
-    std::vector< unsigned int > evenVertexValence( _vertexPositions.size() , 0 );
-    for( unsigned int v = 0 ; v < _vertexPositions.size() ; ++v ) {
-      evenVertexValence[ v ] = neighboringVertices[ v ].size();
-    }
-
-    for (const auto& pair : trianglesOnEdge) {
-    const Edge& edge = pair.first;
-    const std::set<unsigned int>& triangles = pair.second;
-    if (triangles.size() == 1) {
-        evenVertexIsBoundary[edge.a] = true;
-        evenVertexIsBoundary[edge.b] = true;
-      }
-    }
-    
-    for(unsigned int v = 0 ; v < _vertexPositions.size() ; ++v) {
-      glm::vec3 sumNeighbours(0.0,0.0,0.0);
-    if(evenVertexIsBoundary[v]==false)
-    {
-      int n= evenVertexValence[ v ];
-
-      for(unsigned int u : neighboringVertices[v]) {
-        sumNeighbours+=_vertexPositions[u];
-      }
-
-      float warren_formula;
-      if (n==3)
-      {
-        warren_formula= 3.0f/16.0f;
-      }
-      else
-      {
-        warren_formula= 3.0f/(8.0f*n);
-      }
-
-      newVertices[v]=(sumNeighbours*warren_formula) + ((1-n*warren_formula)*_vertexPositions[v]);
-    }
-    else
-    {
-
-      for(unsigned int u : neighboringVertices[v]) {
-        if(evenVertexIsBoundary[u]==true)
-        {
-          sumNeighbours+=_vertexPositions[u];
-        }
-      }
-
-      newVertices[v]=(0.125f*sumNeighbours) + (0.75f*_vertexPositions[v]);
-    }
-
-
-    }
-      
-    for(unsigned int tIt = 0 ; tIt < _triangleIndices.size() ; ++tIt) {
-      unsigned int a = _triangleIndices[tIt][0];
-      unsigned int b = _triangleIndices[tIt][1];
-      unsigned int c = _triangleIndices[tIt][2];
-
-
-      Edge Eab(a,b);
-      unsigned int oddVertexOnEdgeEab = 0;
-      if( newVertexOnEdge.find( Eab ) == newVertexOnEdge.end() ) {
-        newVertices.push_back( glm::vec3(0,0,0) );
-        oddVertexOnEdgeEab = newVertices.size() - 1;
-        newVertexOnEdge[Eab] = oddVertexOnEdgeEab;
-      }
-      else { oddVertexOnEdgeEab = newVertexOnEdge[Eab]; }
-
-      if (trianglesOnEdge[Eab].size() == 1) {
-        newVertices[oddVertexOnEdgeEab] = 0.5f * (_vertexPositions[a] + _vertexPositions[b]);
-      } 
-      
-      else {
-
-        glm::vec3 positionOddVertex = 0.375f * (_vertexPositions[a] + _vertexPositions[b]);
-
-        for (unsigned int triangleIndex :  trianglesOnEdge[Eab])
-        {
-          const glm::uvec3 &triangleOfEdge = _triangleIndices[triangleIndex];
-          for (unsigned int vertex : {triangleOfEdge[0],triangleOfEdge[1],triangleOfEdge[2]})
-          {
-            if (vertex!=a && vertex!=b)
-            {
-              positionOddVertex+=0.125f*_vertexPositions[vertex];
-            }
-          }
-        }
-
-        newVertices[oddVertexOnEdgeEab] = positionOddVertex;
-    
-      }
-
-
-
-      Edge Ebc(b,c);
-      unsigned int oddVertexOnEdgeEbc = 0;
-      if( newVertexOnEdge.find( Ebc ) == newVertexOnEdge.end() ) {
-        newVertices.push_back( glm::vec3(0,0,0) );
-        oddVertexOnEdgeEbc = newVertices.size() - 1;
-        newVertexOnEdge[Ebc] = oddVertexOnEdgeEbc;
-      }
-      else { oddVertexOnEdgeEbc = newVertexOnEdge[Ebc]; }      
-      if (trianglesOnEdge[Ebc].size() == 1) {
-        newVertices[oddVertexOnEdgeEbc] = 0.5f * (_vertexPositions[b] + _vertexPositions[c]);
-      } 
-      
-      else {
-
-        glm::vec3 positionOddVertex = 0.375f * (_vertexPositions[b] + _vertexPositions[c]);
-
-        for (unsigned int triangleIndex :  trianglesOnEdge[Ebc])
-        {
-          const glm::uvec3 &triangleOfEdge = _triangleIndices[triangleIndex];
-          for (unsigned int vertex : {triangleOfEdge[0],triangleOfEdge[1],triangleOfEdge[2]})
-          {
-            if (vertex!=b && vertex!=c)
-            {
-              positionOddVertex+=0.125f*_vertexPositions[vertex];
-            }
-          }
-        }
-
-        newVertices[oddVertexOnEdgeEbc] = positionOddVertex;
-    
-      }
-
-      Edge Eca(c,a);
-      unsigned int oddVertexOnEdgeEca = 0;
-      if( newVertexOnEdge.find( Eca ) == newVertexOnEdge.end() ) {
-        newVertices.push_back( glm::vec3(0,0,0) );
-        oddVertexOnEdgeEca = newVertices.size() - 1;
-        newVertexOnEdge[Eca] = oddVertexOnEdgeEca;
-      }
-      else { oddVertexOnEdgeEca = newVertexOnEdge[Eca]; }
-
-      if (trianglesOnEdge[Eca].size() == 1) {
-        newVertices[oddVertexOnEdgeEca] = 0.5f * (_vertexPositions[c] + _vertexPositions[a]);
-      } 
-      
-      else {
-
-        glm::vec3 positionOddVertex = 0.375f * (_vertexPositions[c] + _vertexPositions[a]);
-
-        for (unsigned int triangleIndex :  trianglesOnEdge[Eca])
-        {
-          const glm::uvec3 &triangleOfEdge = _triangleIndices[triangleIndex];
-          for (unsigned int vertex : {triangleOfEdge[0],triangleOfEdge[1],triangleOfEdge[2]})
-          {
-            if (vertex!=c && vertex!=a)
-            {
-              positionOddVertex+=0.125f*_vertexPositions[vertex];
-            }
-          }
-        }
-
-        newVertices[oddVertexOnEdgeEca] = positionOddVertex;
-    
-      }
-    
-      newTriangles.push_back( glm::uvec3( a , oddVertexOnEdgeEab , oddVertexOnEdgeEca ) );
-      newTriangles.push_back( glm::uvec3( oddVertexOnEdgeEab , b , oddVertexOnEdgeEbc ) );
-      newTriangles.push_back( glm::uvec3( oddVertexOnEdgeEca , oddVertexOnEdgeEbc , c ) );
-      newTriangles.push_back( glm::uvec3( oddVertexOnEdgeEab , oddVertexOnEdgeEbc , oddVertexOnEdgeEca ) );
-    }
-
-    _triangleIndices = newTriangles;
-    _vertexPositions = newVertices;
-    recomputePerVertexNormals( );
-    recomputePerVertexTextureCoordinates( );
+  // Range-based building blocks of the contour pipeline, used to spread its work over frames
+  void resizeContourAttributes();
+  void calculateRadialCurvature(const glm::vec3& cameraPosition, unsigned int begin, unsigned int end);
+  // The per-vertex arrays are indexed by vertex and sized to the number of vertices, whether
+  // std::vector or arena storage
+  void accumulateTriangleGradients(unsigned int begin, unsigned int end,
+                                   std::vector<glm::vec3> &gradAccum, std::vector<float> &weightAccum) const {
+    accumulateTriangleGradients(begin, end, gradAccum.data(), weightAccum.data());
+  }
+  void accumulateTriangleGradients(unsigned int begin, unsigned int end, glm::vec3 *gradAccum, float *weightAccum) const;
+  void computeDirectionalDerivatives(const std::vector<glm::vec3>& gradAccum,
+                                     const std::vector<float>& weightAccum,
+                                     const glm::vec3 &cameraPosition,
+                                     unsigned int begin, unsigned int end,
+                                     std::vector<float> &dirDeriv) const {
+    computeDirectionalDerivatives(gradAccum.data(), weightAccum.data(), cameraPosition, begin, end, dirDeriv.data());
+  }
+  void computeDirectionalDerivatives(const glm::vec3 *gradAccum, const float *weightAccum,
+                                     const glm::vec3 &cameraPosition, unsigned int begin, unsigned int end,
+                                     float *dirDeriv) const;
+  void classifyForSuggestiveContour(const std::vector<float> &dirDeriv,
+                                    const SuggestiveContourThresholds &thresholds,
+                                    const glm::vec3 &cameraPosition,
+                                    unsigned int begin, unsigned int end,
+                                    std::vector<int> &eligibility) const {
+    classifyForSuggestiveContour(dirDeriv.data(), thresholds, cameraPosition, begin, end, eligibility.data());
+  }
+  void classifyForSuggestiveContour(const float *dirDeriv, const SuggestiveContourThresholds &thresholds,
+                                    const glm::vec3 &cameraPosition, unsigned int begin, unsigned int end,
+                                    int *eligibility) const;
+  void resolveHysteresis(const std::vector<std::set<unsigned int>> &neighbors, std::vector<int> &eligibility) const;
+  // Same on the compressed one-ring adjacency, with the search buffers taken from the arena
+  void resolveHysteresis(const unsigned int *ringOffsets, const unsigned int *ring, int *eligibility,
+                         FrameArena &arena) const;
+  // computeOneRingAdjacency() into arena storage
+  void computeOneRingAdjacency(FrameArena &arena, unsigned int *&offsets, unsigned int *&neighbors) const;
+  void setSuggestiveContourEligibility(const std::vector<int> &eligibility) {
+    setSuggestiveContourEligibility(eligibility.data());
+  }
+  void setSuggestiveContourEligibility(const int *eligibility);
+  /// Transient buffers of calculateRadialCurvature(), reset on every call: once its capacity
+  /// covers a call, heapAllocations() stays constant
+  const FrameArena &contourArena() const { return _contourArena; }
+  void setSuggestiveContourEligibility(unsigned int v, bool eligible) { eligible_for_suggestive_contour[v] = eligible; }
+  // Eligibility of the vertices [begin, end) as one integer per vertex, e.g., for a GPU vertex
+  // attribute; 0 past the computed attributes
+  void packSuggestiveContourEligibility(unsigned int begin, unsigned int end, int32_t *packed) const;
+  void setContourAttributes(const std::vector<float> &radial, const std::vector<bool> &eligible) {
+    radialCurvature = radial;
+    eligible_for_suggestive_contour = eligible;
   }
 
+  // Loop subdivision. The new vertices and triangles are then sorted in vertexOrder() and
+  // triangleOrder(). Only with VertexOrder::File do the odd vertices follow the even ones, in the
+  // order their edge is first met by the triangles, and only with TriangleOrder::File are the 4
+  // children of triangle t the triangles 4t to 4t+3.
+  void subdivideLoop1();
+  // Frees the adjacency that subdivideLoop1() keeps for the next call
+  void releaseSubdivisionScratch();
+
 
   void subdivideLoop() 
   {
     subdivideLoop1();
   }
 private:
+  void calculatePrincipalCurvatureTriangleTensor();
+  void calculatePrincipalCurvatureLeastSquares();
+  // Estimated bytes of subdivideLoop() for a mesh of the given size: its scratch buffers, and the
+  // peak of its other allocations on top of the mesh and the scratch
+  static size_t subdivisionScratchBytes(size_t vertexCount, size_t edgeCount, size_t triangleCount);
+  static size_t subdivisionTransientBytes(size_t vertexCount, size_t edgeCount, size_t triangleCount);
+  // Estimated bytes of calculatePrincipalCurvature(): the arrays it fills, and the peak of its
+  // temporaries on top of them
+  static size_t curvatureBytes(size_t vertexCount);
+  static size_t curvatureTransientBytes(size_t vertexCount, size_t triangleCount);
+
   std::vector<glm::vec3> _vertexPositions;
   std::vector<glm::vec3> _vertexNormals;
   std::vector<glm::vec2> _vertexTexCoords;
@@ -279,19 +251,55 @@ private:
   std::vector<glm::vec3> principalDirectionK2;
   std::vector<float> radialCurvature;
   std::vector<bool> eligible_for_suggestive_contour;
+  mutable std::shared_ptr<const Bvh> _bvh; // shared by the copies of the same geometry
+  VertexOrder _vertexOrder = VertexOrder::Hilbert;
+  TriangleOrder _triangleOrder = TriangleOrder::Tipsify;
+  CurvatureEstimator _curvatureEstimator = CurvatureEstimator::TriangleTensor;
+  NormalWeighting _normalWeighting = NormalWeighting::Area;
+  bool _cleanupOnLoad = false;
+  MeshCleanupOptions _cleanupOptions;
+  MeshCleanupReport _cleanupReport;
+  FrameArena _contourArena;
+  size_t _lastSubdivisionTransientBytes = 0;
+  // Buffers of subdivideLoop1(), kept between calls so that the next level reuses them. A copy
+  // of the mesh starts without them.
+  struct SubdivisionScratch {
+    SubdivisionScratch() = default;
+    SubdivisionScratch(const SubdivisionScratch &) {}
+    SubdivisionScratch &operator=(const SubdivisionScratch &) { return *this; }
+
+    std::vector<unsigned int> ringOffsets, ring, cursor;  // see computeOneRingAdjacency()
+    std::vector<unsigned int> slotOddVertex;              // odd vertex of the edge (a, b) at slot b of the ring of a <= b
+    std::vector<glm::uvec2> oddEdges;
+    std::vector<unsigned int> oppositeOffsets, opposites; // vertices opposite to each edge, by increasing triangle
+    std::vector<uint8_t> evenIsBoundary;
+
+    size_t memoryBytes() const;
+  } _subdivisionScratch;
+#if defined(SC_SOA_VERTICES)
+  SoaVec3 _positionsSoA;
+  SoaVec3 _normalsSoA;
+  SoaVec3 _principalDirectionK1SoA; // normalized, as used by the radial curvature
+#endif
+};
 
-
-  GLuint _vao = 0;
-  GLuint _posVbo = 0;
-  GLuint _normalVbo = 0;
-  GLuint _texCoordVbo = 0;
-  GLuint _ibo = 0;
-  GLuint _radialCurvatureVbo=0;
-  GLuint _eligibleForSuggestiveContourVbo = 0;
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Notified when the contour attributes of a vertex range [begin, end) have been recomputed,
+ * e.g., by a renderer mirroring them on the GPU. The core library does no rendering itself.
+ */
+class ContourAttributeListener {
+public:
+  virtual ~ContourAttributeListener() {}
+  virtual void radialCurvatureChanged(const Mesh &mesh, unsigned int begin, unsigned int end) = 0;
+  virtual void eligibilityChanged(const Mesh &mesh, unsigned int begin, unsigned int end) = 0;
 };
 
 // utility: loader
 void loadOFF(const std::string &filename, std::shared_ptr<Mesh> meshPtr);
 void loadOBJ(const std::string &filename, std::shared_ptr<Mesh> meshPtr);
+// utility: saver
+void saveOFF(const std::string &filename, const Mesh &mesh);
 
 #endif  // MESH_H
@@ -0,0 +1,285 @@
+#include "MeshCleanup.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+namespace {
+
+// Cells per axis of the bounding box at most, so that the cell coordinates fit in 21 bits
+const float kMinCellFraction = 1.f/(1 << 20);
+// Cell size over the weld distance: a vertex is looked up in the neighbor cells only on the
+// axes along which it is close to the border of its cell
+const float kCellsPerWeldDistance = 8.f;
+// Margin for the rounding of the cell coordinates, in cells
+const float kCellRounding = 0.125f;
+
+inline uint64_t cellHash(const glm::ivec3 &c)
+{
+  return (static_cast<uint64_t>(static_cast<uint32_t>(c.x))*0x9E3779B97F4A7C15ull) ^
+         (static_cast<uint64_t>(static_cast<uint32_t>(c.y))*0xC2B2AE3D27D4EB4Full) ^
+         (static_cast<uint64_t>(static_cast<uint32_t>(c.z))*0x165667B19E3779F9ull);
+}
+
+// For each vertex, the vertex of lowest index of its cluster: the connected component of the
+// graph linking the vertices closer than the tolerance
+std::vector<unsigned int> weldVertices(const std::vector<glm::vec3> &positions, float tolerance)
+{
+  SC_PROFILE_SCOPE("weldVertices");
+  const size_t V = positions.size();
+  glm::vec3 lower(std::numeric_limits<float>::max()), upper(-std::numeric_limits<float>::max());
+  for(const glm::vec3 &p : positions) {
+    lower = glm::min(lower, p);
+    upper = glm::max(upper, p);
+  }
+  const float diagonal = V > 0 ? glm::length(upper - lower) : 0.f;
+  const float distance = tolerance*diagonal, distance2 = distance*distance;
+  const float cellSize = std::max(kCellsPerWeldDistance*distance, diagonal*kMinCellFraction);
+  const float inverseCellSize = cellSize > 0.f ? 1.f/cellSize : 0.f;
+  const float margin = distance > 0.f ? distance*inverseCellSize + kCellRounding : 0.f;
+
+  // Spatial hash in compressed form: the vertices of bucket b, by increasing index, are
+  // vertices[offsets[b]] to vertices[offsets[b + 1] - 1]
+  size_t bucketCount = 1;
+  while(bucketCount < 2*V)
+    bucketCount *= 2;
+  std::vector<glm::ivec3> cells(V);
+  std::vector<unsigned int> buckets(V);
+  parallel_for(0, V, 16384, [&](size_t first, size_t last) {
+    for(size_t v = first; v < last; ++v) {
+      cells[v] = glm::ivec3(glm::floor((positions[v] - lower)*inverseCellSize));
+      buckets[v] = static_cast<unsigned int>(cellHash(cells[v]) & (bucketCount - 1));
+    }
+  });
+  std::vector<unsigned int> offsets(bucketCount + 1, 0), vertices(V);
+  for(size_t v = 0; v < V; ++v)
+    ++offsets[buckets[v] + 1];
+  for(size_t b = 0; b < bucketCount; ++b)
+    offsets[b + 1] += offsets[b];
+  {
+    std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+    for(unsigned int v = 0; v < V; ++v)
+      vertices[cursor[buckets[v]]++] = v;
+  }
+
+  // All the pairs (u, v), u < v, closer than the weld distance, found per block of vertices in
+  // the cell and the neighbor cells within the weld distance
+  const size_t kBlockSize = 4096;
+  const size_t blockCount = (V + kBlockSize - 1)/kBlockSize;
+  std::vector<std::vector<glm::uvec2>> pairs(blockCount);
+  parallel_for(0, blockCount, 1, [&](size_t firstBlock, size_t lastBlock) {
+    for(size_t block = firstBlock; block < lastBlock; ++block)
+      for(size_t v = block*kBlockSize; v < std::min(V, (block + 1)*kBlockSize); ++v) {
+        const glm::vec3 inCell = (positions[v] - lower)*inverseCellSize - glm::vec3(cells[v]);
+        const glm::ivec3 from(glm::lessThanEqual(inCell, glm::vec3(margin))), to(glm::greaterThanEqual(inCell, glm::vec3(1.f - margin)));
+        for(int dx = -from.x; dx <= to.x; ++dx)
+          for(int dy = -from.y; dy <= to.y; ++dy)
+            for(int dz = -from.z; dz <= to.z; ++dz) {
+              const size_t b = cellHash(cells[v] + glm::ivec3(dx, dy, dz)) & (bucketCount - 1);
+              for(unsigned int i = offsets[b]; i < offsets[b + 1] && vertices[i] < v; ++i) {
+                const glm::vec3 d = positions[vertices[i]] - positions[v];
+                if(glm::dot(d, d) <= distance2)
+                  pairs[block].push_back(glm::uvec2(vertices[i], v));
+              }
+            }
+      }
+  });
+
+  // Union-find, the root of a cluster being its vertex of lowest index whatever the order of
+  // the unions
+  std::vector<unsigned int> representative(V);
+  for(unsigned int v = 0; v < V; ++v)
+    representative[v] = v;
+  const auto find = [&](unsigned int v) {
+    while(representative[v] != v)
+      v = representative[v] = representative[representative[v]];
+    return v;
+  };
+  for(const std::vector<glm::uvec2> &blockPairs : pairs)
+    for(const glm::uvec2 &pair : blockPairs) {
+      const unsigned int a = find(pair[0]), b = find(pair[1]);
+      if(a != b)
+        representative[std::max(a, b)] = std::min(a, b);
+    }
+  // A parent has a lower index than its children: in increasing order, it already is a root
+  for(size_t v = 0; v < V; ++v)
+    representative[v] = representative[representative[v]];
+  return representative;
+}
+
+// Items emitted by the triangles, grouped by vertex in compressed form: the items of vertex v
+// are items[offsets[v]] to items[offsets[v + 1] - 1], by increasing triangle
+template <typename Emitter>
+void groupByVertex(size_t vertexCount, size_t triangleCount, const Emitter &forTriangle,
+                   std::vector<unsigned int> &offsets, std::vector<unsigned int> &items)
+{
+  offsets.assign(vertexCount + 1, 0);
+  const std::function<void(unsigned int, unsigned int)> count = [&](unsigned int v, unsigned int) { ++offsets[v + 1]; };
+  for(unsigned int t = 0; t < triangleCount; ++t)
+    forTriangle(t, count);
+  for(size_t v = 0; v < vertexCount; ++v)
+    offsets[v + 1] += offsets[v];
+  items.resize(offsets.back());
+  std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+  const std::function<void(unsigned int, unsigned int)> fill = [&](unsigned int v, unsigned int item) {
+    items[cursor[v]++] = item;
+  };
+  for(unsigned int t = 0; t < triangleCount; ++t)
+    forTriangle(t, fill);
+}
+
+} // namespace
+
+void MeshCleanupReport::write(std::ostream &out) const
+{
+  out << "welded " << weldedVertices << " vertices, removed " << degenerateTriangles << " degenerate and "
+      << duplicateTriangles << " duplicate triangles and " << unreferencedVertices << " unreferenced vertices; "
+      << nonManifoldEdges << " non-manifold and " << boundaryEdges << " boundary edges; " << vertexCount
+      << " vertices, " << triangleCount << " triangles left";
+}
+
+MeshCleanupReport cleanupMeshGeometry(std::vector<glm::vec3> &positions, std::vector<glm::uvec3> &triangles,
+                                      const MeshCleanupOptions &options, std::vector<unsigned int> &newToOld)
+{
+  SC_PROFILE_SCOPE("cleanupMeshGeometry");
+  const size_t V = positions.size(), T = triangles.size();
+  MeshCleanupReport report;
+
+  std::vector<unsigned int> representative;
+  if(options.weldTolerance >= 0.f) {
+    representative = weldVertices(positions, options.weldTolerance);
+    for(size_t v = 0; v < V; ++v)
+      report.weldedVertices += representative[v] != v;
+  }
+
+  // 1: degenerate, 2: duplicate
+  std::vector<uint8_t> removed(T, 0);
+  parallel_for(0, T, 16384, [&](size_t first, size_t last) {
+    for(size_t t = first; t < last; ++t) {
+      glm::uvec3 &tri = triangles[t];
+      if(tri[0] >= V || tri[1] >= V || tri[2] >= V) {
+        removed[t] = 1;
+        continue;
+      }
+      if(!representative.empty())
+        tri = glm::uvec3(representative[tri[0]], representative[tri[1]], representative[tri[2]]);
+      if(tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0] ||
+         (options.degenerateTolerance >= 0.f &&
+          isDegenerateTriangle(positions[tri[0]], positions[tri[1]], positions[tri[2]], options.degenerateTolerance)))
+        removed[t] = 1;
+    }
+  });
+
+  // The triangles by smallest corner, and their edges (a, b), a < b, by a: each list is short
+  // and sorted on its own, in parallel
+  std::vector<glm::uvec3> corners(T);
+  parallel_for(0, T, 16384, [&](size_t first, size_t last) {
+    for(size_t t = first; t < last; ++t) {
+      if(removed[t])
+        continue;
+      glm::uvec3 &c = corners[t];
+      c = triangles[t];
+      if(c[0] > c[1])
+        std::swap(c[0], c[1]);
+      if(c[1] > c[2])
+        std::swap(c[1], c[2]);
+      if(c[0] > c[1])
+        std::swap(c[0], c[1]);
+    }
+  });
+
+  if(options.removeDuplicateTriangles) {
+    std::vector<unsigned int> offsets, incident;
+    groupByVertex(V, T, [&](unsigned int t, const std::function<void(unsigned int, unsigned int)> &emit) {
+      if(!removed[t])
+        emit(corners[t][0], t);
+    }, offsets, incident);
+    // Sorted by the other two corners, then by index: the first of each run is kept
+    parallel_for(0, V, 4096, [&](size_t first, size_t last) {
+      std::vector<std::array<unsigned int, 3>> keys;
+      for(size_t v = first; v < last; ++v) {
+        keys.clear();
+        for(unsigned int i = offsets[v]; i < offsets[v + 1]; ++i)
+          keys.push_back({{corners[incident[i]][1], corners[incident[i]][2], incident[i]}});
+        std::sort(keys.begin(), keys.end());
+        for(size_t i = 1; i < keys.size(); ++i)
+          if(keys[i][0] == keys[i - 1][0] && keys[i][1] == keys[i - 1][1])
+            removed[keys[i][2]] = 2;
+      }
+    });
+  }
+
+  // The number of triangles of an edge is the length of a run of its end b
+  {
+    std::vector<unsigned int> offsets, ends;
+    groupByVertex(V, T, [&](unsigned int t, const std::function<void(unsigned int, unsigned int)> &emit) {
+      if(removed[t])
+        return;
+      emit(corners[t][0], corners[t][1]);
+      emit(corners[t][0], corners[t][2]);
+      emit(corners[t][1], corners[t][2]);
+    }, offsets, ends);
+    std::vector<glm::uvec2> counts(V, glm::uvec2(0)); // boundary, non-manifold
+    parallel_for(0, V, 4096, [&](size_t first, size_t last) {
+      for(size_t v = first; v < last; ++v) {
+        std::sort(ends.begin() + offsets[v], ends.begin() + offsets[v + 1]);
+        for(unsigned int i = offsets[v]; i < offsets[v + 1];) {
+          unsigned int j = i + 1;
+          while(j < offsets[v + 1] && ends[j] == ends[i])
+            ++j;
+          counts[v] += glm::uvec2(j - i == 1, j - i > 2);
+          i = j;
+        }
+      }
+    });
+    for(const glm::uvec2 &c : counts) {
+      report.boundaryEdges += c[0];
+      report.nonManifoldEdges += c[1];
+    }
+  }
+
+  size_t kept = 0;
+  for(size_t t = 0; t < T; ++t) {
+    if(removed[t] == 1)
+      ++report.degenerateTriangles;
+    else if(removed[t] == 2)
+      ++report.duplicateTriangles;
+    else
+      triangles[kept++] = triangles[t];
+  }
+  triangles.resize(kept);
+
+  std::vector<uint8_t> referenced(V, 0);
+  for(const glm::uvec3 &tri : triangles)
+    referenced[tri[0]] = referenced[tri[1]] = referenced[tri[2]] = 1;
+  newToOld.clear();
+  for(unsigned int v = 0; v < V; ++v) {
+    if(referenced[v] || !options.removeUnreferencedVertices)
+      newToOld.push_back(v);
+    if(!referenced[v] && (representative.empty() || representative[v] == v))
+      ++report.unreferencedVertices;
+  }
+  if(newToOld.size() < V) {
+    std::vector<unsigned int> oldToNew(V, 0);
+    for(unsigned int v = 0; v < newToOld.size(); ++v)
+      oldToNew[newToOld[v]] = v;
+    parallel_for(0, triangles.size(), 16384, [&](size_t first, size_t last) {
+      for(size_t t = first; t < last; ++t)
+        for(unsigned int k = 0; k < 3; ++k)
+          triangles[t][k] = oldToNew[triangles[t][k]];
+    });
+    std::vector<glm::vec3> compacted(newToOld.size());
+    for(size_t v = 0; v < newToOld.size(); ++v)
+      compacted[v] = positions[newToOld[v]];
+    positions.swap(compacted);
+  }
+  report.vertexCount = positions.size();
+  report.triangleCount = triangles.size();
+  return report;
+}
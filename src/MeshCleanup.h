@@ -0,0 +1,66 @@
+#ifndef MESH_CLEANUP_H
+#define MESH_CLEANUP_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Height of a triangle over its longest edge below which it is degenerate
+const float kDegenerateTriangleTolerance = 1e-6f;
+
+// Triangle of zero area or nearly so: 2 area <= tolerance * (longest edge)^2, which also holds
+// for a triangle with two equal corners
+inline bool isDegenerateTriangle(const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2,
+                                 float tolerance = kDegenerateTriangleTolerance)
+{
+  const glm::vec3 e0 = p1 - p0, e1 = p2 - p1, e2 = p0 - p2;
+  const float longest2 = glm::max(glm::dot(e0, e0), glm::max(glm::dot(e1, e1), glm::dot(e2, e2)));
+  const glm::vec3 n = glm::cross(e0, -e2);
+  return !(glm::dot(n, n) > tolerance*tolerance*longest2*longest2);
+}
+
+// Stages of cleanupMeshGeometry()
+struct MeshCleanupOptions {
+  float weldTolerance = 1e-6f;        // distance, relative to the bounding box diagonal, below which vertices are welded; negative: no welding
+  float degenerateTolerance = kDegenerateTriangleTolerance; // see isDegenerateTriangle(); negative: only triangles with a repeated corner
+  bool removeDuplicateTriangles = true;
+  bool removeUnreferencedVertices = true;
+};
+
+// What cleanupMeshGeometry() found and removed
+struct MeshCleanupReport {
+  size_t weldedVertices = 0;        // merged into a vertex of lower index
+  size_t degenerateTriangles = 0;   // with a repeated or missing corner, or of zero area
+  size_t duplicateTriangles = 0;    // on the same corners as a triangle of lower index, in any order
+  size_t unreferencedVertices = 0;  // in no triangle, welded vertices excepted
+  size_t nonManifoldEdges = 0;      // of more than two triangles, left as is
+  size_t boundaryEdges = 0;         // of a single triangle
+  size_t vertexCount = 0, triangleCount = 0; // after cleanup
+
+  size_t removedTriangles() const { return degenerateTriangles + duplicateTriangles; }
+  // On one line
+  void write(std::ostream &out) const;
+};
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Repairs a triangle soup as found in scans and exported files, in this order:
+ * - welds the vertices closer than the tolerance: every such pair is found in a spatial hash,
+ *   and the connected components of these pairs (single linkage) are merged by union-find,
+ *   each into its vertex of lowest index: the triangles are rewritten on the kept vertices;
+ * - removes the degenerate triangles, then the duplicate ones, keeping the first;
+ * - counts the non-manifold and boundary edges of the remaining triangles;
+ * - removes the vertices no triangle references anymore, keeping the order of the others.
+ * The per-vertex and per-triangle passes run on the thread pool; the result does not depend on
+ * the number of threads.
+ *
+ * @param newToOld For each vertex after cleanup, its index before: other vertex attributes are
+ *                 to be gathered with it. The identity of the vertex count if nothing is removed.
+ */
+MeshCleanupReport cleanupMeshGeometry(std::vector<glm::vec3> &positions, std::vector<glm::uvec3> &triangles,
+                                      const MeshCleanupOptions &options, std::vector<unsigned int> &newToOld);
+
+#endif  // MESH_CLEANUP_H
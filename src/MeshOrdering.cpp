@@ -0,0 +1,274 @@
+#include "MeshOrdering.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+#include <utility>
+
+namespace {
+
+const unsigned int kKeyBits = 21; // per axis, 63 bits in total
+
+uint32_t quantize(float x)
+{
+  const float scaled = x*static_cast<float>(1u << kKeyBits);
+  return static_cast<uint32_t>(glm::clamp(scaled, 0.f, static_cast<float>((1u << kKeyBits) - 1)));
+}
+
+// Interleaves the bits of the three coordinates, x being the most significant at each level
+uint64_t interleave(const uint32_t x[3])
+{
+  uint64_t key = 0;
+  for(int bit = kKeyBits - 1; bit >= 0; --bit)
+    for(unsigned int i = 0; i < 3; ++i)
+      key = (key << 1) | ((x[i] >> bit) & 1u);
+  return key;
+}
+
+} // namespace
+
+const char *vertexOrderName(VertexOrder order)
+{
+  switch(order) {
+  case VertexOrder::Morton: return "morton";
+  case VertexOrder::Hilbert: return "hilbert";
+  default: return "file";
+  }
+}
+
+const char *triangleOrderName(TriangleOrder order)
+{
+  switch(order) {
+  case TriangleOrder::Tipsify: return "tipsify";
+  case TriangleOrder::TipsifyOverdraw: return "tipsify+overdraw";
+  default: return "file";
+  }
+}
+
+uint64_t mortonKey(const glm::vec3 &p)
+{
+  const uint32_t x[3] = {quantize(p.x), quantize(p.y), quantize(p.z)};
+  return interleave(x);
+}
+
+// Skilling's transform ("Programming the Hilbert curve", 2004): the coordinates are turned in
+// place into the transposed Hilbert index, whose interleaved bits are the key
+uint64_t hilbertKey(const glm::vec3 &p)
+{
+  uint32_t x[3] = {quantize(p.x), quantize(p.y), quantize(p.z)};
+  const uint32_t m = 1u << (kKeyBits - 1);
+  for(uint32_t q = m; q > 1; q >>= 1) {
+    const uint32_t mask = q - 1;
+    for(unsigned int i = 0; i < 3; ++i) {
+      if(x[i] & q) {
+        x[0] ^= mask;
+      } else {
+        const uint32_t t = (x[0] ^ x[i]) & mask;
+        x[0] ^= t;
+        x[i] ^= t;
+      }
+    }
+  }
+  // Gray encoding
+  x[1] ^= x[0];
+  x[2] ^= x[1];
+  uint32_t t = 0;
+  for(uint32_t q = m; q > 1; q >>= 1)
+    if(x[2] & q)
+      t ^= q - 1;
+  for(unsigned int i = 0; i < 3; ++i)
+    x[i] ^= t;
+  return interleave(x);
+}
+
+std::vector<unsigned int> spatialVertexOrder(const std::vector<glm::vec3> &positions, VertexOrder order)
+{
+  std::vector<unsigned int> newToOld(positions.size());
+  std::iota(newToOld.begin(), newToOld.end(), 0u);
+  if(order == VertexOrder::File || positions.empty())
+    return newToOld;
+
+  glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+  for(const glm::vec3 &p : positions) {
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  // Cubic cells, so that the curve does not favor the longest axis
+  const float extent = std::max(hi.x - lo.x, std::max(hi.y - lo.y, hi.z - lo.z));
+  const float scale = extent > 0.f ? 1.f/extent : 0.f;
+
+  std::vector<std::pair<uint64_t, unsigned int>> keys(positions.size());
+  parallel_for(0, positions.size(), 16384, [&](size_t first, size_t last) {
+    for(size_t v = first; v < last; ++v) {
+      const glm::vec3 p = (positions[v] - lo)*scale;
+      keys[v].first = (order == VertexOrder::Morton) ? mortonKey(p) : hilbertKey(p);
+      keys[v].second = static_cast<unsigned int>(v);
+    }
+  });
+  std::sort(keys.begin(), keys.end());
+  for(size_t v = 0; v < keys.size(); ++v)
+    newToOld[v] = keys[v].second;
+  return newToOld;
+}
+
+VertexCacheStats vertexCacheStats(const std::vector<glm::uvec3> &triangles, size_t vertexCount,
+                                  unsigned int cacheSize)
+{
+  // FIFO: a vertex is still cached while fewer than cacheSize misses followed its own
+  std::vector<uint64_t> missIndex(vertexCount, 0);
+  uint64_t misses = 0;
+  size_t usedVertices = 0;
+  for(const glm::uvec3 &tri : triangles) {
+    for(unsigned int k = 0; k < 3; ++k) {
+      uint64_t &stamp = missIndex[tri[k]];
+      if(stamp == 0)
+        ++usedVertices;
+      if(stamp == 0 || misses - stamp >= cacheSize) {
+        ++misses;
+        stamp = misses;
+      }
+    }
+  }
+  VertexCacheStats stats;
+  if(!triangles.empty()) {
+    stats.acmr = static_cast<double>(misses)/triangles.size();
+    stats.atvr = static_cast<double>(misses)/usedVertices;
+  }
+  return stats;
+}
+
+std::vector<unsigned int> vertexCacheTriangleOrder(const std::vector<glm::uvec3> &triangles,
+                                                   const std::vector<glm::vec3> &positions, TriangleOrder order,
+                                                   unsigned int cacheSize)
+{
+  const unsigned int triangleCount = static_cast<unsigned int>(triangles.size());
+  const unsigned int vertexCount = static_cast<unsigned int>(positions.size());
+  std::vector<unsigned int> newToOld;
+  newToOld.reserve(triangleCount);
+  if(order == TriangleOrder::File) {
+    newToOld.resize(triangleCount);
+    std::iota(newToOld.begin(), newToOld.end(), 0u);
+    return newToOld;
+  }
+
+  // Incident triangles of each vertex (CSR), and the number of them not emitted yet
+  std::vector<unsigned int> offsets(vertexCount + 1, 0), incident(3*static_cast<size_t>(triangleCount));
+  for(const glm::uvec3 &tri : triangles)
+    for(unsigned int k = 0; k < 3; ++k)
+      offsets[tri[k] + 1]++;
+  for(unsigned int v = 0; v < vertexCount; ++v)
+    offsets[v + 1] += offsets[v];
+  std::vector<unsigned int> live(vertexCount);
+  for(unsigned int v = 0; v < vertexCount; ++v)
+    live[v] = offsets[v + 1] - offsets[v];
+  {
+    std::vector<unsigned int> cursor(offsets.begin(), offsets.end() - 1);
+    for(unsigned int t = 0; t < triangleCount; ++t)
+      for(unsigned int k = 0; k < 3; ++k)
+        incident[cursor[triangles[t][k]]++] = t;
+  }
+
+  std::vector<unsigned int> cacheTime(vertexCount, 0);
+  std::vector<bool> emitted(triangleCount, false);
+  std::vector<unsigned int> deadEnd;    // vertices of the emitted triangles, most recent last
+  std::vector<unsigned int> candidates; // vertices of the last fan
+  std::vector<unsigned int> clusterStarts(1, 0);
+  unsigned int time = cacheSize + 1;
+  unsigned int cursor = 0; // restart position in vertex order
+  const bool overdraw = (order == TriangleOrder::TipsifyOverdraw);
+
+  auto skipDeadEnd = [&]() -> int {
+    while(!deadEnd.empty()) {
+      const unsigned int d = deadEnd.back();
+      deadEnd.pop_back();
+      if(live[d] > 0)
+        return static_cast<int>(d);
+    }
+    for(; cursor < vertexCount; ++cursor)
+      if(live[cursor] > 0)
+        return static_cast<int>(cursor);
+    return -1;
+  };
+
+  int fan = vertexCount > 0 ? skipDeadEnd() : -1;
+  while(fan >= 0) {
+    candidates.clear();
+    for(unsigned int i = offsets[fan]; i < offsets[fan + 1]; ++i) {
+      const unsigned int t = incident[i];
+      if(emitted[t])
+        continue;
+      emitted[t] = true;
+      newToOld.push_back(t);
+      for(unsigned int k = 0; k < 3; ++k) {
+        const unsigned int v = triangles[t][k];
+        deadEnd.push_back(v);
+        candidates.push_back(v);
+        live[v]--;
+        if(time - cacheTime[v] > cacheSize)
+          cacheTime[v] = time++;
+      }
+    }
+
+    // Oldest candidate that is still cached after its fan (two new vertices per triangle at most)
+    int next = -1, bestPriority = -1;
+    for(unsigned int v : candidates) {
+      if(live[v] == 0)
+        continue;
+      int priority = 0;
+      if(time - cacheTime[v] + 2*live[v] <= cacheSize)
+        priority = static_cast<int>(time - cacheTime[v]);
+      if(priority > bestPriority) {
+        bestPriority = priority;
+        next = static_cast<int>(v);
+      }
+    }
+    if(next < 0) {
+      next = skipDeadEnd();
+      if(overdraw && newToOld.size() - clusterStarts.back() >= kMinOverdrawClusterSize)
+        clusterStarts.push_back(static_cast<unsigned int>(newToOld.size()));
+    }
+    fan = next;
+  }
+  if(!overdraw)
+    return newToOld;
+
+  // Clusters from the outside in, ties (and the last, possibly small, cluster) in emission order
+  if(clusterStarts.back() == newToOld.size())
+    clusterStarts.pop_back();
+  glm::vec3 meshCentroid(0.f);
+  for(const glm::vec3 &p : positions)
+    meshCentroid += p;
+  meshCentroid /= static_cast<float>(std::max(1u, vertexCount));
+  std::vector<std::pair<float, unsigned int>> clusterKeys(clusterStarts.size());
+  for(unsigned int c = 0; c < clusterStarts.size(); ++c) {
+    const unsigned int end = (c + 1 < clusterStarts.size()) ? clusterStarts[c + 1] : triangleCount;
+    glm::vec3 centroid(0.f), normal(0.f);
+    float area = 0.f;
+    for(unsigned int i = clusterStarts[c]; i < end; ++i) {
+      const glm::uvec3 &tri = triangles[newToOld[i]];
+      const glm::vec3 n = glm::cross(positions[tri[1]] - positions[tri[0]], positions[tri[2]] - positions[tri[0]]);
+      const float a = glm::length(n);
+      centroid += a*(positions[tri[0]] + positions[tri[1]] + positions[tri[2]])/3.f;
+      normal += n;
+      area += a;
+    }
+    if(area > 0.f)
+      centroid /= area;
+    const float length = glm::length(normal);
+    clusterKeys[c].first = (length > 0.f) ? -glm::dot(centroid - meshCentroid, normal/length) : 0.f;
+    clusterKeys[c].second = c;
+  }
+  std::stable_sort(clusterKeys.begin(), clusterKeys.end(),
+                   [](const std::pair<float, unsigned int> &a, const std::pair<float, unsigned int> &b) {
+                     return a.first < b.first;
+                   });
+  std::vector<unsigned int> sorted;
+  sorted.reserve(triangleCount);
+  for(const auto &key : clusterKeys) {
+    const unsigned int c = key.second;
+    const unsigned int end = (c + 1 < clusterStarts.size()) ? clusterStarts[c + 1] : triangleCount;
+    sorted.insert(sorted.end(), newToOld.begin() + clusterStarts[c], newToOld.begin() + end);
+  }
+  return sorted;
+}
@@ -0,0 +1,75 @@
+#ifndef MESH_ORDERING_H
+#define MESH_ORDERING_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Space-filling curve along which the vertices of a mesh are stored
+enum class VertexOrder {
+  File,    // as loaded, odd vertices of a subdivision appended in triangle order
+  Morton,  // Z-order curve: cheapest key, but with long jumps between octants
+  Hilbert  // Hilbert curve: consecutive keys are always neighbor cells
+};
+
+// Order in which the triangles of a mesh are stored and drawn
+enum class TriangleOrder {
+  File,           // as loaded, the four children of a subdivided triangle following each other
+  Tipsify,        // post-transform vertex cache order
+  TipsifyOverdraw // Tipsify clusters sorted from the outside in, to reduce overdraw
+};
+
+// Size of the FIFO vertex cache targeted by Tipsify and simulated by vertexCacheStats()
+const unsigned int kVertexCacheSize = 16;
+// Fewest triangles in a cluster of the overdraw variant: smaller clusters are merged with the next one
+const unsigned int kMinOverdrawClusterSize = 64;
+
+const char *vertexOrderName(VertexOrder order);
+const char *triangleOrderName(TriangleOrder order);
+
+// Keys of a point on a 2^21 grid per axis, the point being given in [0, 1]^3
+uint64_t mortonKey(const glm::vec3 &p);
+uint64_t hilbertKey(const glm::vec3 &p);
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Sorts the points along a space-filling curve over their bounding box, ties being broken by
+ * index so that the order is deterministic. For VertexOrder::File, the identity is returned.
+ *
+ * @return The permutation giving, for each new index, the old index of the point.
+ */
+std::vector<unsigned int> spatialVertexOrder(const std::vector<glm::vec3> &positions, VertexOrder order);
+
+// Efficiency of a triangle order on a FIFO post-transform vertex cache
+struct VertexCacheStats {
+  double acmr = 0.0; // average cache miss ratio: transformed vertices per triangle, 0.5 at best
+  double atvr = 0.0; // average transform to vertex ratio: transformed vertices per used vertex, 1 at best
+};
+
+VertexCacheStats vertexCacheStats(const std::vector<glm::uvec3> &triangles, size_t vertexCount,
+                                  unsigned int cacheSize = kVertexCacheSize);
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Orders the triangles for the post-transform vertex cache with Tipsify (Sander, Nehab and
+ * Barczak, "Fast triangle reordering for vertex locality and reduced overdraw", 2007): the
+ * triangles around a fanning vertex are emitted together, the next fanning vertex being the
+ * oldest vertex of the last fan which will still be in the cache once its own fan is emitted.
+ * Dead ends restart from the most recent vertex with remaining triangles, then by vertex index,
+ * so that a spatial vertex order also gives spatially coherent restarts.
+ *
+ * For TriangleOrder::TipsifyOverdraw, the output is cut into clusters at the dead ends, each
+ * cluster having at least kMinOverdrawClusterSize triangles, and the clusters are sorted by
+ * decreasing dot(c - m, n), c being the centroid of the cluster, n its average normal and m
+ * the centroid of the mesh. Outer clusters, likely occluders from any view, are drawn first.
+ *
+ * @return The permutation giving, for each new index, the old index of the triangle.
+ */
+std::vector<unsigned int> vertexCacheTriangleOrder(const std::vector<glm::uvec3> &triangles,
+                                                   const std::vector<glm::vec3> &positions, TriangleOrder order,
+                                                   unsigned int cacheSize = kVertexCacheSize);
+
+#endif  // MESH_ORDERING_H
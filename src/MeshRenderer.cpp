@@ -0,0 +1,218 @@
+#include "MeshRenderer.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+MeshRenderer::~MeshRenderer()
+{
+  clear();
+}
+
+#ifdef SUPPORT_OPENGL_45
+void MeshRenderer::init(const Mesh &mesh)
+{
+  clear(); // buffers of a previous geometry
+  _indexCount = static_cast<GLsizei>(3*mesh.triangleIndices().size());
+  _vertexCount = mesh.vertexPositions().size();
+  glCreateBuffers(1, &_posVbo); // Generate a GPU buffer to store the positions of the vertices
+  size_t vertexBufferSize = sizeof(glm::vec3)*mesh.vertexPositions().size(); // Gather the size of the buffer from the CPU-side vector
+  glNamedBufferStorage(_posVbo, vertexBufferSize, mesh.vertexPositions().data(), GL_DYNAMIC_STORAGE_BIT); // Create a data store on the GPU
+
+  glCreateBuffers(1, &_normalVbo); // Same for normal
+  glNamedBufferStorage(_normalVbo, vertexBufferSize, mesh.vertexNormals().data(), GL_DYNAMIC_STORAGE_BIT);
+
+  glCreateBuffers(1, &_texCoordVbo); // Same for texture coordinates
+  size_t texCoordBufferSize = sizeof(glm::vec2)*mesh.vertexTexCoords().size();
+  glNamedBufferStorage(_texCoordVbo, texCoordBufferSize, mesh.vertexTexCoords().data(), GL_DYNAMIC_STORAGE_BIT);
+
+  glCreateBuffers(1, &_ibo); // Same for the index buffer, that stores the list of indices of the triangles forming the mesh
+  size_t indexBufferSize = sizeof(glm::uvec3)*mesh.triangleIndices().size();
+  glNamedBufferStorage(_ibo, indexBufferSize, mesh.triangleIndices().data(), GL_DYNAMIC_STORAGE_BIT);
+
+  glCreateVertexArrays(1, &_vao); // Create a single handle that joins together attributes (vertex positions, normals) and connectivity (triangles indices)
+  glBindVertexArray(_vao);
+
+  glEnableVertexAttribArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, _posVbo);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GLfloat), 0);
+
+  glEnableVertexAttribArray(1);
+  glBindBuffer(GL_ARRAY_BUFFER, _normalVbo);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GLfloat), 0);
+
+  glEnableVertexAttribArray(2);
+  glBindBuffer(GL_ARRAY_BUFFER, _texCoordVbo);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2*sizeof(GLfloat), 0);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+  glBindVertexArray(0); // Desactive the VAO just created. Will be activated at rendering time.
+}
+#else
+void MeshRenderer::init(const Mesh &mesh)
+{
+  clear(); // buffers of a previous geometry
+  _indexCount = static_cast<GLsizei>(3*mesh.triangleIndices().size());
+  _vertexCount = mesh.vertexPositions().size();
+  //MY CODE CHOOSES WITH IF-BRANCH
+  // Generate a GPU buffer to store the positions of the vertices
+  size_t vertexBufferSize = sizeof(glm::vec3)*mesh.vertexPositions().size();
+  glGenBuffers(1, &_posVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, _posVbo);
+  glBufferData(GL_ARRAY_BUFFER, vertexBufferSize, mesh.vertexPositions().data(), GL_DYNAMIC_READ);
+
+  // Generate a GPU buffer to store the vertex normals of the vertices
+  glGenBuffers(1, &_normalVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, _normalVbo);
+  glBufferData(GL_ARRAY_BUFFER, vertexBufferSize, mesh.vertexNormals().data(), GL_DYNAMIC_READ);
+
+  // Generate a GPU buffer to store the texture coordinates of the vertices
+  size_t texCoordBufferSize = sizeof(glm::vec2)*mesh.vertexTexCoords().size();
+  glGenBuffers(1, &_texCoordVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, _texCoordVbo);
+  glBufferData(GL_ARRAY_BUFFER, texCoordBufferSize, mesh.vertexTexCoords().data(), GL_DYNAMIC_READ);
+
+  // Create and populate buffer for radialCurvature (location=5)
+  glGenBuffers(1, &_radialCurvatureVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, _radialCurvatureVbo);
+  // Sized to the vertex count even before the contour attributes are computed, so that they
+  // can be uploaded in place afterwards
+  const size_t vertexCount = mesh.vertexPositions().size();
+  _uploadArena.reset();
+  float *radial = _uploadArena.allocate<float>(vertexCount, 0.0f);
+  std::copy_n(mesh.radialCurvatures().begin(), std::min(vertexCount, mesh.radialCurvatures().size()), radial);
+  glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(float), radial, GL_DYNAMIC_READ);
+
+  GLint *eligibleInt = _uploadArena.allocate<GLint>(vertexCount, 0);
+  mesh.packSuggestiveContourEligibility(0, static_cast<unsigned int>(vertexCount), eligibleInt);
+  glGenBuffers(1, &_eligibleForSuggestiveContourVbo);
+  glBindBuffer(GL_ARRAY_BUFFER, _eligibleForSuggestiveContourVbo);
+  glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(GLint), eligibleInt, GL_DYNAMIC_READ);
+
+  // // Generate a GPU buffer to store the index buffer that stores the list of indices of the triangles forming the mesh
+  size_t indexBufferSize = sizeof(glm::uvec3)*mesh.triangleIndices().size();
+  glGenBuffers(1, &_ibo);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBufferSize, mesh.triangleIndices().data(), GL_DYNAMIC_READ);
+
+  // Create a single handle that joins together attributes (vertex positions, normals) and connectivity (triangles indices)
+  glGenVertexArrays(1, &_vao);
+  glBindVertexArray(_vao);
+
+  /*
+  The previous snippet treating _posVbo had the following function:
+  It sets up the storage for the vertex positions on the GPU and populates it with the data from the CPU. 
+  It only prepares the data but does not tell OpenGL how to interpret it for rendering.
+
+  This following snippet treating _posVbo has the following function:
+  It tells OpenGL how to read and interpret the data in the buffer for the enabled vertex attribute:
+    - The attribute at location 0 (likely vertex positions) is associated with _posVbo.
+    - OpenGL now knows that each vertex is represented by 3 floats.
+  */
+  glEnableVertexAttribArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, _posVbo);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GLfloat), 0);
+
+  glEnableVertexAttribArray(1);
+  glBindBuffer(GL_ARRAY_BUFFER, _normalVbo);
+  glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3*sizeof(GLfloat), 0);
+
+  
+  glEnableVertexAttribArray(2);
+  glBindBuffer(GL_ARRAY_BUFFER, _texCoordVbo);
+  glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 2*sizeof(GLfloat), 0);
+
+  glEnableVertexAttribArray(5); // Radial curvature attribute location
+  glBindBuffer(GL_ARRAY_BUFFER, _radialCurvatureVbo);
+  glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, sizeof(float), 0);
+
+  glEnableVertexAttribArray(6);
+  glBindBuffer(GL_ARRAY_BUFFER, _eligibleForSuggestiveContourVbo);
+  // Use the integer version of the attribute pointer.
+  glVertexAttribIPointer(6, 1, GL_INT, sizeof(GLint), 0);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _ibo);
+
+  glBindVertexArray(0); // Desactive the VAO just created. Will be activated at rendering time.
+}
+#endif
+
+void MeshRenderer::render() const
+{
+  glBindVertexArray(_vao);      // Activate the VAO storing geometry data
+  glDrawElements(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, 0);
+  // Call for rendering: stream the current GPU geometry through the current GPU program
+}
+
+void MeshRenderer::radialCurvatureChanged(const Mesh &mesh, unsigned int begin, unsigned int end)
+{
+  SC_PROFILE_SCOPE("MeshRenderer::radialCurvatureChanged");
+  if(!_radialCurvatureVbo || begin >= end)
+    return;
+  glBindBuffer(GL_ARRAY_BUFFER, _radialCurvatureVbo);
+  glBufferSubData(GL_ARRAY_BUFFER, begin*sizeof(float), (end - begin)*sizeof(float), mesh.radialCurvatures().data() + begin);
+}
+
+void MeshRenderer::eligibilityChanged(const Mesh &mesh, unsigned int begin, unsigned int end)
+{
+  SC_PROFILE_SCOPE("MeshRenderer::eligibilityChanged");
+  if(!_eligibleForSuggestiveContourVbo || begin >= end)
+    return;
+  _uploadArena.reset();
+  GLint *eligibleInt = _uploadArena.allocate<GLint>(end - begin);
+  mesh.packSuggestiveContourEligibility(begin, end, eligibleInt);
+  glBindBuffer(GL_ARRAY_BUFFER, _eligibleForSuggestiveContourVbo);
+  glBufferSubData(GL_ARRAY_BUFFER, begin*sizeof(GLint), (end - begin)*sizeof(GLint), eligibleInt);
+}
+
+void MeshRenderer::clear()
+{
+  if(_vao) {
+    glDeleteVertexArrays(1, &_vao);
+    _vao = 0;
+  }
+  if(_posVbo) {
+    glDeleteBuffers(1, &_posVbo);
+    _posVbo = 0;
+  }
+  if(_normalVbo) {
+    glDeleteBuffers(1, &_normalVbo);
+    _normalVbo = 0;
+  }
+  if(_texCoordVbo) {
+    glDeleteBuffers(1, &_texCoordVbo);
+    _texCoordVbo = 0;
+  }
+  if (_radialCurvatureVbo) {
+    glDeleteBuffers(1, &_radialCurvatureVbo);
+    _radialCurvatureVbo= 0;
+    }
+  
+  if (_eligibleForSuggestiveContourVbo) {
+    glDeleteBuffers(1, &_eligibleForSuggestiveContourVbo);
+    _eligibleForSuggestiveContourVbo = 0;
+  }
+
+  if(_ibo) {
+    glDeleteBuffers(1, &_ibo);
+    _ibo = 0;
+  }
+  _indexCount = 0;
+  _vertexCount = 0;
+}
+
+void MeshRenderer::accountMemory(MemoryFootprint &footprint) const
+{
+  const MemoryScale perVertex = MemoryScale::Vertices;
+  footprint.add(MemoryCategory::Gpu, "vertex positions", _posVbo ? _vertexCount*sizeof(glm::vec3) : 0, perVertex);
+  footprint.add(MemoryCategory::Gpu, "vertex normals", _normalVbo ? _vertexCount*sizeof(glm::vec3) : 0, perVertex);
+  footprint.add(MemoryCategory::Gpu, "vertex texture coordinates", _texCoordVbo ? _vertexCount*sizeof(glm::vec2) : 0, perVertex);
+  footprint.add(MemoryCategory::Gpu, "radial curvatures", _radialCurvatureVbo ? _vertexCount*sizeof(float) : 0, perVertex);
+  footprint.add(MemoryCategory::Gpu, "suggestive contour eligibility",
+                _eligibleForSuggestiveContourVbo ? _vertexCount*sizeof(GLint) : 0, perVertex);
+  footprint.add(MemoryCategory::Gpu, "triangle indices", _indexCount*sizeof(GLuint), MemoryScale::Triangles);
+}
+
+size_t MeshRenderer::bufferBytes(size_t vertexCount, size_t triangleCount)
+{
+  return vertexCount*(2*sizeof(glm::vec3) + sizeof(glm::vec2) + sizeof(float) + sizeof(GLint)) + triangleCount*sizeof(glm::uvec3);
+}
@@ -0,0 +1,46 @@
+#ifndef MESH_RENDERER_H
+#define MESH_RENDERER_H
+
+#include <glad/glad.h>
+
+#include "FrameArena.h"
+#include "Mesh.h"
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * GPU buffers of a mesh, for the viewer: the mesh itself is kept free of any GL dependency so
+ * that the geometry processing can run headless. init() must be called again after any change
+ * of the geometry, while the contour attributes are updated in place through the listener
+ * interface.
+ */
+class MeshRenderer : public ContourAttributeListener {
+public:
+  ~MeshRenderer();
+
+  // (Re)creates the buffers from the mesh. Requires a current GL context, as all the methods.
+  void init(const Mesh &mesh);
+  void render() const;
+  void clear();
+
+  // Bytes of the buffers, and those of the buffers of a mesh of the given size
+  void accountMemory(MemoryFootprint &footprint) const;
+  static size_t bufferBytes(size_t vertexCount, size_t triangleCount);
+
+  void radialCurvatureChanged(const Mesh &mesh, unsigned int begin, unsigned int end) override;
+  void eligibilityChanged(const Mesh &mesh, unsigned int begin, unsigned int end) override;
+
+private:
+  GLuint _vao = 0;
+  GLuint _posVbo = 0;
+  GLuint _normalVbo = 0;
+  GLuint _texCoordVbo = 0;
+  GLuint _ibo = 0;
+  GLuint _radialCurvatureVbo=0;
+  GLuint _eligibleForSuggestiveContourVbo = 0;
+  GLsizei _indexCount = 0;
+  size_t _vertexCount = 0;
+  FrameArena _uploadArena; // staging of the converted attributes
+};
+
+#endif  // MESH_RENDERER_H
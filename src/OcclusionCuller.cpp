@@ -0,0 +1,250 @@
+#include "OcclusionCuller.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+const float kMinW = 1e-5f;  // triangles with a vertex closer to the eye plane are not rasterized
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Positive floats are ordered as their bits
+uint32_t toBits(float f)
+{
+  uint32_t bits;
+  std::memcpy(&bits, &f, sizeof(bits));
+  return bits;
+}
+
+float fromBits(uint32_t bits)
+{
+  float f;
+  std::memcpy(&f, &bits, sizeof(f));
+  return f;
+}
+
+void atomicMin(std::atomic<uint32_t> &target, uint32_t value)
+{
+  uint32_t current = target.load(std::memory_order_relaxed);
+  while(value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    ;
+}
+
+} // namespace
+
+void OcclusionCuller::reset(const Mesh &mesh)
+{
+  const std::vector<glm::vec3> &positions = mesh.vertexPositions();
+  _vertexCount = positions.size();
+  _clusters.resize((_vertexCount + kClusterSize - 1)/kClusterSize);
+  parallel_for(0, _clusters.size(), 64, [&](size_t first, size_t last) {
+    for(size_t c = first; c < last; ++c) {
+      const size_t begin = c*kClusterSize, end = std::min(_vertexCount, begin + kClusterSize);
+      Cluster &cluster = _clusters[c];
+      cluster.min = cluster.max = positions[begin];
+      for(size_t v = begin + 1; v < end; ++v) {
+        cluster.min = glm::min(cluster.min, positions[v]);
+        cluster.max = glm::max(cluster.max, positions[v]);
+      }
+      cluster.vertexCount = static_cast<unsigned int>(end - begin);
+    }
+  });
+  _visible.assign(_clusters.size(), 1);
+  _results.resize(_clusters.size());
+  _culledVertices = _offScreenVertices = 0;
+}
+
+void OcclusionCuller::update(const Mesh &mesh, const glm::mat4 &modelViewProj)
+{
+  SC_PROFILE_SCOPE("OcclusionCuller::update");
+  if(_clusters.size() != (mesh.vertexPositions().size() + kClusterSize - 1)/kClusterSize)
+    reset(mesh);
+
+  auto start = std::chrono::steady_clock::now();
+  rasterizeOccluders(_occluders ? *_occluders : mesh, modelViewProj);
+  buildPyramid();
+  _rasterMs = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  parallel_for(0, _clusters.size(), 256, [&](size_t first, size_t last) {
+    for(size_t c = first; c < last; ++c) {
+      _results[c] = static_cast<uint8_t>(testCluster(_clusters[c], modelViewProj));
+      _visible[c] = _results[c] == 0;
+    }
+  });
+  _culledVertices = _offScreenVertices = 0;
+  for(size_t c = 0; c < _clusters.size(); ++c) {
+    if(_results[c] != 0)
+      _culledVertices += _clusters[c].vertexCount;
+    if(_results[c] == 2)
+      _offScreenVertices += _clusters[c].vertexCount;
+  }
+  _testMs = elapsedMs(start);
+}
+
+void OcclusionCuller::rasterizeOccluders(const Mesh &occluders, const glm::mat4 &modelViewProj)
+{
+  const std::vector<glm::vec3> &positions = occluders.vertexPositions();
+  const std::vector<glm::uvec3> &triangles = occluders.triangleIndices();
+
+  const size_t texelCount = static_cast<size_t>(_width)*_height;
+  if(_depthBits.size() != texelCount)
+    std::vector<std::atomic<uint32_t>>(texelCount).swap(_depthBits);
+  const uint32_t farBits = toBits(std::numeric_limits<float>::infinity());
+  for(std::atomic<uint32_t> &bits : _depthBits)
+    bits.store(farBits, std::memory_order_relaxed);
+
+  // Texel coordinates (texel centers at half-integers) and inverse view depth of the vertices,
+  // the latter being negative for the vertices too close to the eye plane
+  const float width = static_cast<float>(_width), height = static_cast<float>(_height);
+  _screen.resize(positions.size());
+  parallel_for(0, positions.size(), 4096, [&](size_t first, size_t last) {
+    for(size_t v = first; v < last; ++v) {
+      const glm::vec4 c = modelViewProj*glm::vec4(positions[v], 1.f);
+      if(c.w < kMinW) {
+        _screen[v] = glm::vec3(0.f, 0.f, -1.f);
+        continue;
+      }
+      const float invW = 1.f/c.w;
+      _screen[v] = glm::vec3((c.x*invW*0.5f + 0.5f)*width, (c.y*invW*0.5f + 0.5f)*height, invW);
+    }
+  });
+
+  parallel_for(0, triangles.size(), 4096, [&](size_t first, size_t last) {
+    for(size_t t = first; t < last; ++t) {
+      const glm::vec3 &s0 = _screen[triangles[t][0]], &s1 = _screen[triangles[t][1]], &s2 = _screen[triangles[t][2]];
+      if(s0.z < 0.f || s1.z < 0.f || s2.z < 0.f)
+        continue;
+      const glm::vec2 p0(s0), p1(s1), p2(s2);
+      glm::vec2 lo = glm::min(p0, glm::min(p1, p2)) - 0.5f, hi = glm::max(p0, glm::max(p1, p2)) - 0.5f;
+      if(!(lo.x <= hi.x && lo.y <= hi.y))  // NaN
+        continue;
+      lo = glm::clamp(lo, glm::vec2(0.f), glm::vec2(width, height));
+      hi = glm::clamp(hi, glm::vec2(-1.f), glm::vec2(width, height) - 1.f);
+      const int x0 = static_cast<int>(std::ceil(lo.x)), y0 = static_cast<int>(std::ceil(lo.y));
+      const int x1 = static_cast<int>(std::floor(hi.x)), y1 = static_cast<int>(std::floor(hi.y));
+      if(x0 > x1 || y0 > y1)
+        continue;
+      const float area = (p1.x - p0.x)*(p2.y - p0.y) - (p1.y - p0.y)*(p2.x - p0.x);
+      if(area == 0.f)
+        continue;
+      // Both windings are rasterized: the nearest surface is kept either way
+      const float invArea = 1.f/area;
+      for(int y = y0; y <= y1; ++y) {
+        const float py = y + 0.5f;
+        for(int x = x0; x <= x1; ++x) {
+          const float px = x + 0.5f;
+          const float b0 = ((p1.x - px)*(p2.y - py) - (p1.y - py)*(p2.x - px))*invArea;
+          const float b1 = ((p2.x - px)*(p0.y - py) - (p2.y - py)*(p0.x - px))*invArea;
+          const float b2 = 1.f - b0 - b1;
+          if(b0 < 0.f || b1 < 0.f || b2 < 0.f)
+            continue;
+          const float depth = 1.f/(b0*s0.z + b1*s1.z + b2*s2.z);
+          atomicMin(_depthBits[static_cast<size_t>(y)*_width + x], toBits(depth));
+        }
+      }
+    }
+  });
+}
+
+void OcclusionCuller::buildPyramid()
+{
+  // Sizes of the levels, down to 1x1. The levels keep their buffers from frame to frame, so
+  // that only a change of resolution allocates.
+  _levelSizes.assign(1, glm::uvec2(_width, _height));
+  while(_levelSizes.back().x > 1 || _levelSizes.back().y > 1)
+    _levelSizes.push_back(glm::uvec2((_levelSizes.back().x + 1)/2, (_levelSizes.back().y + 1)/2));
+  _levels.resize(_levelSizes.size());
+  for(size_t l = 0; l < _levels.size(); ++l)
+    _levels[l].resize(static_cast<size_t>(_levelSizes[l].x)*_levelSizes[l].y);
+
+  // Level 0: farthest depth over the 3x3 neighborhood of each texel
+  parallel_for(0, _height, 16, [&](size_t first, size_t last) {
+    for(size_t y = first; y < last; ++y)
+      for(unsigned int x = 0; x < _width; ++x) {
+        float depth = 0.f;
+        for(size_t ny = (y ? y - 1 : y); ny <= std::min<size_t>(y + 1, _height - 1); ++ny)
+          for(unsigned int nx = (x ? x - 1 : x); nx <= std::min(x + 1, _width - 1); ++nx)
+            depth = std::max(depth, fromBits(_depthBits[ny*_width + nx].load(std::memory_order_relaxed)));
+        _levels[0][y*_width + x] = depth;
+      }
+  });
+
+  // Coarser levels: farthest depth over 2x2 texels, texel i of a level covering texels i >> 1
+  // of the previous one
+  for(size_t l = 1; l < _levels.size(); ++l) {
+    const glm::uvec2 size = _levelSizes[l - 1], next = _levelSizes[l];
+    std::vector<float> &level = _levels[l];
+    const std::vector<float> &prev = _levels[l - 1];
+    for(unsigned int y = 0; y < next.y; ++y)
+      for(unsigned int x = 0; x < next.x; ++x) {
+        const unsigned int x0 = 2*x, y0 = 2*y, x1 = std::min(x0 + 1, size.x - 1), y1 = std::min(y0 + 1, size.y - 1);
+        level[static_cast<size_t>(y)*next.x + x] = std::max(std::max(prev[y0*size.x + x0], prev[y0*size.x + x1]),
+                                                            std::max(prev[y1*size.x + x0], prev[y1*size.x + x1]));
+      }
+  }
+}
+
+int OcclusionCuller::testCluster(const Cluster &cluster, const glm::mat4 &modelViewProj) const
+{
+  glm::vec2 lo(std::numeric_limits<float>::max()), hi(-std::numeric_limits<float>::max());
+  float nearest = std::numeric_limits<float>::max();
+  bool crossesEyePlane = false;
+  unsigned int outside[6] = {0, 0, 0, 0, 0, 0};
+  for(unsigned int i = 0; i < 8; ++i) {
+    const glm::vec3 corner(i & 1 ? cluster.max.x : cluster.min.x, i & 2 ? cluster.max.y : cluster.min.y,
+                           i & 4 ? cluster.max.z : cluster.min.z);
+    const glm::vec4 c = modelViewProj*glm::vec4(corner, 1.f);
+    outside[0] += c.x < -c.w;
+    outside[1] += c.x > c.w;
+    outside[2] += c.y < -c.w;
+    outside[3] += c.y > c.w;
+    outside[4] += c.z < -c.w;
+    outside[5] += c.z > c.w;
+    if(c.w < kMinW) {
+      crossesEyePlane = true;
+      continue;
+    }
+    nearest = std::min(nearest, c.w);
+    const glm::vec2 ndc(c.x/c.w, c.y/c.w);
+    lo = glm::min(lo, ndc);
+    hi = glm::max(hi, ndc);
+  }
+  for(unsigned int plane = 0; plane < 6; ++plane)
+    if(outside[plane] == 8)
+      return 2;
+  if(crossesEyePlane)
+    return 0;
+
+  // Level-0 texels overlapped by the screen rectangle of the box
+  const float width = static_cast<float>(_width), height = static_cast<float>(_height);
+  lo = glm::clamp((lo*0.5f + 0.5f)*glm::vec2(width, height), glm::vec2(0.f), glm::vec2(width, height) - 1.f);
+  hi = glm::clamp((hi*0.5f + 0.5f)*glm::vec2(width, height), glm::vec2(0.f), glm::vec2(width, height) - 1.f);
+  unsigned int x0 = static_cast<unsigned int>(lo.x), y0 = static_cast<unsigned int>(lo.y);
+  unsigned int x1 = static_cast<unsigned int>(hi.x), y1 = static_cast<unsigned int>(hi.y);
+
+  size_t level = 0;
+  while(level + 1 < _levels.size() && (x1 - x0 > 1 || y1 - y0 > 1)) {
+    x0 >>= 1;
+    y0 >>= 1;
+    x1 >>= 1;
+    y1 >>= 1;
+    ++level;
+  }
+  const std::vector<float> &depths = _levels[level];
+  const unsigned int levelWidth = _levelSizes[level].x;
+  float farthest = 0.f;
+  for(unsigned int y = y0; y <= y1; ++y)
+    for(unsigned int x = x0; x <= x1; ++x)
+      farthest = std::max(farthest, depths[static_cast<size_t>(y)*levelWidth + x]);
+  return nearest > farthest + _depthMargin ? 1 : 0;
+}
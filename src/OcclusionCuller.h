@@ -0,0 +1,124 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class Mesh;
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Hierarchical-Z culling of vertex clusters, so that the contour stages skip the parts of the
+ * mesh hidden from the camera. Every frame, the occluders are rasterized into a low-resolution
+ * buffer of view depths, which is dilated by one texel (a texel is then only as near as its
+ * neighbors, covering the partial coverage at the occluder borders) and reduced into a max-depth
+ * pyramid. A cluster is culled if its bounding box is off screen, or behind the farthest
+ * occluder depth over its screen rectangle, read from the pyramid level where this rectangle
+ * spans at most 2x2 texels.
+ *
+ * The occluders are the triangles of the mesh itself by default: the test is then conservative
+ * up to the depth variation between texel centers, which the dilation absorbs on smooth
+ * surfaces. A coarser occluder mesh (e.g., the coarse LOD) can be given with a depth margin
+ * bounding how far in front of the mesh it may lie. Triangles crossing the near plane are not
+ * rasterized, which only makes the test more conservative. Clusters are runs of consecutive vertices, so a mesh
+ * with a spatially coherent vertex order gives tighter clusters.
+ */
+class OcclusionCuller {
+public:
+  static const unsigned int kClusterSize = 256;
+
+  void setResolution(unsigned int width, unsigned int height) { _width = width; _height = height; }
+  // Occluders other than the mesh, pushed back by depthMargin; nullptr for the mesh itself
+  void setOccluders(const Mesh *occluders, float depthMargin) { _occluders = occluders; _depthMargin = depthMargin; }
+
+  // Builds the clusters. Must be called after any change of the mesh geometry.
+  void reset(const Mesh &mesh);
+  // Culls the clusters for the model-view-projection matrix of the mesh
+  void update(const Mesh &mesh, const glm::mat4 &modelViewProj);
+
+  unsigned int clusterCount() const { return static_cast<unsigned int>(_clusters.size()); }
+  bool clusterVisible(unsigned int cluster) const { return _visible[cluster] != 0; }
+  unsigned int clusterOf(unsigned int vertex) const { return vertex/kClusterSize; }
+  bool vertexVisible(unsigned int vertex) const { return _visible[vertex/kClusterSize] != 0; }
+
+  // Calls fn(first, last) on the maximal runs of visible vertices in [begin, end)
+  template <typename Fn>
+  void forEachVisibleRange(unsigned int begin, unsigned int end, const Fn &fn) const
+  {
+    unsigned int first = begin;
+    while(first < end) {
+      unsigned int c = clusterOf(first);
+      if(!_visible[c]) {
+        first = std::min(end, (c + 1)*kClusterSize);
+        continue;
+      }
+      while(c + 1 < _visible.size() && (c + 1)*kClusterSize < end && _visible[c + 1])
+        ++c;
+      const unsigned int last = std::min(end, (c + 1)*kClusterSize);
+      fn(first, last);
+      first = last;
+    }
+  }
+  // Calls fn(first, last) on the maximal runs of culled vertices in [begin, end)
+  template <typename Fn>
+  void forEachCulledRange(unsigned int begin, unsigned int end, const Fn &fn) const
+  {
+    unsigned int first = begin;
+    while(first < end) {
+      unsigned int c = clusterOf(first);
+      if(_visible[c]) {
+        first = std::min(end, (c + 1)*kClusterSize);
+        continue;
+      }
+      while(c + 1 < _visible.size() && (c + 1)*kClusterSize < end && !_visible[c + 1])
+        ++c;
+      const unsigned int last = std::min(end, (c + 1)*kClusterSize);
+      fn(first, last);
+      first = last;
+    }
+  }
+
+  // Statistics of the last update
+  size_t culledVertexCount() const { return _culledVertices; }
+  size_t offScreenVertexCount() const { return _offScreenVertices; }  // part of the culled ones
+  float culledFraction() const { return _vertexCount ? static_cast<float>(_culledVertices)/_vertexCount : 0.f; }
+  double rasterTime() const { return _rasterMs; }
+  double testTime() const { return _testMs; }
+
+private:
+  struct Cluster {
+    glm::vec3 min, max;
+    unsigned int vertexCount;
+  };
+
+  void rasterizeOccluders(const Mesh &occluders, const glm::mat4 &modelViewProj);
+  void buildPyramid();
+  // 0: visible, 1: occluded, 2: off screen
+  int testCluster(const Cluster &cluster, const glm::mat4 &modelViewProj) const;
+
+  unsigned int _width = 256, _height = 144;
+  const Mesh *_occluders = nullptr;
+  float _depthMargin = 0.f;
+
+  std::vector<Cluster> _clusters;
+  std::vector<uint8_t> _visible;
+  std::vector<uint8_t> _results;  // of testCluster(), per cluster
+  size_t _vertexCount = 0;
+
+  // Nearest occluder view depth per texel, as ordered float bits for the atomic minimum
+  std::vector<std::atomic<uint32_t>> _depthBits;
+  std::vector<glm::vec3> _screen;
+  // Max-depth pyramid, level 0 at full (low) resolution
+  std::vector<std::vector<float>> _levels;
+  std::vector<glm::uvec2> _levelSizes;
+
+  size_t _culledVertices = 0, _offScreenVertices = 0;
+  double _rasterMs = 0.0, _testMs = 0.0;
+};
+
+#endif  // OCCLUSION_CULLER_H
@@ -0,0 +1,98 @@
+#include "PngWriter.h"
+
+#include <algorithm>
+#include <fstream>
+#include <ios>
+
+namespace {
+
+uint32_t crc32(const std::string &data, size_t begin)
+{
+  static uint32_t table[256] = {0};
+  static const bool initialized = []() {
+    for(uint32_t n = 0; n < 256; ++n) {
+      uint32_t c = n;
+      for(int k = 0; k < 8; ++k)
+        c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      table[n] = c;
+    }
+    return true;
+  }();
+  (void)initialized;
+  uint32_t crc = 0xffffffffu;
+  for(size_t i = begin; i < data.size(); ++i)
+    crc = table[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+  return crc ^ 0xffffffffu;
+}
+
+void appendBigEndian(std::string &out, uint32_t value)
+{
+  out.push_back(static_cast<char>(value >> 24));
+  out.push_back(static_cast<char>(value >> 16));
+  out.push_back(static_cast<char>(value >> 8));
+  out.push_back(static_cast<char>(value));
+}
+
+void appendChunk(std::string &out, const char *type, const std::string &data)
+{
+  appendBigEndian(out, static_cast<uint32_t>(data.size()));
+  const size_t begin = out.size();
+  out.append(type, 4);
+  out += data;
+  appendBigEndian(out, crc32(out, begin));
+}
+
+} // namespace
+
+std::string encodePNG(unsigned int width, unsigned int height, const std::vector<uint8_t> &rgb)
+{
+  std::string header;
+  appendBigEndian(header, width);
+  appendBigEndian(header, height);
+  header += std::string("\x08\x02\x00\x00\x00", 5); // 8 bits per channel, RGB, no interlacing
+
+  // Scanlines, each one prefixed with its filter type (none)
+  const size_t rowSize = 3*static_cast<size_t>(width);
+  std::string raw;
+  raw.reserve((rowSize + 1)*height);
+  for(unsigned int y = 0; y < height; ++y) {
+    raw.push_back('\0');
+    raw.append(reinterpret_cast<const char *>(rgb.data()) + y*rowSize, rowSize);
+  }
+
+  // zlib stream made of stored deflate blocks, followed by the Adler-32 checksum of the data
+  std::string zlib("\x78\x01", 2);
+  zlib.reserve(raw.size() + raw.size()/65535*5 + 16);
+  size_t pos = 0;
+  do {
+    const size_t length = std::min<size_t>(65535, raw.size() - pos);
+    zlib.push_back(pos + length == raw.size() ? '\x01' : '\x00');
+    zlib.push_back(static_cast<char>(length & 0xff));
+    zlib.push_back(static_cast<char>(length >> 8));
+    zlib.push_back(static_cast<char>(~length & 0xff));
+    zlib.push_back(static_cast<char>((~length >> 8) & 0xff));
+    zlib.append(raw, pos, length);
+    pos += length;
+  } while(pos < raw.size());
+  uint32_t a = 1, b = 0;
+  for(char c : raw) {
+    a = (a + static_cast<uint8_t>(c)) % 65521;
+    b = (b + a) % 65521;
+  }
+  appendBigEndian(zlib, (b << 16) | a);
+
+  std::string png("\x89PNG\r\n\x1a\n", 8);
+  appendChunk(png, "IHDR", header);
+  appendChunk(png, "IDAT", zlib);
+  appendChunk(png, "IEND", std::string());
+  return png;
+}
+
+void savePNG(const std::string &filename, unsigned int width, unsigned int height, const std::vector<uint8_t> &rgb)
+{
+  std::ofstream out(filename.c_str(), std::ios::binary);
+  if(!out)
+    throw std::ios_base::failure("[PNG Writer][savePNG] Cannot open " + filename);
+  const std::string png = encodePNG(width, height, rgb);
+  out.write(png.data(), static_cast<std::streamsize>(png.size()));
+}
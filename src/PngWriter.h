@@ -0,0 +1,13 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// utility: minimal PNG writer for 8-bit RGB images, rows from top to bottom. The image data is
+// stored uncompressed (deflate "stored" blocks), so no compression library is needed.
+std::string encodePNG(unsigned int width, unsigned int height, const std::vector<uint8_t> &rgb);
+void savePNG(const std::string &filename, unsigned int width, unsigned int height, const std::vector<uint8_t> &rgb);
+
+#endif  // PNG_WRITER_H
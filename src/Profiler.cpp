@@ -0,0 +1,218 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <ios>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+
+std::atomic<bool> Profiler::_enabled{false};
+
+namespace {
+
+struct Event {
+  const char *name;
+  uint64_t start, end;
+};
+
+// Ring buffer of one thread: written by its thread only, read by the exports
+struct ThreadEvents {
+  std::vector<Event> ring;
+  std::atomic<uint64_t> written{0}; // events ever written
+  std::atomic<uint64_t> cleared{0}; // events written before the last clear()
+  unsigned int id = 0;
+};
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadEvents>> threads; // kept after their thread exits
+  std::set<std::string> names;
+  const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+Registry &registry()
+{
+  static Registry instance;
+  return instance;
+}
+
+thread_local ThreadEvents *t_events = nullptr;
+
+ThreadEvents &threadEvents()
+{
+  if(!t_events) {
+    auto events = std::make_shared<ThreadEvents>();
+    events->ring.resize(Profiler::kRingCapacity);
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    events->id = static_cast<unsigned int>(r.threads.size());
+    r.threads.push_back(events);
+    t_events = events.get();
+  }
+  return *t_events;
+}
+
+struct ThreadSnapshot {
+  unsigned int id;
+  std::vector<Event> events;
+};
+
+std::vector<ThreadSnapshot> snapshot()
+{
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  std::vector<ThreadSnapshot> threads;
+  for(const auto &t : r.threads) {
+    const uint64_t end = t->written.load(std::memory_order_acquire);
+    const uint64_t begin = std::max(t->cleared.load(std::memory_order_relaxed),
+                                    end > Profiler::kRingCapacity ? end - Profiler::kRingCapacity : 0);
+    ThreadSnapshot s;
+    s.id = t->id;
+    for(uint64_t i = begin; i < end; ++i)
+      s.events.push_back(t->ring[i & (Profiler::kRingCapacity - 1)]);
+    threads.push_back(std::move(s));
+  }
+  return threads;
+}
+
+// Nearest-rank percentile of sorted durations
+double percentile(const std::vector<double> &sorted, double p)
+{
+  if(sorted.empty())
+    return 0.0;
+  const size_t rank = static_cast<size_t>(std::ceil(p*sorted.size()));
+  return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+void writeJsonString(std::ostream &out, const char *s)
+{
+  out << '"';
+  for(; *s; ++s) {
+    if(*s == '"' || *s == '\\')
+      out << '\\' << *s;
+    else if(static_cast<unsigned char>(*s) < 0x20)
+      out << ' ';
+    else
+      out << *s;
+  }
+  out << '"';
+}
+
+} // namespace
+
+const char *Profiler::intern(const std::string &name)
+{
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  return r.names.insert(name).first->c_str();
+}
+
+uint64_t Profiler::now()
+{
+  return static_cast<uint64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - registry().epoch).count());
+}
+
+void Profiler::record(const char *name, uint64_t start, uint64_t end)
+{
+  ThreadEvents &events = threadEvents();
+  const uint64_t i = events.written.load(std::memory_order_relaxed);
+  events.ring[i & (kRingCapacity - 1)] = Event{name, start, end};
+  events.written.store(i + 1, std::memory_order_release);
+}
+
+void Profiler::clear()
+{
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  for(const auto &t : r.threads)
+    t->cleared.store(t->written.load(std::memory_order_acquire), std::memory_order_relaxed);
+}
+
+std::vector<ProfileSummary> Profiler::summarize()
+{
+  std::vector<ProfileSummary> summaries;
+  std::vector<std::vector<double>> durations;
+  std::unordered_map<std::string, size_t> index;
+  std::vector<ThreadSnapshot> threads = snapshot();
+  // Names in order of first appearance over all threads
+  std::vector<Event> events;
+  for(const ThreadSnapshot &t : threads)
+    events.insert(events.end(), t.events.begin(), t.events.end());
+  std::stable_sort(events.begin(), events.end(), [](const Event &a, const Event &b) { return a.start < b.start; });
+  for(const Event &e : events) {
+    auto it = index.find(e.name);
+    if(it == index.end()) {
+      it = index.insert(std::make_pair(std::string(e.name), summaries.size())).first;
+      summaries.emplace_back();
+      summaries.back().name = e.name;
+      durations.emplace_back();
+    }
+    durations[it->second].push_back((e.end - e.start)*1e-6);
+  }
+  for(size_t s = 0; s < summaries.size(); ++s) {
+    std::vector<double> &d = durations[s];
+    std::sort(d.begin(), d.end());
+    ProfileSummary &summary = summaries[s];
+    summary.count = d.size();
+    for(double ms : d)
+      summary.totalMs += ms;
+    summary.p50Ms = percentile(d, 0.50);
+    summary.p95Ms = percentile(d, 0.95);
+    summary.p99Ms = percentile(d, 0.99);
+    summary.maxMs = d.back();
+  }
+  return summaries;
+}
+
+void Profiler::writeSummary(std::ostream &out)
+{
+  const std::vector<ProfileSummary> summaries = summarize();
+  out << " > Profile: " << summaries.size() << " scopes" << std::endl;
+  out << "      count   total ms     p50 ms     p95 ms     p99 ms     max ms  scope" << std::endl;
+  out << std::fixed << std::setprecision(3);
+  for(const ProfileSummary &s : summaries)
+    out << std::setw(11) << s.count << std::setw(11) << s.totalMs << std::setw(11) << s.p50Ms << std::setw(11)
+        << s.p95Ms << std::setw(11) << s.p99Ms << std::setw(11) << s.maxMs << "  " << s.name << std::endl;
+  out.unsetf(std::ios_base::floatfield);
+}
+
+void Profiler::writeChromeTrace(std::ostream &out)
+{
+  const std::vector<ThreadSnapshot> threads = snapshot();
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  auto separator = [&]() {
+    out << (first ? "\n" : ",\n");
+    first = false;
+  };
+  out << std::fixed << std::setprecision(3);
+  for(const ThreadSnapshot &t : threads) {
+    separator();
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t.id
+        << ",\"args\":{\"name\":\"thread " << t.id << "\"}}";
+    // Complete events, in microseconds
+    for(const Event &e : t.events) {
+      separator();
+      out << "{\"name\":";
+      writeJsonString(out, e.name);
+      out << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << t.id << ",\"ts\":" << e.start*1e-3
+          << ",\"dur\":" << (e.end - e.start)*1e-3 << "}";
+    }
+  }
+  out << "\n]}" << std::endl;
+  out.unsetf(std::ios_base::floatfield);
+}
+
+void Profiler::saveChromeTrace(const std::string &filename)
+{
+  std::ofstream out(filename.c_str());
+  if(!out)
+    throw std::ios_base::failure("[Profiler][saveChromeTrace] Cannot open " + filename);
+  writeChromeTrace(out);
+}
@@ -0,0 +1,79 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Times the enclosing scope under a name with static storage duration (a literal, or a name
+// returned by Profiler::intern()). Compiled out without SC_PROFILING.
+#if defined(SC_PROFILING)
+#define SC_PROFILE_CONCAT_(a, b) a##b
+#define SC_PROFILE_CONCAT(a, b) SC_PROFILE_CONCAT_(a, b)
+#define SC_PROFILE_SCOPE(name) ProfileScope SC_PROFILE_CONCAT(profileScope_, __LINE__)(name)
+#else
+#define SC_PROFILE_SCOPE(name) ((void)0)
+#endif
+
+// Statistics of the recorded scopes of one name, in milliseconds
+struct ProfileSummary {
+  std::string name;
+  size_t count = 0;
+  double totalMs = 0.0;
+  double p50Ms = 0.0, p95Ms = 0.0, p99Ms = 0.0, maxMs = 0.0;
+};
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Low-overhead scope profiler. Every thread records its scopes into its own ring buffer of
+ * kRingCapacity events, without locking: the oldest events are overwritten once it is full.
+ * Recording is off until setEnabled(true), a disabled scope costing one relaxed atomic load.
+ * The events of all threads can be exported as a Chrome trace (chrome://tracing, Perfetto) or
+ * summarized per scope name with percentiles. Exports should be made while the profiled
+ * threads are idle, e.g., between frames: an event written during the export may be torn.
+ */
+class Profiler {
+public:
+  static const size_t kRingCapacity = size_t(1) << 16; // events per thread, a power of two
+
+  static void setEnabled(bool enabled) { _enabled.store(enabled, std::memory_order_relaxed); }
+  static bool enabled() { return _enabled.load(std::memory_order_relaxed); }
+
+  // Stable copy of a dynamic scope name, e.g., of a task graph stage
+  static const char *intern(const std::string &name);
+  // Nanoseconds on the steady clock
+  static uint64_t now();
+  static void record(const char *name, uint64_t start, uint64_t end);
+  // Drops the events recorded so far
+  static void clear();
+
+  // Per name, in order of first appearance
+  static std::vector<ProfileSummary> summarize();
+  static void writeSummary(std::ostream &out);
+  static void writeChromeTrace(std::ostream &out);
+  static void saveChromeTrace(const std::string &filename);
+
+private:
+  static std::atomic<bool> _enabled;
+};
+
+class ProfileScope {
+public:
+  explicit ProfileScope(const char *name) : _name(Profiler::enabled() ? name : nullptr), _start(_name ? Profiler::now() : 0) {}
+  ~ProfileScope() {
+    if(_name)
+      Profiler::record(_name, _start, Profiler::now());
+  }
+  ProfileScope(const ProfileScope &) = delete;
+  ProfileScope &operator=(const ProfileScope &) = delete;
+
+private:
+  const char *_name;
+  uint64_t _start;
+};
+
+#endif  // PROFILER_H
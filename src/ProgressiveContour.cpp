@@ -0,0 +1,194 @@
+#include "ProgressiveContour.h"
+#include "Mesh.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+const unsigned int kVertexBlockSize = 2048;
+const unsigned int kTriangleBlockSize = 4096;
+
+// View direction changes below this angle (in radians) leave a block up to date
+const float kViewTolerance = 1e-4f;
+
+} // namespace
+
+void ProgressiveContourEvaluator::reset(const Mesh &mesh)
+{
+  const auto &P = mesh.vertexPositions();
+  _blocks.clear();
+  for(unsigned int begin = 0; begin < P.size(); begin += kVertexBlockSize) {
+    Block block;
+    block.begin = begin;
+    block.end = std::min<unsigned int>(begin + kVertexBlockSize, static_cast<unsigned int>(P.size()));
+    glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+    for(unsigned int v = block.begin; v < block.end; ++v) {
+      lo = glm::min(lo, P[v]);
+      hi = glm::max(hi, P[v]);
+    }
+    block.center = 0.5f*(lo + hi);
+    block.radius = 0.5f*glm::length(hi - lo);
+    block.viewDir = glm::vec3(0.f);
+    block.evaluated = false;
+    block.priority = 0.f;
+    _blocks.push_back(block);
+  }
+  mesh.computeOneRingAdjacency(_ringOffsets, _ring);
+  _triangleCount = static_cast<unsigned int>(mesh.triangleIndices().size());
+  _gradAccum.assign(P.size(), glm::vec3(0.f));
+  _weightAccum.assign(P.size(), 0.f);
+  _dirDeriv.assign(P.size(), 0.f);
+  _eligibility.assign(P.size(), 0);
+  _hysteresisQueue.assign(P.size(), 0);
+  _queueHead = _queueTail = 0;
+  _queue.clear();
+  _cursor = 0;
+  _hasCamera = false;
+  _phase = Phase::Done;
+}
+
+void ProgressiveContourEvaluator::scheduleBlocks(const glm::vec3 &cameraPosition, const glm::mat4 &modelViewProj)
+{
+  _queue.clear();
+  for(unsigned int b = 0; b < _blocks.size(); ++b) {
+    Block &block = _blocks[b];
+    const glm::vec3 viewDir = glm::normalize(cameraPosition - block.center);
+    const float change = block.evaluated ? 1.f - glm::dot(viewDir, block.viewDir) : 2.f;
+    if(block.evaluated && change < 0.5f*kViewTolerance*kViewTolerance)
+      continue; // 1 - cos(a) ~ a^2/2
+
+    // Screen-space importance: projected radius of the bounding sphere, reduced off screen
+    const glm::vec4 clip = modelViewProj*glm::vec4(block.center, 1.f);
+    float importance = 0.01f;
+    if(clip.w > 0.f) {
+      const float ndcRadius = block.radius/clip.w;
+      const glm::vec2 ndc = glm::vec2(clip)/clip.w;
+      const bool onScreen = std::abs(ndc.x) <= 1.f + ndcRadius && std::abs(ndc.y) <= 1.f + ndcRadius;
+      importance = (onScreen ? 1.f : 0.1f)*(ndcRadius + 1e-3f);
+    }
+    block.priority = importance*(change + 1e-6f);
+    _queue.push_back(b);
+  }
+  std::sort(_queue.begin(), _queue.end(),
+            [this](unsigned int x, unsigned int y) { return _blocks[x].priority > _blocks[y].priority; });
+}
+
+bool ProgressiveContourEvaluator::step(Mesh &mesh, const glm::vec3 &cameraPosition, const glm::mat4 &modelViewProj,
+                                       ContourAttributeListener *listener)
+{
+  SC_PROFILE_SCOPE("ProgressiveContourEvaluator::step");
+  const auto start = std::chrono::steady_clock::now();
+  const unsigned int vertexCount = static_cast<unsigned int>(mesh.vertexPositions().size());
+
+  if(!_hasCamera || cameraPosition != _cameraPosition) {
+    _hasCamera = true;
+    _cameraPosition = cameraPosition;
+    scheduleBlocks(cameraPosition, modelViewProj);
+    _cursor = 0;
+    _phase = Phase::Radial;
+  }
+  if(_phase == Phase::Done)
+    return true;
+
+  const SuggestiveContourThresholds thresholds;
+  unsigned int uploadBegin = UINT_MAX, uploadEnd = 0;
+  bool first = true; // always make some progress, whatever the budget
+  while(_phase != Phase::Done &&
+        (first || std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count() < _budgetMs)) {
+    first = false;
+    switch(_phase) {
+    case Phase::Radial:
+      if(_cursor < _queue.size()) {
+        Block &block = _blocks[_queue[_cursor++]];
+        mesh.calculateRadialCurvature(cameraPosition, block.begin, block.end);
+        block.viewDir = glm::normalize(cameraPosition - block.center);
+        block.evaluated = true;
+        uploadBegin = std::min(uploadBegin, block.begin);
+        uploadEnd = std::max(uploadEnd, block.end);
+      } else {
+        std::fill(_gradAccum.begin(), _gradAccum.end(), glm::vec3(0.f));
+        std::fill(_weightAccum.begin(), _weightAccum.end(), 0.f);
+        _cursor = 0;
+        _phase = Phase::Gradient;
+      }
+      break;
+    case Phase::Gradient:
+      if(_cursor < _triangleCount) {
+        const unsigned int end = std::min(_cursor + kTriangleBlockSize, _triangleCount);
+        mesh.accumulateTriangleGradients(_cursor, end, _gradAccum, _weightAccum);
+        _cursor = end;
+      } else {
+        _cursor = 0;
+        _phase = Phase::Derivative;
+      }
+      break;
+    case Phase::Derivative:
+      if(_cursor < vertexCount) {
+        const unsigned int end = std::min(_cursor + kVertexBlockSize, vertexCount);
+        mesh.computeDirectionalDerivatives(_gradAccum, _weightAccum, cameraPosition, _cursor, end, _dirDeriv);
+        mesh.classifyForSuggestiveContour(_dirDeriv, thresholds, cameraPosition, _cursor, end, _eligibility);
+        _cursor = end;
+      } else {
+        _cursor = 0;
+        _queueHead = _queueTail = 0;
+        _phase = Phase::Hysteresis;
+      }
+      break;
+    case Phase::Hysteresis:
+      // The strong vertices are queued first, then each slice upgrades the weak neighbors of
+      // the queued vertices, which are queued in turn
+      if(_cursor < vertexCount) {
+        const unsigned int end = std::min(_cursor + kVertexBlockSize, vertexCount);
+        for(unsigned int v = _cursor; v < end; ++v)
+          if(_eligibility[v] == 2)
+            _hysteresisQueue[_queueTail++] = v;
+        _cursor = end;
+      } else if(_queueHead < _queueTail) {
+        const unsigned int end = std::min(_queueHead + kVertexBlockSize, _queueTail);
+        for(; _queueHead < end; ++_queueHead) {
+          const unsigned int v = _hysteresisQueue[_queueHead];
+          for(unsigned int n = _ringOffsets[v]; n < _ringOffsets[v + 1]; ++n) {
+            if(_eligibility[_ring[n]] == 1) {
+              _eligibility[_ring[n]] = 2;
+              _hysteresisQueue[_queueTail++] = _ring[n];
+            }
+          }
+        }
+      } else {
+        mesh.setSuggestiveContourEligibility(_eligibility);
+        if(listener)
+          listener->eligibilityChanged(mesh, 0, static_cast<unsigned int>(mesh.vertexPositions().size()));
+        ++_generation;
+        _phase = Phase::Done;
+      }
+      break;
+    case Phase::Done:
+      break;
+    }
+  }
+  if(listener)
+    listener->radialCurvatureChanged(mesh, uploadBegin, uploadEnd);
+  return _phase == Phase::Done;
+}
+
+float ProgressiveContourEvaluator::progress() const
+{
+  switch(_phase) {
+  case Phase::Radial:
+    return _queue.empty() ? 0.5f : 0.5f*_cursor/_queue.size();
+  case Phase::Gradient:
+    return 0.5f + (_triangleCount ? 0.2f*_cursor/_triangleCount : 0.2f);
+  case Phase::Derivative:
+    return 0.7f + (_dirDeriv.empty() ? 0.2f : 0.2f*_cursor/_dirDeriv.size());
+  case Phase::Hysteresis:
+    return 0.9f + (_dirDeriv.empty() ? 0.1f : 0.05f*_cursor/_dirDeriv.size()) +
+           (_queueTail ? 0.05f*_queueHead/_queueTail : 0.f);
+  default:
+    return 1.f;
+  }
+}
@@ -0,0 +1,82 @@
+#ifndef PROGRESSIVE_CONTOUR_H
+#define PROGRESSIVE_CONTOUR_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class Mesh;
+class ContourAttributeListener;
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Time-budgeted evaluation of the suggestive contour attributes. Instead of recomputing the
+ * whole mesh when the camera moves, every call to step() runs as much of the pipeline as fits
+ * in the frame budget and uploads the partial results, so that interaction keeps a fixed frame
+ * rate and the exact solution is reached over a few frames once the view settles.
+ *
+ * Vertices are processed in blocks. After a camera change, stale blocks are visited by
+ * decreasing priority: the screen-space size of their bounding sphere times the change of
+ * their view direction since they were last evaluated. Once all radial curvatures match the
+ * camera, the eligibility stages (gradient accumulation, directional derivatives, thresholds
+ * and hysteresis) run in budgeted slices as well. The hysteresis is a breadth-first search
+ * from the strong vertices over the compressed one-ring, whose queue is consumed slice by slice.
+ */
+class ProgressiveContourEvaluator {
+public:
+  void setBudget(float milliseconds) { _budgetMs = milliseconds; }
+  float budget() const { return _budgetMs; }
+
+  // Rebuilds the vertex blocks. Must be called after any change of the mesh geometry, once the
+  // contour attributes of the mesh are sized (and mirrored by the listener, if any).
+  void reset(const Mesh &mesh);
+
+  // Advances the evaluation for the camera and notifies the listener of the updated attributes.
+  // Returns true once the contour attributes of the mesh match the camera.
+  bool step(Mesh &mesh, const glm::vec3 &cameraPosition, const glm::mat4 &modelViewProj,
+            ContourAttributeListener *listener = nullptr);
+
+  bool converged() const { return _phase == Phase::Done; }
+  // Number of complete evaluations so far, to detect newly converged results
+  unsigned int generation() const { return _generation; }
+  // Fraction of the work done for the current view, in [0, 1]
+  float progress() const;
+
+private:
+  enum class Phase { Radial, Gradient, Derivative, Hysteresis, Done };
+
+  struct Block {
+    unsigned int begin, end;
+    glm::vec3 center;
+    float radius;
+    glm::vec3 viewDir; // view direction at the center when the block was last evaluated
+    bool evaluated;
+    float priority;
+  };
+
+  void scheduleBlocks(const glm::vec3 &cameraPosition, const glm::mat4 &modelViewProj);
+
+  float _budgetMs = 4.f;
+  Phase _phase = Phase::Done;
+  glm::vec3 _cameraPosition = glm::vec3(0.f);
+  bool _hasCamera = false;
+
+  std::vector<Block> _blocks;
+  std::vector<unsigned int> _queue; // stale blocks, by decreasing priority
+  unsigned int _cursor = 0;         // position in the queue or in the triangle/vertex ranges
+
+  // Intermediate buffers of the eligibility stages; the one-ring is compressed, see
+  // Mesh::computeOneRingAdjacency()
+  std::vector<unsigned int> _ringOffsets, _ring;
+  std::vector<glm::vec3> _gradAccum;
+  std::vector<float> _weightAccum;
+  std::vector<float> _dirDeriv;
+  std::vector<int> _eligibility;
+  std::vector<unsigned int> _hysteresisQueue; // every vertex enters it at most once
+  unsigned int _queueHead = 0, _queueTail = 0;
+  unsigned int _triangleCount = 0;
+  unsigned int _generation = 0;
+};
+
+#endif  // PROGRESSIVE_CONTOUR_H
@@ -0,0 +1,211 @@
+#include "SilhouetteTree.h"
+#include "Mesh.h"
+#include "MemoryFootprint.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+namespace {
+
+const unsigned int kLeafSize = 8;
+
+struct BuildItem {
+  glm::vec4 lo, hi;   // bounds of the dual segment of the edge
+  glm::vec4 centroid;
+  SilhouetteEdge edge;
+};
+
+// Recursively builds the subtree over items[begin, end) and returns the index of its root.
+unsigned int buildNode(std::vector<BuildItem> &items, unsigned int begin, unsigned int end,
+                       const glm::vec4 &axisWeight, std::vector<glm::vec4> &nodeLo, std::vector<glm::vec4> &nodeHi,
+                       std::vector<std::pair<unsigned int, unsigned int>> &nodeRange)
+{
+  glm::vec4 lo(FLT_MAX), hi(-FLT_MAX), cLo(FLT_MAX), cHi(-FLT_MAX);
+  for(unsigned int i = begin; i < end; ++i) {
+    lo = glm::min(lo, items[i].lo);
+    hi = glm::max(hi, items[i].hi);
+    cLo = glm::min(cLo, items[i].centroid);
+    cHi = glm::max(cHi, items[i].centroid);
+  }
+  const unsigned int nodeIndex = static_cast<unsigned int>(nodeLo.size());
+  nodeLo.push_back(lo);
+  nodeHi.push_back(hi);
+  nodeRange.push_back(std::make_pair(begin, end - begin));
+  if(end - begin <= kLeafSize)
+    return nodeIndex;
+
+  // Median split along the largest extent of the centroids, measured in units of the eye
+  // hyperplane so that the normal and offset axes are comparable
+  const glm::vec4 extent = axisWeight*(cHi - cLo);
+  int axis = 0;
+  for(int k = 1; k < 4; ++k)
+    if(extent[k] > extent[axis])
+      axis = k;
+  const unsigned int mid = begin + (end - begin)/2;
+  std::nth_element(items.begin() + begin, items.begin() + mid, items.begin() + end,
+                   [axis](const BuildItem &x, const BuildItem &y) { return x.centroid[axis] < y.centroid[axis]; });
+
+  buildNode(items, begin, mid, axisWeight, nodeLo, nodeHi, nodeRange);
+  const unsigned int right = buildNode(items, mid, end, axisWeight, nodeLo, nodeHi, nodeRange);
+  nodeRange[nodeIndex] = std::make_pair(right, 0u); // internal node: offset of the right child
+  return nodeIndex;
+}
+
+} // namespace
+
+void SilhouetteTree::clear()
+{
+  _facePlanes.clear();
+  _edges.clear();
+  _nodes.clear();
+  _boundaryEdgeCount = 0;
+}
+
+void SilhouetteTree::accountMemory(MemoryFootprint &footprint) const
+{
+  const size_t bytes = _facePlanes.capacity()*sizeof(glm::vec4) + _edges.capacity()*sizeof(SilhouetteEdge) +
+                       _nodes.capacity()*sizeof(Node);
+  footprint.add(MemoryCategory::Caches, "silhouette tree", bytes, MemoryScale::Triangles);
+}
+
+size_t SilhouetteTree::buildBytes(size_t triangleCount)
+{
+  // A closed mesh has 3/2 edges per triangle, and about two nodes per leaf
+  const size_t edges = 3*triangleCount/2, nodes = 2*edges/kLeafSize + 1;
+  const size_t tree = triangleCount*sizeof(glm::vec4) + edges*sizeof(SilhouetteEdge) + nodes*sizeof(Node);
+  // Half-edges, then the build items next to the node bounds and ranges
+  const size_t temporaries = 3*triangleCount*sizeof(std::pair<uint64_t, unsigned int>) + edges*sizeof(BuildItem) +
+                             nodes*(2*sizeof(glm::vec4) + sizeof(std::pair<unsigned int, unsigned int>));
+  return tree + temporaries;
+}
+
+void SilhouetteTree::build(const Mesh &mesh)
+{
+  SC_PROFILE_SCOPE("SilhouetteTree::build");
+  clear();
+  const auto &P = mesh.vertexPositions();
+  const auto &T = mesh.triangleIndices();
+
+  // Dual points of the face planes
+  _facePlanes.resize(T.size());
+  for(unsigned int t = 0; t < T.size(); ++t) {
+    const glm::vec3 &p0 = P[T[t][0]];
+    glm::vec3 n = glm::cross(P[T[t][1]] - p0, P[T[t][2]] - p0);
+    const float len = glm::length(n);
+    n = (len > 0.f) ? n/len : glm::vec3(0.f);
+    _facePlanes[t] = glm::vec4(n, -glm::dot(n, p0));
+  }
+
+  // Edge-to-face adjacency: sort (edge key, face) pairs so that the faces of an edge are contiguous
+  std::vector<std::pair<uint64_t, unsigned int>> halfEdges;
+  halfEdges.reserve(3*T.size());
+  for(unsigned int t = 0; t < T.size(); ++t) {
+    for(unsigned int k = 0; k < 3; ++k) {
+      const uint64_t a = std::min(T[t][k], T[t][(k + 1)%3]);
+      const uint64_t b = std::max(T[t][k], T[t][(k + 1)%3]);
+      halfEdges.push_back(std::make_pair((a << 32) | b, t));
+    }
+  }
+  std::sort(halfEdges.begin(), halfEdges.end());
+
+  std::vector<BuildItem> items;
+  items.reserve(halfEdges.size()/2);
+  for(size_t i = 0; i < halfEdges.size(); ) {
+    size_t j = i + 1;
+    while(j < halfEdges.size() && halfEdges[j].first == halfEdges[i].first)
+      ++j;
+    if(j - i == 1) {
+      ++_boundaryEdgeCount; // boundary edges never change sides: skip them
+    } else {
+      // Non-manifold edges are represented by their first two faces
+      BuildItem item;
+      item.edge.a = static_cast<unsigned int>(halfEdges[i].first >> 32);
+      item.edge.b = static_cast<unsigned int>(halfEdges[i].first & 0xffffffffu);
+      item.edge.f0 = halfEdges[i].second;
+      item.edge.f1 = halfEdges[i + 1].second;
+      const glm::vec4 &d0 = _facePlanes[item.edge.f0];
+      const glm::vec4 &d1 = _facePlanes[item.edge.f1];
+      item.lo = glm::min(d0, d1);
+      item.hi = glm::max(d0, d1);
+      item.centroid = 0.5f*(d0 + d1);
+      items.push_back(item);
+    }
+    i = j;
+  }
+  if(items.empty())
+    return;
+
+  std::vector<glm::vec4> nodeLo, nodeHi;
+  std::vector<std::pair<unsigned int, unsigned int>> nodeRange;
+  nodeLo.reserve(2*items.size()/kLeafSize + 1);
+  nodeHi.reserve(nodeLo.capacity());
+  nodeRange.reserve(nodeLo.capacity());
+  // Eyes are expected at a few mesh radii from the origin: weight the normal axes accordingly
+  float extent = 0.f;
+  for(const glm::vec3 &p : P)
+    extent = std::max(extent, glm::length(p));
+  const float eyeScale = 3.f*std::max(extent, 1e-6f);
+  const glm::vec4 axisWeight(eyeScale, eyeScale, eyeScale, 1.f);
+  buildNode(items, 0, static_cast<unsigned int>(items.size()), axisWeight, nodeLo, nodeHi, nodeRange);
+
+  _nodes.resize(nodeLo.size());
+  for(size_t n = 0; n < _nodes.size(); ++n) {
+    _nodes[n].lo = nodeLo[n];
+    _nodes[n].hi = nodeHi[n];
+    _nodes[n].offset = nodeRange[n].first;
+    _nodes[n].count = nodeRange[n].second;
+  }
+  _edges.resize(items.size());
+  for(size_t i = 0; i < items.size(); ++i)
+    _edges[i] = items[i].edge;
+}
+
+size_t SilhouetteTree::query(const glm::vec3 &eye, std::vector<SilhouetteEdge> &out) const
+{
+  SC_PROFILE_SCOPE("SilhouetteTree::query");
+  if(_nodes.empty())
+    return 0;
+  // Side of a dual point (n, d) with respect to the eye hyperplane: n.e + d
+  const glm::vec4 h(eye, 1.f);
+  size_t visited = 0;
+  unsigned int stack[64];
+  int top = 0;
+  stack[top++] = 0;
+  while(top > 0) {
+    const Node &node = _nodes[stack[--top]];
+    ++visited;
+    // Range of the linear function h over the node box: skip the node if the hyperplane misses
+    // it, with some slack so that rounding never prunes an edge that the exact test would accept
+    float minSide = 0.f, maxSide = 0.f, slack = 0.f;
+    for(int k = 0; k < 4; ++k) {
+      minSide += h[k]*(h[k] > 0.f ? node.lo[k] : node.hi[k]);
+      maxSide += h[k]*(h[k] > 0.f ? node.hi[k] : node.lo[k]);
+      slack += std::abs(h[k])*std::max(std::abs(node.lo[k]), std::abs(node.hi[k]));
+    }
+    slack *= 1e-5f;
+    if(minSide > slack || maxSide < -slack)
+      continue;
+    if(node.count > 0) {
+      for(unsigned int i = node.offset; i < node.offset + node.count; ++i)
+        if(isSilhouette(_edges[i], h))
+          out.push_back(_edges[i]);
+    } else {
+      const unsigned int self = static_cast<unsigned int>(&node - _nodes.data());
+      stack[top++] = node.offset;
+      stack[top++] = self + 1;
+    }
+  }
+  return visited;
+}
+
+void SilhouetteTree::queryBruteForce(const glm::vec3 &eye, std::vector<SilhouetteEdge> &out) const
+{
+  const glm::vec4 h(eye, 1.f);
+  for(const SilhouetteEdge &e : _edges)
+    if(isSilhouette(e, h))
+      out.push_back(e);
+}
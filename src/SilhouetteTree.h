@@ -0,0 +1,72 @@
+#ifndef SILHOUETTE_TREE_H
+#define SILHOUETTE_TREE_H
+
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+class Mesh;
+class MemoryFootprint;
+
+// A mesh edge shared by two faces. It lies on the silhouette whenever exactly one
+// of its two faces is front-facing.
+struct SilhouetteEdge {
+  unsigned int a, b;   // end vertices
+  unsigned int f0, f1; // adjacent faces
+};
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Dual-space silhouette query structure, following Hertzmann and Zorin ("Illustrating
+ * smooth surfaces", 2000). Every face plane n.x + d = 0 is mapped to the 4D point (n, d).
+ * A perspective eye e maps to the hyperplane {(n, d) : n.e + d = 0}, and an edge is on the
+ * silhouette iff the dual points of its two faces lie on opposite sides of that hyperplane.
+ * The dual segments of all edges are stored in a 4D bounding volume hierarchy, so that a
+ * query only visits the nodes crossed by the eye hyperplane: its cost is proportional to the
+ * number of silhouette edges rather than to the size of the mesh.
+ *
+ * The query eye position must be expressed in the coordinate frame of the mesh.
+ */
+class SilhouetteTree {
+public:
+  void build(const Mesh &mesh);
+  void clear();
+  bool empty() const { return _nodes.empty(); }
+
+  size_t edgeCount() const { return _edges.size(); }
+  size_t nodeCount() const { return _nodes.size(); }
+  size_t boundaryEdgeCount() const { return _boundaryEdgeCount; }
+
+  void accountMemory(MemoryFootprint &footprint) const;
+  // Estimated bytes of build() for a closed mesh of the given size: the tree, and the peak of the
+  // temporaries on top of it
+  static size_t buildBytes(size_t triangleCount);
+
+  // Appends all silhouette edges for the eye position to out. Returns the number of visited nodes.
+  size_t query(const glm::vec3 &eye, std::vector<SilhouetteEdge> &out) const;
+
+  // Reference implementation: tests every interior edge of the mesh.
+  void queryBruteForce(const glm::vec3 &eye, std::vector<SilhouetteEdge> &out) const;
+
+private:
+  // Flattened node: the left child directly follows its parent, the right child is at index
+  // 'offset'. Leaves store their edges in _edges[offset, offset + count).
+  struct Node {
+    glm::vec4 lo, hi;
+    unsigned int offset;
+    unsigned int count; // 0 for internal nodes
+  };
+
+  bool isSilhouette(const SilhouetteEdge &e, const glm::vec4 &h) const {
+    return (glm::dot(_facePlanes[e.f0], h) > 0.f) != (glm::dot(_facePlanes[e.f1], h) > 0.f);
+  }
+
+  std::vector<glm::vec4> _facePlanes; // dual points (n, d), with |n| = 1
+  std::vector<SilhouetteEdge> _edges; // interior edges, in leaf order
+  std::vector<Node> _nodes;
+  size_t _boundaryEdgeCount = 0;
+};
+
+#endif  // SILHOUETTE_TREE_H
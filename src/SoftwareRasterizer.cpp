@@ -0,0 +1,354 @@
+#include "SoftwareRasterizer.h"
+#include "Mesh.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <glm/ext.hpp>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const uint32_t kNoTriangle = ~0u;
+const size_t kChunkSize = 4096; // triangles set up together, independently of the thread count
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// A vertex of a triangle clipped against the near plane, with its barycentric coordinates in
+// the mesh triangle
+struct ClipVertex {
+  glm::vec4 position;
+  glm::vec3 bary;
+};
+
+// Sutherland-Hodgman against z >= -w: at most 4 vertices out of 3
+unsigned int clipNear(const ClipVertex in[3], ClipVertex out[4])
+{
+  unsigned int count = 0;
+  for(unsigned int i = 0; i < 3; ++i) {
+    const ClipVertex &a = in[i], &b = in[(i + 1) % 3];
+    const float da = a.position.z + a.position.w, db = b.position.z + b.position.w;
+    if(da >= 0.f)
+      out[count++] = a;
+    if((da >= 0.f) != (db >= 0.f)) {
+      const float t = da/(da - db);
+      out[count].position = glm::mix(a.position, b.position, t);
+      out[count].bary = glm::mix(a.bary, b.bary, t);
+      ++count;
+    }
+  }
+  return count;
+}
+
+uint8_t toUnorm8(float c)
+{
+  return static_cast<uint8_t>(glm::clamp(c, 0.f, 1.f)*255.f + 0.5f);
+}
+
+} // namespace
+
+void SoftwareRasterizer::render(const Mesh &mesh, const glm::mat4 &modelMat, const glm::mat4 &viewMat,
+                                const glm::mat4 &projMat, const glm::vec3 &camPos, int contourMode,
+                                unsigned int width, unsigned int height)
+{
+  SC_PROFILE_SCOPE("SoftwareRasterizer::render");
+  _width = width;
+  _height = height;
+  _tilesX = (width + kTileSize - 1)/kTileSize;
+  _tilesY = (height + kTileSize - 1)/kTileSize;
+  _stride = _tilesX*kTileSize;
+  const size_t pixelCount = static_cast<size_t>(_stride)*_tilesY*kTileSize;
+  _depth.resize(pixelCount);
+  _triangle.resize(pixelCount);
+  _bary1.resize(pixelCount);
+  _bary2.resize(pixelCount);
+
+  auto start = std::chrono::steady_clock::now();
+  transformVertices(mesh, modelMat, viewMat, projMat, camPos);
+  _vertexMs = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  setupTriangles(mesh);
+  _binningMs = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  parallel_for(0, _tilesX*_tilesY, 1, [&](size_t first, size_t last) {
+    for(size_t tile = first; tile < last; ++tile)
+      rasterizeTile(static_cast<unsigned int>(tile));
+  });
+  _rasterMs = elapsedMs(start);
+
+  start = std::chrono::steady_clock::now();
+  shade(mesh, contourMode);
+  _shadingMs = elapsedMs(start);
+}
+
+// The vertex shader
+void SoftwareRasterizer::transformVertices(const Mesh &mesh, const glm::mat4 &modelMat, const glm::mat4 &viewMat,
+                                           const glm::mat4 &projMat, const glm::vec3 &camPos)
+{
+  SC_PROFILE_SCOPE("SoftwareRasterizer::transformVertices");
+  const auto &P = mesh.vertexPositions();
+  const auto &N = mesh.vertexNormals();
+  const auto &radial = mesh.radialCurvatures();
+  const auto &eligible = mesh.eligibleForSuggestiveContour();
+  const bool hasContours = radial.size() == P.size() && eligible.size() == P.size();
+  _clipPositions.resize(P.size());
+  _positions.resize(P.size());
+  _normals.resize(P.size());
+  _dotProducts.resize(P.size());
+  _radialCurvatures.resize(P.size());
+
+  const glm::mat4 viewProj = projMat*viewMat;
+  const glm::mat3 normMat = glm::mat3(glm::inverseTranspose(modelMat));
+  parallel_for(0, P.size(), 4096, [&](size_t first, size_t last) {
+    for(size_t v = first; v < last; ++v) {
+      const glm::vec4 position = modelMat*glm::vec4(P[v], 1.f);
+      _positions[v] = glm::vec3(position);
+      _normals[v] = normMat*N[v];
+      _clipPositions[v] = viewProj*position;
+      _dotProducts[v] = glm::dot(_normals[v], glm::normalize(camPos - _positions[v]));
+      _radialCurvatures[v] = (hasContours && eligible[v]) ? radial[v] : 100.f;
+    }
+  });
+}
+
+// Clipping, projection, back-face culling and binning of the triangles
+void SoftwareRasterizer::setupTriangles(const Mesh &mesh)
+{
+  SC_PROFILE_SCOPE("SoftwareRasterizer::setupTriangles");
+  const auto &T = mesh.triangleIndices();
+  const unsigned int tileCount = _tilesX*_tilesY;
+  const float width = static_cast<float>(_width), height = static_cast<float>(_height);
+  _chunks.resize((T.size() + kChunkSize - 1)/kChunkSize);
+
+  parallel_for(0, _chunks.size(), 1, [&](size_t first, size_t last) {
+    for(size_t c = first; c < last; ++c) {
+      Chunk &chunk = _chunks[c];
+      chunk.triangles.clear();
+      chunk.tileCursors.assign(tileCount, 0);
+      const size_t end = std::min(T.size(), (c + 1)*kChunkSize);
+      for(size_t t = c*kChunkSize; t < end; ++t) {
+        ClipVertex in[3];
+        for(unsigned int k = 0; k < 3; ++k) {
+          in[k].position = _clipPositions[T[t][k]];
+          in[k].bary = glm::vec3(0.f);
+          in[k].bary[k] = 1.f;
+        }
+        // Trivial rejection against the side planes
+        bool outside = false;
+        for(unsigned int axis = 0; axis < 2 && !outside; ++axis)
+          outside = (in[0].position[axis] > in[0].position.w && in[1].position[axis] > in[1].position.w &&
+                     in[2].position[axis] > in[2].position.w) ||
+                    (in[0].position[axis] < -in[0].position.w && in[1].position[axis] < -in[1].position.w &&
+                     in[2].position[axis] < -in[2].position.w);
+        if(outside)
+          continue;
+        ClipVertex polygon[4];
+        const unsigned int count = clipNear(in, polygon);
+
+        for(unsigned int f = 1; f + 1 < count; ++f) {
+          const ClipVertex *v[3] = {&polygon[0], &polygon[f], &polygon[f + 1]};
+          glm::vec3 window[3];
+          float invW[3];
+          for(unsigned int k = 0; k < 3; ++k) {
+            invW[k] = 1.f/v[k]->position.w;
+            const glm::vec3 ndc = glm::vec3(v[k]->position)*invW[k];
+            window[k] = glm::vec3((ndc.x + 1.f)*0.5f*width, (ndc.y + 1.f)*0.5f*height, ndc.z*0.5f + 0.5f);
+          }
+          // Counter-clockwise front faces, as in the viewer
+          const float area = (window[1].x - window[0].x)*(window[2].y - window[0].y) -
+                             (window[2].x - window[0].x)*(window[1].y - window[0].y);
+          if(!(area > 0.f))
+            continue;
+
+          ScreenTriangle tri;
+          const float minX = std::min(window[0].x, std::min(window[1].x, window[2].x));
+          const float maxX = std::max(window[0].x, std::max(window[1].x, window[2].x));
+          const float minY = std::min(window[0].y, std::min(window[1].y, window[2].y));
+          const float maxY = std::max(window[0].y, std::max(window[1].y, window[2].y));
+          // Pixels whose center is in the bounding box, clamped in float to avoid integer overflows
+          tri.minX = static_cast<int>(std::ceil(glm::clamp(minX - 0.5f, 0.f, width)));
+          tri.maxX = static_cast<int>(std::floor(glm::clamp(maxX - 0.5f, -1.f, width - 1.f)));
+          tri.minY = static_cast<int>(std::ceil(glm::clamp(minY - 0.5f, 0.f, height)));
+          tri.maxY = static_cast<int>(std::floor(glm::clamp(maxY - 0.5f, -1.f, height - 1.f)));
+          if(tri.minX > tri.maxX || tri.minY > tri.maxY)
+            continue;
+
+          // Edge k is opposite to vertex k, so that the barycentric coordinates are edge/area
+          for(unsigned int k = 0; k < 3; ++k) {
+            const glm::vec3 &a = window[(k + 1) % 3], &b = window[(k + 2) % 3];
+            Plane &e = tri.edge[k];
+            e.a = a.y - b.y;
+            e.b = b.x - a.x;
+            e.c = -(e.a*a.x + e.b*a.y);
+            tri.topLeft[k] = e.a > 0.f || (e.a == 0.f && e.b < 0.f);
+          }
+          auto plane = [&](float v0, float v1, float v2) {
+            Plane p;
+            p.a = (tri.edge[0].a*v0 + tri.edge[1].a*v1 + tri.edge[2].a*v2)/area;
+            p.b = (tri.edge[0].b*v0 + tri.edge[1].b*v1 + tri.edge[2].b*v2)/area;
+            p.c = (tri.edge[0].c*v0 + tri.edge[1].c*v1 + tri.edge[2].c*v2)/area;
+            return p;
+          };
+          tri.depth = plane(window[0].z, window[1].z, window[2].z);
+          tri.q1 = plane(v[0]->bary[1]*invW[0], v[1]->bary[1]*invW[1], v[2]->bary[1]*invW[2]);
+          tri.q2 = plane(v[0]->bary[2]*invW[0], v[1]->bary[2]*invW[1], v[2]->bary[2]*invW[2]);
+          tri.r = plane(invW[0], invW[1], invW[2]);
+          tri.triangle = static_cast<unsigned int>(t);
+          chunk.triangles.push_back(tri);
+          for(int ty = tri.minY/kTileSize; ty <= tri.maxY/static_cast<int>(kTileSize); ++ty)
+            for(int tx = tri.minX/kTileSize; tx <= tri.maxX/static_cast<int>(kTileSize); ++tx)
+              ++chunk.tileCursors[ty*_tilesX + tx];
+        }
+      }
+    }
+  });
+
+  // Tile lists in mesh order: the chunks of a tile one after the other
+  _tileOffsets.assign(tileCount + 1, 0);
+  unsigned int total = 0;
+  for(unsigned int tile = 0; tile < tileCount; ++tile) {
+    _tileOffsets[tile] = total;
+    for(Chunk &chunk : _chunks) {
+      const unsigned int count = chunk.tileCursors[tile];
+      chunk.tileCursors[tile] = total;
+      total += count;
+    }
+  }
+  _tileOffsets[tileCount] = total;
+  _tileTriangles.resize(total);
+  parallel_for(0, _chunks.size(), 1, [&](size_t first, size_t last) {
+    for(size_t c = first; c < last; ++c) {
+      Chunk &chunk = _chunks[c];
+      for(const ScreenTriangle &tri : chunk.triangles)
+        for(int ty = tri.minY/kTileSize; ty <= tri.maxY/static_cast<int>(kTileSize); ++ty)
+          for(int tx = tri.minX/kTileSize; tx <= tri.maxX/static_cast<int>(kTileSize); ++tx)
+            _tileTriangles[chunk.tileCursors[ty*_tilesX + tx]++] = &tri;
+    }
+  });
+}
+
+void SoftwareRasterizer::rasterizeTile(unsigned int tile)
+{
+  const int tileX = static_cast<int>((tile % _tilesX)*kTileSize), tileY = static_cast<int>((tile/_tilesX)*kTileSize);
+  for(int y = tileY; y < tileY + static_cast<int>(kTileSize); ++y) {
+    const size_t row = static_cast<size_t>(y)*_stride;
+    std::fill(_depth.begin() + row + tileX, _depth.begin() + row + tileX + kTileSize, 1.f);
+    std::fill(_triangle.begin() + row + tileX, _triangle.begin() + row + tileX + kTileSize, kNoTriangle);
+  }
+
+  for(unsigned int i = _tileOffsets[tile]; i < _tileOffsets[tile + 1]; ++i) {
+    const ScreenTriangle &tri = *_tileTriangles[i];
+    // Groups of 4 pixels aligned on the tile, which is a multiple of 4 wide
+    const int x0 = std::max(tri.minX, tileX) & ~3, x1 = std::min(tri.maxX, tileX + static_cast<int>(kTileSize) - 1);
+    const int y0 = std::max(tri.minY, tileY), y1 = std::min(tri.maxY, tileY + static_cast<int>(kTileSize) - 1);
+    for(int y = y0; y <= y1; ++y) {
+      const float py = y + 0.5f;
+      const size_t row = static_cast<size_t>(y)*_stride;
+#if defined(__SSE2__)
+      const __m128 vpy = _mm_set1_ps(py);
+      auto evaluate = [&](const Plane &p, __m128 px) {
+        return _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.a), px), _mm_mul_ps(_mm_set1_ps(p.b), vpy)), _mm_set1_ps(p.c));
+      };
+      const __m128 zero = _mm_setzero_ps();
+      for(int x = x0; x <= x1; x += 4) {
+        const __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+        __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for(unsigned int k = 0; k < 3; ++k) {
+          const __m128 e = evaluate(tri.edge[k], px);
+          mask = _mm_and_ps(mask, tri.topLeft[k] ? _mm_cmpge_ps(e, zero) : _mm_cmpgt_ps(e, zero));
+        }
+        if(!_mm_movemask_ps(mask))
+          continue;
+        const __m128 z = evaluate(tri.depth, px);
+        const __m128 depth = _mm_loadu_ps(&_depth[row + x]);
+        mask = _mm_and_ps(mask, _mm_and_ps(_mm_cmplt_ps(z, depth), _mm_cmpge_ps(z, zero)));
+        if(!_mm_movemask_ps(mask))
+          continue;
+        const __m128 invR = _mm_div_ps(_mm_set1_ps(1.f), evaluate(tri.r, px));
+        const __m128 b1 = _mm_mul_ps(evaluate(tri.q1, px), invR), b2 = _mm_mul_ps(evaluate(tri.q2, px), invR);
+        auto select = [&](__m128 value, __m128 old) { return _mm_or_ps(_mm_and_ps(mask, value), _mm_andnot_ps(mask, old)); };
+        _mm_storeu_ps(&_depth[row + x], select(z, depth));
+        _mm_storeu_ps(&_bary1[row + x], select(b1, _mm_loadu_ps(&_bary1[row + x])));
+        _mm_storeu_ps(&_bary2[row + x], select(b2, _mm_loadu_ps(&_bary2[row + x])));
+        float *ids = reinterpret_cast<float *>(&_triangle[row + x]);
+        _mm_storeu_ps(ids, select(_mm_castsi128_ps(_mm_set1_epi32(static_cast<int>(tri.triangle))), _mm_loadu_ps(ids)));
+      }
+#else
+      auto evaluate = [&](const Plane &p, float px) { return p.a*px + p.b*py + p.c; };
+      for(int x = x0; x <= x1; ++x) {
+        const float px = x + 0.5f;
+        bool inside = true;
+        for(unsigned int k = 0; k < 3 && inside; ++k) {
+          const float e = evaluate(tri.edge[k], px);
+          inside = tri.topLeft[k] ? e >= 0.f : e > 0.f;
+        }
+        if(!inside)
+          continue;
+        const float z = evaluate(tri.depth, px);
+        if(!(z < _depth[row + x] && z >= 0.f))
+          continue;
+        const float invR = 1.f/evaluate(tri.r, px);
+        _depth[row + x] = z;
+        _bary1[row + x] = evaluate(tri.q1, px)*invR;
+        _bary2[row + x] = evaluate(tri.q2, px)*invR;
+        _triangle[row + x] = tri.triangle;
+      }
+#endif
+    }
+  }
+}
+
+// The fragment shader, once per pixel
+void SoftwareRasterizer::shade(const Mesh &mesh, int contourMode)
+{
+  SC_PROFILE_SCOPE("SoftwareRasterizer::shade");
+  const auto &T = mesh.triangleIndices();
+  _image.resize(3*static_cast<size_t>(_width)*_height);
+  parallel_for(0, _height, 16, [&](size_t first, size_t last) {
+    for(size_t line = first; line < last; ++line) {
+      const size_t row = (_height - 1 - line)*_stride; // the image is stored from the top
+      uint8_t *out = &_image[3*line*_width];
+      for(unsigned int x = 0; x < _width; ++x, out += 3) {
+        const uint32_t t = _triangle[row + x];
+        if(t == kNoTriangle) {
+          out[0] = out[1] = out[2] = 255;
+          continue;
+        }
+        const float b1 = _bary1[row + x], b2 = _bary2[row + x], b0 = 1.f - b1 - b2;
+        const glm::uvec3 &tri = T[t];
+        glm::vec3 color;
+        if(contourMode == 0) {
+          const glm::vec3 position = b0*_positions[tri[0]] + b1*_positions[tri[1]] + b2*_positions[tri[2]];
+          const glm::vec3 n = glm::normalize(b0*_normals[tri[0]] + b1*_normals[tri[1]] + b2*_normals[tri[2]]);
+          color = glm::vec3(0.f);
+          for(const RasterLight &light : _lights) {
+            const glm::vec3 wi = glm::normalize(light.position - position);
+            color += light.color*light.intensity*std::max(glm::dot(n, wi), 0.f);
+          }
+        } else {
+          color = glm::vec3(0.8f, 0.8f, 0.8f);
+          const float dotProduct = b0*_dotProducts[tri[0]] + b1*_dotProducts[tri[1]] + b2*_dotProducts[tri[2]];
+          if(std::abs(dotProduct) < 0.001f && contourMode == 1)
+            color = glm::vec3(0.1f, 0.1f, 0.6f); // silhouettes/occluding contours
+          const float radial = b0*_radialCurvatures[tri[0]] + b1*_radialCurvatures[tri[1]] + b2*_radialCurvatures[tri[2]];
+          if(std::abs(radial) < 0.003f && contourMode == 2)
+            color = glm::vec3(0.6f, 0.1f, 0.1f); // suggestive contours
+        }
+        out[0] = toUnorm8(color.r);
+        out[1] = toUnorm8(color.g);
+        out[2] = toUnorm8(color.b);
+      }
+    }
+  });
+}
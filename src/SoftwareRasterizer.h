@@ -0,0 +1,103 @@
+#ifndef SOFTWARE_RASTERIZER_H
+#define SOFTWARE_RASTERIZER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class Mesh;
+
+// Point light, as the lightSources of the fragment shader
+struct RasterLight {
+  glm::vec3 position;
+  glm::vec3 color;
+  float intensity;
+};
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * CPU renderer of a mesh reproducing the viewer shaders, for machines without a GPU. The
+ * contour modes are the ones of the viewer (0: shaded, 1: silhouettes, 2: suggestive
+ * contours), with back-face culling, a z-buffer and a white background.
+ *
+ * Rendering is deferred and tiled. The projected triangles are clipped against the near plane
+ * and binned into screen tiles in parallel. The tiles are then rasterized in parallel with
+ * edge functions evaluated 4 pixels at a time (SSE), keeping per pixel the depth, the
+ * triangle and its perspective-correct barycentric coordinates. Finally, every pixel is shaded
+ * once with the logic of the fragment shader.
+ */
+class SoftwareRasterizer {
+public:
+  static const unsigned int kTileSize = 64;
+
+  void setLights(const std::vector<RasterLight> &lights) { _lights = lights; }
+
+  // Renders the mesh at the given resolution. The contour attributes of the mesh are the ones
+  // last computed, a mesh without them showing no suggestive contour.
+  void render(const Mesh &mesh, const glm::mat4 &modelMat, const glm::mat4 &viewMat, const glm::mat4 &projMat,
+              const glm::vec3 &camPos, int contourMode, unsigned int width, unsigned int height);
+
+  // 8-bit RGB image of the last render, rows from top to bottom
+  const std::vector<uint8_t> &image() const { return _image; }
+  unsigned int width() const { return _width; }
+  unsigned int height() const { return _height; }
+
+  // Timings of the last render, in milliseconds
+  double vertexTime() const { return _vertexMs; }
+  double binningTime() const { return _binningMs; }
+  double rasterTime() const { return _rasterMs; }
+  double shadingTime() const { return _shadingMs; }
+
+private:
+  // A projected triangle, with the planes a*x + b*y + c of its attributes in window coordinates
+  struct Plane {
+    float a, b, c;
+  };
+  struct ScreenTriangle {
+    Plane edge[3];     // edge functions, positive inside
+    bool topLeft[3];   // fill rule for pixel centers exactly on an edge
+    Plane depth;       // window depth
+    Plane q1, q2, r;   // perspective-correct barycentrics of the mesh triangle: q/r
+    int minX, minY, maxX, maxY;
+    unsigned int triangle;
+  };
+  // Triangles set up together, and their counts (then write cursors) per tile
+  struct Chunk {
+    std::vector<ScreenTriangle> triangles;
+    std::vector<unsigned int> tileCursors;
+  };
+
+  void transformVertices(const Mesh &mesh, const glm::mat4 &modelMat, const glm::mat4 &viewMat,
+                         const glm::mat4 &projMat, const glm::vec3 &camPos);
+  void setupTriangles(const Mesh &mesh);
+  void rasterizeTile(unsigned int tile);
+  void shade(const Mesh &mesh, int contourMode);
+
+  std::vector<RasterLight> _lights;
+  unsigned int _width = 0, _height = 0;
+  unsigned int _tilesX = 0, _tilesY = 0, _stride = 0;
+
+  // Vertex stage outputs (the varyings of the vertex shader)
+  std::vector<glm::vec4> _clipPositions;
+  std::vector<glm::vec3> _positions;
+  std::vector<glm::vec3> _normals;
+  std::vector<float> _dotProducts;
+  std::vector<float> _radialCurvatures;
+
+  // Binned triangles: per tile, the triangles overlapping it in mesh order
+  std::vector<Chunk> _chunks;
+  std::vector<unsigned int> _tileOffsets;
+  std::vector<const ScreenTriangle *> _tileTriangles;
+
+  // Visibility buffer, bottom row first, _stride pixels per row
+  std::vector<float> _depth;
+  std::vector<uint32_t> _triangle;
+  std::vector<float> _bary1, _bary2;
+
+  std::vector<uint8_t> _image;
+  double _vertexMs = 0.0, _binningMs = 0.0, _rasterMs = 0.0, _shadingMs = 0.0;
+};
+
+#endif  // SOFTWARE_RASTERIZER_H
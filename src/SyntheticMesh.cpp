@@ -0,0 +1,298 @@
+#include "SyntheticMesh.h"
+#include "Mesh.h"
+#include "Profiler.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+// Icosahedron with outward counter-clockwise faces
+const float kGolden = 1.6180339887f;
+const glm::vec3 kIcosahedronVertices[12] = {
+  {-1.f, kGolden, 0.f}, {1.f, kGolden, 0.f}, {-1.f, -kGolden, 0.f}, {1.f, -kGolden, 0.f},
+  {0.f, -1.f, kGolden}, {0.f, 1.f, kGolden}, {0.f, -1.f, -kGolden}, {0.f, 1.f, -kGolden},
+  {kGolden, 0.f, -1.f}, {kGolden, 0.f, 1.f}, {-kGolden, 0.f, -1.f}, {-kGolden, 0.f, 1.f}};
+const unsigned int kIcosahedronFaces[20][3] = {
+  {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11}, {1, 5, 9}, {5, 11, 4}, {11, 10, 2}, {10, 7, 6}, {7, 1, 8},
+  {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8}, {3, 8, 9}, {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}};
+
+// Geodesic sphere of radius 1 with 20 n^2 triangles. Corners, edge vertices and face interiors
+// are numbered in this order and each computed once, so that the result does not depend on the
+// scheduling.
+void icosphere(unsigned int n, std::vector<glm::vec3> &P, std::vector<glm::uvec3> &T)
+{
+  // The 30 edges, from their lower to their higher corner
+  std::vector<std::pair<unsigned int, unsigned int>> edges;
+  for(const auto &face : kIcosahedronFaces)
+    for(unsigned int k = 0; k < 3; ++k) {
+      const unsigned int a = std::min(face[k], face[(k + 1) % 3]), b = std::max(face[k], face[(k + 1) % 3]);
+      if(std::find(edges.begin(), edges.end(), std::make_pair(a, b)) == edges.end())
+        edges.push_back(std::make_pair(a, b));
+    }
+  const size_t edgeBase = 12, faceBase = edgeBase + edges.size()*(n - 1);
+  const size_t interior = (n >= 3) ? static_cast<size_t>(n - 1)*(n - 2)/2 : 0;
+  P.resize(faceBase + 20*interior);
+  T.resize(20*static_cast<size_t>(n)*n);
+
+  for(unsigned int c = 0; c < 12; ++c)
+    P[c] = glm::normalize(kIcosahedronVertices[c]);
+  parallel_for(0, edges.size(), 1, [&](size_t first, size_t last) {
+    for(size_t e = first; e < last; ++e)
+      for(unsigned int k = 1; k < n; ++k)
+        P[edgeBase + e*(n - 1) + k - 1] = glm::normalize(glm::mix(kIcosahedronVertices[edges[e].first],
+                                                                  kIcosahedronVertices[edges[e].second], float(k)/n));
+  });
+
+  parallel_for(0, 20, 1, [&](size_t first, size_t last) {
+    for(size_t f = first; f < last; ++f) {
+      const unsigned int *corner = kIcosahedronFaces[f];
+      // Vertex at step t of n from corner a to corner b
+      auto onEdge = [&](unsigned int a, unsigned int b, unsigned int t) -> unsigned int {
+        if(t == 0)
+          return a;
+        if(t == n)
+          return b;
+        const auto e = std::find(edges.begin(), edges.end(), std::make_pair(std::min(a, b), std::max(a, b))) - edges.begin();
+        return static_cast<unsigned int>(edgeBase + e*(n - 1) + ((a < b) ? t : n - t) - 1);
+      };
+      // Vertex A (n - i - j)/n + B i/n + C j/n of the face ABC
+      auto index = [&](unsigned int i, unsigned int j) -> unsigned int {
+        if(j == 0)
+          return onEdge(corner[0], corner[1], i);
+        if(i == 0)
+          return onEdge(corner[0], corner[2], j);
+        if(i + j == n)
+          return onEdge(corner[1], corner[2], j);
+        const size_t row = static_cast<size_t>(i - 1)*(n - 1) - static_cast<size_t>(i - 1)*i/2;
+        return static_cast<unsigned int>(faceBase + f*interior + row + j - 1);
+      };
+      const glm::vec3 &A = kIcosahedronVertices[corner[0]], &B = kIcosahedronVertices[corner[1]],
+                      &C = kIcosahedronVertices[corner[2]];
+      for(unsigned int i = 1; i + 1 < n; ++i)
+        for(unsigned int j = 1; i + j < n; ++j)
+          P[index(i, j)] = glm::normalize((float(n - i - j)*A + float(i)*B + float(j)*C)/float(n));
+      size_t t = f*static_cast<size_t>(n)*n;
+      for(unsigned int i = 0; i < n; ++i)
+        for(unsigned int j = 0; i + j < n; ++j) {
+          T[t++] = glm::uvec3(index(i, j), index(i + 1, j), index(i, j + 1));
+          if(i + j + 1 < n)
+            T[t++] = glm::uvec3(index(i + 1, j), index(i + 1, j + 1), index(i, j + 1));
+        }
+    }
+  });
+}
+
+void torus(size_t triangles, float R, float r, std::vector<glm::vec3> &P, std::vector<glm::uvec3> &T)
+{
+  // Cells about as long around the axis as around the tube
+  const double ratio = std::max(1.0, static_cast<double>(R)/r);
+  const unsigned int v = std::max(3u, static_cast<unsigned int>(std::lround(std::sqrt(triangles/(2.0*ratio)))));
+  const unsigned int u = std::max(3u, static_cast<unsigned int>(std::lround(v*ratio)));
+  P.resize(static_cast<size_t>(u)*v);
+  T.resize(2*P.size());
+  parallel_for(0, u, 64, [&](size_t first, size_t last) {
+    for(size_t i = first; i < last; ++i) {
+      const float theta = 2.f*glm::pi<float>()*i/u;
+      for(unsigned int j = 0; j < v; ++j) {
+        const float phi = 2.f*glm::pi<float>()*j/v;
+        const size_t a = i*v + j, b = ((i + 1) % u)*v + j, c = ((i + 1) % u)*v + (j + 1) % v, d = i*v + (j + 1) % v;
+        P[a] = glm::vec3((R + r*std::cos(phi))*std::cos(theta), r*std::sin(phi), (R + r*std::cos(phi))*std::sin(theta));
+        T[2*a] = glm::uvec3(a, d, c);
+        T[2*a + 1] = glm::uvec3(a, c, b);
+      }
+    }
+  });
+}
+
+void terrain(size_t triangles, float amplitude, float frequency, unsigned int octaves, uint32_t seed,
+             std::vector<glm::vec3> &P, std::vector<glm::uvec3> &T)
+{
+  const unsigned int n = std::max(1u, static_cast<unsigned int>(std::lround(std::sqrt(triangles/2.0))));
+  P.resize(static_cast<size_t>(n + 1)*(n + 1));
+  T.resize(2*static_cast<size_t>(n)*n);
+  parallel_for(0, n + 1, 64, [&](size_t first, size_t last) {
+    for(size_t i = first; i < last; ++i)
+      for(unsigned int j = 0; j <= n; ++j) {
+        const float x = 2.f*i/n - 1.f, z = 2.f*j/n - 1.f;
+        P[i*(n + 1) + j] = glm::vec3(x, 2.f*amplitude*fractalNoise(frequency*glm::vec3(x, 0.f, z), octaves, seed), z);
+        if(i < n && j < n) {
+          const size_t a = i*(n + 1) + j, b = a + 1, c = a + n + 2, d = a + n + 1;
+          T[2*(i*n + j)] = glm::uvec3(a, b, c);
+          T[2*(i*n + j) + 1] = glm::uvec3(a, c, d);
+        }
+      }
+  });
+}
+
+void tiling(const Mesh &source, size_t triangles, std::vector<glm::vec3> &P, std::vector<glm::uvec3> &T)
+{
+  const std::vector<glm::vec3> &sourceP = source.vertexPositions();
+  const std::vector<glm::uvec3> &sourceT = source.triangleIndices();
+  if(sourceT.empty()) {
+    P = sourceP;
+    T = sourceT;
+    return;
+  }
+  const size_t copies = std::max<size_t>(1, (triangles + sourceT.size()/2)/sourceT.size());
+  unsigned int side = 1;
+  while(static_cast<size_t>(side)*side*side < copies)
+    ++side;
+  glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+  for(const glm::vec3 &p : sourceP) {
+    lo = glm::min(lo, p);
+    hi = glm::max(hi, p);
+  }
+  const glm::vec3 spacing = 1.25f*(hi - lo), origin = -0.5f*(side - 1.f)*spacing - 0.5f*(lo + hi);
+  P.resize(copies*sourceP.size());
+  T.resize(copies*sourceT.size());
+  parallel_for(0, copies, 1, [&](size_t first, size_t last) {
+    for(size_t c = first; c < last; ++c) {
+      const glm::vec3 offset = origin + spacing*glm::vec3(c % side, (c/side) % side, c/(side*side));
+      const unsigned int base = static_cast<unsigned int>(c*sourceP.size());
+      for(size_t v = 0; v < sourceP.size(); ++v)
+        P[base + v] = sourceP[v] + offset;
+      for(size_t t = 0; t < sourceT.size(); ++t)
+        T[c*sourceT.size() + t] = sourceT[t] + glm::uvec3(base);
+    }
+  });
+}
+
+uint32_t hash(int32_t x, int32_t y, int32_t z, uint32_t seed)
+{
+  uint32_t h = seed*0x9E3779B9u;
+  for(int32_t k : {x, y, z}) {
+    h ^= static_cast<uint32_t>(k) + 0x7F4A7C15u + (h << 6) + (h >> 2);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+  }
+  return h;
+}
+
+// Trilinear interpolation of random values in [-1, 1] at the integer points, smoothstepped
+float valueNoise(const glm::vec3 &p, uint32_t seed)
+{
+  const glm::vec3 cell = glm::floor(p), f = p - cell;
+  const glm::vec3 w = f*f*(3.f - 2.f*f);
+  const int32_t x = static_cast<int32_t>(cell.x), y = static_cast<int32_t>(cell.y), z = static_cast<int32_t>(cell.z);
+  float corners[8];
+  for(unsigned int k = 0; k < 8; ++k)
+    corners[k] = hash(x + (k & 1), y + ((k >> 1) & 1), z + ((k >> 2) & 1), seed)*(2.f/4294967295.f) - 1.f;
+  const float x00 = glm::mix(corners[0], corners[1], w.x), x10 = glm::mix(corners[2], corners[3], w.x);
+  const float x01 = glm::mix(corners[4], corners[5], w.x), x11 = glm::mix(corners[6], corners[7], w.x);
+  return glm::mix(glm::mix(x00, x10, w.y), glm::mix(x01, x11, w.y), w.z);
+}
+
+// As the loaders do
+void prepare(Mesh &mesh)
+{
+  mesh.applyVertexOrder();
+  mesh.applyTriangleOrder();
+  mesh.vertexNormals().resize(mesh.vertexPositions().size(), glm::vec3(0.f, 0.f, 1.f));
+  mesh.vertexTexCoords().resize(mesh.vertexPositions().size(), glm::vec2(0.f, 0.f));
+  mesh.recomputePerVertexNormals();
+  mesh.recomputePerVertexTextureCoordinates();
+}
+
+} // namespace
+
+const char *syntheticShapeName(SyntheticShape shape)
+{
+  switch(shape) {
+  case SyntheticShape::Torus: return "torus";
+  case SyntheticShape::NoisySphere: return "noisy-sphere";
+  case SyntheticShape::Terrain: return "terrain";
+  case SyntheticShape::Tiling: return "tiling";
+  default: return "icosphere";
+  }
+}
+
+float fractalNoise(const glm::vec3 &p, unsigned int octaves, uint32_t seed)
+{
+  float sum = 0.f, amplitude = 1.f, norm = 0.f;
+  glm::vec3 q = p;
+  for(unsigned int o = 0; o < octaves; ++o) {
+    sum += amplitude*valueNoise(q, seed + o);
+    norm += amplitude;
+    amplitude *= 0.5f;
+    q *= 2.f;
+  }
+  return norm > 0.f ? sum/norm : 0.f;
+}
+
+void generateSyntheticMesh(const SyntheticMeshParameters &parameters, Mesh &mesh)
+{
+  SC_PROFILE_SCOPE("generateSyntheticMesh");
+  std::vector<glm::vec3> P;
+  std::vector<glm::uvec3> T;
+  switch(parameters.shape) {
+  case SyntheticShape::Icosphere:
+  case SyntheticShape::NoisySphere: {
+    const unsigned int n = std::max(1u, static_cast<unsigned int>(std::lround(std::sqrt(parameters.triangles/20.0))));
+    icosphere(n, P, T);
+    const bool noisy = (parameters.shape == SyntheticShape::NoisySphere);
+    parallel_for(0, P.size(), 16384, [&](size_t first, size_t last) {
+      for(size_t v = first; v < last; ++v) {
+        float scale = parameters.radius;
+        if(noisy)
+          scale *= 1.f + parameters.amplitude*fractalNoise(parameters.frequency*P[v], parameters.octaves, parameters.seed);
+        P[v] *= scale;
+      }
+    });
+    break;
+  }
+  case SyntheticShape::Torus:
+    torus(parameters.triangles, parameters.radius, parameters.minorRadius, P, T);
+    break;
+  case SyntheticShape::Terrain:
+    terrain(parameters.triangles, parameters.amplitude, parameters.frequency, parameters.octaves, parameters.seed, P, T);
+    break;
+  case SyntheticShape::Tiling:
+    if(parameters.source)
+      tiling(*parameters.source, parameters.triangles, P, T);
+    break;
+  }
+  mesh.clear();
+  mesh.vertexPositions().swap(P);
+  mesh.triangleIndices().swap(T);
+  prepare(mesh);
+}
+
+bool hasCurvatureGroundTruth(SyntheticShape shape)
+{
+  return shape == SyntheticShape::Icosphere || shape == SyntheticShape::Torus;
+}
+
+void computeCurvatureGroundTruth(const SyntheticMeshParameters &parameters, const Mesh &mesh, CurvatureGroundTruth &truth)
+{
+  const std::vector<glm::vec3> &P = mesh.vertexPositions();
+  truth.kappa1.resize(P.size());
+  truth.kappa2.resize(P.size());
+  truth.direction1.resize(P.size());
+  truth.direction2.resize(P.size());
+  const float R = parameters.radius, r = parameters.minorRadius;
+  const bool isTorus = (parameters.shape == SyntheticShape::Torus);
+  parallel_for(0, P.size(), 16384, [&](size_t first, size_t last) {
+    for(size_t v = first; v < last; ++v) {
+      if(!isTorus) {
+        truth.kappa1[v] = truth.kappa2[v] = -1.f/R;
+        truth.direction1[v] = truth.direction2[v] = glm::vec3(0.f);
+        continue;
+      }
+      // Around the tube, the normal section is the tube circle; around the axis, it is the
+      // circle of radius (R + r cos phi)/cos phi
+      const glm::vec3 &p = P[v];
+      const float theta = std::atan2(p.z, p.x), phi = std::atan2(p.y, std::sqrt(p.x*p.x + p.z*p.z) - R);
+      truth.kappa1[v] = -1.f/r;
+      truth.kappa2[v] = -std::cos(phi)/(R + r*std::cos(phi));
+      truth.direction1[v] = glm::vec3(-std::sin(phi)*std::cos(theta), std::cos(phi), -std::sin(phi)*std::sin(theta));
+      truth.direction2[v] = glm::vec3(-std::sin(theta), 0.f, std::cos(theta));
+    }
+  });
+}
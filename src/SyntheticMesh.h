@@ -0,0 +1,72 @@
+#ifndef SYNTHETIC_MESH_H
+#define SYNTHETIC_MESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class Mesh;
+
+// Shapes of the procedural generator
+enum class SyntheticShape {
+  Icosphere,   // geodesic sphere: every icosahedron face split into n^2 triangles
+  Torus,       // u x v grid around the y axis
+  NoisySphere, // icosphere displaced along the radius by fractal value noise
+  Terrain,     // height field of fractal value noise over [-1, 1]^2, open boundary
+  Tiling       // copies of a source mesh on a cubic lattice
+};
+
+const char *syntheticShapeName(SyntheticShape shape);
+
+/**
+ * This struct has been created for the suggestive contouring project.
+ *
+ * Parameters of a generated mesh. The number of triangles is a target: each shape rounds it
+ * to its own grid, e.g., 20 n^2 for an icosphere. The shapes are centered at the origin.
+ * Generation runs on the thread pool and only depends on these parameters, never on the
+ * number of threads.
+ */
+struct SyntheticMeshParameters {
+  SyntheticShape shape = SyntheticShape::Icosphere;
+  size_t triangles = 100000;
+  float radius = 1.f;             // sphere radius, torus major radius
+  float minorRadius = 0.4f;       // torus tube radius, below radius
+  float amplitude = 0.1f;         // noise amplitude, relative to the radius or to the terrain extent
+  float frequency = 4.f;          // noise frequency of the first octave, per unit
+  unsigned int octaves = 4;       // each of twice the frequency and half the amplitude of the previous one
+  uint32_t seed = 1;              // noise seed
+  const Mesh *source = nullptr;   // tiled mesh
+};
+
+/**
+ * This function has been created for the suggestive contouring project.
+ *
+ * Replaces the geometry of the mesh by a generated one, then prepares it as the loaders do:
+ * vertex and triangle orders of the mesh applied, normals and texture coordinates computed.
+ */
+void generateSyntheticMesh(const SyntheticMeshParameters &parameters, Mesh &mesh);
+
+// Fractal value noise in [-1, 1], a deterministic function of the point and the seed
+float fractalNoise(const glm::vec3 &p, unsigned int octaves, uint32_t seed);
+
+/**
+ * This struct has been created for the suggestive contouring project.
+ *
+ * Exact principal curvatures and directions at the vertices of a generated surface, with the
+ * conventions of Mesh::calculatePrincipalCurvature(): kappa1 <= kappa2, signed along the
+ * derivative of the outward normal, so that a sphere of radius r has kappa1 = kappa2 = -1/r.
+ * The directions are unit tangents, zero at umbilics where every tangent is principal.
+ */
+struct CurvatureGroundTruth {
+  std::vector<float> kappa1, kappa2;
+  std::vector<glm::vec3> direction1, direction2;
+};
+
+// Only the sphere and the torus have a closed form. The values are computed from the vertex
+// positions, which must be the generated ones (any vertex order).
+bool hasCurvatureGroundTruth(SyntheticShape shape);
+void computeCurvatureGroundTruth(const SyntheticMeshParameters &parameters, const Mesh &mesh, CurvatureGroundTruth &truth);
+
+#endif  // SYNTHETIC_MESH_H
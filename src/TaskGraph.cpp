@@ -0,0 +1,221 @@
+#include "TaskGraph.h"
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <iomanip>
+
+struct TaskGraph::Stage {
+  std::string name;
+  const char *profileName; // interned name of the stage
+  std::vector<BufferRange> inputs, outputs;
+  std::function<void()> work;
+  bool mainThread;
+  std::vector<unsigned int> predecessors, successors;
+  std::unique_ptr<StageJob> job;
+
+  // State and timings of the current run
+  std::atomic<unsigned int> remaining{0};
+  double startMs = 0.0, endMs = 0.0;
+  std::thread::id thread;
+};
+
+class TaskGraph::StageJob : public ThreadPool::Job {
+public:
+  StageJob(TaskGraph &graph, Stage &stage) : _graph(graph), _stage(stage) {}
+  void run(size_t) const override { _graph.execute(_stage); }
+
+private:
+  TaskGraph &_graph;
+  Stage &_stage;
+};
+
+namespace {
+
+bool conflicts(const std::vector<BufferRange> &a, const std::vector<BufferRange> &b)
+{
+  for(const BufferRange &x : a)
+    for(const BufferRange &y : b)
+      if(x.overlaps(y))
+        return true;
+  return false;
+}
+
+} // namespace
+
+TaskGraph::TaskGraph()
+{
+}
+
+TaskGraph::~TaskGraph()
+{
+}
+
+unsigned int TaskGraph::addStage(const std::string &name, std::initializer_list<BufferRange> inputs,
+                                 std::initializer_list<BufferRange> outputs, std::function<void()> work,
+                                 bool mainThread)
+{
+  std::unique_ptr<Stage> stage(new Stage);
+  stage->name = name;
+  stage->profileName = Profiler::intern(name);
+  stage->inputs = inputs;
+  stage->outputs = outputs;
+  stage->work = std::move(work);
+  stage->mainThread = mainThread;
+  stage->job.reset(new StageJob(*this, *stage));
+
+  const unsigned int index = static_cast<unsigned int>(_stages.size());
+  for(unsigned int p = 0; p < index; ++p) {
+    const Stage &previous = *_stages[p];
+    // Read after write, write after read and write after write
+    if(conflicts(stage->inputs, previous.outputs) || conflicts(stage->outputs, previous.inputs) ||
+       conflicts(stage->outputs, previous.outputs)) {
+      stage->predecessors.push_back(p);
+      _stages[p]->successors.push_back(index);
+    }
+  }
+  _stages.push_back(std::move(stage));
+  return index;
+}
+
+void TaskGraph::clear()
+{
+  _stages.clear();
+  _wallMs = 0.0;
+}
+
+void TaskGraph::schedule(Stage &stage)
+{
+  if(stage.mainThread) {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      _mainQueue.push_back(&stage);
+    }
+    _mainReady.notify_one();
+  } else {
+    ThreadPool::instance().submit(*stage.job, 1);
+  }
+}
+
+void TaskGraph::execute(Stage &stage)
+{
+  auto sinceStart = [this]() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+  };
+  stage.thread = std::this_thread::get_id();
+  stage.startMs = sinceStart();
+  {
+    SC_PROFILE_SCOPE(stage.profileName);
+    stage.work();
+  }
+  stage.endMs = sinceStart();
+
+  for(unsigned int s : stage.successors)
+    if(--_stages[s]->remaining == 0)
+      schedule(*_stages[s]);
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    ++_done;
+  }
+  _mainReady.notify_one();
+}
+
+void TaskGraph::run()
+{
+  SC_PROFILE_SCOPE("TaskGraph::run");
+  const unsigned int count = static_cast<unsigned int>(_stages.size());
+  _start = std::chrono::steady_clock::now();
+  _mainThread = std::this_thread::get_id();
+  _mainQueue.clear();
+  _done = 0;
+  for(auto &stage : _stages)
+    stage->remaining = static_cast<unsigned int>(stage->predecessors.size());
+  for(auto &stage : _stages)
+    if(stage->predecessors.empty())
+      schedule(*stage);
+
+  ThreadPool &pool = ThreadPool::instance();
+  while(_done < count) {
+    Stage *next = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if(!_mainQueue.empty()) {
+        next = _mainQueue.front();
+        _mainQueue.erase(_mainQueue.begin());
+      }
+    }
+    if(next) {
+      execute(*next);
+      continue;
+    }
+    // Help the pool while no main-thread stage is ready
+    if(pool.runPendingTask())
+      continue;
+    std::unique_lock<std::mutex> lock(_mutex);
+    _mainReady.wait_for(lock, std::chrono::microseconds(200),
+                        [&]() { return !_mainQueue.empty() || _done == count; });
+  }
+  // The pool releases a job right after its last chunk has run: wait for it before reusing them
+  for(auto &stage : _stages)
+    if(!stage->mainThread)
+      pool.wait(*stage->job);
+  _wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - _start).count();
+}
+
+std::vector<unsigned int> TaskGraph::criticalPath() const
+{
+  // Backwards from the last stage to finish, through the predecessor that finished last
+  std::vector<unsigned int> path;
+  if(_stages.empty())
+    return path;
+  unsigned int current = 0;
+  for(unsigned int s = 1; s < _stages.size(); ++s)
+    if(_stages[s]->endMs > _stages[current]->endMs)
+      current = s;
+  for(;;) {
+    path.push_back(current);
+    const Stage &stage = *_stages[current];
+    if(stage.predecessors.empty())
+      break;
+    current = stage.predecessors.front();
+    for(unsigned int p : stage.predecessors)
+      if(_stages[p]->endMs > _stages[current]->endMs)
+        current = p;
+  }
+  std::reverse(path.begin(), path.end());
+  return path;
+}
+
+double TaskGraph::criticalPathTime() const
+{
+  double total = 0.0;
+  for(unsigned int s : criticalPath())
+    total += _stages[s]->endMs - _stages[s]->startMs;
+  return total;
+}
+
+void TaskGraph::report(std::ostream &out) const
+{
+  const std::vector<unsigned int> path = criticalPath();
+  double work = 0.0;
+  std::vector<std::thread::id> threads(1, _mainThread);
+  for(const auto &stage : _stages) {
+    work += stage->endMs - stage->startMs;
+    if(std::find(threads.begin(), threads.end(), stage->thread) == threads.end())
+      threads.push_back(stage->thread);
+  }
+
+  out << " > Frame task graph: " << _stages.size() << " stages on " << threads.size() << " thread(s), "
+      << std::fixed << std::setprecision(2) << "wall " << _wallMs << " ms, work " << work << " ms (x"
+      << (_wallMs > 0.0 ? work/_wallMs : 0.0) << "), critical path " << criticalPathTime() << " ms" << std::endl;
+  out << "         start  duration  thread  stage" << std::endl;
+  for(unsigned int s = 0; s < _stages.size(); ++s) {
+    const Stage &stage = *_stages[s];
+    const size_t thread = std::find(threads.begin(), threads.end(), stage.thread) - threads.begin();
+    const bool critical = std::find(path.begin(), path.end(), s) != path.end();
+    out << "    " << (critical ? '*' : ' ') << std::setw(9) << stage.startMs << std::setw(10)
+        << stage.endMs - stage.startMs << "  " << std::setw(6)
+        << (thread == 0 ? std::string("main") : "w" + std::to_string(thread)) << "  " << stage.name << std::endl;
+  }
+  out.unsetf(std::ios_base::floatfield);
+}
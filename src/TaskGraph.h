@@ -0,0 +1,98 @@
+#ifndef TASK_GRAPH_H
+#define TASK_GRAPH_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Mesh buffers the pipeline stages read and write, CPU- or GPU-side
+enum class MeshBuffer {
+  Positions,
+  Normals,
+  Triangles,
+  PrincipalCurvature,
+  OneRing,
+  RadialCurvature,
+  Gradient,
+  DirectionalDerivative,
+  Classification,
+  Eligibility,
+  Visibility,
+  Contours,
+  GpuRadialCurvature,
+  GpuEligibility
+};
+
+// A buffer, or one block of it: two ranges conflict if they overlap
+struct BufferRange {
+  static const unsigned int kWhole = ~0u;
+
+  BufferRange(MeshBuffer b) : buffer(b), block(kWhole) {}
+  BufferRange(MeshBuffer b, unsigned int k) : buffer(b), block(k) {}
+  bool overlaps(const BufferRange &o) const { return buffer == o.buffer && (block == kWhole || o.block == kWhole || block == o.block); }
+
+  MeshBuffer buffer;
+  unsigned int block;
+};
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Declarative runner for the per-frame stages of the contour pipeline. Each stage declares the
+ * buffers (or buffer blocks) it reads and writes, and the dependencies follow from the order in
+ * which the stages are added: a stage waits for the previous writers of what it reads or
+ * writes, and for the previous readers of what it writes. Independent stages then overlap on
+ * the thread pool, while stages flagged for the main thread (e.g., GPU uploads, which need the
+ * GL context) are run by the thread calling run() as soon as they are ready.
+ *
+ * The graph is built once and run every frame. Each run is timed, and report() prints the
+ * stages with their critical path: the chain of stages that gated the end of the frame.
+ */
+class TaskGraph {
+public:
+  TaskGraph();
+  ~TaskGraph();
+
+  unsigned int addStage(const std::string &name, std::initializer_list<BufferRange> inputs,
+                        std::initializer_list<BufferRange> outputs, std::function<void()> work,
+                        bool mainThread = false);
+  void clear();
+  bool empty() const { return _stages.empty(); }
+
+  // Runs all the stages and returns once they are done. Must be called from the main thread.
+  void run();
+
+  // Timings of the last run, in milliseconds since its start
+  double wallTime() const { return _wallMs; }
+  double criticalPathTime() const;
+  void report(std::ostream &out) const;
+
+private:
+  struct Stage;
+  class StageJob;
+
+  void schedule(Stage &stage);
+  void execute(Stage &stage);
+  std::vector<unsigned int> criticalPath() const;
+
+  std::vector<std::unique_ptr<Stage>> _stages;
+
+  // State of the current run
+  std::mutex _mutex;
+  std::condition_variable _mainReady;
+  std::vector<Stage *> _mainQueue;
+  std::atomic<unsigned int> _done{0};
+  std::chrono::steady_clock::time_point _start;
+  double _wallMs = 0.0;
+  std::thread::id _mainThread;
+};
+
+#endif  // TASK_GRAPH_H
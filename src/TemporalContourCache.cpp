@@ -0,0 +1,230 @@
+#include "TemporalContourCache.h"
+#include "Mesh.h"
+#include "Profiler.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+const unsigned int kVertexBlockSize = 256;
+
+} // namespace
+
+void TemporalContourCache::reset(const Mesh &mesh)
+{
+  const auto &P = mesh.vertexPositions();
+  const auto &T = mesh.triangleIndices();
+
+  _blocks.clear();
+  for(unsigned int begin = 0; begin < P.size(); begin += kVertexBlockSize) {
+    Block block;
+    block.begin = begin;
+    block.end = std::min<unsigned int>(begin + kVertexBlockSize, static_cast<unsigned int>(P.size()));
+    glm::vec3 lo(FLT_MAX), hi(-FLT_MAX);
+    for(unsigned int v = block.begin; v < block.end; ++v) {
+      lo = glm::min(lo, P[v]);
+      hi = glm::max(hi, P[v]);
+    }
+    block.center = 0.5f*(lo + hi);
+    block.radius = 0.5f*glm::length(hi - lo);
+    block.eye = glm::vec3(0.f);
+    block.slack = 0.f;
+    block.valid = false;
+    _blocks.push_back(block);
+  }
+  _viewDir.assign(P.size(), glm::vec3(0.f));
+
+  mesh.computeOneRingAdjacency(_ringOffsets, _ring);
+  mesh.computeVertexTriangleAdjacency(_faceOffsets, _faces);
+
+  // Barycentric gradients and corner angles only depend on the geometry: computed once, with
+  // the same expressions as Mesh::accumulateTriangleGradients()
+  _gradLambda.resize(3*T.size());
+  _angle.resize(3*T.size());
+  _validTriangle.resize(T.size());
+  for(unsigned int t = 0; t < T.size(); ++t) {
+    const glm::vec3 &p_i = P[T[t][0]];
+    const glm::vec3 &p_j = P[T[t][1]];
+    const glm::vec3 &p_k = P[T[t][2]];
+    _validTriangle[t] = isDegenerateTriangle(p_i, p_j, p_k) ? 0 : 1;
+    if(!_validTriangle[t])
+      continue;
+    glm::vec3 e1 = p_j - p_i;
+    glm::vec3 e2 = p_k - p_i;
+    glm::vec3 n = glm::normalize(glm::cross(e1, e2));
+    float area2 = glm::length(glm::cross(e1, e2));
+    _gradLambda[3*t + 0] = glm::cross(n, p_k - p_j) / area2;
+    _gradLambda[3*t + 1] = glm::cross(n, p_i - p_k) / area2;
+    _gradLambda[3*t + 2] = glm::cross(n, p_j - p_i) / area2;
+    _angle[3*t + 0] = acos(glm::clamp(glm::dot(glm::normalize(p_j - p_i), glm::normalize(p_k - p_i)), -1.0f, 1.0f));
+    _angle[3*t + 1] = acos(glm::clamp(glm::dot(glm::normalize(p_i - p_j), glm::normalize(p_k - p_j)), -1.0f, 1.0f));
+    _angle[3*t + 2] = acos(glm::clamp(glm::dot(glm::normalize(p_i - p_k), glm::normalize(p_j - p_k)), -1.0f, 1.0f));
+  }
+
+  _gradAccum.assign(P.size(), glm::vec3(0.f));
+  _weightAccum.assign(P.size(), 0.f);
+  _dirDeriv.assign(P.size(), 0.f);
+  _class.assign(P.size(), 0);
+  _stamp.assign(P.size(), 0);
+  _currentStamp = 0;
+}
+
+bool TemporalContourCache::blockUpToDate(const Block &block, const glm::vec3 &eye) const
+{
+  if(!block.valid)
+    return false;
+  // Seen from any point of the block, the segment between the previous and the current eye
+  // positions subtends at most asin(move/dist) when move < dist (law of sines)
+  const float move = glm::length(eye - block.eye);
+  const float dist = std::min(glm::length(eye - block.center), glm::length(block.eye - block.center)) - block.radius;
+  if(move >= dist)
+    return false;
+  return block.slack + std::asin(move/dist) < _tolerance;
+}
+
+void TemporalContourCache::gatherGradient(const Mesh &mesh, unsigned int v)
+{
+  const auto &T = mesh.triangleIndices();
+  const auto &radial = mesh.radialCurvatures();
+  glm::vec3 grad(0.f);
+  float weight = 0.f;
+  for(unsigned int i = _faceOffsets[v]; i < _faceOffsets[v + 1]; ++i) {
+    const unsigned int t = _faces[i];
+    if((i > _faceOffsets[v] && _faces[i - 1] == t) || !_validTriangle[t])
+      continue;
+    glm::vec3 G = radial[T[t][0]] * _gradLambda[3*t] + radial[T[t][1]] * _gradLambda[3*t + 1] +
+                  radial[T[t][2]] * _gradLambda[3*t + 2];
+    for(unsigned int k = 0; k < 3; ++k) {
+      if(T[t][k] == v) {
+        grad += _angle[3*t + k] * G;
+        weight += _angle[3*t + k];
+      }
+    }
+  }
+  _gradAccum[v] = grad;
+  _weightAccum[v] = weight;
+}
+
+void TemporalContourCache::setEligibility(Mesh &mesh, unsigned int v, bool eligible)
+{
+  if(mesh.eligibleForSuggestiveContour()[v] == eligible)
+    return;
+  mesh.setSuggestiveContourEligibility(v, eligible);
+  _eligibleBegin = std::min(_eligibleBegin, v);
+  _eligibleEnd = std::max(_eligibleEnd, v + 1);
+}
+
+void TemporalContourCache::updateHysteresis(Mesh &mesh)
+{
+  // A weak vertex ends up strong iff its component of weak/strong vertices contains a strong
+  // one: only the components touching a reclassified vertex can change.
+  ++_currentStamp;
+  for(unsigned int seed : _seeds) {
+    if(_class[seed] == 0)
+      setEligibility(mesh, seed, false);
+    for(unsigned int i = _ringOffsets[seed]; i <= _ringOffsets[seed + 1]; ++i) {
+      const unsigned int start = (i == _ringOffsets[seed + 1]) ? seed : _ring[i];
+      if(_class[start] == 0 || _stamp[start] == _currentStamp)
+        continue;
+      _component.clear();
+      _component.push_back(start);
+      _stamp[start] = _currentStamp;
+      bool hasStrong = false;
+      for(size_t c = 0; c < _component.size(); ++c) {
+        const unsigned int v = _component[c];
+        hasStrong = hasStrong || _class[v] == 2;
+        for(unsigned int j = _ringOffsets[v]; j < _ringOffsets[v + 1]; ++j) {
+          const unsigned int u = _ring[j];
+          if(_class[u] != 0 && _stamp[u] != _currentStamp) {
+            _stamp[u] = _currentStamp;
+            _component.push_back(u);
+          }
+        }
+      }
+      for(unsigned int v : _component)
+        setEligibility(mesh, v, hasStrong);
+      _hysteresisCount += _component.size();
+    }
+  }
+}
+
+void TemporalContourCache::update(Mesh &mesh, const glm::vec3 &eye, ContourAttributeListener *listener)
+{
+  SC_PROFILE_SCOPE("TemporalContourCache::update");
+  const auto &P = mesh.vertexPositions();
+  const auto &T = mesh.triangleIndices();
+  _staleCount = _updatedCount = _hysteresisCount = _skippedBlocks = 0;
+
+  // Step 1: find the vertices whose view direction left the tolerance, and update their radial curvature
+  _stale.clear();
+  for(Block &block : _blocks) {
+    if(blockUpToDate(block, eye)) {
+      ++_skippedBlocks;
+      continue;
+    }
+    float slack = 0.f;
+    for(unsigned int v = block.begin; v < block.end; ++v) {
+      const glm::vec3 dir = glm::normalize(eye - P[v]);
+      const glm::vec3 &cached = _viewDir[v];
+      if(cached == glm::vec3(0.f) || dir != cached) {
+        const float angle = std::acos(glm::clamp(glm::dot(dir, cached), -1.f, 1.f));
+        if(cached == glm::vec3(0.f) || angle >= _tolerance) {
+          _viewDir[v] = dir;
+          _stale.push_back(v);
+        } else {
+          slack = std::max(slack, angle);
+        }
+      }
+    }
+    block.eye = eye;
+    block.slack = slack;
+    block.valid = true;
+  }
+  _staleCount = _stale.size();
+  if(_stale.empty())
+    return;
+  for(unsigned int v : _stale)
+    mesh.calculateRadialCurvature(eye, v, v + 1);
+
+  // Step 2: the gradient of every vertex sharing a triangle with a stale vertex has changed
+  ++_currentStamp;
+  _affected.clear();
+  for(unsigned int s : _stale) {
+    for(unsigned int i = _faceOffsets[s]; i < _faceOffsets[s + 1]; ++i) {
+      const glm::uvec3 &tri = T[_faces[i]];
+      for(unsigned int k = 0; k < 3; ++k) {
+        if(_stamp[tri[k]] != _currentStamp) {
+          _stamp[tri[k]] = _currentStamp;
+          _affected.push_back(tri[k]);
+        }
+      }
+    }
+  }
+  _updatedCount = _affected.size();
+
+  // Step 3: directional derivative and classification of the affected vertices
+  const SuggestiveContourThresholds thresholds;
+  _seeds.clear();
+  for(unsigned int v : _affected) {
+    gatherGradient(mesh, v);
+    mesh.computeDirectionalDerivatives(_gradAccum, _weightAccum, eye, v, v + 1, _dirDeriv);
+    const int previous = _class[v];
+    mesh.classifyForSuggestiveContour(_dirDeriv, thresholds, eye, v, v + 1, _class);
+    if(_class[v] != previous)
+      _seeds.push_back(v);
+  }
+
+  // Step 4: local hysteresis, then notification of the changed ranges
+  _eligibleBegin = UINT_MAX;
+  _eligibleEnd = 0;
+  updateHysteresis(mesh);
+
+  if(listener) {
+    const auto range = std::minmax_element(_stale.begin(), _stale.end());
+    listener->radialCurvatureChanged(mesh, *range.first, *range.second + 1);
+    listener->eligibilityChanged(mesh, _eligibleBegin, _eligibleEnd);
+  }
+}
@@ -0,0 +1,89 @@
+#ifndef TEMPORAL_CONTOUR_CACHE_H
+#define TEMPORAL_CONTOUR_CACHE_H
+
+#include <vector>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+class Mesh;
+class ContourAttributeListener;
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Incremental update of the suggestive contour attributes between consecutive frames. Every
+ * vertex caches the view direction its radial curvature was computed for, and is only
+ * re-evaluated once the current view direction deviates from it by more than an angular
+ * tolerance. The changes are then propagated to the dependent quantities only:
+ *  - the gradient accumulators of the vertices sharing a triangle with a changed vertex,
+ *  - their directional derivatives and threshold classification,
+ *  - the hysteresis of the weak/strong components containing a vertex whose classification
+ *    changed, or one of its neighbors.
+ * Vertex blocks whose view direction provably moved by less than the tolerance are skipped
+ * without visiting their vertices, so the cost of an update follows the changed set.
+ *
+ * With a zero tolerance, the result is identical to Mesh::calculateRadialCurvature().
+ */
+class TemporalContourCache {
+public:
+  void setAngularTolerance(float radians) { _tolerance = radians; }
+  float angularTolerance() const { return _tolerance; }
+
+  // Rebuilds the topology caches and invalidates all vertices. Must be called after any change
+  // of the mesh geometry, once the contour attributes of the mesh are sized.
+  void reset(const Mesh &mesh);
+
+  // Brings the contour attributes of the mesh up to date for the eye position (in the frame of
+  // the mesh), and notifies the listener of the changed ranges.
+  void update(Mesh &mesh, const glm::vec3 &eye, ContourAttributeListener *listener = nullptr);
+
+  // Statistics of the last update
+  size_t staleVertexCount() const { return _staleCount; }         // radial curvature recomputed
+  size_t updatedVertexCount() const { return _updatedCount; }     // derivative and classification recomputed
+  size_t hysteresisVertexCount() const { return _hysteresisCount; } // visited by the hysteresis
+  size_t skippedBlockCount() const { return _skippedBlocks; }
+
+private:
+  struct Block {
+    unsigned int begin, end;
+    glm::vec3 center;
+    float radius;
+    glm::vec3 eye;  // eye position at the last check of the block
+    float slack;    // max angle between the cached and the current view directions at that check
+    bool valid;
+  };
+
+  bool blockUpToDate(const Block &block, const glm::vec3 &eye) const;
+  void gatherGradient(const Mesh &mesh, unsigned int v);
+  void updateHysteresis(Mesh &mesh);
+  void setEligibility(Mesh &mesh, unsigned int v, bool eligible);
+
+  float _tolerance = glm::radians(0.5f);
+
+  std::vector<Block> _blocks;
+  std::vector<glm::vec3> _viewDir; // cached per-vertex view direction, zero if never computed
+
+  // Topology and static geometry
+  std::vector<unsigned int> _ringOffsets, _ring;
+  std::vector<unsigned int> _faceOffsets, _faces;
+  std::vector<glm::vec3> _gradLambda; // 3 per triangle
+  std::vector<float> _angle;          // 3 per triangle
+  std::vector<unsigned char> _validTriangle;
+
+  // View-dependent state
+  std::vector<glm::vec3> _gradAccum;
+  std::vector<float> _weightAccum;
+  std::vector<float> _dirDeriv;
+  std::vector<int> _class; // 0 not eligible, 1 weak, 2 strong, before hysteresis
+
+  // Traversal scratch
+  std::vector<unsigned int> _stamp;
+  unsigned int _currentStamp = 0;
+  std::vector<unsigned int> _stale, _affected, _seeds, _component;
+
+  size_t _staleCount = 0, _updatedCount = 0, _hysteresisCount = 0, _skippedBlocks = 0;
+  unsigned int _eligibleBegin = 0, _eligibleEnd = 0;
+};
+
+#endif  // TEMPORAL_CONTOUR_CACHE_H
@@ -0,0 +1,167 @@
+#include "ThreadPool.h"
+
+#include <chrono>
+#include <deque>
+#include <thread>
+
+namespace {
+
+// Index of the pool worker running on this thread, -1 on other threads
+thread_local int t_workerIndex = -1;
+
+// Declared before the instance, so that it outlives it at exit
+std::mutex g_instanceMutex;
+
+unsigned int resolveThreadCount(unsigned int count)
+{
+  if(count == 0)
+    count = std::thread::hardware_concurrency();
+  return std::max(count, 1u);
+}
+
+} // namespace
+
+struct ThreadPool::Worker {
+  std::mutex mutex;
+  std::deque<Task> tasks;
+  std::thread thread;
+};
+
+std::unique_ptr<ThreadPool> ThreadPool::_instance;
+
+ThreadPool &ThreadPool::instance()
+{
+  std::lock_guard<std::mutex> lock(g_instanceMutex);
+  if(!_instance)
+    _instance.reset(new ThreadPool(resolveThreadCount(0)));
+  return *_instance;
+}
+
+void ThreadPool::setThreadCount(unsigned int count)
+{
+  count = resolveThreadCount(count);
+  std::lock_guard<std::mutex> lock(g_instanceMutex);
+  if(_instance && _instance->_threadCount == count)
+    return;
+  _instance.reset();
+  _instance.reset(new ThreadPool(count));
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount) : _threadCount(threadCount)
+{
+  // The thread calling parallel_for takes part in the work: threadCount - 1 workers
+  for(unsigned int i = 0; i + 1 < threadCount; ++i)
+    _workers.emplace_back(new Worker);
+  for(unsigned int i = 0; i < _workers.size(); ++i)
+    _workers[i]->thread = std::thread(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(_sleepMutex);
+    _quit = true;
+  }
+  _wake.notify_all();
+  for(auto &worker : _workers)
+    worker->thread.join();
+}
+
+void ThreadPool::submit(Job &job, size_t chunkCount)
+{
+  job.pending = chunkCount;
+  if(_workers.empty()) {
+    for(size_t c = 0; c < chunkCount; ++c) {
+      job.run(c);
+      --job.pending;
+    }
+    return;
+  }
+
+  _queued += chunkCount;
+  // Enqueue: in our own deque from a worker (the others steal from it), otherwise spread
+  // contiguous runs of chunks over all deques
+  if(t_workerIndex >= 0) {
+    Worker &self = *_workers[t_workerIndex];
+    std::lock_guard<std::mutex> lock(self.mutex);
+    for(size_t c = chunkCount; c-- > 0;)
+      self.tasks.push_back(Task{&job, c});
+  } else {
+    const size_t perWorker = (chunkCount + _workers.size() - 1)/_workers.size();
+    for(size_t w = 0; w < _workers.size() && w*perWorker < chunkCount; ++w) {
+      std::lock_guard<std::mutex> lock(_workers[w]->mutex);
+      for(size_t c = std::min(chunkCount, (w + 1)*perWorker); c-- > w*perWorker;)
+        _workers[w]->tasks.push_back(Task{&job, c});
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(_sleepMutex);
+  }
+  _wake.notify_all();
+}
+
+void ThreadPool::wait(Job &job)
+{
+  // Help until the job is done (possibly running tasks of other jobs meanwhile)
+  while(job.pending.load(std::memory_order_acquire) > 0) {
+    if(!runOneTask(t_workerIndex))
+      std::this_thread::yield();
+  }
+}
+
+bool ThreadPool::runPendingTask()
+{
+  return !_workers.empty() && runOneTask(t_workerIndex);
+}
+
+void ThreadPool::runTask(const Task &task)
+{
+  task.job->run(task.chunk);
+  // Last access to the job: its owner may return as soon as pending reaches zero
+  const_cast<Job *>(task.job)->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool ThreadPool::runOneTask(int self)
+{
+  Task task;
+  bool found = false;
+  if(self >= 0) {
+    Worker &own = *_workers[self];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if(!own.tasks.empty()) {
+      task = own.tasks.back();
+      own.tasks.pop_back();
+      found = true;
+    }
+  }
+  const unsigned int count = static_cast<unsigned int>(_workers.size());
+  const unsigned int first = _nextVictim.fetch_add(1, std::memory_order_relaxed);
+  for(unsigned int i = 0; !found && i < count; ++i) {
+    Worker &victim = *_workers[(first + i) % count];
+    if(static_cast<int>((first + i) % count) == self)
+      continue;
+    std::lock_guard<std::mutex> lock(victim.mutex);
+    if(!victim.tasks.empty()) {
+      task = victim.tasks.front();
+      victim.tasks.pop_front();
+      found = true;
+    }
+  }
+  if(!found)
+    return false;
+  --_queued;
+  runTask(task);
+  return true;
+}
+
+void ThreadPool::workerLoop(unsigned int index)
+{
+  t_workerIndex = static_cast<int>(index);
+  while(!_quit) {
+    if(runOneTask(t_workerIndex))
+      continue;
+    std::unique_lock<std::mutex> lock(_sleepMutex);
+    _wake.wait_for(lock, std::chrono::milliseconds(1), [this]() { return _quit || _queued > 0; });
+  }
+  t_workerIndex = -1;
+}
@@ -0,0 +1,129 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * Small work-stealing scheduler shared by all mesh kernels, so that concurrent users (e.g.,
+ * the contour worker and the loader) do not oversubscribe the machine. Each worker owns a
+ * deque: it pops its own tasks from the back and steals from the front of the others' when
+ * idle. Threads waiting for a parallel loop to finish execute pending tasks meanwhile, so
+ * parallel loops can be nested and can be started from any thread.
+ *
+ * The thread count is global: setThreadCount(n) runs the kernels on n threads in total (the
+ * calling thread included), 1 making everything sequential and 0 selecting the hardware
+ * concurrency. It must not be changed while a parallel loop is running.
+ */
+class ThreadPool {
+public:
+  // A batch of chunks executed by parallel_for/parallel_reduce
+  class Job {
+  public:
+    virtual ~Job() {}
+    virtual void run(size_t chunk) const = 0;
+    std::atomic<size_t> pending{0};
+  };
+
+  static ThreadPool &instance();
+  static void setThreadCount(unsigned int count);
+  static unsigned int threadCount() { return instance()._threadCount; }
+
+  // Runs the chunks [0, chunkCount) of the job and returns once all of them are done
+  void execute(Job &job, size_t chunkCount) { submit(job, chunkCount); wait(job); }
+  // Enqueues the chunks of the job and returns immediately (without workers, runs them inline).
+  // The job must stay alive until wait() has returned for it.
+  void submit(Job &job, size_t chunkCount);
+  // Runs pending tasks until all the chunks of the job are done
+  void wait(Job &job);
+  // Runs one pending task, if any, for threads waiting on something else than a job
+  bool runPendingTask();
+
+  ~ThreadPool();
+
+private:
+  struct Task {
+    const Job *job;
+    size_t chunk;
+  };
+  struct Worker;
+
+  explicit ThreadPool(unsigned int threadCount);
+  void workerLoop(unsigned int index);
+  bool runOneTask(int self);
+  void runTask(const Task &task);
+
+  unsigned int _threadCount;
+  std::vector<std::unique_ptr<Worker>> _workers;
+  std::atomic<size_t> _queued{0};
+  std::atomic<bool> _quit{false};
+  std::atomic<unsigned int> _nextVictim{0};
+  std::mutex _sleepMutex;
+  std::condition_variable _wake;
+
+  static std::unique_ptr<ThreadPool> _instance;
+};
+
+// Calls fn(chunkBegin, chunkEnd) over [begin, end) split into chunks of at least grain items
+template <typename Fn>
+void parallel_for(size_t begin, size_t end, size_t grain, const Fn &fn)
+{
+  if(end <= begin)
+    return;
+  grain = std::max<size_t>(grain, 1);
+  const size_t count = end - begin;
+  ThreadPool &pool = ThreadPool::instance();
+  if(pool.threadCount() <= 1 || count <= grain) {
+    fn(begin, end);
+    return;
+  }
+  // A few chunks per thread for load balancing, but never smaller than the grain
+  const size_t chunkSize = std::max(grain, (count + 4*pool.threadCount() - 1)/(4*pool.threadCount()));
+  const size_t chunkCount = (count + chunkSize - 1)/chunkSize;
+
+  class ForJob : public ThreadPool::Job {
+  public:
+    ForJob(const Fn &f, size_t b, size_t e, size_t s) : _fn(f), _begin(b), _end(e), _chunkSize(s) {}
+    void run(size_t chunk) const override {
+      const size_t first = _begin + chunk*_chunkSize;
+      _fn(first, std::min(_end, first + _chunkSize));
+    }
+  private:
+    const Fn &_fn;
+    size_t _begin, _end, _chunkSize;
+  } job(fn, begin, end, chunkSize);
+  pool.execute(job, chunkCount);
+}
+
+// Reduces map(chunkBegin, chunkEnd) over [begin, end) with reduce, starting from identity.
+// Chunk results are combined in order, so the result does not depend on the scheduling.
+template <typename T, typename Map, typename Reduce>
+T parallel_reduce(size_t begin, size_t end, size_t grain, const T &identity, const Map &map, const Reduce &reduce)
+{
+  if(end <= begin)
+    return identity;
+  grain = std::max<size_t>(grain, 1);
+  const size_t chunkCount = std::max<size_t>(1, std::min((end - begin + grain - 1)/grain,
+                                                         static_cast<size_t>(4*ThreadPool::threadCount())));
+  const size_t chunkSize = (end - begin + chunkCount - 1)/chunkCount;
+  std::vector<T> partial(chunkCount, identity);
+  parallel_for(0, chunkCount, 1, [&](size_t first, size_t last) {
+    for(size_t c = first; c < last; ++c) {
+      const size_t b = begin + c*chunkSize;
+      partial[c] = map(b, std::min(end, b + chunkSize));
+    }
+  });
+  T result = identity;
+  for(const T &value : partial)
+    result = reduce(result, value);
+  return result;
+}
+
+#endif  // THREAD_POOL_H
@@ -0,0 +1,122 @@
+#ifndef VERTEX_ATTRIBUTE_STORE_H
+#define VERTEX_ATTRIBUTE_STORE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Width in floats the structure-of-arrays attributes are padded to (one SSE register)
+const size_t kSimdWidth = 4;
+// Alignment of their arrays: a cache line, so that no SIMD load splits one
+const size_t kSimdAlignment = 64;
+
+// Allocator of kSimdAlignment-aligned storage for std::vector
+template <typename T>
+struct AlignedAllocator {
+  using value_type = T;
+
+  AlignedAllocator() = default;
+  template <typename U>
+  AlignedAllocator(const AlignedAllocator<U> &) {}
+
+  // Over-allocates and keeps the malloc pointer just before the aligned block (malloc blocks
+  // are at least 16-byte aligned, so there is always room for it)
+  T *allocate(size_t n) {
+    void *raw = std::malloc(n*sizeof(T) + kSimdAlignment);
+    if(!raw)
+      throw std::bad_alloc();
+    void **aligned = reinterpret_cast<void **>((reinterpret_cast<uintptr_t>(raw) + kSimdAlignment) & ~(kSimdAlignment - 1));
+    aligned[-1] = raw;
+    return reinterpret_cast<T *>(aligned);
+  }
+  void deallocate(T *p, size_t) {
+    if(p)
+      std::free(reinterpret_cast<void **>(p)[-1]);
+  }
+
+  template <typename U>
+  bool operator==(const AlignedAllocator<U> &) const { return true; }
+  template <typename U>
+  bool operator!=(const AlignedAllocator<U> &) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+// Read-only view of one component of a structure-of-arrays attribute, e.g., to be uploaded to
+// the GPU as is: glBufferData(GL_ARRAY_BUFFER, view.size*sizeof(float), view.data, ...) and
+// glVertexAttribPointer(location, 1, GL_FLOAT, GL_FALSE, 0, 0)
+struct FloatArrayView {
+  const float *data;
+  size_t size;
+};
+
+/**
+ * This class has been created for the suggestive contouring project.
+ *
+ * A per-vertex 3D attribute stored as three aligned x, y and z arrays, padded with zeros to a
+ * multiple of kSimdWidth, so that kernels can load kSimdWidth consecutive vertices of one
+ * component at once and run over the padded size without a scalar tail.
+ */
+class SoaVec3 {
+public:
+  size_t size() const { return _size; }
+  size_t paddedSize() const { return _x.size(); }
+  size_t memoryBytes() const { return (_x.capacity() + _y.capacity() + _z.capacity())*sizeof(float); }
+  bool empty() const { return _size == 0; }
+
+  void resize(size_t size) {
+    const size_t padded = (size + kSimdWidth - 1)/kSimdWidth*kSimdWidth;
+    _size = size;
+    for(AlignedVector<float> *c : {&_x, &_y, &_z}) {
+      c->resize(padded);
+      std::fill(c->begin() + size, c->end(), 0.f);
+    }
+  }
+  void clear() { resize(0); }
+
+  glm::vec3 operator[](size_t i) const { return glm::vec3(_x[i], _y[i], _z[i]); }
+  void set(size_t i, const glm::vec3 &v) {
+    _x[i] = v.x;
+    _y[i] = v.y;
+    _z[i] = v.z;
+  }
+
+  float *x() { return _x.data(); }
+  float *y() { return _y.data(); }
+  float *z() { return _z.data(); }
+  const float *x() const { return _x.data(); }
+  const float *y() const { return _y.data(); }
+  const float *z() const { return _z.data(); }
+  FloatArrayView component(unsigned int k) const {
+    const AlignedVector<float> &c = (k == 0) ? _x : (k == 1) ? _y : _z;
+    return FloatArrayView{c.data(), _size};
+  }
+
+  // Conversions from and to the array-of-structures layout of the Mesh accessors
+  void assign(const std::vector<glm::vec3> &aos) {
+    resize(aos.size());
+    float *x = _x.data(), *y = _y.data(), *z = _z.data();
+    for(size_t i = 0; i < aos.size(); ++i) {
+      x[i] = aos[i].x;
+      y[i] = aos[i].y;
+      z[i] = aos[i].z;
+    }
+  }
+  void copyTo(std::vector<glm::vec3> &aos) const {
+    aos.resize(_size);
+    for(size_t i = 0; i < _size; ++i)
+      aos[i] = (*this)[i];
+  }
+
+private:
+  size_t _size = 0;
+  AlignedVector<float> _x, _y, _z;
+};
+
+#endif  // VERTEX_ATTRIBUTE_STORE_H
@@ -27,6 +27,7 @@
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 
+#include <chrono>
 #include <cstdlib>
 #include <cstdio>
 #include <iostream>
@@ -43,11 +44,26 @@
 #include "ShaderProgram.h"
 #include "Camera.h"
 #include "Mesh.h"
+#include "Bvh.h"
+#include "MeshRenderer.h"
+#include "SilhouetteTree.h"
+#include "ContourExtractor.h"
+#include "ProgressiveContour.h"
+#include "TemporalContourCache.h"
+#include "ContourWorker.h"
+#include "ContourPipeline.h"
+#include "OcclusionCuller.h"
+#include "SoftwareRasterizer.h"
+#include "PngWriter.h"
+#include "Profiler.h"
+#include "InteractionRecording.h"
+#include "MemoryFootprint.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 const std::string DEFAULT_MESH_FILENAME("data/monkey.off");
+const std::string WINDOW_TITLE("Suggestive Contouriing Implementation - Vincent Frippiat");
 
 // window parameters
 GLFWwindow *g_window = nullptr;
@@ -82,6 +98,36 @@ unsigned int g_availableTextureSlot = 0;
 //contours
 int g_contourMode= 0;
 
+// progressive contour evaluation: per-frame time budget, in milliseconds
+bool g_progressiveMode = false;
+float g_progressiveBudgetMs = 4.f;
+
+// temporal-coherence contour update: only vertices whose view direction changed are recomputed
+bool g_temporalCacheMode = false;
+
+// asynchronous contour computation on a worker thread, and age of the displayed result in frames
+bool g_asyncMode = false;
+unsigned long long g_frameIndex = 0;
+unsigned long long g_contourStaleness = 0;
+
+// synchronous contour stages scheduled as a task graph, with pipelined uploads
+bool g_taskGraphMode = false;
+
+// hierarchical-Z culling of the hidden vertex clusters in the task-graph contour stages
+bool g_occlusionCulling = false;
+
+// weld tolerance of the cleanup of the loaded mesh, relative to its bounding box diagonal: no cleanup if negative
+float g_weldTolerance = -1.f;
+
+// recording of the interaction into a file, and its replay at a fixed simulated timestep
+InteractionRecording g_recording;
+std::string g_recordingFilename;          // empty when not recording
+std::vector<RecordedKey> g_recordedKeys;  // entered since the last recorded frame
+InteractionRecording g_replay;
+bool g_replayingP = false;
+size_t g_replayFrame = 0;
+bool g_replayKeysP = false; // keys sent by the replay: the user's are ignored meanwhile
+
 
 struct Light {
   glm::mat4 depthMVP;
@@ -98,6 +144,8 @@ struct Scene {
   // meshes
   std::shared_ptr<Mesh> rhino = nullptr;
   std::shared_ptr<Mesh> plane = nullptr;
+  MeshRenderer rhinoRenderer; // GPU buffers of the rhino
+  SoftwareRasterizer softwareRasterizer;
 
   // transformation matrices
   glm::mat4 rhinoMat = glm::mat4(1.0);
@@ -108,6 +156,32 @@ struct Scene {
   // shaders to render the meshes
   std::shared_ptr<ShaderProgram> mainShader;
 
+  // silhouette edges of the center mesh, extracted on the CPU
+  SilhouetteTree silhouetteTree;
+  std::vector<SilhouetteEdge> silhouetteEdges;
+
+  // suggestive contours of the center mesh, extracted on the CPU for the current frame
+  ContourExtractor contourExtractor;
+  std::vector<ContourPolyline> suggestiveContours;
+
+  // per-frame contour stages as a task graph
+  ContourPipeline contourPipeline;
+  OcclusionCuller occlusionCuller;
+
+  // time-budgeted evaluation of the contour attributes
+  ProgressiveContourEvaluator progressiveContours;
+  unsigned int extractedGeneration = 0;
+
+  // incremental update of the contour attributes between frames
+  TemporalContourCache temporalContours;
+
+  // contour attributes computed off the render thread
+  ContourWorker contourWorker;
+  unsigned int subdivisions = 0; // Loop subdivisions of the loaded mesh
+  bool asyncViewPosted = false;
+  glm::vec3 asyncPostedCamera = glm::vec3(0.0);
+  glm::mat4 asyncPostedModelMat = glm::mat4(1.0);
+
     void render()
   {
     //<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
@@ -137,25 +211,201 @@ struct Scene {
     // rhino
     mainShader->set("modelMat", rhinoMat);
     mainShader->set("normMat", glm::mat3(glm::inverseTranspose(rhinoMat)));
-    rhino->render();
+    rhinoRenderer.render();
 
     mainShader->stop();
     //>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
   }
   void subdivideCenterMesh() {
     rhino->subdivideLoop();
+    ++subdivisions;
     rhino->calculatePrincipalCurvature();
-    rhino->init();
+    rhinoRenderer.init(*rhino);
+    silhouetteTree.build(*rhino);
+    if(g_progressiveMode || g_temporalCacheMode)
+      resetIncrementalContours();
+  }
+
+  // Host and GPU memory of the mesh, and the forecast of the next subdivision
+  void printMemoryFootprint() const {
+    MemoryFootprint footprint;
+    rhino->accountMemory(footprint);
+    silhouetteTree.accountMemory(footprint);
+    rhinoRenderer.accountMemory(footprint);
+    std::cout << " > Memory footprint of " << rhino->vertexPositions().size() << " vertices, "
+              << rhino->triangleIndices().size() << " triangles:" << std::endl;
+    footprint.write(std::cout);
+    const SubdivisionForecast forecast = rhino->forecastSubdivision();
+    std::cout << " > Next subdivision: " << forecast.vertexCount << " vertices, " << forecast.triangleCount
+              << " triangles, mesh of " << forecast.residentBytes/1048576.0 << " MiB once done, "
+              << forecast.peakBytes/1048576.0 << " MiB at the peak, "
+              << MeshRenderer::bufferBytes(forecast.vertexCount, forecast.triangleCount)/1048576.0
+              << " MiB GPU (" << availablePhysicalMemory()/1048576.0 << " MiB available)" << std::endl;
+  }
+
+  // Whether the memory needed by subdivideCenterMesh() is available, as far as the OS tells: the
+  // mesh with its curvature, then the silhouette tree and the renderer buffers rebuilt at the
+  // next level. The latter are counted as host memory too, as the driver stages the uploads there.
+  bool subdivisionFits() const {
+    MemoryFootprint footprint;
+    rhino->accountMemory(footprint);
+    const SubdivisionForecast forecast = rhino->forecastSubdivision();
+    MemoryFootprint others;
+    silhouetteTree.accountMemory(others);
+    rhinoRenderer.accountMemory(others);
+    const size_t othersNow = others.residentBytes() + others.total(MemoryCategory::Gpu);
+    const size_t othersNext = SilhouetteTree::buildBytes(forecast.triangleCount) +
+                              MeshRenderer::bufferBytes(forecast.vertexCount, forecast.triangleCount);
+    const size_t needed = forecast.additionalBytes(footprint.residentBytes()) + othersNext - std::min(othersNow, othersNext);
+    const size_t available = availablePhysicalMemory();
+    if(available == 0 || needed <= available)
+      return true;
+    std::cout << " > Subdivision refused: it needs " << needed/1048576.0 << " MiB more, "
+              << available/1048576.0 << " MiB available" << std::endl;
+    return false;
   }
 
   void calculatePrincipalCurvatureCenterMesh() {
     rhino->calculatePrincipalCurvature();
-    rhino->init();
+    rhinoRenderer.init(*rhino);
   }
 
   void calculateRadialCurvatureCenterMesh() {
-    rhino->calculateRadialCurvature(g_cam->getPosition());
-    rhino->init();
+    rhino->calculateRadialCurvature(eyeInMeshFrame());
+    // In place: the buffers are sized to the vertices since the last change of the geometry
+    const unsigned int vertexCount = static_cast<unsigned int>(rhino->vertexPositions().size());
+    rhinoRenderer.radialCurvatureChanged(*rhino, 0, vertexCount);
+    rhinoRenderer.eligibilityChanged(*rhino, 0, vertexCount);
+    contourExtractor.extract(*rhino, suggestiveContours);
+  }
+
+  // Same result as calculateRadialCurvatureCenterMesh(), but the stages overlap on the thread
+  // pool and the attributes are uploaded into the existing buffers, block by block
+  void runContourTaskGraph() {
+    if(!contourPipeline.ready(*rhino) || (contourPipeline.occlusionCuller() != nullptr) != g_occlusionCulling) {
+      contourPipeline.setOcclusionCuller(g_occlusionCulling ? &occlusionCuller : nullptr);
+      contourPipeline.reset(*rhino, contourExtractor, suggestiveContours, &rhinoRenderer);
+      rhinoRenderer.init(*rhino); // buffers sized to the contour attributes
+    }
+    const glm::mat4 mvp = g_cam->computeProjectionMatrix()*g_cam->computeViewMatrix()*rhinoMat;
+    contourPipeline.run(eyeInMeshFrame(), mvp);
+  }
+
+  void printOcclusionCullingStats() const {
+    std::cout << " > Occlusion culling: " << occlusionCuller.culledVertexCount() << " vertices culled ("
+              << 100.f*occlusionCuller.culledFraction() << "%, " << occlusionCuller.offScreenVertexCount()
+              << " off screen), depth pyramid " << occlusionCuller.rasterTime() << " ms, cluster tests "
+              << occlusionCuller.testTime() << " ms" << std::endl;
+  }
+
+  void resetIncrementalContours() {
+    rhino->resizeContourAttributes();
+    rhinoRenderer.init(*rhino);
+    progressiveContours.reset(*rhino);
+    extractedGeneration = progressiveContours.generation();
+    temporalContours.reset(*rhino);
+  }
+
+  void stepProgressiveContours() {
+    progressiveContours.setBudget(g_progressiveBudgetMs);
+    const glm::mat4 mvp = g_cam->computeProjectionMatrix()*g_cam->computeViewMatrix()*rhinoMat;
+    progressiveContours.step(*rhino, eyeInMeshFrame(), mvp, &rhinoRenderer);
+    if(progressiveContours.generation() != extractedGeneration) {
+      extractedGeneration = progressiveContours.generation();
+      contourExtractor.extract(*rhino, suggestiveContours);
+    }
+  }
+
+  void updateTemporalContours() {
+    temporalContours.update(*rhino, eyeInMeshFrame(), &rhinoRenderer);
+    if(temporalContours.staleVertexCount() > 0)
+      contourExtractor.extract(*rhino, suggestiveContours);
+  }
+
+  void startAsyncContours() {
+    contourWorker.start(*rhino);
+    rhino->resizeContourAttributes();
+    rhinoRenderer.init(*rhino);
+    asyncViewPosted = false;
+  }
+
+  // Prints the vertex closest to the surface point under the cursor
+  void pickVertex(GLFWwindow *window) {
+    double x, y;
+    glfwGetCursorPos(window, &x, &y);
+    const glm::vec4 viewport(0.f, 0.f, static_cast<float>(g_windowWidth), static_cast<float>(g_windowHeight));
+    RayHit hit;
+    if(!rhino->pick(glm::vec2(x, g_windowHeight - y), g_cam->computeViewMatrix()*rhinoMat, g_cam->computeProjectionMatrix(),
+                    viewport, hit)) {
+      std::cout << " > Nothing picked" << std::endl;
+      return;
+    }
+    const glm::uvec3 &tri = rhino->triangleIndices()[hit.triangle];
+    const float w[3] = {1.f - hit.u - hit.v, hit.u, hit.v};
+    const unsigned int v = tri[std::max_element(w, w + 3) - w];
+    const glm::vec3 &p = rhino->vertexPositions()[v];
+    std::cout << " > Picked triangle " << hit.triangle << ", vertex " << v << " at (" << p.x << ", " << p.y << ", " << p.z << ")";
+    if(v < rhino->radialCurvatures().size())
+      std::cout << ", radial curvature " << rhino->radialCurvatures()[v]
+                << (rhino->eligibleForSuggestiveContour()[v] ? " (eligible)" : "");
+    std::cout << std::endl;
+  }
+
+  // Renders the current view on the CPU, as the render farm does, and saves it as a PNG
+  void saveSoftwareSnapshot(const std::string &filename) {
+    std::vector<RasterLight> rasterLights;
+    for(const Light &light : lights)
+      rasterLights.push_back(RasterLight{light.position, light.color, light.intensity});
+    softwareRasterizer.setLights(rasterLights);
+    softwareRasterizer.render(*rhino, rhinoMat, g_cam->computeViewMatrix(), g_cam->computeProjectionMatrix(),
+                              g_cam->getPosition(), g_contourMode, g_windowWidth, g_windowHeight);
+    try {
+      savePNG(filename, softwareRasterizer.width(), softwareRasterizer.height(), softwareRasterizer.image());
+    } catch(std::exception &e) {
+      std::cerr << " > " << e.what() << std::endl;
+      return;
+    }
+    std::cout << " > CPU render saved to " << filename << " (vertices " << softwareRasterizer.vertexTime()
+              << " ms, binning " << softwareRasterizer.binningTime() << " ms, raster " << softwareRasterizer.rasterTime()
+              << " ms, shading " << softwareRasterizer.shadingTime() << " ms)" << std::endl;
+  }
+
+  // Posts the current view to the worker and picks up its latest completed results
+  void syncAsyncContours(unsigned long long frame) {
+    std::shared_ptr<Mesh> refined = contourWorker.takeGeometry();
+    if(refined) {
+      rhino = refined;
+      ++subdivisions;
+      rhinoRenderer.init(*rhino);
+      silhouetteTree.build(*rhino);
+      std::cout << " > Refined mesh received: " << rhino->vertexPositions().size() << " vertices" << std::endl;
+    }
+    const bool viewChanged = !asyncViewPosted || g_cam->getPosition() != asyncPostedCamera || rhinoMat != asyncPostedModelMat;
+    if(g_contourMode == 2 && viewChanged && contourWorker.postView(frame, g_cam->getPosition(), rhinoMat)) {
+      asyncViewPosted = true;
+      asyncPostedCamera = g_cam->getPosition();
+      asyncPostedModelMat = rhinoMat;
+    }
+    const ContourAttributes *attributes = contourWorker.fetchAttributes();
+    if(attributes && attributes->generation == contourWorker.generation()) {
+      rhino->setContourAttributes(attributes->radialCurvature, attributes->eligible);
+      const unsigned int vertexCount = static_cast<unsigned int>(attributes->radialCurvature.size());
+      rhinoRenderer.radialCurvatureChanged(*rhino, 0, vertexCount);
+      rhinoRenderer.eligibilityChanged(*rhino, 0, vertexCount);
+      suggestiveContours = attributes->polylines;
+      g_contourStaleness = frame - attributes->frame;
+      glfwSetWindowTitle(g_window, (WINDOW_TITLE + " [contours " + std::to_string(g_contourStaleness) + " frame(s) behind]").c_str());
+    }
+  }
+
+  void extractSilhouetteCenterMesh() {
+    silhouetteEdges.clear();
+    silhouetteTree.query(eyeInMeshFrame(), silhouetteEdges);
+  }
+
+  // The view-dependent quantities are computed in the frame of the mesh: bring the camera into it
+  glm::vec3 eyeInMeshFrame() const {
+    return glm::vec3(glm::inverse(rhinoMat)*glm::vec4(g_cam->getPosition(), 1.0));
   }
 };
 
@@ -169,10 +419,22 @@ void printHelp()
     "    * Left button: rotate camera" << std::endl <<
     "    * Middle button: zoom" << std::endl <<
     "    * Right button: pan camera" << std::endl <<
+    "    * Ctrl + left button: pick a vertex" << std::endl <<
     "    Keyboard commands:" << std::endl <<
     "    * H: print this help" << std::endl <<
+    "    * L: subdivide the mesh, unless the memory it needs is not available" << std::endl <<
+    "    * M: print the memory footprint of the mesh and the forecast of its next subdivision" << std::endl <<
     "    * T: toggle animation" << std::endl <<
     "    * F1: toggle wireframe/surface rendering" << std::endl <<
+    "    * F4: toggle progressive (time-budgeted) contour evaluation" << std::endl <<
+    "    * +/-: increase/decrease the progressive evaluation budget" << std::endl <<
+    "    * F5: toggle temporal-coherence (incremental) contour update" << std::endl <<
+    "    * F6: toggle asynchronous contour computation on a worker thread" << std::endl <<
+    "    * F7: toggle task-graph scheduling of the per-frame contour stages" << std::endl <<
+    "    * F8: print the critical-path report of the last task-graph frame" << std::endl <<
+    "    * F9: render the current view on the CPU into snapshot.png" << std::endl <<
+    "    * F10: toggle the occlusion culling of the task-graph contour stages" << std::endl <<
+    "    * F11: start/stop profiling; on stop, print the stage percentiles and save profile.json" << std::endl <<
     "    * ESC: quit the program" << std::endl;
 }
 
@@ -188,11 +450,26 @@ void windowSizeCallback(GLFWwindow *window, int width, int height)
 // Executed each time a key is entered.
 void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
 {
+  if(g_replayingP && !g_replayKeysP && key != GLFW_KEY_ESCAPE)
+    return;
+  if(!g_recordingFilename.empty() && action != GLFW_RELEASE && key != GLFW_KEY_ESCAPE)
+    g_recordedKeys.push_back(RecordedKey{key, action, mods});
+
   if(action == GLFW_PRESS && key == GLFW_KEY_H) {
     printHelp();
   } else if(action == GLFW_PRESS && key == GLFW_KEY_L) {
+    if(!g_scene.subdivisionFits())
+      return;
+    if(g_asyncMode) {
+      // Refined on the worker: the current mesh stays on screen until the result is received
+      if(!g_scene.contourWorker.postSubdivide())
+        std::cout << " > Worker busy, subdivision request dropped" << std::endl;
+      return;
+    }
     g_contourMode=0;
     g_scene.subdivideCenterMesh();
+  } else if(action == GLFW_PRESS && key == GLFW_KEY_M) {
+    g_scene.printMemoryFootprint();
   } else if(action == GLFW_PRESS && key == GLFW_KEY_T) {
     g_appTimerStoppedP = !g_appTimerStoppedP;
     if(!g_appTimerStoppedP)
@@ -213,6 +490,8 @@ void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
     else
     {
       g_contourMode=1;
+      g_scene.extractSilhouetteCenterMesh();
+      std::cout << " > " << g_scene.silhouetteEdges.size() << " silhouette edges" << std::endl;
     }
 } else if (action == GLFW_PRESS && key == GLFW_KEY_F3) {
     if(g_contourMode==2)
@@ -222,8 +501,81 @@ void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods
     else
     {
       g_contourMode=2;
-      g_scene.calculateRadialCurvatureCenterMesh();
+      if(g_progressiveMode || g_temporalCacheMode || g_asyncMode)
+        return; // evaluated over the next frames by update()
+      if(g_taskGraphMode)
+        g_scene.runContourTaskGraph();
+      else
+        g_scene.calculateRadialCurvatureCenterMesh();
+      std::cout << " > " << g_scene.suggestiveContours.size() << " suggestive contour polylines ("
+                << g_scene.contourExtractor.segmentCount() << " segments)" << std::endl;
+      if(g_taskGraphMode && g_occlusionCulling)
+        g_scene.printOcclusionCullingStats();
+    }
+} else if (action == GLFW_PRESS && key == GLFW_KEY_F4) {
+    g_progressiveMode = !g_progressiveMode;
+    g_temporalCacheMode = false;
+    g_asyncMode = false;
+    g_scene.contourWorker.stop();
+    if(g_progressiveMode)
+      g_scene.resetIncrementalContours();
+    std::cout << " > Progressive contour evaluation " << (g_progressiveMode ? "on" : "off")
+              << " (" << g_progressiveBudgetMs << " ms/frame)" << std::endl;
+} else if (action == GLFW_PRESS && key == GLFW_KEY_F5) {
+    g_temporalCacheMode = !g_temporalCacheMode;
+    g_progressiveMode = false;
+    g_asyncMode = false;
+    g_scene.contourWorker.stop();
+    if(g_temporalCacheMode)
+      g_scene.resetIncrementalContours();
+    std::cout << " > Temporal-coherence contour update " << (g_temporalCacheMode ? "on" : "off") << std::endl;
+} else if (action == GLFW_PRESS && key == GLFW_KEY_F6) {
+    g_asyncMode = !g_asyncMode;
+    g_progressiveMode = false;
+    g_temporalCacheMode = false;
+    if(g_asyncMode) {
+      g_scene.startAsyncContours();
+    } else {
+      g_scene.contourWorker.stop();
+      glfwSetWindowTitle(g_window, WINDOW_TITLE.c_str());
+    }
+    std::cout << " > Asynchronous contour computation " << (g_asyncMode ? "on" : "off") << std::endl;
+} else if (action == GLFW_PRESS && key == GLFW_KEY_F7) {
+    g_taskGraphMode = !g_taskGraphMode;
+    std::cout << " > Task-graph contour stages " << (g_taskGraphMode ? "on" : "off") << std::endl;
+} else if (action == GLFW_PRESS && key == GLFW_KEY_F8) {
+    if(g_scene.contourPipeline.graph().empty())
+      std::cout << " > No task graph run yet (F7, then F3)" << std::endl;
+    else
+      g_scene.contourPipeline.graph().report(std::cout);
+    if(g_scene.contourPipeline.occlusionCuller())
+      g_scene.printOcclusionCullingStats();
+} else if (action == GLFW_PRESS && key == GLFW_KEY_F9) {
+    g_scene.saveSoftwareSnapshot("snapshot.png");
+} else if (action == GLFW_PRESS && key == GLFW_KEY_F10) {
+    g_occlusionCulling = !g_occlusionCulling;
+    std::cout << " > Occlusion culling of the task-graph contour stages " << (g_occlusionCulling ? "on" : "off") << std::endl;
+} else if (action == GLFW_PRESS && key == GLFW_KEY_F11) {
+    if(!Profiler::enabled()) {
+      Profiler::clear();
+      Profiler::setEnabled(true);
+      std::cout << " > Profiling on" << std::endl;
+    } else {
+      Profiler::setEnabled(false);
+      Profiler::writeSummary(std::cout);
+      try {
+        Profiler::saveChromeTrace("profile.json");
+        std::cout << " > Chrome trace saved to profile.json" << std::endl;
+      } catch(std::exception &e) {
+        std::cerr << " > " << e.what() << std::endl;
+      }
     }
+} else if ((action == GLFW_PRESS || action == GLFW_REPEAT) && (key == GLFW_KEY_EQUAL || key == GLFW_KEY_KP_ADD)) {
+    g_progressiveBudgetMs += 1.f;
+    std::cout << " > Progressive budget: " << g_progressiveBudgetMs << " ms/frame" << std::endl;
+} else if ((action == GLFW_PRESS || action == GLFW_REPEAT) && (key == GLFW_KEY_MINUS || key == GLFW_KEY_KP_SUBTRACT)) {
+    g_progressiveBudgetMs = std::max(1.f, g_progressiveBudgetMs - 1.f);
+    std::cout << " > Progressive budget: " << g_progressiveBudgetMs << " ms/frame" << std::endl;
 } else if(action == GLFW_PRESS && key == GLFW_KEY_ESCAPE) {
     glfwSetWindowShouldClose(window, true); // Closes the application if the escape key is pressed
   }
@@ -250,7 +602,9 @@ void cursorPosCallback(GLFWwindow *window, double xpos, double ypos)
 // Called each time a mouse button is pressed
 void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods)
 {
-  if(button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
+  if(button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && (mods & GLFW_MOD_CONTROL)) {
+    g_scene.pickVertex(window);
+  } else if(button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS) {
     if(!g_rotatingP) {
       g_rotatingP = true;
       glfwGetCursorPos(window, &g_baseX, &g_baseY);
@@ -298,7 +652,7 @@ void initGLFW()
   glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
 
   // Create the window
-  g_window = glfwCreateWindow(g_windowWidth, g_windowHeight, "Suggestive Contouriing Implementation - Vincent Frippiat", nullptr, nullptr);
+  g_window = glfwCreateWindow(g_windowWidth, g_windowHeight, WINDOW_TITLE.c_str(), nullptr, nullptr);
   if(!g_window) {
     std::cerr << "ERROR: Failed to open window" << std::endl;
     glfwTerminate();
@@ -368,13 +722,19 @@ void initScene(const std::string &meshFilename)
   // Load meshes in the scene
   {
     g_scene.rhino = std::make_shared<Mesh>();
+    if(g_weldTolerance >= 0.f) {
+      MeshCleanupOptions cleanup;
+      cleanup.weldTolerance = g_weldTolerance;
+      g_scene.rhino->setCleanupOnLoad(true, cleanup);
+    }
     try {
       loadOFF(meshFilename, g_scene.rhino);
     } catch(std::exception &e) {
       exitOnCriticalError(std::string("[Error loading mesh]") + e.what());
     }
     g_scene.rhino->calculatePrincipalCurvature();
-    g_scene.rhino->init();
+    g_scene.rhinoRenderer.init(*g_scene.rhino);
+    g_scene.silhouetteTree.build(*g_scene.rhino);
   }
 
   // Setup lights
@@ -420,7 +780,9 @@ void init(const std::string &meshFilename)
 
 void clear()
 {
+  g_scene.contourWorker.stop();
   g_cam.reset();
+  g_scene.rhinoRenderer.clear();
   g_scene.rhino.reset();
   g_scene.mainShader.reset();
   glfwDestroyWindow(g_window);
@@ -433,6 +795,88 @@ void render()
   g_scene.render();
 }
 
+// Appends the keys, the camera, the model matrix and the modes of the current frame to the recording
+void recordFrame()
+{
+  RecordedFrame frame;
+  frame.keys.swap(g_recordedKeys);
+  frame.cameraPosition = g_cam->getPosition();
+  frame.cameraRotation = g_cam->getRotation();
+  frame.modelMat = g_scene.rhinoMat;
+  frame.contourMode = g_contourMode;
+  frame.subdivisions = g_scene.subdivisions;
+  frame.animating = !g_appTimerStoppedP || !g_appTimer2StoppedP;
+  frame.progressive = g_progressiveMode;
+  frame.temporalCache = g_temporalCacheMode;
+  frame.async = g_asyncMode;
+  frame.taskGraph = g_taskGraphMode;
+  frame.occlusionCulling = g_occlusionCulling;
+  frame.progressiveBudgetMs = g_progressiveBudgetMs;
+  g_recording.frames.push_back(frame);
+}
+
+void startRecording(const std::string &filename)
+{
+  g_recordingFilename = filename;
+  g_recording.width = g_windowWidth;
+  g_recording.height = g_windowHeight;
+  g_recording.fov = g_cam->getFov();
+  g_recording.nearPlane = g_cam->getNear();
+  g_recording.farPlane = g_cam->getFar();
+  std::cout << " > Recording the interaction into " << filename << std::endl;
+}
+
+void saveRecording()
+{
+  try {
+    saveInteractionRecording(g_recordingFilename, g_recording);
+    std::cout << " > " << g_recording.frames.size() << " frames recorded into " << g_recordingFilename << std::endl;
+  } catch(std::exception &e) {
+    std::cerr << " > " << e.what() << std::endl;
+  }
+}
+
+// Vsync is turned off, so that frames follow each other as fast as their stages run
+void startReplay(const std::string &filename)
+{
+  try {
+    loadInteractionRecording(filename, g_replay);
+  } catch(std::exception &e) {
+    exitOnCriticalError(std::string("[Error loading recording]") + e.what());
+  }
+  g_replayingP = true;
+  glfwSwapInterval(0);
+  glfwSetWindowSize(g_window, g_replay.width, g_replay.height);
+  g_windowWidth = g_replay.width;
+  g_windowHeight = g_replay.height;
+  g_cam->setAspectRatio(static_cast<float>(g_replay.width)/static_cast<float>(g_replay.height));
+  g_cam->setFoV(g_replay.fov);
+  g_cam->setNear(g_replay.nearPlane);
+  g_cam->setFar(g_replay.farPlane);
+  std::cout << " > Replaying " << g_replay.frames.size() << " frames of " << filename << " ("
+            << g_replay.frames.size()*g_replay.timestep << " s simulated)" << std::endl;
+}
+
+// Sets the camera and sends the keys of the current recorded frame
+void replayFrame()
+{
+  const RecordedFrame &frame = g_replay.frames[g_replayFrame];
+  g_replayKeysP = true;
+  for(const RecordedKey &k : frame.keys)
+    keyCallback(g_window, k.key, 0, k.action, k.mods);
+  g_replayKeysP = false;
+  g_cam->setPosition(frame.cameraPosition);
+  g_cam->setRotation(frame.cameraRotation);
+}
+
+// Milliseconds since start, which is moved to now
+double lapMs(std::chrono::steady_clock::time_point &start)
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const double ms = std::chrono::duration<double, std::milli>(now - start).count();
+  start = now;
+  return ms;
+}
 
 /**
  * This function has been heavily modified for the suggestive contouring project.
@@ -445,6 +889,7 @@ void render()
  */
 void update(float currentTime)
 {
+  ++g_frameIndex;
 
   // Update first timer (rotation about Y)
   if(!g_appTimerStoppedP) {
@@ -466,30 +911,122 @@ void update(float currentTime)
 
   // Combine the rotations (order matters—here Y is applied first, then X)
   g_scene.rhinoMat = rotY * rotX;
-
-  if (!g_appTimerStoppedP || !g_appTimer2StoppedP) {
-        g_scene.calculateRadialCurvatureCenterMesh();
+  if(g_replayingP)
+    g_scene.rhinoMat = g_replay.frames[g_replayFrame].modelMat; // whatever the clock of the T/Y keys
+
+  if (g_asyncMode) {
+        // The worker computes the contours: just exchange snapshots and results
+        g_scene.syncAsyncContours(g_frameIndex);
+    } else if (g_progressiveMode && g_contourMode == 2) {
+        // Spread the contour evaluation over frames: converges once the view settles
+        g_scene.stepProgressiveContours();
+    } else if (g_temporalCacheMode && g_contourMode == 2) {
+        // Recompute only where the view direction moved beyond the tolerance
+        g_scene.updateTemporalContours();
+    } else if (!g_appTimerStoppedP || !g_appTimer2StoppedP) {
+        if (g_taskGraphMode && g_contourMode == 2)
+          g_scene.runContourTaskGraph();
+        else
+          g_scene.calculateRadialCurvatureCenterMesh();
+        if (g_contourMode == 1)
+          g_scene.extractSilhouetteCenterMesh();
     }
+
+  if(!g_recordingFilename.empty())
+    recordFrame();
 }
 
 
 void usage(const char *command)
 {
-  std::cerr << "Usage : " << command << " [<file.off>]" << std::endl;
+  std::cerr << "Usage : " << command << " [-r <recording> | -p <recording> [-o <timings.csv>]] [-w <weld tolerance>] [<file.off>]" << std::endl;
   std::exit(EXIT_FAILURE);
 }
 
+/**
+ * This function has been modified for the suggestive contouring project.
+ *
+ * With -r, the camera, the model matrix and the keys of every frame are recorded into a file,
+ * saved on quit. With -p, such a file is replayed on the same mesh: one recorded frame per
+ * frame, at the recorded timestep of simulated time and without vsync, the user input being
+ * ignored. The CPU time of the frame stages is then printed, and saved per frame with -o.
+ * With -w, the mesh is cleaned up at load, see Mesh::cleanup().
+ */
 int main(int argc, char **argv)
 {
-  if(argc > 2) usage(argv[0]);
+  std::string meshFilename = DEFAULT_MESH_FILENAME, recordFilename, replayFilename, timingsFilename;
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    if(arg == "-r" && i + 1 < argc)
+      recordFilename = argv[++i];
+    else if(arg == "-p" && i + 1 < argc)
+      replayFilename = argv[++i];
+    else if(arg == "-o" && i + 1 < argc)
+      timingsFilename = argv[++i];
+    else if(arg == "-w" && i + 1 < argc)
+      g_weldTolerance = std::max(0.f, static_cast<float>(std::atof(argv[++i])));
+    else if(arg[0] == '-' || i + 1 != argc)
+      usage(argv[0]);
+    else
+      meshFilename = arg;
+  }
+  if(!recordFilename.empty() && !replayFilename.empty())
+    usage(argv[0]);
   // Your initialization code (user interface, OpenGL states, scene with geometry, material, lights, etc)
-  init(argc==1 ? DEFAULT_MESH_FILENAME : argv[1]);
-  while(!glfwWindowShouldClose(g_window)) {
-    update(static_cast<float>(glfwGetTime()));
-    render();
-    glfwSwapBuffers(g_window);
+  init(meshFilename);
+  if(!recordFilename.empty())
+    startRecording(recordFilename);
+  if(!replayFilename.empty())
+    startReplay(replayFilename);
+
+  FrameTimings timings({"update", "render", "swap buffers", "events"});
+  while(!glfwWindowShouldClose(g_window) && !(g_replayingP && g_replayFrame == g_replay.frames.size())) {
+    SC_PROFILE_SCOPE("frame");
+    if(g_replayingP)
+      timings.beginFrame();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+      SC_PROFILE_SCOPE("update");
+      if(g_replayingP) {
+        replayFrame();
+        update(static_cast<float>(g_replayFrame*g_replay.timestep));
+      } else {
+        update(static_cast<float>(glfwGetTime()));
+      }
+    }
+    const double updateMs = lapMs(start);
+    {
+      SC_PROFILE_SCOPE("render");
+      render();
+    }
+    const double renderMs = lapMs(start);
+    {
+      SC_PROFILE_SCOPE("swap buffers");
+      glfwSwapBuffers(g_window);
+    }
+    const double swapMs = lapMs(start);
     glfwPollEvents();
+    if(g_replayingP) {
+      timings.add(0, updateMs);
+      timings.add(1, renderMs);
+      timings.add(2, swapMs);
+      timings.add(3, lapMs(start));
+      ++g_replayFrame;
+    }
+  }
+  if(g_replayingP) {
+    timings.writeSummary(std::cout);
+    if(!timingsFilename.empty()) {
+      try {
+        timings.saveCSV(timingsFilename);
+        std::cout << " > Frame timings saved to " << timingsFilename << std::endl;
+      } catch(std::exception &e) {
+        std::cerr << " > " << e.what() << std::endl;
+      }
+    }
   }
+  if(!g_recordingFilename.empty())
+    saveRecording();
   clear();
   std::cout << " > Quit" << std::endl;
   return EXIT_SUCCESS;
@@ -0,0 +1,526 @@
+// ----------------------------------------------------------------------------
+// scbatch.cpp
+//
+// Headless batch extraction of suggestive contours over a camera path. Every
+// mesh is subdivided and its principal curvatures computed once, then the
+// contour pipeline runs for every view. Loading, computing and writing are
+// separate pipeline stages, several meshes being computed concurrently.
+//
+// Usage: scbatch [-s <subdivision levels>] [-p <camera path file> | -o <views>[,<elevation>[,<distance>]]]
+//                [-m polylines|eligibility] [-v] [-u] [-r <width>x<height> [-c shaded|silhouettes|contours]]
+//                [-j <meshes in flight>] [-t <threads>] [-d <output dir>] [-P <trace.json>] [-M]
+//                [-w <weld tolerance>] <file.off|file.obj> ...
+//
+// Camera path files hold one eye position "x y z" per line, in the frame of
+// the mesh ('#' starts a comment). An orbit turns around the vertical axis
+// through the center of the bounding sphere, at an elevation in degrees and a
+// distance in bounding radii (default: 36 views, 20 degrees, 3 radii).
+//
+// Each mesh gives <output dir>/<mesh name>.scb, in native byte order:
+//   char[4] "SCB1", uint32 mode (0: polylines, 1: eligibility),
+//   uint32 vertex count, uint32 triangle count, uint32 view count,
+//   then for every view: float eye[3], followed by
+//   - polylines:   uint32 polyline count, and for every polyline
+//                  uint32 point count, uint32 closed, float xyz[point count]
+//   - eligibility: (vertex count + 7)/8 bytes, bit v%8 of byte v/8 set if
+//                  vertex v is eligible for a suggestive contour
+// In eligibility mode, the meshes keep the vertex and triangle orders of their
+// files: vertex v is the v-th vertex of the file, and the vertices added by
+// subdivision follow those of the previous level. With -w, the indices are
+// those after welding and the removal of unreferenced vertices.
+// With -v, the polylines are cut where they are hidden by the mesh.
+//
+// With -u, the pipeline culls the vertex clusters hidden from the camera, which
+// looks at the center of the bounding sphere: the culled vertices are neither
+// eligible nor crossed by contours. The fraction culled is reported.
+//
+// With -r, every view is also rendered on the CPU in the given contour mode of
+// the viewer (default: contours), looking at the center of the bounding
+// sphere, and saved as <output dir>/<mesh name>_<view>.png.
+//
+// A subdivision level is refused, and the mesh processed at the previous one,
+// when the memory it needs (see Mesh::forecastSubdivision) is not available.
+// With -M, the memory footprint of every mesh is printed once computed, with
+// the forecast of its next subdivision.
+//
+// With -w, every mesh is cleaned up at load (see Mesh::cleanup): the vertices
+// closer than the tolerance, relative to the bounding box diagonal, are welded,
+// and the degenerate and duplicate triangles and the unreferenced vertices are
+// removed. The counts are printed by the loader.
+//
+// With -P, the profiling scopes are recorded (when built with SC_PROFILING):
+// their percentiles are printed at the end and the Chrome trace is saved to
+// the given file, to be opened in chrome://tracing or Perfetto.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ContourExtractor.h"
+#include "ContourPipeline.h"
+#include "Bvh.h"
+#include "MemoryFootprint.h"
+#include "Mesh.h"
+#include "OcclusionCuller.h"
+#include "PngWriter.h"
+#include "Profiler.h"
+#include "SoftwareRasterizer.h"
+#include "ThreadPool.h"
+
+namespace {
+
+enum class OutputMode : uint32_t { Polylines = 0, Eligibility = 1 };
+
+struct Options {
+  unsigned int levels = 0;
+  std::string pathFile;
+  unsigned int orbitViews = 36;
+  float orbitElevation = 20.f;  // degrees
+  float orbitDistance = 3.f;    // bounding radii
+  OutputMode mode = OutputMode::Polylines;
+  bool visibleOnly = false;
+  bool occlusionCulling = false;
+  unsigned int imageWidth = 0, imageHeight = 0; // no images if 0
+  int contourMode = 2;
+  unsigned int inFlight = 2;
+  unsigned int threads = 0;
+  std::string outputDir = ".";
+  std::string traceFile;
+  bool memoryReport = false;
+  float weldTolerance = -1.f;  // no cleanup if negative
+  std::vector<std::string> files;
+};
+
+// A mesh travelling through the stages
+struct Job {
+  std::string filename;
+  std::shared_ptr<Mesh> mesh;
+  std::string output;  // serialized results
+  std::vector<std::string> images;  // encoded PNGs, one per view
+  unsigned int views = 0;
+  double loadMs = 0.0, computeMs = 0.0;
+  double culledFraction = 0.0;  // mean over the views, with -u
+  std::string notes;  // refused subdivisions and memory footprint, printed by the write stage
+};
+
+// Bounded queue between two stages. pop() returns false once the queue is closed and drained.
+template <typename T>
+class StageQueue {
+public:
+  explicit StageQueue(size_t capacity) : _capacity(capacity) {}
+
+  void push(T item)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _notFull.wait(lock, [this]() { return _items.size() < _capacity; });
+    _items.push_back(std::move(item));
+    _notEmpty.notify_one();
+  }
+
+  bool pop(T &item)
+  {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _notEmpty.wait(lock, [this]() { return !_items.empty() || _closed; });
+    if(_items.empty())
+      return false;
+    item = std::move(_items.front());
+    _items.pop_front();
+    _notFull.notify_one();
+    return true;
+  }
+
+  void close()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _closed = true;
+    _notEmpty.notify_all();
+  }
+
+private:
+  size_t _capacity;
+  std::deque<T> _items;
+  bool _closed = false;
+  std::mutex _mutex;
+  std::condition_variable _notEmpty, _notFull;
+};
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool endsWith(const std::string &s, const std::string &suffix)
+{
+  return s.size() >= suffix.size() && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string baseName(const std::string &filename)
+{
+  const size_t slash = filename.find_last_of("/\\");
+  std::string name = (slash == std::string::npos) ? filename : filename.substr(slash + 1);
+  const size_t dot = name.find_last_of('.');
+  return (dot == std::string::npos) ? name : name.substr(0, dot);
+}
+
+std::vector<glm::vec3> readCameraPath(const std::string &filename)
+{
+  std::ifstream in(filename.c_str());
+  if(!in)
+    throw std::ios_base::failure("[scbatch] Cannot open camera path " + filename);
+  std::vector<glm::vec3> eyes;
+  std::string line;
+  while(std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream ss(line);
+    glm::vec3 eye;
+    if(ss >> eye.x >> eye.y >> eye.z)
+      eyes.push_back(eye);
+  }
+  return eyes;
+}
+
+std::vector<glm::vec3> orbit(const Mesh &mesh, const Options &options)
+{
+  glm::vec3 center;
+  float radius;
+  mesh.computeBoundingSphere(center, radius);
+  const float elevation = glm::radians(options.orbitElevation);
+  const float distance = options.orbitDistance*radius;
+  std::vector<glm::vec3> eyes(options.orbitViews);
+  for(unsigned int i = 0; i < options.orbitViews; ++i) {
+    const float azimuth = 2.f*glm::pi<float>()*i/options.orbitViews;
+    eyes[i] = center + distance*glm::vec3(std::cos(elevation)*std::sin(azimuth), std::sin(elevation),
+                                          std::cos(elevation)*std::cos(azimuth));
+  }
+  return eyes;
+}
+
+template <typename T>
+void append(std::string &out, const T &value)
+{
+  out.append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+void writeView(std::string &out, const Mesh &mesh, const glm::vec3 &eye, OutputMode mode,
+               const std::vector<ContourPolyline> &polylines)
+{
+  append(out, eye);
+  if(mode == OutputMode::Polylines) {
+    append(out, static_cast<uint32_t>(polylines.size()));
+    for(const ContourPolyline &polyline : polylines) {
+      append(out, static_cast<uint32_t>(polyline.points.size()));
+      append(out, static_cast<uint32_t>(polyline.closed));
+      out.append(reinterpret_cast<const char *>(polyline.points.data()), polyline.points.size()*sizeof(glm::vec3));
+    }
+  } else {
+    const std::vector<bool> &eligible = mesh.eligibleForSuggestiveContour();
+    std::string bits((eligible.size() + 7)/8, '\0');
+    for(size_t v = 0; v < eligible.size(); ++v)
+      if(eligible[v])
+        bits[v/8] |= static_cast<char>(1 << (v % 8));
+    out += bits;
+  }
+}
+
+// Compute stage: curvature once, then the contour pipeline for every view
+void compute(Job &job, const Options &options, const std::vector<glm::vec3> &path)
+{
+  const auto start = std::chrono::steady_clock::now();
+  Mesh &mesh = *job.mesh;
+  std::ostringstream notes;
+  notes << std::fixed << std::setprecision(1);
+  for(unsigned int l = 0; l < options.levels; ++l) {
+    MemoryFootprint footprint;
+    mesh.accountMemory(footprint);
+    // The forecast includes the curvature, computed once at the last level
+    const size_t needed = mesh.forecastSubdivision().additionalBytes(footprint.residentBytes());
+    const size_t available = availablePhysicalMemory();
+    if(available > 0 && needed > available) {
+      notes << " > Subdivision level " << l + 1 << " refused: it needs " << needed/1048576.0 << " MiB more, "
+            << available/1048576.0 << " MiB available" << std::endl;
+      break;
+    }
+    mesh.subdivideLoop();
+  }
+  mesh.calculatePrincipalCurvature();
+
+  const std::vector<glm::vec3> eyes = options.pathFile.empty() ? orbit(mesh, options) : path;
+  ContourExtractor extractor;
+  std::vector<ContourPolyline> polylines;
+  ContourPipeline pipeline;
+  OcclusionCuller culler;
+  if(options.occlusionCulling)
+    pipeline.setOcclusionCuller(&culler);
+  pipeline.reset(mesh, extractor, polylines);
+
+  job.output.assign("SCB1", 4);
+  append(job.output, static_cast<uint32_t>(options.mode));
+  append(job.output, static_cast<uint32_t>(mesh.vertexPositions().size()));
+  append(job.output, static_cast<uint32_t>(mesh.triangleIndices().size()));
+  append(job.output, static_cast<uint32_t>(eyes.size()));
+  SoftwareRasterizer rasterizer;
+  rasterizer.setLights({RasterLight{glm::vec3(100.f, 100.f, 100.f), glm::vec3(1.f, 1.f, 1.f), 0.5f},
+                        RasterLight{glm::vec3(100.f, 100.f, -100.f), glm::vec3(1.f, 1.f, 0.8f), 0.5f},
+                        RasterLight{glm::vec3(100.f, -100.f, 0.f), glm::vec3(1.f, 1.f, 0.8f), 0.5f}}); // the viewer's
+  glm::vec3 center;
+  float radius;
+  mesh.computeBoundingSphere(center, radius);
+  job.images.clear();
+  std::vector<ContourPolyline> visiblePolylines;
+  const float aspect = options.imageWidth > 0 ? static_cast<float>(options.imageWidth)/options.imageHeight : 1.f;
+  job.culledFraction = 0.0;
+  for(const glm::vec3 &eye : eyes) {
+    SC_PROFILE_SCOPE("scbatch view");
+    const glm::mat4 viewMat = glm::lookAt(eye, center, glm::vec3(0.f, 1.f, 0.f));
+    const glm::mat4 projMat = glm::perspective(glm::radians(45.f), aspect, radius/100.f, glm::distance(eye, center) + 2.f*radius);
+    pipeline.run(eye, projMat*viewMat);
+    if(options.occlusionCulling)
+      job.culledFraction += culler.culledFraction()/eyes.size();
+    if(options.visibleOnly && options.mode == OutputMode::Polylines) {
+      removeHiddenContours(*mesh.bvh(), eye, polylines, visiblePolylines);
+      writeView(job.output, mesh, eye, options.mode, visiblePolylines);
+    } else {
+      writeView(job.output, mesh, eye, options.mode, polylines);
+    }
+    if(options.imageWidth > 0) {
+      rasterizer.render(mesh, glm::mat4(1.f), viewMat, projMat, eye, options.contourMode, options.imageWidth, options.imageHeight);
+      job.images.push_back(encodePNG(rasterizer.width(), rasterizer.height(), rasterizer.image()));
+    }
+  }
+  job.views = static_cast<unsigned int>(eyes.size());
+  job.computeMs = elapsedMs(start);
+  if(options.memoryReport) {
+    MemoryFootprint footprint;
+    mesh.accountMemory(footprint);
+    notes << " > Memory footprint of " << baseName(job.filename) << ", " << mesh.vertexPositions().size()
+          << " vertices, " << mesh.triangleIndices().size() << " triangles:" << std::endl;
+    footprint.write(notes);
+    const SubdivisionForecast forecast = mesh.forecastSubdivision();
+    notes << std::fixed << std::setprecision(1) << " > Next subdivision: " << forecast.vertexCount << " vertices, "
+          << forecast.triangleCount << " triangles, mesh of " << forecast.residentBytes/1048576.0
+          << " MiB once done, " << forecast.peakBytes/1048576.0 << " MiB at the peak" << std::endl;
+  }
+  job.notes = notes.str();
+}
+
+bool parseArguments(int argc, char **argv, Options &options)
+{
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const bool hasValue = i + 1 < argc;
+    if(arg == "-s" && hasValue)
+      options.levels = static_cast<unsigned int>(std::atoi(argv[++i]));
+    else if(arg == "-p" && hasValue)
+      options.pathFile = argv[++i];
+    else if(arg == "-o" && hasValue) {
+      std::string spec(argv[++i]);
+      std::replace(spec.begin(), spec.end(), ',', ' ');
+      std::istringstream ss(spec);
+      ss >> options.orbitViews;
+      ss >> options.orbitElevation >> options.orbitDistance;
+      options.orbitViews = std::max(1u, options.orbitViews);
+    } else if(arg == "-m" && hasValue) {
+      const std::string mode(argv[++i]);
+      if(mode == "polylines")
+        options.mode = OutputMode::Polylines;
+      else if(mode == "eligibility")
+        options.mode = OutputMode::Eligibility;
+      else
+        return false;
+    } else if(arg == "-v")
+      options.visibleOnly = true;
+    else if(arg == "-u")
+      options.occlusionCulling = true;
+    else if(arg == "-r" && hasValue) {
+      const std::string size(argv[++i]);
+      const size_t x = size.find('x');
+      if(x == std::string::npos)
+        return false;
+      options.imageWidth = static_cast<unsigned int>(std::max(0, std::atoi(size.substr(0, x).c_str())));
+      options.imageHeight = static_cast<unsigned int>(std::max(0, std::atoi(size.substr(x + 1).c_str())));
+      if(options.imageWidth == 0 || options.imageHeight == 0)
+        return false;
+    } else if(arg == "-c" && hasValue) {
+      const std::string mode(argv[++i]);
+      if(mode == "shaded")
+        options.contourMode = 0;
+      else if(mode == "silhouettes")
+        options.contourMode = 1;
+      else if(mode == "contours")
+        options.contourMode = 2;
+      else
+        return false;
+    } else if(arg == "-j" && hasValue)
+      options.inFlight = std::max(1, std::atoi(argv[++i]));
+    else if(arg == "-t" && hasValue)
+      options.threads = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+    else if(arg == "-d" && hasValue)
+      options.outputDir = argv[++i];
+    else if(arg == "-P" && hasValue)
+      options.traceFile = argv[++i];
+    else if(arg == "-M")
+      options.memoryReport = true;
+    else if(arg == "-w" && hasValue) {
+      options.weldTolerance = static_cast<float>(std::atof(argv[++i]));
+      if(options.weldTolerance < 0.f)
+        return false;
+    }
+    else if(!arg.empty() && arg[0] == '-')
+      return false;
+    else
+      options.files.push_back(arg);
+  }
+  return !options.files.empty();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if(!parseArguments(argc, argv, options)) {
+    std::cerr << "Usage: " << argv[0] << " [-s <subdivision levels>] [-p <camera path file> | -o <views>[,<elevation>[,<distance>]]]"
+              << " [-m polylines|eligibility] [-v] [-u] [-r <width>x<height> [-c shaded|silhouettes|contours]] [-j <meshes in flight>] [-t <threads>] [-d <output dir>] [-P <trace.json>] [-M] [-w <weld tolerance>] <file.off|file.obj> ..."
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  ThreadPool::setThreadCount(options.threads);
+  Profiler::setEnabled(!options.traceFile.empty());
+
+  std::vector<glm::vec3> path;
+  if(!options.pathFile.empty()) {
+    try {
+      path = readCameraPath(options.pathFile);
+    } catch(std::exception &e) {
+      std::cerr << " > " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  StageQueue<std::shared_ptr<Job>> loaded(options.inFlight), computed(options.inFlight);
+  std::mutex reportMutex;
+  unsigned int failures = 0;
+  const auto start = std::chrono::steady_clock::now();
+
+  // Load stage
+  std::thread loader([&]() {
+    for(const std::string &filename : options.files) {
+      auto job = std::make_shared<Job>();
+      job->filename = filename;
+      job->mesh = std::make_shared<Mesh>();
+      if(options.mode == OutputMode::Eligibility) {
+        // The output is indexed by vertex: keep the indices of the file
+        job->mesh->setVertexOrder(VertexOrder::File);
+        job->mesh->setTriangleOrder(TriangleOrder::File);
+      }
+      if(options.weldTolerance >= 0.f) {
+        MeshCleanupOptions cleanup;
+        cleanup.weldTolerance = options.weldTolerance;
+        job->mesh->setCleanupOnLoad(true, cleanup);
+      }
+      const auto loadStart = std::chrono::steady_clock::now();
+      try {
+        if(endsWith(filename, ".obj"))
+          loadOBJ(filename, job->mesh);
+        else
+          loadOFF(filename, job->mesh);
+      } catch(std::exception &e) {
+        std::lock_guard<std::mutex> lock(reportMutex);
+        std::cerr << " > [Error loading mesh]" << e.what() << std::endl;
+        ++failures;
+        continue;
+      }
+      job->loadMs = elapsedMs(loadStart);
+      loaded.push(job);
+    }
+    loaded.close();
+  });
+
+  // Compute stage: several meshes in flight, their kernels sharing the thread pool
+  std::vector<std::thread> computers;
+  for(unsigned int i = 0; i < options.inFlight; ++i)
+    computers.emplace_back([&]() {
+      std::shared_ptr<Job> job;
+      while(loaded.pop(job)) {
+        compute(*job, options, path);
+        job->mesh.reset();  // only the results travel further
+        computed.push(job);
+      }
+    });
+
+  // Write stage, on this thread
+  std::thread closer([&]() {
+    for(std::thread &computer : computers)
+      computer.join();
+    computed.close();
+  });
+  unsigned int meshes = 0;
+  unsigned long long views = 0;
+  double loadMs = 0.0, computeMs = 0.0, writeMs = 0.0;
+  std::shared_ptr<Job> job;
+  while(computed.pop(job)) {
+    const auto writeStart = std::chrono::steady_clock::now();
+    const std::string outName = options.outputDir + "/" + baseName(job->filename) + ".scb";
+    std::ofstream out(outName.c_str(), std::ios::binary);
+    out.write(job->output.data(), static_cast<std::streamsize>(job->output.size()));
+    if(!out) {
+      std::lock_guard<std::mutex> lock(reportMutex);
+      std::cerr << " > [Error writing]" << outName << std::endl;
+      ++failures;
+      continue;
+    }
+    out.close();
+    for(size_t v = 0; v < job->images.size(); ++v) {
+      std::ostringstream imageName;
+      imageName << options.outputDir << "/" << baseName(job->filename) << "_" << std::setw(4) << std::setfill('0') << v << ".png";
+      std::ofstream image(imageName.str().c_str(), std::ios::binary);
+      image.write(job->images[v].data(), static_cast<std::streamsize>(job->images[v].size()));
+    }
+    writeMs += elapsedMs(writeStart);
+    ++meshes;
+    views += job->views;
+    loadMs += job->loadMs;
+    computeMs += job->computeMs;
+    std::lock_guard<std::mutex> lock(reportMutex);
+    std::cout << " > " << outName << ": " << job->views << " views, " << job->output.size() << " bytes, "
+              << std::fixed << std::setprecision(1) << job->computeMs << " ms";
+    if(options.occlusionCulling)
+      std::cout << ", " << 100.0*job->culledFraction << "% of the vertices culled";
+    std::cout << std::endl << job->notes;
+  }
+  closer.join();
+  loader.join();
+
+  const double seconds = elapsedMs(start)/1000.0;
+  std::cout << std::fixed << std::setprecision(2) << " > " << meshes << " meshes, " << views << " views in "
+            << seconds << " s: " << meshes/seconds << " meshes/s, " << views/seconds << " views/s" << std::endl;
+  std::cout << std::setprecision(1) << " > Stage time: load " << loadMs << " ms, compute " << computeMs
+            << " ms, write " << writeMs << " ms (" << ThreadPool::threadCount() << " threads, "
+            << options.inFlight << " meshes in flight)" << std::endl;
+  if(!options.traceFile.empty()) {
+    Profiler::setEnabled(false);
+    Profiler::writeSummary(std::cout);
+    try {
+      Profiler::saveChromeTrace(options.traceFile);
+    } catch(std::exception &e) {
+      std::cerr << " > " << e.what() << std::endl;
+      ++failures;
+    }
+  }
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
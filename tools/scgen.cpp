@@ -0,0 +1,174 @@
+// ----------------------------------------------------------------------------
+// scgen.cpp
+//
+// Procedural test meshes of any size, see SyntheticMesh.h.
+//
+// Usage: scgen [-n <triangles>] [-r <radius>] [-m <minor radius>] [-a <amplitude>]
+//              [-f <frequency>] [-k <octaves>] [-e <seed>] [-i <tiled mesh>]
+//              [-g <ground truth file>] [-t <threads>]
+//              icosphere|torus|noisy-sphere|terrain|tiling <output.off>
+//
+// The number of triangles (default 100k, 1e6 notation accepted) is rounded to
+// the grid of the shape; a tiling makes as many copies of the -i mesh as needed
+// to reach it. The same parameters always give the same file, whatever the
+// number of threads.
+//
+// With -g, the exact principal curvatures and directions of an icosphere or a
+// torus are saved, one line per vertex in the order of the saved mesh:
+//   kappa1 kappa2 d1x d1y d1z d2x d2y d2z
+// Loading the saved mesh keeps this order, the vertices being already sorted.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "Mesh.h"
+#include "SyntheticMesh.h"
+#include "ThreadPool.h"
+
+namespace {
+
+struct Options {
+  SyntheticMeshParameters parameters;
+  std::string sourceFile;
+  std::string truthFile;
+  std::string output;
+  unsigned int threads = 0;
+};
+
+double elapsedMs(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool parseShape(const std::string &name, SyntheticShape &shape)
+{
+  for(SyntheticShape s : {SyntheticShape::Icosphere, SyntheticShape::Torus, SyntheticShape::NoisySphere,
+                          SyntheticShape::Terrain, SyntheticShape::Tiling})
+    if(name == syntheticShapeName(s)) {
+      shape = s;
+      return true;
+    }
+  return false;
+}
+
+bool parseArguments(int argc, char **argv, Options &options)
+{
+  SyntheticMeshParameters &p = options.parameters;
+  std::vector<std::string> positional;
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const bool hasValue = i + 1 < argc;
+    if(arg == "-n" && hasValue)
+      p.triangles = static_cast<size_t>(std::max(1.0, std::atof(argv[++i])));
+    else if(arg == "-r" && hasValue)
+      p.radius = static_cast<float>(std::atof(argv[++i]));
+    else if(arg == "-m" && hasValue)
+      p.minorRadius = static_cast<float>(std::atof(argv[++i]));
+    else if(arg == "-a" && hasValue)
+      p.amplitude = static_cast<float>(std::atof(argv[++i]));
+    else if(arg == "-f" && hasValue)
+      p.frequency = static_cast<float>(std::atof(argv[++i]));
+    else if(arg == "-k" && hasValue)
+      p.octaves = static_cast<unsigned int>(std::max(1, std::atoi(argv[++i])));
+    else if(arg == "-e" && hasValue)
+      p.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    else if(arg == "-i" && hasValue)
+      options.sourceFile = argv[++i];
+    else if(arg == "-g" && hasValue)
+      options.truthFile = argv[++i];
+    else if(arg == "-t" && hasValue)
+      options.threads = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+    else if(!arg.empty() && arg[0] == '-')
+      return false;
+    else
+      positional.push_back(arg);
+  }
+  if(positional.size() != 2 || !parseShape(positional[0], p.shape))
+    return false;
+  options.output = positional[1];
+  if(p.shape == SyntheticShape::Tiling && options.sourceFile.empty())
+    return false;
+  if(p.shape == SyntheticShape::Torus && !(p.minorRadius > 0.f && p.minorRadius < p.radius))
+    return false;
+  return p.radius > 0.f;
+}
+
+void saveGroundTruth(const std::string &filename, const CurvatureGroundTruth &truth)
+{
+  std::ofstream out(filename.c_str());
+  if(!out)
+    throw std::ios_base::failure("[scgen] Cannot open " + filename);
+  char line[256];
+  for(size_t v = 0; v < truth.kappa1.size(); ++v) {
+    const glm::vec3 &d1 = truth.direction1[v], &d2 = truth.direction2[v];
+    out.write(line, std::snprintf(line, sizeof(line), "%.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g\n", truth.kappa1[v],
+                                  truth.kappa2[v], d1.x, d1.y, d1.z, d2.x, d2.y, d2.z));
+  }
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if(!parseArguments(argc, argv, options)) {
+    std::cerr << "Usage: " << argv[0] << " [-n <triangles>] [-r <radius>] [-m <minor radius>] [-a <amplitude>]"
+              << " [-f <frequency>] [-k <octaves>] [-e <seed>] [-i <tiled mesh>] [-g <ground truth file>] [-t <threads>]"
+              << " icosphere|torus|noisy-sphere|terrain|tiling <output.off>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  ThreadPool::setThreadCount(options.threads);
+  SyntheticMeshParameters &parameters = options.parameters;
+
+  auto source = std::make_shared<Mesh>();
+  if(!options.sourceFile.empty()) {
+    try {
+      if(options.sourceFile.size() >= 4 && options.sourceFile.compare(options.sourceFile.size() - 4, 4, ".obj") == 0)
+        loadOBJ(options.sourceFile, source);
+      else
+        loadOFF(options.sourceFile, source);
+    } catch(std::exception &e) {
+      std::cerr << " > [Error loading mesh]" << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    parameters.source = source.get();
+  }
+
+  Mesh mesh;
+  auto start = std::chrono::steady_clock::now();
+  generateSyntheticMesh(parameters, mesh);
+  const double generateMs = elapsedMs(start);
+  std::cout << " > " << syntheticShapeName(parameters.shape) << ": " << mesh.vertexPositions().size() << " vertices, "
+            << mesh.triangleIndices().size() << " triangles in " << std::fixed << std::setprecision(1) << generateMs
+            << " ms (" << ThreadPool::threadCount() << " threads)" << std::endl;
+
+  try {
+    start = std::chrono::steady_clock::now();
+    saveOFF(options.output, mesh);
+    std::cout << " > Saved to " << options.output << " in " << elapsedMs(start) << " ms" << std::endl;
+    if(!options.truthFile.empty()) {
+      if(!hasCurvatureGroundTruth(parameters.shape)) {
+        std::cerr << " > No curvature ground truth for a " << syntheticShapeName(parameters.shape) << std::endl;
+        return EXIT_FAILURE;
+      }
+      CurvatureGroundTruth truth;
+      computeCurvatureGroundTruth(parameters, mesh, truth);
+      saveGroundTruth(options.truthFile, truth);
+      std::cout << " > Curvature ground truth saved to " << options.truthFile << std::endl;
+    }
+  } catch(std::exception &e) {
+    std::cerr << " > " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
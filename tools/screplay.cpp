@@ -0,0 +1,261 @@
+// ----------------------------------------------------------------------------
+// screplay.cpp
+//
+// Headless replay of an interaction recorded by the viewer (tpSubdiv -r, see
+// InteractionRecording.h), to compare frame times before and after a change
+// on a machine without a display.
+//
+// Usage: screplay [-n] [-o <timings.csv>] [-t <threads>] [-P <trace.json>]
+//                 <file.off|file.obj> <recording>
+//
+// The mesh must be the one the interaction was recorded on. Every recorded
+// frame runs the CPU work of the viewer's frame: the subdivisions, the contour
+// attributes and polylines in the recorded mode (full, task graph, progressive
+// or temporal cache), the silhouette query, and the rendering of the view by
+// the software rasterizer at the recorded viewport (skipped with -n). The
+// asynchronous mode is replayed synchronously: the contours are computed on
+// every frame whose view changed.
+//
+// The CPU time of every stage is printed as percentiles over the frames, and
+// saved frame by frame with -o. With -P, the profiling scopes are recorded
+// (when built with SC_PROFILING) and saved as a Chrome trace.
+// ----------------------------------------------------------------------------
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include "Camera.h"
+#include "ContourExtractor.h"
+#include "ContourPipeline.h"
+#include "InteractionRecording.h"
+#include "Mesh.h"
+#include "OcclusionCuller.h"
+#include "Profiler.h"
+#include "ProgressiveContour.h"
+#include "SilhouetteTree.h"
+#include "SoftwareRasterizer.h"
+#include "TemporalContourCache.h"
+#include "ThreadPool.h"
+
+namespace {
+
+enum Stage { kSubdivision, kContours, kSilhouettes, kRender };
+
+struct Options {
+  bool render = true;
+  std::string timingsFile;
+  unsigned int threads = 0;
+  std::string traceFile;
+  std::string meshFile;
+  std::string recordingFile;
+};
+
+// Milliseconds since start, which is moved to now
+double lapMs(std::chrono::steady_clock::time_point &start)
+{
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  const double ms = std::chrono::duration<double, std::milli>(now - start).count();
+  start = now;
+  return ms;
+}
+
+bool parseArguments(int argc, char **argv, Options &options)
+{
+  std::vector<std::string> positional;
+  for(int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    const bool hasValue = i + 1 < argc;
+    if(arg == "-n")
+      options.render = false;
+    else if(arg == "-o" && hasValue)
+      options.timingsFile = argv[++i];
+    else if(arg == "-t" && hasValue)
+      options.threads = static_cast<unsigned int>(std::max(0, std::atoi(argv[++i])));
+    else if(arg == "-P" && hasValue)
+      options.traceFile = argv[++i];
+    else if(!arg.empty() && arg[0] == '-')
+      return false;
+    else
+      positional.push_back(arg);
+  }
+  if(positional.size() != 2)
+    return false;
+  options.meshFile = positional[0];
+  options.recordingFile = positional[1];
+  return true;
+}
+
+// The contour state of the viewer (Scene in main.cpp), without the GPU buffers
+struct Viewer {
+  std::shared_ptr<Mesh> mesh = std::make_shared<Mesh>();
+  unsigned int subdivisions = 0;
+  SilhouetteTree silhouetteTree;
+  std::vector<SilhouetteEdge> silhouetteEdges;
+  ContourExtractor contourExtractor;
+  std::vector<ContourPolyline> suggestiveContours;
+  ContourPipeline contourPipeline;
+  OcclusionCuller occlusionCuller;
+  ProgressiveContourEvaluator progressiveContours;
+  unsigned int extractedGeneration = 0;
+  TemporalContourCache temporalContours;
+
+  void resetIncrementalContours() {
+    mesh->resizeContourAttributes();
+    progressiveContours.reset(*mesh);
+    extractedGeneration = progressiveContours.generation();
+    temporalContours.reset(*mesh);
+  }
+
+  // Radial curvature, eligibility and polylines of the whole mesh, as by the F3 key
+  void computeContours(const RecordedFrame &frame, const glm::vec3 &eye, const glm::mat4 &mvp) {
+    if(frame.taskGraph && frame.contourMode == 2) {
+      if(!contourPipeline.ready(*mesh) || (contourPipeline.occlusionCuller() != nullptr) != frame.occlusionCulling) {
+        contourPipeline.setOcclusionCuller(frame.occlusionCulling ? &occlusionCuller : nullptr);
+        contourPipeline.reset(*mesh, contourExtractor, suggestiveContours);
+      }
+      contourPipeline.run(eye, mvp);
+    } else {
+      mesh->calculateRadialCurvature(eye);
+      contourExtractor.extract(*mesh, suggestiveContours);
+    }
+  }
+
+  // The contour work of update() in main.cpp, preceded by that of the keys of the frame
+  void updateContours(const RecordedFrame &frame, const RecordedFrame &previous, const glm::vec3 &eye,
+                      const glm::vec3 &previousEye, const glm::mat4 &mvp) {
+    const bool modeChanged = frame.contourMode != previous.contourMode;
+    const bool suggestive = frame.contourMode == 2;
+    if(suggestive && modeChanged && !frame.progressive && !frame.temporalCache && !frame.async)
+      computeContours(frame, eye, mvp);
+    if(frame.async) {
+      if(suggestive && (modeChanged || eye != previousEye))
+        computeContours(frame, eye, mvp);
+    } else if(frame.progressive && suggestive) {
+      progressiveContours.setBudget(frame.progressiveBudgetMs);
+      progressiveContours.step(*mesh, eye, mvp);
+      if(progressiveContours.generation() != extractedGeneration) {
+        extractedGeneration = progressiveContours.generation();
+        contourExtractor.extract(*mesh, suggestiveContours);
+      }
+    } else if(frame.temporalCache && suggestive) {
+      temporalContours.update(*mesh, eye);
+      if(temporalContours.staleVertexCount() > 0)
+        contourExtractor.extract(*mesh, suggestiveContours);
+    } else if(frame.animating) {
+      computeContours(frame, eye, mvp);
+    }
+  }
+
+  void updateSilhouettes(const RecordedFrame &frame, const RecordedFrame &previous, const glm::vec3 &eye) {
+    const bool incremental = frame.async || ((frame.progressive || frame.temporalCache) && frame.contourMode == 2);
+    if(frame.contourMode == 1 && (frame.contourMode != previous.contourMode || (frame.animating && !incremental))) {
+      silhouetteEdges.clear();
+      silhouetteTree.query(eye, silhouetteEdges);
+    }
+  }
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+  Options options;
+  if(!parseArguments(argc, argv, options)) {
+    std::cerr << "Usage: " << argv[0] << " [-n] [-o <timings.csv>] [-t <threads>] [-P <trace.json>]"
+              << " <file.off|file.obj> <recording>" << std::endl;
+    return EXIT_FAILURE;
+  }
+  ThreadPool::setThreadCount(options.threads);
+
+  InteractionRecording recording;
+  Viewer viewer;
+  try {
+    loadInteractionRecording(options.recordingFile, recording);
+    if(options.meshFile.size() >= 4 && options.meshFile.compare(options.meshFile.size() - 4, 4, ".obj") == 0)
+      loadOBJ(options.meshFile, viewer.mesh);
+    else
+      loadOFF(options.meshFile, viewer.mesh);
+  } catch(std::exception &e) {
+    std::cerr << " > " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  viewer.mesh->calculatePrincipalCurvature();
+  viewer.silhouetteTree.build(*viewer.mesh);
+
+  Camera cam;
+  cam.setAspectRatio(static_cast<float>(recording.width)/static_cast<float>(recording.height));
+  cam.setFoV(recording.fov);
+  cam.setNear(recording.nearPlane);
+  cam.setFar(recording.farPlane);
+  SoftwareRasterizer rasterizer;
+  rasterizer.setLights({RasterLight{glm::vec3(100.f, 100.f, 100.f), glm::vec3(1.f, 1.f, 1.f), 0.5f},
+                        RasterLight{glm::vec3(100.f, 100.f, -100.f), glm::vec3(1.f, 1.f, 0.8f), 0.5f},
+                        RasterLight{glm::vec3(100.f, -100.f, 0.f), glm::vec3(1.f, 1.f, 0.8f), 0.5f}}); // the viewer's
+
+  std::cout << " > Replaying " << recording.frames.size() << " frames (" << recording.frames.size()*recording.timestep
+            << " s simulated) on " << viewer.mesh->vertexPositions().size() << " vertices, "
+            << ThreadPool::threadCount() << " threads" << std::endl;
+  Profiler::setEnabled(!options.traceFile.empty());
+  FrameTimings timings({"subdivision", "contours", "silhouettes", "render"});
+  RecordedFrame previous;
+  glm::vec3 previousEye(0.f);
+  std::chrono::steady_clock::time_point replayStart = std::chrono::steady_clock::now();
+  for(const RecordedFrame &frame : recording.frames) {
+    SC_PROFILE_SCOPE("screplay frame");
+    timings.beginFrame();
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const bool geometryChanged = viewer.subdivisions < frame.subdivisions;
+    for(; viewer.subdivisions < frame.subdivisions; ++viewer.subdivisions) {
+      viewer.mesh->subdivideLoop();
+      viewer.mesh->calculatePrincipalCurvature();
+      viewer.silhouetteTree.build(*viewer.mesh);
+    }
+    if((frame.progressive && (geometryChanged || !previous.progressive)) ||
+       (frame.temporalCache && (geometryChanged || !previous.temporalCache)))
+      viewer.resetIncrementalContours();
+    timings.add(kSubdivision, lapMs(start));
+
+    cam.setPosition(frame.cameraPosition);
+    cam.setRotation(frame.cameraRotation);
+    const glm::mat4 viewMat = cam.computeViewMatrix(), projMat = cam.computeProjectionMatrix();
+    const glm::vec3 eye = glm::vec3(glm::inverse(frame.modelMat)*glm::vec4(frame.cameraPosition, 1.f));
+    viewer.updateContours(frame, previous, eye, previousEye, projMat*viewMat*frame.modelMat);
+    timings.add(kContours, lapMs(start));
+    viewer.updateSilhouettes(frame, previous, eye);
+    timings.add(kSilhouettes, lapMs(start));
+    if(options.render)
+      rasterizer.render(*viewer.mesh, frame.modelMat, viewMat, projMat, frame.cameraPosition, frame.contourMode,
+                        static_cast<unsigned int>(recording.width), static_cast<unsigned int>(recording.height));
+    timings.add(kRender, lapMs(start));
+    previous = frame;
+    previousEye = eye;
+  }
+  const double replayMs = lapMs(replayStart);
+
+  timings.writeSummary(std::cout);
+  std::cout << " > Replayed in " << replayMs << " ms" << std::endl;
+  try {
+    if(!options.timingsFile.empty()) {
+      timings.saveCSV(options.timingsFile);
+      std::cout << " > Frame timings saved to " << options.timingsFile << std::endl;
+    }
+    if(!options.traceFile.empty()) {
+      Profiler::setEnabled(false);
+      Profiler::writeSummary(std::cout);
+      Profiler::saveChromeTrace(options.traceFile);
+      std::cout << " > Chrome trace saved to " << options.traceFile << std::endl;
+    }
+  } catch(std::exception &e) {
+    std::cerr << " > " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}